@@ -72,6 +72,7 @@
   emcAxisDeactivate(int axis);
   emcAxisSetMaxVelocity(int axis, double vel);
   emcAxisSetMaxAcceleration(int axis, double acc);
+  emcAxisSetMaxJerk(int axis, double jerk);
   emcAxisLoadComp(int axis, const char * file);
   emcAxisLoadComp(int axis, const char * file);
   */
@@ -98,6 +99,7 @@ static int loadAxis(int axis, EmcIniFile *axisIniFile)
     int comp_file_type; //type for the compensation file. type==0 means nom, forw, rev. 
     double maxVelocity;
     double maxAcceleration;
+    double maxJerk;
     double ferror;
 
     // compose string to match, axis = 0 -> AXIS_0, etc.
@@ -242,6 +244,16 @@ static int loadAxis(int axis, EmcIniFile *axisIniFile)
             return -1;
         }
 
+        maxJerk = 0.0;
+        axisIniFile->Find(&maxJerk, "MAX_JERK", axisString);
+
+        if (0 != emcAxisSetMaxJerk(axis, maxJerk)) {
+            if (emc_debug & EMC_DEBUG_CONFIG) {
+                rcs_print_error("bad return from emcAxisSetMaxJerk\n");
+            }
+            return -1;
+        }
+
         comp_file_type = 0;             // default
         axisIniFile->Find(&comp_file_type, "COMP_FILE_TYPE", axisString);
 
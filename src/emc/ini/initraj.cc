@@ -38,6 +38,9 @@
   DEFAULT_VELOCITY <float>      default velocity
   MAX_VELOCITY <float>          max velocity
   MAX_ACCELERATION <float>      max acceleration
+  MAX_JERK <float>              max jerk, 0 for trapezoidal velocity
+  VOLUMETRIC_COMP_FILE <file>   X, Y, Z error table over X, Y, Z
+  VOLUMETRIC_COMP_MAX_VEL <float> how fast the correction may change
   DEFAULT_ACCELERATION <float>  default acceleration
   HOME <float> ...              world coords of home, in X Y Z R P W
 
@@ -50,6 +53,8 @@
   emcTrajSetAcceleration(double acc);
   emcTrajSetMaxVelocity(double vel);
   emcTrajSetMaxAcceleration(double acc);
+  emcTrajSetMaxJerk(double jerk);
+  emcTrajLoadVolComp(const char *file, double maxVel);
   emcTrajSetHome(EmcPose home);
   */
 
@@ -60,6 +65,8 @@ static int loadTraj(EmcIniFile *trajInifile)
     EmcAngularUnits angularUnits;
     double vel;
     double acc;
+    double jerk;
+    double volCompVel;
     unsigned char coordinateMark[6] = { 1, 1, 1, 0, 0, 0 };
     int t;
     int len;
@@ -155,6 +162,28 @@ static int loadTraj(EmcIniFile *trajInifile)
             }
             return -1;
         }
+
+        jerk = 0.0; // no jerk limit
+        trajInifile->Find(&jerk, "MAX_JERK", "TRAJ");
+
+        if (0 != emcTrajSetMaxJerk(jerk)) {
+            if (emc_debug & EMC_DEBUG_CONFIG) {
+                rcs_print("bad return value from emcTrajSetMaxJerk\n");
+            }
+            return -1;
+        }
+
+        if (NULL != (inistring = trajInifile->Find("VOLUMETRIC_COMP_FILE", "TRAJ"))) {
+            volCompVel = 1.0;
+            trajInifile->Find(&volCompVel, "VOLUMETRIC_COMP_MAX_VEL", "TRAJ");
+
+            if (0 != emcTrajLoadVolComp(inistring, volCompVel)) {
+                if (emc_debug & EMC_DEBUG_CONFIG) {
+                    rcs_print("bad return value from emcTrajLoadVolComp\n");
+                }
+                return -1;
+            }
+        }
     }
 
     catch(EmcIniFile::Exception &e){
@@ -72,9 +72,11 @@ typedef struct {
     double target;          // segment length
     double reqvel;          // vel requested by F word, calc'd by task
     double maxaccel;        // accel calc'd by task
+    double maxjerk;         // jerk limit, 0 for none (trapezoidal velocity)
     double feed_override;   // feed override requested by user
     double maxvel;          // max possible vel (feed override stops here)
     double currentvel;      // keep track of current step (vel * cycle_time)
+    double currentacc;      // acceleration over the last cycle
     
     int id;                 // segment's serial number
 
@@ -99,6 +101,10 @@ typedef struct {
     int velocity_mode;	    // TRUE if spindle sync is in velocity mode, FALSE if in position mode
     double uu_per_rev;      // for sync, user units per rev (e.g. 0.0625 for 16tpi)
     double vel_at_blend_start;
+    double finalvel;        // set by the look-ahead: fastest we may still be
+                            // going at the end of this segment
+    int chain_with_next;    // set by the look-ahead: the next segment picks
+                            // up our velocity at the end instead of blending
     int sync_accel;         // we're accelerating up to sync with the spindle
     unsigned char enables;  // Feed scale, etc, enable bits for this move
     char atspeed;           // wait for the spindle to be at-speed before starting this move
@@ -0,0 +1,222 @@
+/********************************************************************
+* Description:  test_tp_jerk.c
+*               Runs tpRunCycle in userspace with a jerk limit set and
+*               checks the peak jerk of the commanded path and the time
+*               moves take: stop to stop, blended, and through pause,
+*               resume and abort.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "rtapi.h"
+#include "posemath.h"
+#include "tc.h"
+#include "tp.h"
+#include "motion.h"
+#include "motion_types.h"
+#include "hal.h"
+#include "mot_priv.h"
+#include "motion_debug.h"
+#include "tests/unittest.h"
+
+#define CYCLE_TIME 0.001
+#define FEED 100.0		/* mm/s */
+#define MAXVEL 200.0
+#define ACCEL 1000.0
+#define JERK 20000.0
+#define TOLERANCE 0.01
+
+static TP_STRUCT tp;
+
+/* path derivatives from the last four commanded positions */
+static struct {
+    EmcPose pos[4];
+    int n;
+    double vel, accel, jerk;	/* peaks */
+} trace;
+
+static void setup(double jerk)
+{
+    EmcPose home;
+
+    memset(emcmotStatus, 0, sizeof(*emcmotStatus));
+    emcmotStatus->net_feed_scale = 1.0;
+    memset(emcmotDebug, 0, sizeof(*emcmotDebug));
+
+    tpCreate(&tp, DEFAULT_TC_QUEUE_SIZE, emcmotDebug->queueTcSpace);
+    tpSetCycleTime(&tp, CYCLE_TIME);
+    tpSetVmax(&tp, FEED, MAXVEL);
+    tpSetVlimit(&tp, MAXVEL);
+    tpSetAmax(&tp, ACCEL);
+    tpSetJmax(&tp, jerk);
+    tpSetTermCond(&tp, TC_TERM_COND_STOP, 0.0);
+    memset(&home, 0, sizeof(home));
+    tpSetPos(&tp, home);
+
+    memset(&trace, 0, sizeof(trace));
+}
+
+static void line(double x, double y)
+{
+    EmcPose end;
+
+    memset(&end, 0, sizeof(end));
+    end.tran.x = x;
+    end.tran.y = y;
+    tpAddLine(&tp, end, EMC_MOTION_TYPE_FEED, FEED, MAXVEL, ACCEL, 0, 0, -1);
+}
+
+static double diff(int n, int k)
+{
+    PmCartesian d;
+    double mag;
+
+    /* n-th difference ending k back in the history */
+    if (n == 1) {
+	pmCartCartSub(trace.pos[k].tran, trace.pos[k + 1].tran, &d);
+    } else if (n == 2) {
+	d.x = trace.pos[k].tran.x - 2 * trace.pos[k + 1].tran.x +
+	    trace.pos[k + 2].tran.x;
+	d.y = trace.pos[k].tran.y - 2 * trace.pos[k + 1].tran.y +
+	    trace.pos[k + 2].tran.y;
+	d.z = 0.0;
+    } else {
+	d.x = trace.pos[0].tran.x - 3 * trace.pos[1].tran.x +
+	    3 * trace.pos[2].tran.x - trace.pos[3].tran.x;
+	d.y = trace.pos[0].tran.y - 3 * trace.pos[1].tran.y +
+	    3 * trace.pos[2].tran.y - trace.pos[3].tran.y;
+	d.z = 0.0;
+    }
+    pmCartMag(d, &mag);
+    return mag / pow(CYCLE_TIME, n);
+}
+
+static void cycle(void)
+{
+    double d;
+
+    tpRunCycle(&tp, (long) (CYCLE_TIME * 1e9));
+    memmove(&trace.pos[1], &trace.pos[0], 3 * sizeof(EmcPose));
+    trace.pos[0] = tpGetPos(&tp);
+    if (trace.n < 4) {
+	trace.n++;
+    }
+    if (trace.n >= 2 && (d = diff(1, 0)) > trace.vel) {
+	trace.vel = d;
+    }
+    if (trace.n >= 3 && (d = diff(2, 0)) > trace.accel) {
+	trace.accel = d;
+    }
+    if (trace.n >= 4 && (d = diff(3, 0)) > trace.jerk) {
+	trace.jerk = d;
+    }
+}
+
+/* runs the queue empty, returns the number of cycles */
+static int run(void)
+{
+    int cycles;
+
+    for (cycles = 0; cycles < 1000000 && !tpIsDone(&tp); cycles++) {
+	cycle();
+    }
+    /* the planner notices it's done on the cycle after the last motion */
+    return cycles - 1;
+}
+
+static double seconds(int cycles)
+{
+    return cycles * CYCLE_TIME;
+}
+
+int main(void)
+{
+    int trap, scurve, n;
+    double expect, stop_vel;
+
+    /* a straight move from rest to rest */
+    setup(0.0);
+    line(100.0, 0.0);
+    trap = run();
+    CHECK(trace.accel <= ACCEL * 1.001);
+
+    setup(JERK);
+    line(100.0, 0.0);
+    scurve = run();
+    CHECK(fabs(trace.pos[0].tran.x - 100.0) < 1e-9);
+    CHECK(trace.vel <= FEED * 1.001);
+    CHECK(trace.accel <= ACCEL * 1.001);
+    CHECK(trace.jerk <= JERK * 1.01);
+    /* cruise, plus FEED/ACCEL + ACCEL/JERK for getting up to speed and
+       back down: the jerk limit costs ACCEL/JERK over a trapezoid */
+    expect = 100.0 / FEED + FEED / ACCEL + ACCEL / JERK;
+    CHECK(fabs(seconds(scurve) - expect) < 0.01);
+    CHECK(fabs(seconds(scurve - trap) - ACCEL / JERK) < 0.01);
+    printf("100mm move: %.3fs trapezoidal, %.3fs with jerk %g (%.3fs "
+	"expected), peak jerk %.0f\n", seconds(trap), seconds(scurve), JERK,
+	expect, trace.jerk);
+
+    /* short moves that never reach the feed */
+    setup(JERK);
+    for (n = 1; n <= 20; n++) {
+	line(n * 0.5, 0.0);
+    }
+    run();
+    CHECK(fabs(trace.pos[0].tran.x - 10.0) < 1e-9);
+    /* these come to rest part way through a cycle */
+    CHECK(trace.jerk <= JERK * 1.01);
+    printf("short moves: peak jerk %.0f\n", trace.jerk);
+
+    /* blended corners: each side of the blend keeps half the jerk */
+    setup(JERK);
+    tpSetTermCond(&tp, TC_TERM_COND_BLEND, TOLERANCE);
+    line(20.0, 0.0);
+    line(20.0, 20.0);
+    line(40.0, 20.0);
+    line(40.0, 0.0);
+    run();
+    CHECK(fabs(trace.pos[0].tran.x - 40.0) < 1e-9);
+    CHECK(fabs(trace.pos[0].tran.y) < 1e-9);
+    CHECK(trace.accel <= ACCEL * 1.001);
+    CHECK(trace.jerk <= JERK * 1.01);
+    printf("blended square: peak accel %.0f, peak jerk %.0f\n", trace.accel,
+	trace.jerk);
+
+    /* pause in the middle of the move, then resume */
+    setup(JERK);
+    line(100.0, 0.0);
+    for (n = 0; n < 500; n++) {
+	cycle();
+    }
+    tpPause(&tp);
+    for (n = 0; n < 500; n++) {
+	cycle();
+    }
+    stop_vel = diff(1, 0);
+    CHECK(stop_vel == 0.0);
+    tpResume(&tp);
+    run();
+    CHECK(fabs(trace.pos[0].tran.x - 100.0) < 1e-9);
+    CHECK(trace.jerk <= JERK * 1.01);
+
+    /* abort in the middle of the move */
+    setup(JERK);
+    line(100.0, 0.0);
+    for (n = 0; n < 500; n++) {
+	cycle();
+    }
+    tpAbort(&tp);
+    run();
+    CHECK(trace.pos[0].tran.x < 100.0);
+    CHECK(diff(1, 0) == 0.0);
+    CHECK(trace.jerk <= JERK * 1.01);
+    printf("pause/resume and abort: peak jerk %.0f, %s\n", trace.jerk,
+	CHECK_RESULT);
+
+    return CHECK_EXIT;
+}
@@ -0,0 +1,187 @@
+/********************************************************************
+* Description:  test_tp_lookahead.c
+*               Replays a program of dense short segments, the way CAM
+*               output looks, through the trajectory planner with and
+*               without look-ahead, checks the path and the acceleration
+*               limit, and reports the cycle time saved.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "rtapi.h"
+#include "posemath.h"
+#include "tc.h"
+#include "tp.h"
+#include "motion.h"
+#include "motion_types.h"
+#include "hal.h"
+#include "mot_priv.h"
+#include "motion_debug.h"
+#include "tests/unittest.h"
+
+#define CYCLE_TIME 0.001
+#define FEED 100.0		/* mm/s */
+#define MAXVEL 200.0
+#define ACCEL 1000.0
+#define TOLERANCE 0.01
+#define STEP 0.05		/* segment length */
+#define SEGMENTS 4000
+#define QUEUED 200		/* what task keeps in the queue */
+#define LOOKAHEAD 100
+
+/* the program: a wavy line in 0.05mm steps, then a square the look-ahead
+   leaves to the ordinary blends */
+static int program_point(int n, EmcPose * pos)
+{
+    static const double square[4][2] = { {10, 0}, {10, 10}, {0, 10}, {0, 0} };
+    double x;
+
+    memset(pos, 0, sizeof(*pos));
+    if (n >= SEGMENTS + 4) {
+	return -1;
+    }
+    x = (n < SEGMENTS ? n : SEGMENTS) * STEP;
+    pos->tran.x = x;
+    pos->tran.y = 2.0 * sin(x / 5.0);
+    if (n > SEGMENTS) {
+	pos->tran.x += square[n - SEGMENTS - 1][0];
+	pos->tran.y += square[n - SEGMENTS - 1][1];
+    }
+    return 0;
+}
+
+static int run(int lookahead, double *max_accel)
+{
+    TP_STRUCT tp;
+    EmcPose pos, last, end;
+    PmCartesian vel, last_vel, dv;
+    double mag;
+    int n, cycles;
+
+    memset(emcmotStatus, 0, sizeof(*emcmotStatus));
+    emcmotStatus->net_feed_scale = 1.0;
+    memset(emcmotDebug, 0, sizeof(*emcmotDebug));
+
+    tpCreate(&tp, DEFAULT_TC_QUEUE_SIZE, emcmotDebug->queueTcSpace);
+    tpSetCycleTime(&tp, CYCLE_TIME);
+    tpSetVmax(&tp, FEED, MAXVEL);
+    tpSetVlimit(&tp, MAXVEL);
+    tpSetAmax(&tp, ACCEL);
+    tpSetTermCond(&tp, TC_TERM_COND_BLEND, TOLERANCE);
+    tpSetLookahead(&tp, lookahead);
+    program_point(0, &pos);
+    tpSetPos(&tp, pos);
+
+    last = pos;
+    memset(&last_vel, 0, sizeof(last_vel));
+    *max_accel = 0.0;
+    n = 1;
+    for (cycles = 0; cycles < 10000000; cycles++) {
+	while (tcqLen(&tp.queue) < QUEUED && program_point(n, &end) == 0) {
+	    tpAddLine(&tp, end, EMC_MOTION_TYPE_FEED, FEED, MAXVEL, ACCEL, 0,
+		0, -1);
+	    n++;
+	}
+	tpRunCycle(&tp, (long) (CYCLE_TIME * 1e9));
+	pos = tpGetPos(&tp);
+	pmCartCartSub(pos.tran, last.tran, &vel);
+	pmCartScalMult(vel, 1.0 / CYCLE_TIME, &vel);
+	pmCartMag(vel, &mag);
+	CHECK(mag <= MAXVEL * 1.001);
+	pmCartCartSub(vel, last_vel, &dv);
+	pmCartMag(dv, &mag);
+	if (mag / CYCLE_TIME > *max_accel) {
+	    *max_accel = mag / CYCLE_TIME;
+	}
+	last = pos;
+	last_vel = vel;
+	if (tpIsDone(&tp) && program_point(n, &end) != 0) {
+	    break;
+	}
+    }
+    program_point(n - 1, &end);
+    CHECK(fabs(pos.tran.x - end.tran.x) < 1e-9);
+    CHECK(fabs(pos.tran.y - end.tran.y) < 1e-9);
+    return cycles;
+}
+
+/* X10 at FEED, then a nearly straight X20 at a tenth of it: the slow
+   segment has to start out slow, whether the look-ahead planned the
+   corner for the feed override we have or for a higher one */
+static double feed_drop(double max_feed_scale)
+{
+    TP_STRUCT tp;
+    EmcPose pos, last, end;
+    PmCartesian vel;
+    double mag, peak = 0.0;
+    int cycles;
+
+    memset(emcmotStatus, 0, sizeof(*emcmotStatus));
+    emcmotStatus->net_feed_scale = 1.0;
+    memset(emcmotDebug, 0, sizeof(*emcmotDebug));
+
+    tpCreate(&tp, DEFAULT_TC_QUEUE_SIZE, emcmotDebug->queueTcSpace);
+    tpSetCycleTime(&tp, CYCLE_TIME);
+    tpSetVmax(&tp, FEED, MAXVEL);
+    tpSetVlimit(&tp, MAXVEL);
+    tpSetAmax(&tp, ACCEL);
+    tpSetTermCond(&tp, TC_TERM_COND_BLEND, TOLERANCE);
+    tpSetLookahead(&tp, 10);
+    tpSetMaxFeedScale(&tp, max_feed_scale);
+    memset(&pos, 0, sizeof(pos));
+    tpSetPos(&tp, pos);
+    end = pos;
+    end.tran.x = 10.0;
+    tpAddLine(&tp, end, EMC_MOTION_TYPE_FEED, FEED, MAXVEL, ACCEL, 0, 0, -1);
+    end.tran.x = 20.0;
+    end.tran.y = 0.001;
+    tpAddLine(&tp, end, EMC_MOTION_TYPE_FEED, FEED / 10.0, MAXVEL, ACCEL, 0,
+	0, -1);
+
+    last = pos;
+    for (cycles = 0; cycles < 100000 && !tpIsDone(&tp); cycles++) {
+	tpRunCycle(&tp, (long) (CYCLE_TIME * 1e9));
+	pos = tpGetPos(&tp);
+	pmCartCartSub(pos.tran, last.tran, &vel);
+	pmCartMag(vel, &mag);
+	/* a whole cycle on the slow segment */
+	if (last.tran.x > 10.0 && mag / CYCLE_TIME > peak) {
+	    peak = mag / CYCLE_TIME;
+	}
+	last = pos;
+    }
+    CHECK(fabs(pos.tran.x - end.tran.x) < 1e-9);
+    CHECK(fabs(pos.tran.y - end.tran.y) < 1e-9);
+    return peak;
+}
+
+int main(void)
+{
+    int plain, ahead;
+    double plain_accel, ahead_accel, drop, drop_scaled;
+
+    plain = run(0, &plain_accel);
+    ahead = run(LOOKAHEAD, &ahead_accel);
+    /* a little over the limit where the velocity is sampled across a
+       segment change */
+    CHECK(plain_accel <= ACCEL * 1.1);
+    CHECK(ahead_accel <= ACCEL * 1.1);
+    CHECK(ahead < plain);
+
+    drop = feed_drop(1.0);
+    drop_scaled = feed_drop(2.0);
+    CHECK(drop <= FEED / 10.0 * 1.001);
+    CHECK(drop_scaled <= FEED / 10.0 * 1.001);
+
+    printf("%d segments of %gmm: %d cycles without look-ahead, %d with "
+	"%d (%.1f%% less), peak accel %.0f/%.0f, F%g after F%g at %.1f/%.1f, "
+	"%s\n", SEGMENTS + 4, STEP, plain, ahead, LOOKAHEAD,
+	100.0 * (plain - ahead) / plain, plain_accel, ahead_accel,
+	FEED / 10.0, FEED, drop, drop_scaled, CHECK_RESULT);
+    return CHECK_EXIT;
+}
@@ -0,0 +1,53 @@
+/********************************************************************
+* Description:  test_tp_stubs.c
+*               What the trajectory planner expects from the rest of
+*               motion, for running it in the userspace tests.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "rtapi.h"
+#include "posemath.h"
+#include "tc.h"
+#include "tp.h"
+#include "motion.h"
+#include "hal.h"
+#include "mot_priv.h"
+#include "motion_debug.h"
+
+static emcmot_status_t status;
+static emcmot_debug_t debug;
+emcmot_status_t *emcmotStatus = &status;
+emcmot_debug_t *emcmotDebug = &debug;
+int num_dio = 4;
+int num_aio = 4;
+
+void emcmotDioWrite(int index, char value)
+{
+}
+
+void emcmotAioWrite(int index, double value)
+{
+}
+
+void emcmotSetRotaryUnlock(int axis, int unlock)
+{
+}
+
+int emcmotGetRotaryIsUnlocked(int axis)
+{
+    return 1;
+}
+
+void rtapi_print_msg(int level, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
@@ -111,10 +111,13 @@ int tpInit(TP_STRUCT * tp)
     tp->vLimit = 0.0;
     tp->vScale = 1.0;
     tp->aMax = 0.0;
+    tp->jMax = 0.0;
     tp->vMax = 0.0;
     tp->ini_maxvel = 0.0;
     tp->wMax = 0.0;
     tp->wDotMax = 0.0;
+    tp->lookahead = TP_DEFAULT_LOOKAHEAD;
+    tp->maxFeedScale = TP_DEFAULT_MAX_FEED_SCALE;
 
     ZERO_EMC_POSE(tp->currentPos);
 
@@ -182,6 +185,20 @@ int tpSetAmax(TP_STRUCT * tp, double aMax)
     return 0;
 }
 
+// Set max jerk for coordinated moves queued from now on, 0 for none
+// (acceleration switches straight between +/- the max, as before)
+
+int tpSetJmax(TP_STRUCT * tp, double jMax)
+{
+    if (0 == tp || jMax < 0.0) {
+	return -1;
+    }
+
+    tp->jMax = jMax;
+
+    return 0;
+}
+
 /*
   tpSetId() sets the id that will be used for the next appended motions.
   nextId is incremented so that the next time a motion is appended its id
@@ -241,6 +258,39 @@ int tpSetTermCond(TP_STRUCT * tp, int cond, double tolerance)
     return 0;
 }
 
+/*
+  tpSetLookahead(tp, depth) sets how many queued segments are replanned each
+  time a line or arc is added.  0 turns the look-ahead off, and blended
+  segments slow down at every corner as before.
+  */
+int tpSetLookahead(TP_STRUCT * tp, int depth)
+{
+    if (0 == tp || depth < 0 || depth > TP_MAX_LOOKAHEAD) {
+	return -1;
+    }
+
+    tp->lookahead = depth;
+
+    return 0;
+}
+
+/*
+  tpSetMaxFeedScale(tp, scale) sets the highest feed override the look-ahead
+  plans for.  A corner is never planned faster than the slower segment's
+  requested velocity times this; a higher override only gets slower corners,
+  a lower one is caught in tpRunCycle.
+  */
+int tpSetMaxFeedScale(TP_STRUCT * tp, double scale)
+{
+    if (0 == tp || scale <= 0.0) {
+	return -1;
+    }
+
+    tp->maxFeedScale = scale;
+
+    return 0;
+}
+
 // Used to tell the tp the initial position.  It sets
 // the current position AND the goal position to be the same.
 // Used only at TP initialization and when switching modes.
@@ -301,6 +351,7 @@ int tpAddRigidTap(TP_STRUCT *tp, EmcPose end, double vel, double ini_maxvel,
     tc.progress = 0.0;
     tc.reqvel = vel;
     tc.maxaccel = acc;
+    tc.maxjerk = 0.0;
     tc.feed_override = 0.0;
     tc.maxvel = ini_maxvel;
     tc.id = tp->nextId;
@@ -308,9 +359,12 @@ int tpAddRigidTap(TP_STRUCT *tp, EmcPose end, double vel, double ini_maxvel,
     tc.atspeed = 1;
 
     tc.currentvel = 0.0;
+    tc.currentacc = 0.0;
     tc.blending = 0;
     tc.blend_vel = 0.0;
     tc.vel_at_blend_start = 0.0;
+    tc.finalvel = 0.0;
+    tc.chain_with_next = 0;
 
     tc.coords.rigidtap.xyz = line_xyz;
     tc.coords.rigidtap.abc = abc;
@@ -354,6 +408,221 @@ int tpAddRigidTap(TP_STRUCT *tp, EmcPose end, double vel, double ini_maxvel,
     return 0;
 }
 
+// Distance it takes to get from velocity v and acceleration a down to
+// velocity vf and no acceleration, with deceleration up to A and jerk up
+// to J.  The deceleration ramps up and back down symmetrically, so the
+// average velocity is (v + vf) / 2.
+
+static double tcStopDistance(double v, double a, double vf, double A, double J)
+{
+    double t, dv, d = 0.0;
+
+    if (a > 0.0) {
+        // first bring the acceleration back to zero
+        t = a / J;
+        d = v * t + 0.5 * a * t * t - J * t * t * t / 6.0;
+        v += 0.5 * a * t;
+        a = 0.0;
+    }
+    if (a < 0.0) {
+        t = -a / J;
+        if (v - vf <= -0.5 * a * t) {
+            // braking too hard already: we get to vf before the
+            // deceleration is off, even taking it off right away
+            t = (-a - pmSqrt(a * a - 2.0 * J * (v - vf))) / J;
+            return v * t + 0.5 * a * t * t + J * t * t * t / 6.0;
+        }
+        // already part way into the deceleration: start from where it
+        // began, with no acceleration, and take off what is behind us
+        v -= 0.5 * a * t;
+        d = -(v * t - J * t * t * t / 6.0);
+    }
+    dv = v - vf;
+    if (dv <= 0.0)
+        return d;
+    if (dv * J >= A * A)
+        t = dv / A + A / J;
+    else
+        t = 2.0 * pmSqrt(dv / J);
+    return d + 0.5 * (v + vf) * t;
+}
+
+// Direction of travel in xyz at the start or end of a segment.  Unlike
+// tcGetStartingUnitVector this is the true tangent, with the helix rise.
+
+static PmCartesian tpGetTangent(TC_STRUCT * tc, int of_endpoint)
+{
+    PmCartesian v;
+
+    if (tc->motion_type == TC_LINEAR) {
+        v = tc->coords.line.xyz.uVec;
+    } else {
+        PmCircle *circle = &tc->coords.circle.xyz;
+        PmCartesian par, perp;
+        double angle = of_endpoint ? circle->angle : 0.0;
+
+        pmCartScalMult(circle->rTan, -sin(angle) * circle->angle, &par);
+        pmCartScalMult(circle->rPerp, cos(angle) * circle->angle, &perp);
+        pmCartCartAdd(par, perp, &v);
+        pmCartCartAdd(v, circle->rHelix, &v);
+        pmCartUnit(v, &v);
+    }
+    return v;
+}
+
+// tpRunCycle halves a segment's acceleration and jerk on activation when
+// either end of it is blended.  This is the factor it will run with.
+
+static double tpLookaheadScale(TP_STRUCT * tp, int n)
+{
+    TC_STRUCT *tc = tcqItem(&tp->queue, n, 0);
+    TC_STRUCT *prev = tcqItem(&tp->queue, n - 1, 0);
+
+    if (tc->active)
+        return 1.0;
+    if (tc->blend_with_next || (prev && prev->blend_with_next))
+        return 0.5;
+    return 1.0;
+}
+
+// Line or arc that moves xyz and nothing else.
+
+static int tpIsXYZOnly(TC_STRUCT * tc)
+{
+    if (tc->motion_type == TC_LINEAR)
+        return !tc->coords.line.xyz.tmag_zero &&
+            tc->coords.line.abc.tmag_zero && tc->coords.line.uvw.tmag_zero;
+    if (tc->motion_type == TC_CIRCULAR)
+        return tc->coords.circle.abc.tmag_zero &&
+            tc->coords.circle.uvw.tmag_zero;
+    return 0;
+}
+
+// Fastest we can go from tc straight into next, or 0 if this corner
+// should be blended (or stopped at) the usual way.  Chaining runs through
+// the programmed corner point, so it never leaves the path; the direction
+// change happens in a single cycle, and the velocity step that makes has
+// to stay within one cycle's worth of acceleration.
+
+static double tpJunctionVel(TP_STRUCT * tp, TC_STRUCT * tc, TC_STRUCT * next,
+    double acc)
+{
+    PmCartesian v1, v2;
+    double dot, sinhalf, vel, vmax, blend_vel;
+
+    if (!tc->blend_with_next || next->atspeed ||
+        tc->synchronized || next->synchronized ||
+        tc->indexrotary != -1 || next->indexrotary != -1)
+        return 0.0;
+    // only plain xyz moves: a rotary or uvw axis would start or stop
+    // moving in a single cycle at the corner
+    if (!tpIsXYZOnly(tc) || !tpIsXYZOnly(next))
+        return 0.0;
+
+    // no faster than one segment per cycle, so tpRunCycle never has to
+    // hand off more than once in a cycle
+    vel = (tc->target < next->target ? tc->target : next->target) /
+        tc->cycle_time;
+    // nor faster than either segment may go at any feed override we
+    // plan for
+    vmax = (tc->maxvel < next->maxvel ? tc->maxvel : next->maxvel);
+    if (tc->reqvel * tp->maxFeedScale < vmax)
+        vmax = tc->reqvel * tp->maxFeedScale;
+    if (next->reqvel * tp->maxFeedScale < vmax)
+        vmax = next->reqvel * tp->maxFeedScale;
+    if (vel > vmax)
+        vel = vmax;
+
+    v1 = tpGetTangent(tc, 1);
+    v2 = tpGetTangent(next, 0);
+    pmCartCartDot(v1, v2, &dot);
+    if (dot > 1.0) dot = 1.0;
+    if (dot < -1.0) dot = -1.0;
+    sinhalf = pmSqrt(0.5 * (1.0 - dot));
+    if (2.0 * sinhalf * vel > acc * tc->cycle_time)
+        vel = acc * tc->cycle_time / (2.0 * sinhalf);
+
+    // sharp corners go faster as a blend within the tolerance: leave those
+    // to tpRunCycle.  Same estimate as its blend_vel.
+    blend_vel = pmSqrt(acc * next->target);
+    if (tc->tolerance) {
+        double theta = acos(-dot) / 2.0;
+        if (cos(theta) > 0.001) {
+            double tblend_vel = 2.0 * pmSqrt(acc * tc->tolerance / cos(theta));
+            if (tblend_vel < blend_vel)
+                blend_vel = tblend_vel;
+        }
+    }
+    // which is no faster than the velocity limits either
+    if (blend_vel > vmax)
+        blend_vel = vmax;
+    if (vel < blend_vel)
+        return 0.0;
+
+    return vel;
+}
+
+// Look-ahead, run each time a segment is queued.  Walking back from the new
+// segment, which has to be able to stop at its end, each segment gets the
+// fastest final velocity that its corner allows and that the segments after
+// it can still slow down from.  Queueing more can only raise these limits,
+// so the walk stops at the first one that doesn't change.  tpRunCycle then
+// just decelerates toward each finalvel instead of toward a stop.
+
+static void tpRunLookahead(TP_STRUCT * tp)
+{
+    TC_STRUCT *tc, *next;
+    int len, first, n, i;
+    double scale, acc, next_acc, next_jerk, vel, vmax, vmin, v;
+
+    if (tp->lookahead <= 0)
+        return;
+
+    len = tcqLen(&tp->queue);
+    first = len - 1 - tp->lookahead;
+    if (first < 0)
+        first = 0;
+
+    next = tcqItem(&tp->queue, len - 1, 0);
+    scale = tpLookaheadScale(tp, len - 1);
+    next_acc = next->maxaccel * scale;
+    next_jerk = next->maxjerk * scale;
+    for (n = len - 2; n >= first; n--) {
+        tc = tcqItem(&tp->queue, n, 0);
+        scale = tpLookaheadScale(tp, n);
+        acc = tc->maxaccel * scale;
+
+        vel = tpJunctionVel(tp, tc, next, acc < next_acc ? acc : next_acc);
+        if (vel > 0.0) {
+            // next has to get from vel down to its own final velocity
+            vmax = pmSqrt(pmSq(next->finalvel) + 2.0 * next_acc * next->target);
+            if (next_jerk > 0.0) {
+                // which takes longer with the jerk limit
+                vmin = next->finalvel;
+                for (i = 0; i < 30; i++) {
+                    v = 0.5 * (vmin + vmax);
+                    if (tcStopDistance(v, 0.0, next->finalvel, next_acc,
+                            next_jerk) <= next->target)
+                        vmin = v;
+                    else
+                        vmax = v;
+                }
+                vmax = vmin;
+            }
+            if (vel > vmax)
+                vel = vmax;
+        }
+        if (vel == tc->finalvel)
+            break;
+        tc->finalvel = vel;
+        tc->chain_with_next = vel > 0.0;
+
+        next = tc;
+        next_acc = acc;
+        next_jerk = tc->maxjerk * scale;
+    }
+}
+
 // Add a straight line to the tc queue.  This is a coordinated
 // move in any or all of the six axes.  it goes from the end
 // of the previous move to the new end specified here at the
@@ -418,6 +687,8 @@ int tpAddLine(TP_STRUCT * tp, EmcPose end, int type, double vel, double ini_maxv
     tc.progress = 0.0;
     tc.reqvel = vel;
     tc.maxaccel = acc;
+    // spindle synchronized moves follow the spindle as closely as they can
+    tc.maxjerk = tp->synchronized ? 0.0 : tp->jMax;
     tc.feed_override = 0.0;
     tc.maxvel = ini_maxvel;
     tc.id = tp->nextId;
@@ -425,9 +696,12 @@ int tpAddLine(TP_STRUCT * tp, EmcPose end, int type, double vel, double ini_maxv
     tc.atspeed = atspeed;
 
     tc.currentvel = 0.0;
+    tc.currentacc = 0.0;
     tc.blending = 0;
     tc.blend_vel = 0.0;
     tc.vel_at_blend_start = 0.0;
+    tc.finalvel = 0.0;
+    tc.chain_with_next = 0;
 
     tc.coords.line.xyz = line_xyz;
     tc.coords.line.uvw = line_uvw;
@@ -455,6 +729,7 @@ int tpAddLine(TP_STRUCT * tp, EmcPose end, int type, double vel, double ini_maxv
         rtapi_print_msg(RTAPI_MSG_ERR, "tcqPut failed.\n");
 	return -1;
     }
+    tpRunLookahead(tp);
 
     tp->goalPos = end;      // remember the end of this move, as it's
                             // the start of the next one.
@@ -529,6 +804,8 @@ int tpAddCircle(TP_STRUCT * tp, EmcPose end,
     tc.progress = 0.0;
     tc.reqvel = vel;
     tc.maxaccel = acc;
+    // spindle synchronized moves follow the spindle as closely as they can
+    tc.maxjerk = tp->synchronized ? 0.0 : tp->jMax;
     tc.feed_override = 0.0;
     tc.maxvel = ini_maxvel;
     tc.id = tp->nextId;
@@ -536,9 +813,12 @@ int tpAddCircle(TP_STRUCT * tp, EmcPose end,
     tc.atspeed = atspeed;
 
     tc.currentvel = 0.0;
+    tc.currentacc = 0.0;
     tc.blending = 0;
     tc.blend_vel = 0.0;
     tc.vel_at_blend_start = 0.0;
+    tc.finalvel = 0.0;
+    tc.chain_with_next = 0;
 
     tc.coords.circle.xyz = circle;
     tc.coords.circle.uvw = line_uvw;
@@ -565,6 +845,7 @@ int tpAddCircle(TP_STRUCT * tp, EmcPose end,
     if (tcqPut(&tp->queue, tc) == -1) {
 	return -1;
     }
+    tpRunLookahead(tp);
 
     tp->goalPos = end;
     tp->done = 0;
@@ -574,11 +855,261 @@ int tpAddCircle(TP_STRUCT * tp, EmcPose end,
     return 0;
 }
 
-void tcRunCycle(TP_STRUCT *tp, TC_STRUCT *tc, double *v, int *on_final_decel) {
-    double discr, maxnewvel, newvel, newaccel=0;
+// Velocity tc may go at, before the end of the segment is considered.
+
+static double tcGetVelLimit(TP_STRUCT *tp, TC_STRUCT *tc) {
+    double limit = tc->reqvel * tc->feed_override;
+
+    if(limit > tc->maxvel) limit = tc->maxvel;
+
+    // if the motion is not purely rotary axes (and therefore in angular units) ...
+    if(!(tc->motion_type == TC_LINEAR && tc->coords.line.xyz.tmag_zero && tc->coords.line.uvw.tmag_zero)) {
+        // ... clamp motion's velocity at TRAJ MAX_VELOCITY (tooltip maxvel)
+        // except when it's synced to spindle position.
+        if((!tc->synchronized || tc->velocity_mode) && limit > tp->vLimit) {
+            limit = tp->vLimit;
+        }
+    }
+    return limit;
+}
+
+// The jerk limited cycle ramps the acceleration linearly from currentacc
+// to acc over the cycle; this is how far that takes us.
+
+static double tcJerkStep(TC_STRUCT *tc, double acc) {
+    double ct = tc->cycle_time;
+
+    return ct * (tc->currentvel + ct * (tc->currentacc / 3.0 + acc / 6.0));
+}
+
+// Whether ending the coming cycle at acceleration acc still leaves room to
+// slow down to finalvel by the end of the segment.
+
+static int tcCanStop(TC_STRUCT *tc, double acc, double finalvel) {
+    double newvel = tc->currentvel + 0.5 * (tc->currentacc + acc) * tc->cycle_time;
+
+    if(newvel < 0.0) newvel = 0.0;
+    return tcJerkStep(tc, acc) +
+        tcStopDistance(newvel, acc, finalvel, tc->maxaccel, tc->maxjerk) <=
+        tc->target - tc->progress;
+}
+
+// The stop tcStopDistance measures, as phases of constant jerk: jerk[n]
+// for time[n].  Returns the number of phases, or -1 when we are braking
+// too hard already to take the deceleration off before reaching vf.
+
+static int tcStopPhases(double v, double a, double vf, double A, double J,
+        double *jerk, double *time) {
+    double dv, peak, hold = 0.0;
+    int n = 0;
+
+    if(a > 0.0) {
+        jerk[n] = -J;
+        time[n++] = a / J;
+        v += 0.5 * a * a / J;
+        a = 0.0;
+    }
+    // from where the deceleration began, as in tcStopDistance
+    dv = v + 0.5 * a * a / J - vf;
+    if(dv <= 0.0)
+        return -1;
+    if(dv * J >= A * A) {
+        peak = A;
+        hold = dv / A - A / J;
+    } else {
+        peak = pmSqrt(dv * J);
+    }
+    if(-a > peak) {
+        // a hair below the curve is rounding, not braking too hard
+        if(-a - peak > 1e-6 * A)
+            return -1;
+        peak = -a;
+    }
+    jerk[n] = -J;
+    time[n++] = (peak + a) / J;
+    jerk[n] = 0.0;
+    time[n++] = hold;
+    jerk[n] = J;
+    time[n++] = peak / J;
+    return n;
+}
+
+// Runs up to time t along the phases, from velocity v and acceleration a.
+// Returns the distance, leaves v, a and the time left over in t.
+
+static double tcRunPhases(int n, double *jerk, double *time, double *t,
+        double *v, double *a) {
+    double dt, d = 0.0;
+    int i;
+
+    for(i = 0; i < n && *t > 0.0; i++) {
+        dt = time[i] < *t ? time[i] : *t;
+        d += dt * (*v + dt * (0.5 * *a + dt * jerk[i] / 6.0));
+        *v += dt * (*a + 0.5 * dt * jerk[i]);
+        *a += dt * jerk[i];
+        *t -= dt;
+    }
+    return d;
+}
+
+// Braking cycle: the stop tcStopDistance plans, sampled at the end of the
+// cycle.  The deceleration starts part way into the cycle, holding the
+// acceleration until then, so the stop ends right at the target with
+// velocity and acceleration reaching finalvel and 0 together.  Stepping
+// the acceleration once per cycle instead lands a little short of the
+// curve, and the stop ends with deceleration left that has to come off
+// within a single cycle.  Returns 0 when the planned stop doesn't fit
+// (the target moved closer), for the caller to brake as hard as it can.
+
+static int tcRunStop(TC_STRUCT *tc, double finalvel, double *newvel,
+        double *newaccel) {
+    double ct = tc->cycle_time, A = tc->maxaccel, J = tc->maxjerk;
+    double v = tc->currentvel, a = tc->currentacc;
+    double d = tc->target - tc->progress, lo, hi, mid, t, dist;
+    double jerk[5], time[5];
+    int n, i;
+
+    // holding the acceleration for t, then the stop, takes
+    // t (v + a t / 2) + tcStopDistance(v + a t, a, ...)
+    if(tcStopDistance(v, a, finalvel, A, J) > d + 1e-9)
+        return 0;
+    lo = 0.0;
+    hi = ct;
+    // holding a deceleration goes below the curve the stop ramps off on
+    if(a < 0.0 && (v - finalvel - 0.5 * a * a / J) / -a < hi)
+        hi = (v - finalvel - 0.5 * a * a / J) / -a;
+    if(hi <= 0.0) {
+        hi = 0.0;
+    } else if((dist = hi * (v + 0.5 * a * hi) +
+            tcStopDistance(v + a * hi, a, finalvel, A, J)) <= d) {
+        // braking harder than the stop needs, unless the cycle is over
+        // before the hold is
+        if(hi < ct && dist < d - 1e-9)
+            return 0;
+        lo = hi;
+    } else {
+        for(i = 0; i < 30; i++) {
+            mid = 0.5 * (lo + hi);
+            if(mid * (v + 0.5 * a * mid) +
+                    tcStopDistance(v + a * mid, a, finalvel, A, J) <= d)
+                lo = mid;
+            else
+                hi = mid;
+        }
+    }
+    jerk[0] = 0.0;
+    time[0] = lo;
+    n = tcStopPhases(v + a * lo, a, finalvel, A, J, jerk + 1, time + 1);
+    if(n < 0)
+        return 0;
+
+    t = ct;
+    dist = tcRunPhases(n + 1, jerk, time, &t, &v, &a);
+    for(i = 0, t = ct; i <= n; i++)
+        t -= time[i];
+    if(t > -1e-9) {
+        // the stop is over within the cycle (give or take rounding): at
+        // the target, and carrying on at finalvel for the rest of it
+        tc->progress = tc->target + finalvel * (t > 0.0 ? t : 0.0);
+        v = finalvel;
+        a = 0.0;
+    } else {
+        tc->progress += dist;
+    }
+    *newvel = v > 0.0 ? v : 0.0;
+    *newaccel = a;
+    return 1;
+}
+
+// Jerk limited cycle: the acceleration moves by at most maxjerk *
+// cycle_time per cycle.  We take the acceleration that heads for the
+// velocity limit, arriving there with no acceleration left, unless that
+// leaves too little room to slow down: then we follow the stop tcRunStop
+// plans, or failing that the largest acceleration that still fits.
+
+static void tcRunCycleJerk(TP_STRUCT *tp, TC_STRUCT *tc, double finalvel, double *v, int *on_final_decel) {
+    double ct = tc->cycle_time, jerk = tc->maxjerk, jstep = jerk * ct;
+    double limit, c, wanted, lo, hi, mid, newvel, newaccel;
+    int braking = 0, planned = 0, i;
+
+    // end the cycle where taking the acceleration straight off lands on
+    // the limit: newvel + newaccel * |newaccel| / 2 jerk == limit
+    limit = tcGetVelLimit(tp, tc);
+    c = tc->currentvel + 0.5 * tc->currentacc * ct - limit;
+    if(c <= 0.0)
+        wanted = jerk * (-0.5 * ct + pmSqrt(0.25 * pmSq(ct) - 2.0 * c / jerk));
+    else
+        wanted = 0.5 * (jstep - pmSqrt(pmSq(jstep) + 8.0 * jerk * c));
+
+    lo = tc->currentacc - jstep;
+    if(lo < -tc->maxaccel) lo = -tc->maxaccel;
+    hi = tc->currentacc + jstep;
+    if(hi > tc->maxaccel) hi = tc->maxaccel;
+    newaccel = wanted < lo ? lo : (wanted > hi ? hi : wanted);
+
+    if(!tcCanStop(tc, newaccel, finalvel)) {
+        braking = 1;
+        planned = tcRunStop(tc, finalvel, &newvel, &newaccel);
+        if(!planned) {
+            hi = newaccel;
+            for(i = 0; i < 20; i++) {
+                mid = 0.5 * (lo + hi);
+                if(tcCanStop(tc, mid, finalvel)) lo = mid;
+                else hi = mid;
+            }
+            newaccel = lo;
+        }
+    }
+
+    if(!planned) {
+        newvel = tc->currentvel + 0.5 * (tc->currentacc + newaccel) * ct;
+        if(newvel <= 0.0) {
+            // comes to rest part way through the cycle, with the
+            // acceleration still ramping: v + a t + k t^2 / 2 == 0
+            double a = tc->currentacc, k = (newaccel - a) / ct, t;
+
+            if(fabs(k) < 1e-9)
+                t = a < 0.0 ? -tc->currentvel / a : 0.0;
+            else
+                t = (-a - pmSqrt(pmSq(a) - 2.0 * k * tc->currentvel)) / k;
+            if(t > 0.0 && t < ct)
+                tc->progress += t * (tc->currentvel + t * (0.5 * a + k * t / 6.0));
+            newvel = newaccel = 0.0;
+        } else {
+            tc->progress += tcJerkStep(tc, newaccel);
+            if(fabs(newvel - limit) < TP_VEL_EPSILON &&
+                    fabs(newaccel) < TP_ACCEL_EPSILON) {
+                newvel = limit;
+                newaccel = 0.0;
+            }
+        }
+    }
+    if(finalvel == 0.0 && braking && !planned &&
+            (newvel < TP_VEL_EPSILON || tc->progress > tc->target)) {
+        // stopped at (or within a cycle's motion of) the end
+        tc->progress = tc->target;
+        newvel = newaccel = 0.0;
+    }
+    tc->currentvel = newvel;
+    tc->currentacc = newaccel;
+    if(v) *v = newvel;
+    if(on_final_decel) *on_final_decel = braking;
+}
+
+// finalvel is the velocity tc may still have at its target; the
+// deceleration is planned as a stop that far beyond it.
+
+void tcRunCycle(TP_STRUCT *tp, TC_STRUCT *tc, double finalvel, double *v, int *on_final_decel) {
+    double discr, maxnewvel, newvel, newaccel=0, limit;
     if(!tc->blending) tc->vel_at_blend_start = tc->currentvel;
 
-    discr = 0.5 * tc->cycle_time * tc->currentvel - (tc->target - tc->progress);
+    if(tc->maxjerk > 0.0) {
+        tcRunCycleJerk(tp, tc, finalvel, v, on_final_decel);
+        return;
+    }
+
+    discr = 0.5 * tc->cycle_time * tc->currentvel - (tc->target - tc->progress) -
+        0.5 * pmSq(finalvel) / tc->maxaccel;
     if(discr > 0.0) {
         // should never happen: means we've overshot the target
         newvel = maxnewvel = 0.0;
@@ -594,18 +1125,8 @@ void tcRunCycle(TP_STRUCT *tp, TC_STRUCT *tc, double *v, int *on_final_decel) {
         tc->progress = tc->target;
     } else {
         // constrain velocity
-        if(newvel > tc->reqvel * tc->feed_override)
-            newvel = tc->reqvel * tc->feed_override;
-        if(newvel > tc->maxvel) newvel = tc->maxvel;
-
-        // if the motion is not purely rotary axes (and therefore in angular units) ...
-        if(!(tc->motion_type == TC_LINEAR && tc->coords.line.xyz.tmag_zero && tc->coords.line.uvw.tmag_zero)) {
-            // ... clamp motion's velocity at TRAJ MAX_VELOCITY (tooltip maxvel)
-            // except when it's synced to spindle position.
-            if((!tc->synchronized || tc->velocity_mode) && newvel > tp->vLimit) {
-                newvel = tp->vLimit;
-            }
-        }
+        limit = tcGetVelLimit(tp, tc);
+        if(newvel > limit) newvel = limit;
 
         // get resulting acceleration
         newaccel = (newvel - tc->currentvel) / tc->cycle_time;
@@ -623,6 +1144,7 @@ void tcRunCycle(TP_STRUCT *tp, TC_STRUCT *tc, double *v, int *on_final_decel) {
         tc->progress += (newvel + tc->currentvel) * 0.5 * tc->cycle_time;
     }
     tc->currentvel = newvel;
+    tc->currentacc = newaccel;
     if(v) *v = newvel;
     if(on_final_decel) *on_final_decel = fabs(maxnewvel - newvel) < 0.001;
 }
@@ -672,13 +1194,14 @@ int tpRunCycle(TP_STRUCT * tp, long period)
     TC_STRUCT *tc, *nexttc;
     double primary_vel;
     int on_final_decel;
+    int chain, handoff = 0;
     EmcPose primary_before, primary_after;
     EmcPose secondary_before, secondary_after;
     EmcPose primary_displacement, secondary_displacement;
     static double spindleoffset;
     static int waiting_for_index = MOTION_INVALID_ID;
     static int waiting_for_atspeed = MOTION_INVALID_ID;
-    double save_vel;
+    double save_vel, finalvel;
     static double revs;
     EmcPose target;
 
@@ -755,6 +1278,10 @@ int tpRunCycle(TP_STRUCT * tp, long period)
         nexttc = NULL;
     }
 
+    // the look-ahead lets us reach the end of tc still moving, and nexttc
+    // carries on from there
+    chain = nexttc && tc->chain_with_next;
+
     if(tp->aborting) {
         // an abort message has come
         if( MOTION_ID_VALID(waiting_for_index) ||
@@ -830,14 +1357,17 @@ int tpRunCycle(TP_STRUCT * tp, long period)
 
         tc->active = 1;
         tc->currentvel = 0;
+        tc->currentacc = 0;
         tp->depth = tp->activeDepth = 1;
         tp->motionType = tc->canon_motion_type;
         tc->blending = 0;
 
         // honor accel constraint in case we happen to make an acute angle
         // with the next segment.
-        if(tc->blend_with_next)
+        if(tc->blend_with_next) {
             tc->maxaccel /= 2.0;
+            tc->maxjerk /= 2.0;
+        }
 
         if(tc->synchronized) {
             if(!tc->velocity_mode && !emcmotStatus->spindleSync) {
@@ -932,14 +1462,17 @@ int tpRunCycle(TP_STRUCT * tp, long period)
         // this means this tc is being read for the first time.
 
         nexttc->currentvel = 0;
+        nexttc->currentacc = 0;
         tp->depth = tp->activeDepth = 1;
         nexttc->active = 1;
         nexttc->blending = 0;
 
         // honor accel constraint if we happen to make an acute angle with the
         // above segment or the following one
-        if(tc->blend_with_next || nexttc->blend_with_next)
+        if(tc->blend_with_next || nexttc->blend_with_next) {
             nexttc->maxaccel /= 2.0;
+            nexttc->maxjerk /= 2.0;
+        }
     }
 
 
@@ -1023,7 +1556,7 @@ int tpRunCycle(TP_STRUCT * tp, long period)
     // calculate the approximate peak velocity the nexttc will hit.
     // we know to start blending it in when the current tc goes below
     // this velocity...
-    if(nexttc && nexttc->maxaccel) {
+    if(nexttc && !chain && nexttc->maxaccel) {
         tc->blend_vel = nexttc->maxaccel *
             pmSqrt(nexttc->target / nexttc->maxaccel);
         if(tc->blend_vel > nexttc->reqvel * nexttc->feed_override) {
@@ -1068,7 +1601,24 @@ int tpRunCycle(TP_STRUCT * tp, long period)
     }
 
     primary_before = tcGetPos(tc);
-    tcRunCycle(tp, tc, &primary_vel, &on_final_decel);
+    finalvel = 0.0;
+    if(chain) {
+        // planned for any feed override up to maxFeedScale: the one we
+        // have now may want nexttc slower than that
+        finalvel = tcGetVelLimit(tp, nexttc);
+        if(tc->finalvel < finalvel) finalvel = tc->finalvel;
+    }
+    tcRunCycle(tp, tc, finalvel, &primary_vel, &on_final_decel);
+    if(chain && tc->progress >= tc->target) {
+        // past the end: the rest of this cycle's travel is on nexttc, at
+        // the velocity we got here with.  tc is removed next cycle.
+        double excess = tc->progress - tc->target;
+        tc->progress = tc->target;
+        nexttc->currentvel = tc->currentvel;
+        nexttc->currentacc = tc->currentacc;
+        nexttc->progress = excess < nexttc->target ? excess : nexttc->target;
+        handoff = 1;
+    }
     primary_after = tcGetPos(tc);
     pmCartCartSub(primary_after.tran, primary_before.tran,
             &primary_displacement.tran);
@@ -1080,9 +1630,20 @@ int tpRunCycle(TP_STRUCT * tp, long period)
     primary_displacement.v = primary_after.v - primary_before.v;
     primary_displacement.w = primary_after.w - primary_before.w;
 
-    // blend criteria
-    if((tc->blending && nexttc) ||
-            (nexttc && on_final_decel && primary_vel < tc->blend_vel)) {
+    // handed off to nexttc this cycle (look-ahead), or blend criteria
+    if(handoff) {
+	tpToggleDIOs(nexttc); //check and do DIO changes
+        target = tcGetEndpoint(nexttc);
+        tp->motionType = nexttc->canon_motion_type;
+	emcmotStatus->distance_to_go = nexttc->target - nexttc->progress;
+        tp->currentPos = tcGetPos(nexttc);
+        emcmotStatus->current_vel = nexttc->currentvel;
+        emcmotStatus->requested_vel = nexttc->reqvel;
+	emcmotStatus->enables_queued = nexttc->enables;
+	// report our line number to the guis
+	tp->execId = nexttc->id;
+    } else if(!chain && ((tc->blending && nexttc) ||
+            (nexttc && on_final_decel && primary_vel < tc->blend_vel))) {
         // make sure we continue to blend this segment even when its
         // accel reaches 0 (at the very end)
         tc->blending = 1;
@@ -1116,7 +1677,7 @@ int tpRunCycle(TP_STRUCT * tp, long period)
         nexttc->reqvel = nexttc->feed_override > 0.0 ?
             ((tc->vel_at_blend_start - primary_vel) / nexttc->feed_override) :
             0.0;
-        tcRunCycle(tp, nexttc, NULL, NULL);
+        tcRunCycle(tp, nexttc, 0.0, NULL, NULL);
         nexttc->reqvel = save_vel;
 
         secondary_after = tcGetPos(nexttc);
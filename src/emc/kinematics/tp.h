@@ -19,6 +19,14 @@
 
 #define TP_DEFAULT_QUEUE_SIZE 32
 
+/* number of queued segments the look-ahead replans when one is added,
+   0 leaves it off */
+#define TP_DEFAULT_LOOKAHEAD 0
+#define TP_MAX_LOOKAHEAD 1000
+
+/* highest feed override the look-ahead plans the corners for */
+#define TP_DEFAULT_MAX_FEED_SCALE 1.0
+
 /* closeness to zero, for determining if a move is pure rotation */
 #define TP_PURE_ROTATION_EPSILON 1e-6
 
@@ -36,6 +44,7 @@ typedef struct {
                                    subsequent moves */
     double vScale;		/* feed override value */
     double aMax;
+    double jMax;		/* jerk for subsequent moves, 0 = no limit */
     double vLimit;		/* absolute upper limit on all vels */
     double wMax;		/* rotational velocity max */
     double wDotMax;		/* rotational accelleration max */
@@ -57,6 +66,8 @@ typedef struct {
     int velocity_mode; 	        /* TRUE if spindle sync is in velocity mode,
 				   FALSE if in position mode */
     double uu_per_rev;          /* user units per spindle revolution */
+    int lookahead;              /* segments replanned on every add */
+    double maxFeedScale;        /* highest feed override planned for */
 } TP_STRUCT;
 
 extern int tpCreate(TP_STRUCT * tp, int _queueSize, TC_STRUCT * tcSpace);
@@ -67,9 +78,12 @@ extern int tpSetCycleTime(TP_STRUCT * tp, double secs);
 extern int tpSetVmax(TP_STRUCT * tp, double vmax, double ini_maxvel);
 extern int tpSetVlimit(TP_STRUCT * tp, double limit);
 extern int tpSetAmax(TP_STRUCT * tp, double amax);
+extern int tpSetJmax(TP_STRUCT * tp, double jmax);
 extern int tpSetId(TP_STRUCT * tp, int id);
 extern int tpGetExecId(TP_STRUCT * tp);
 extern int tpSetTermCond(TP_STRUCT * tp, int cond, double tolerance);
+extern int tpSetLookahead(TP_STRUCT * tp, int depth);
+extern int tpSetMaxFeedScale(TP_STRUCT * tp, double scale);
 extern int tpSetPos(TP_STRUCT * tp, EmcPose pos);
 extern int tpAddRigidTap(TP_STRUCT * tp, EmcPose end, double vel, double
         ini_maxvel, double acc, unsigned char enables);
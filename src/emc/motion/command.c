@@ -342,6 +342,51 @@ static int is_feed_type(int motion_type)
     }
 }
 
+/*
+  next_command() returns the next command to run this cycle, or 0 when
+  there are no more.  Moves queued in the command ring come first, up to
+  EMCMOT_COMMAND_BUDGET of them, then a new command in the single slot.
+  Usrmot only writes the single slot once the ring is empty, so commands
+  still run in the order they were sent.  *queued says which one it is;
+  a ring slot is handed back on the following call.
+  */
+static emcmot_command_t *next_command(int *queued, int *budget)
+{
+    emcmot_command_ring_t *ring = emcmotCommandRing;
+
+    if (*queued) {
+	/* finished with the slot before letting usrmot reuse it */
+	emcmot_barrier();
+	ring->tail++;
+	*queued = 0;
+    }
+    /* moves sent after one that failed, before task heard about it */
+    while (ring->tail != ring->head &&
+	emcmotStatus->queuedFailNum != ring->failSeen) {
+	ring->tail++;
+    }
+    if (ring->tail != ring->head) {
+	/* leave moves in the ring while the planner queue has no room */
+	if (*budget <= 0 || tcqFull(&emcmotDebug->queue.queue)) {
+	    return 0;
+	}
+	(*budget)--;
+	/* read the slot only after the head that published it */
+	emcmot_barrier();
+	*queued = 1;
+	return &ring->slot[ring->tail % EMCMOT_COMMAND_RING_LEN];
+    }
+    /* check for split read */
+    if (emcmotCommand->head != emcmotCommand->tail) {
+	emcmotDebug->split++;
+	return 0;		/* not really an error */
+    }
+    if (emcmotCommand->commandNum != emcmotStatus->commandNumEcho) {
+	return emcmotCommand;
+    }
+    return 0;
+}
+
 /*
   emcmotCommandHandler() is called each main cycle to read the
   shared memory buffer
@@ -352,24 +397,30 @@ void emcmotCommandHandler(void *arg, long period)
     int n;
     emcmot_joint_t *joint;
     double tmp1;
-    emcmot_comp_entry_t *comp_entry;
-    char issue_atspeed = 0;
+    emcmot_volcomp_grid_t *grid;
+    int points;
+    char issue_atspeed;
+    /* the command being run, a ring slot or the single slot */
+    emcmot_command_t *emcmotCommand;
+    int queued = 0;
+    int budget = EMCMOT_COMMAND_BUDGET;
     
 check_stuff ( "before command_handler()" );
 
-    /* check for split read */
-    if (emcmotCommand->head != emcmotCommand->tail) {
-	emcmotDebug->split++;
-	return;			/* not really an error */
-    }
-    if (emcmotCommand->commandNum != emcmotStatus->commandNumEcho) {
+    while ((emcmotCommand = next_command(&queued, &budget)) != 0) {
+	issue_atspeed = 0;
+
 	/* increment head count-- we'll be modifying emcmotStatus */
 	emcmotStatus->head++;
 	emcmotDebug->head++;
 
 	/* got a new command-- echo command and number... */
-	emcmotStatus->commandEcho = emcmotCommand->command;
-	emcmotStatus->commandNumEcho = emcmotCommand->commandNum;
+	if (queued) {
+	    emcmotStatus->queuedNumEcho = emcmotCommand->commandNum;
+	} else {
+	    emcmotStatus->commandEcho = emcmotCommand->command;
+	    emcmotStatus->commandNumEcho = emcmotCommand->commandNum;
+	}
 
 	/* clear status value by default */
 	emcmotStatus->commandStatus = EMCMOT_COMMAND_OK;
@@ -1010,6 +1061,14 @@ check_stuff ( "before command_handler()" );
 	    tpSetAmax(&emcmotDebug->queue, emcmotStatus->acc);
 	    break;
 
+	case EMCMOT_SET_JERK:
+	    /* set the max jerk, applies to moves queued after this */
+	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_JERK");
+	    emcmot_config_change();
+	    emcmotConfig->limitJerk = emcmotCommand->jerk;
+	    tpSetJmax(&emcmotDebug->queue, emcmotConfig->limitJerk);
+	    break;
+
 	case EMCMOT_PAUSE:
 	    /* pause the motion */
 	    /* can happen at any time */
@@ -1587,34 +1646,47 @@ check_stuff ( "before command_handler()" );
 	    if (joint == 0) {
 		break;
 	    }
-	    if (joint->comp.entries >= EMCMOT_COMP_SIZE) {
+	    switch (emcmotCompAdd(&(joint->comp), emcmotCommand->comp_nominal,
+		    emcmotCommand->comp_forward, emcmotCommand->comp_reverse)) {
+	    case -1:
 		reportError(_("joint %d: too many compensation entries"), joint_num);
 		break;
-	    }
-	    /* point to last entry */
-	    comp_entry = &(joint->comp.array[joint->comp.entries]);
-	    if (emcmotCommand->comp_nominal <= comp_entry[0].nominal) {
+	    case -2:
 		reportError(_("joint %d: compensation values must increase"), joint_num);
 		break;
 	    }
-	    /* store data to new entry */
-	    comp_entry[1].nominal = emcmotCommand->comp_nominal;
-	    comp_entry[1].fwd_trim = emcmotCommand->comp_forward;
-	    comp_entry[1].rev_trim = emcmotCommand->comp_reverse;
-	    /* calculate slopes from previous entry to the new one */
-	    if ( comp_entry[0].nominal != -DBL_MAX ) {
-		/* but only if the previous entry is "real" */
-		tmp1 = comp_entry[1].nominal - comp_entry[0].nominal;
-		comp_entry[0].fwd_slope =
-		    (comp_entry[1].fwd_trim - comp_entry[0].fwd_trim) / tmp1;
-		comp_entry[0].rev_slope =
-		    (comp_entry[1].rev_trim - comp_entry[0].rev_trim) / tmp1;
-	    } else {
-		/* previous entry is at minus infinity, slopes are zero */
-		comp_entry[0].fwd_trim = comp_entry[1].fwd_trim;
-		comp_entry[0].rev_trim = comp_entry[1].rev_trim;
+	    break;
+
+	case EMCMOT_SET_VOLCOMP:
+	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_VOLCOMP");
+	    grid = &emcmotCommand->volcomp;
+	    if (grid->count[0] == 0) {
+		/* the correction ramps back out at the old max_vel */
+		emcmotVolcomp->enabled = 0;
+		break;
 	    }
-	    joint->comp.entries++;
+	    /* the table is in X, Y, Z, which are joints 0, 1, 2 */
+	    if (kinType != KINEMATICS_IDENTITY || num_joints < 3) {
+		reportError(_("volumetric compensation needs trivial kinematics"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		break;
+	    }
+	    points = 1;
+	    for (n = 0; n < 3; n++) {
+		/* checked before multiplying, so it can't overflow */
+		if (grid->count[n] < 2 || grid->step[n] <= 0.0 ||
+		    grid->count[n] > EMCMOT_VOLCOMP_POINTS / points) {
+		    break;
+		}
+		points *= grid->count[n];
+	    }
+	    if (n < 3 || grid->max_vel <= 0.0) {
+		reportError(_("bad volumetric compensation grid"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		break;
+	    }
+	    emcmotVolcomp->grid = *grid;
+	    emcmotVolcomp->enabled = 1;
 	    break;
 
         case EMCMOT_SET_OFFSET:
@@ -1631,6 +1703,12 @@ check_stuff ( "before command_handler()" );
 	if (emcmotStatus->commandStatus != EMCMOT_COMMAND_OK) {
 	    rtapi_print_msg(RTAPI_MSG_DBG, "ERROR: %d",
 		emcmotStatus->commandStatus);
+	    if (queued) {
+		/* nobody is waiting on this one, keep it for usrmot */
+		emcmotStatus->queuedFailNum = emcmotCommand->commandNum;
+		emcmotStatus->queuedFailId = emcmotCommand->id;
+		emcmotStatus->queuedFailStatus = emcmotStatus->commandStatus;
+	    }
 	}
 	rtapi_print_msg(RTAPI_MSG_DBG, "\n");
 	/* synch tail count */
@@ -1639,7 +1717,7 @@ check_stuff ( "before command_handler()" );
 	emcmotDebug->tail = emcmotDebug->head;
 
     }
-    /* end of: if-new-command */
+    /* end of: while-new-command */
 check_stuff ( "after command_handler()" );
 
     return;
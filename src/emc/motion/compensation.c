@@ -0,0 +1,149 @@
+/********************************************************************
+* Description: compensation.c
+*   the lookups behind leadscrew and volumetric compensation - the
+*   tables are filled by command.c and used each cycle by control.c,
+*   this is the part that can be tested outside of motion
+*
+* License: GPL Version 2
+*
+********************************************************************/
+
+#include "rtapi.h"
+#include "hal.h"
+#include "motion.h"
+#include "mot_priv.h"
+#include "rtapi_math.h"
+
+void emcmotCompInit(emcmot_comp_t * comp)
+{
+    int n;
+
+    comp->entries = 0;
+    comp->step_inv = 0.0;
+    comp->entry = &(comp->array[0]);
+    /* the compensation code has -DBL_MAX at one end of the table
+       and +DBL_MAX at the other so _all_ commanded positions are
+       guaranteed to be covered by the table */
+    comp->array[0].nominal = -DBL_MAX;
+    comp->array[0].fwd_trim = 0.0;
+    comp->array[0].rev_trim = 0.0;
+    comp->array[0].fwd_slope = 0.0;
+    comp->array[0].rev_slope = 0.0;
+    for ( n = 1 ; n < EMCMOT_COMP_SIZE+2 ; n++ ) {
+	comp->array[n].nominal = DBL_MAX;
+	comp->array[n].fwd_trim = 0.0;
+	comp->array[n].rev_trim = 0.0;
+	comp->array[n].fwd_slope = 0.0;
+	comp->array[n].rev_slope = 0.0;
+    }
+}
+
+int emcmotCompAdd(emcmot_comp_t * comp, double nominal, double fwd,
+    double rev)
+{
+    emcmot_comp_entry_t *comp_entry;
+    double tmp1 = 0.0;
+
+    if (comp->entries >= EMCMOT_COMP_SIZE) {
+	return -1;
+    }
+    /* point to last entry */
+    comp_entry = &(comp->array[comp->entries]);
+    if (nominal <= comp_entry[0].nominal) {
+	return -2;
+    }
+    /* store data to new entry */
+    comp_entry[1].nominal = nominal;
+    comp_entry[1].fwd_trim = fwd;
+    comp_entry[1].rev_trim = rev;
+    /* calculate slopes from previous entry to the new one */
+    if ( comp_entry[0].nominal != -DBL_MAX ) {
+	/* but only if the previous entry is "real" */
+	tmp1 = comp_entry[1].nominal - comp_entry[0].nominal;
+	comp_entry[0].fwd_slope =
+	    (comp_entry[1].fwd_trim - comp_entry[0].fwd_trim) / tmp1;
+	comp_entry[0].rev_slope =
+	    (comp_entry[1].rev_trim - comp_entry[0].rev_trim) / tmp1;
+    } else {
+	/* previous entry is at minus infinity, slopes are zero */
+	comp_entry[0].fwd_trim = comp_entry[1].fwd_trim;
+	comp_entry[0].rev_trim = comp_entry[1].rev_trim;
+    }
+    /* keep track of whether the entries are evenly spaced, so the
+       controller can index the table instead of searching it */
+    if (comp->entries == 1) {
+	comp->step_inv = 1.0 / tmp1;
+    } else if (comp->entries > 1 &&
+	fabs(tmp1 * comp->step_inv - 1.0) > 1e-6) {
+	comp->step_inv = 0.0;
+    }
+    comp->entries++;
+    return 0;
+}
+
+emcmot_comp_entry_t *emcmotCompFind(emcmot_comp_t * comp, double pos)
+{
+    double index;
+
+    if ( comp->step_inv > 0.0 ) {
+	/* evenly spaced entries, index straight into the table;
+	   the searches below then fix up any rounding */
+	index = floor((pos - comp->array[1].nominal) * comp->step_inv) + 1.0;
+	if ( index < 0.0 ) {
+	    index = 0.0;
+	} else if ( index > comp->entries ) {
+	    index = comp->entries;
+	}
+	comp->entry = &(comp->array[(int) index]);
+    }
+    /* make sure we're in the right spot in the table */
+    while ( pos < comp->entry->nominal ) {
+	comp->entry--;
+    }
+    while ( pos >= (comp->entry+1)->nominal ) {
+	comp->entry++;
+    }
+    return comp->entry;
+}
+
+void emcmotVolcompLookup(const emcmot_volcomp_t * vc, const double pos[3],
+    double corr[3])
+{
+    const float (*p)[3];
+    double u, t[3];
+    int n, i[3], dx, dy, dz;
+
+    /* find the grid cell the position is in, and where in it; outside
+       the grid the edge values carry on */
+    for (n = 0; n < 3; n++) {
+	u = (pos[n] - vc->grid.origin[n]) / vc->grid.step[n];
+	if (u <= 0.0) {
+	    i[n] = 0;
+	    t[n] = 0.0;
+	} else if (u >= vc->grid.count[n] - 1) {
+	    i[n] = vc->grid.count[n] - 2;
+	    t[n] = 1.0;
+	} else {
+	    i[n] = (int) floor(u);
+	    if (i[n] > vc->grid.count[n] - 2) {
+		i[n] = vc->grid.count[n] - 2;
+	    }
+	    t[n] = u - i[n];
+	}
+    }
+    /* trilinear interpolation between the cell's eight corners */
+    dx = 1;
+    dy = vc->grid.count[0];
+    dz = vc->grid.count[0] * vc->grid.count[1];
+    p = &(vc->err[i[2] * dz + i[1] * dy + i[0]]);
+    for (n = 0; n < 3; n++) {
+	corr[n] =
+	    (1.0 - t[2]) * ((1.0 - t[1]) * ((1.0 - t[0]) * p[0][n] +
+		    t[0] * p[dx][n]) +
+		t[1] * ((1.0 - t[0]) * p[dy][n] + t[0] * p[dy + dx][n])) +
+	    t[2] * ((1.0 - t[1]) * ((1.0 - t[0]) * p[dz][n] +
+		    t[0] * p[dz + dx][n]) +
+		t[1] * ((1.0 - t[0]) * p[dz + dy][n] +
+		    t[0] * p[dz + dy + dx][n]));
+    }
+}
@@ -189,6 +189,14 @@ static void get_pos_cmds(long period);
 */
 static void compute_screw_comp(void);
 
+/* 'compute_vol_comp()' looks up the X, Y and Z error of the machine at
+   the commanded position in the volumetric comp table, and ramps
+   vol_filt of joints 0, 1 and 2 towards it at no more than the table's
+   max_vel.  Like backlash_filt, vol_filt is later added to joint_pos_cmd
+   to create motor_pos_cmd and subtracted from motor_pos_fb.
+*/
+static void compute_vol_comp(void);
+
 /* 'output_to_hal()' writes the handles the final stages of the
    control function.  It applies screw comp and writes the
    final motor position to the HAL (which routes it to the PID
@@ -331,6 +339,8 @@ check_stuff ( "after do_homing()" );
 check_stuff ( "after get_pos_cmds()" );
     compute_screw_comp();
 check_stuff ( "after compute_screw_comp()" );
+    compute_vol_comp();
+check_stuff ( "after compute_vol_comp()" );
     output_to_hal();
 check_stuff ( "after output_to_hal()" );
     update_status();
@@ -339,6 +349,7 @@ check_stuff ( "after update_status()" );
     emcmotStatus->heartbeat++;
     /* set tail to head, to indicate work complete */
     emcmotStatus->tail = emcmotStatus->head;
+    emcmot_publish_status();
     /* clear init flag */
     first_pass = 0;
 
@@ -514,9 +525,10 @@ static void process_inputs(void)
 	       to match the commanded value instead. */
 	    joint->pos_fb = joint->pos_cmd;
 	} else {
-	    /* normal case: subtract backlash comp and motor offset */
+	    /* normal case: subtract screw and volumetric comp and motor
+	       offset */
 	    joint->pos_fb = joint->motor_pos_fb -
-		(joint->backlash_filt + joint->motor_offset);
+		(joint->backlash_filt + joint->vol_filt + joint->motor_offset);
 	}
 	/* calculate following error */
 	joint->ferror = joint->pos_cmd - joint->pos_fb;
@@ -1576,13 +1588,8 @@ static void compute_screw_comp(void)
 	comp = &(joint->comp);
 	if ( comp->entries > 0 ) {
 	    /* there is data in the comp table, use it */
-	    /* first make sure we're in the right spot in the table */
-	    while ( joint->pos_cmd < comp->entry->nominal ) {
-		comp->entry--;
-	    }
-	    while ( joint->pos_cmd >= (comp->entry+1)->nominal ) {
-		comp->entry++;
-	    }
+	    /* first find the right spot in the table */
+	    emcmotCompFind(comp, joint->pos_cmd);
 	    /* now interpolate */
 	    dpos = joint->pos_cmd - comp->entry->nominal;
 	    if (joint->vel_cmd > 0.0) {
@@ -1739,6 +1746,38 @@ static void compute_screw_comp(void)
     }
 }
 
+static void compute_vol_comp(void)
+{
+    emcmot_volcomp_t *vc = emcmotVolcomp;
+    emcmot_joint_t *joint;
+    double pos[3], corr[3], max_step, d;
+    int n;
+
+    if (vc->enabled) {
+	for (n = 0; n < 3; n++) {
+	    pos[n] = joints[n].pos_cmd;
+	}
+	emcmotVolcompLookup(vc, pos, corr);
+    } else {
+	/* disabled, ramp any correction back out */
+	corr[0] = corr[1] = corr[2] = 0.0;
+    }
+
+    /* the correction doesn't go through the trajectory planner, so
+       limit how far it can move the joints in one cycle */
+    max_step = vc->grid.max_vel * servo_period;
+    for (n = 0; n < 3 && n < num_joints; n++) {
+	joint = &joints[n];
+	d = corr[n] - joint->vol_filt;
+	if (d > max_step) {
+	    d = max_step;
+	} else if (d < -max_step) {
+	    d = -max_step;
+	}
+	joint->vol_filt += d;
+    }
+}
+
 /*! \todo FIXME - once the HAL refactor is done so that metadata isn't stored
    in shared memory, I want to seriously consider moving some of the
    structures into the HAL memory block.  This will eliminate most of
@@ -1850,9 +1889,9 @@ static void output_to_hal(void)
     for (joint_num = 0; joint_num < num_joints; joint_num++) {
 	/* point to joint struct */
 	joint = &joints[joint_num];
-	/* apply backlash and motor offset to output */
-	joint->motor_pos_cmd =
-	    joint->pos_cmd + joint->backlash_filt + joint->motor_offset;
+	/* apply backlash, volumetric comp and motor offset to output */
+	joint->motor_pos_cmd = joint->pos_cmd + joint->backlash_filt +
+	    joint->vol_filt + joint->motor_offset;
 	/* point to HAL data */
 	joint_data = &(emcmot_hal_data->joint[joint_num]);
 	/* write to HAL pins */
@@ -1869,6 +1908,7 @@ static void output_to_hal(void)
 	*(joint_data->backlash_corr) = joint->backlash_corr;
 	*(joint_data->backlash_filt) = joint->backlash_filt;
 	*(joint_data->backlash_vel) = joint->backlash_vel;
+	*(joint_data->vol_comp) = joint->vol_filt;
 	*(joint_data->f_error) = joint->ferror;
 	*(joint_data->f_error_lim) = joint->ferror_limit;
 
@@ -1895,6 +1935,7 @@ static void update_status(void)
     int joint_num, dio, aio;
     emcmot_joint_t *joint;
     emcmot_joint_status_t *joint_status;
+    emcmot_joint_settings_t *joint_settings;
 #ifdef WATCH_FLAGS
     static int old_joint_flags[8];
     static int old_motion_flag;
@@ -1921,12 +1962,13 @@ static void update_status(void)
 	joint_status->vel_cmd = joint->vel_cmd;
 	joint_status->ferror = joint->ferror;
 	joint_status->ferror_high_mark = joint->ferror_high_mark;
-	joint_status->backlash = joint->backlash;
-	joint_status->max_pos_limit = joint->max_pos_limit;
-	joint_status->min_pos_limit = joint->min_pos_limit;
-	joint_status->min_ferror = joint->min_ferror;
-	joint_status->max_ferror = joint->max_ferror;
-	joint_status->home_offset = joint->home_offset;
+	joint_settings = &(emcmotStatus->joint_settings[joint_num]);
+	joint_settings->backlash = joint->backlash;
+	joint_settings->max_pos_limit = joint->max_pos_limit;
+	joint_settings->min_pos_limit = joint->min_pos_limit;
+	joint_settings->min_ferror = joint->min_ferror;
+	joint_settings->max_ferror = joint->max_ferror;
+	joint_settings->home_offset = joint->home_offset;
     }
 
     for (dio = 0; dio < num_dio; dio++) {
@@ -1949,7 +1991,11 @@ static void update_status(void)
     emcmotStatus->activeDepth = tpActiveDepth(&emcmotDebug->queue);
     emcmotStatus->id = tpGetExecId(&emcmotDebug->queue);
     emcmotStatus->motionType = tpGetMotionType(&emcmotDebug->queue);
-    emcmotStatus->queueFull = tcqFull(&emcmotDebug->queue.queue);
+    /* task may fill the command ring before it sees this: keep room
+       for all of it */
+    emcmotStatus->queueFull = tcqFull(&emcmotDebug->queue.queue) ||
+	tcqLen(&emcmotDebug->queue.queue) + EMCMOT_COMMAND_RING_LEN >=
+	emcmotDebug->queue.queue.size;
 
     /* check to see if we should pause in order to implement
        single emcmotDebug->stepping */
@@ -36,6 +36,17 @@
 #define EMCMOT_ERROR_NUM 32	/* how many errors we can queue */
 #define EMCMOT_ERROR_LEN 1024	/* how long error string can be */
 
+/* queued line and circle commands: ring size (a power of two), and how
+   many of them the command handler runs per servo cycle */
+#define EMCMOT_COMMAND_RING_LEN 64
+#define EMCMOT_COMMAND_BUDGET 16
+
+/* copies of the status published for user space, at least 3 */
+#define EMCMOT_STATUS_COPIES 3
+
+/* most points in the volumetric compensation grid, e.g. 32 x 32 x 16 */
+#define EMCMOT_VOLCOMP_POINTS 16384
+
 /*
   Shared memory keys for simulated motion process. No base address
   values need to be computed, since operating system does this for us
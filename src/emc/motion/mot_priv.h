@@ -37,6 +37,7 @@ typedef struct {
     hal_float_t *backlash_corr;	/* RPI: correction for backlash */
     hal_float_t *backlash_filt;	/* RPI: filtered backlash correction */
     hal_float_t *backlash_vel;	/* RPI: backlash speed variable */
+    hal_float_t *vol_comp;	/* RPI: volumetric correction */
     hal_float_t *motor_offset;	/* RPI: motor offset, for checking homing stability */
     hal_float_t *motor_pos_cmd;	/* WPI: commanded position, with comp */
     hal_float_t *motor_pos_fb;	/* RPI: position feedback, with comp */
@@ -225,11 +226,14 @@ extern double servo_freq;
 /* Struct pointers */
 extern struct emcmot_struct_t *emcmotStruct;
 extern struct emcmot_command_t *emcmotCommand;
+extern struct emcmot_command_ring_t *emcmotCommandRing;
 extern struct emcmot_status_t *emcmotStatus;
+extern struct emcmot_status_pub_t *emcmotStatusPub;
 extern struct emcmot_config_t *emcmotConfig;
 extern struct emcmot_debug_t *emcmotDebug;
 extern struct emcmot_internal_t *emcmotInternal;
 extern struct emcmot_error_t *emcmotError;
+extern struct emcmot_volcomp_t *emcmotVolcomp;
 
 /***********************************************************************
 *                    PUBLIC FUNCTION PROTOTYPES                        *
@@ -247,6 +251,17 @@ extern void emcmotAioWrite(int index, double value);
 extern void emcmotSetRotaryUnlock(int axis, int unlock);
 extern int emcmotGetRotaryIsUnlocked(int axis);
 
+/* the compensation table lookups, in compensation.c */
+extern void emcmotCompInit(emcmot_comp_t * comp);
+/* 0, -1 if the table is full, -2 if nominal doesn't increase */
+extern int emcmotCompAdd(emcmot_comp_t * comp, double nominal, double fwd,
+    double rev);
+/* the entry pos is in, also left in comp->entry */
+extern emcmot_comp_entry_t *emcmotCompFind(emcmot_comp_t * comp, double pos);
+/* the X, Y, Z error at pos, interpolated in the table */
+extern void emcmotVolcompLookup(const emcmot_volcomp_t * vc,
+    const double pos[3], double corr[3]);
+
 /* homing is no longer in control.c, make functions public */
 extern void do_homing_sequence(void);
 extern void do_homing(void);
@@ -259,6 +274,7 @@ extern void refresh_jog_limits(emcmot_joint_t *joint);
 extern void clearHomes(int joint_num);
 
 extern void emcmot_config_change(void);
+extern void emcmot_publish_status(void);
 extern void reportError(const char *fmt, ...) __attribute((format(printf,1,2))); /* Use the rtapi_print call */
 
  /* rtapi_get_time() returns a nanosecond value. In time, we should use a u64
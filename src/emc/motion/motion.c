@@ -59,6 +59,10 @@ int num_dio = 4;			/* default number of motion synched DIO */
 RTAPI_MP_INT(num_dio, "number of digital inputs/outputs");
 int num_aio = 4;			/* default number of motion synched AIO */
 RTAPI_MP_INT(num_aio, "number of analog inputs/outputs");
+static int tp_lookahead = TP_DEFAULT_LOOKAHEAD;	/* default is no look-ahead */
+RTAPI_MP_INT(tp_lookahead, "number of segments the trajectory look-ahead replans");
+static int tp_max_feed_override = 100;	/* percent, like the GUI's limit */
+RTAPI_MP_INT(tp_max_feed_override, "highest feed override in percent the look-ahead plans for");
 
 /***********************************************************************
 *                  GLOBAL VARIABLE DEFINITIONS                         *
@@ -88,18 +92,24 @@ int kinType = 0;
   emcmotStruct is ptr to this memory.
 
   emcmotCommand points to emcmotStruct->command,
+  emcmotCommandRing points to emcmotStruct->commandRing,
   emcmotStatus points to emcmotStruct->status,
-  emcmotError points to emcmotStruct->error, and
+  emcmotStatusPub points to emcmotStruct->statusPub,
+  emcmotError points to emcmotStruct->error,
+  emcmotVolcomp points to emcmotStruct->volcomp, and
  */
 emcmot_struct_t *emcmotStruct = 0;
 /* ptrs to either buffered copies or direct memory for
    command and status */
 struct emcmot_command_t *emcmotCommand = 0;
+struct emcmot_command_ring_t *emcmotCommandRing = 0;
 struct emcmot_status_t *emcmotStatus = 0;
+struct emcmot_status_pub_t *emcmotStatusPub = 0;
 struct emcmot_config_t *emcmotConfig = 0;
 struct emcmot_debug_t *emcmotDebug = 0;
 struct emcmot_internal_t *emcmotInternal = 0;
 struct emcmot_error_t *emcmotError = 0;	/* unused for RT_FIFO */
+struct emcmot_volcomp_t *emcmotVolcomp = 0;
 
 /***********************************************************************
 *                  LOCAL VARIABLE DECLARATIONS                         *
@@ -150,6 +160,26 @@ void emcmot_config_change(void)
     }
 }
 
+/* makes the status as it is now the latest copy user space sees */
+void emcmot_publish_status(void)
+{
+    unsigned int next = emcmotStatusPub->gen + 1;
+    emcmot_status_t *latest;
+    char *cold;
+
+    /* readers copy the cold end only when cold_num says it changed */
+    latest = &emcmotStatusPub->copy[emcmotStatusPub->gen % EMCMOT_STATUS_COPIES];
+    cold = (char *) emcmotStatus->joint_settings;
+    if (memcmp(cold, latest->joint_settings,
+	    (char *) &emcmotStatus->tail - cold) != 0) {
+	emcmotStatus->cold_num++;
+    }
+    emcmotStatusPub->copy[next % EMCMOT_STATUS_COPIES] = *emcmotStatus;
+    /* the copy has to be complete before gen points readers at it */
+    emcmot_barrier();
+    emcmotStatusPub->gen = next;
+}
+
 void reportError(const char *fmt, ...)
 {
     va_list args;
@@ -725,6 +755,11 @@ static int export_joint(int num, joint_hal_t * addr)
     if (retval != 0) {
 	return retval;
     }
+    retval =
+	hal_pin_float_newf(HAL_OUT, &(addr->vol_comp), mot_comp_id, "axis.%d.vol-comp", num);
+    if (retval != 0) {
+	return retval;
+    }
     retval = hal_pin_float_newf(HAL_OUT, &(addr->f_error), mot_comp_id, "axis.%d.f-error", num);
     if (retval != 0) {
 	return retval;
@@ -814,7 +849,7 @@ static int export_joint(int num, joint_hal_t * addr)
 */
 static int init_comm_buffers(void)
 {
-    int joint_num, n;
+    int joint_num;
     emcmot_joint_t *joint;
     int retval;
 
@@ -824,7 +859,9 @@ static int init_comm_buffers(void)
     emcmotStruct = 0;
     emcmotDebug = 0;
     emcmotStatus = 0;
+    emcmotStatusPub = 0;
     emcmotCommand = 0;
+    emcmotCommandRing = 0;
     emcmotConfig = 0;
 
     /* record the kinematics type of the machine */
@@ -849,11 +886,14 @@ static int init_comm_buffers(void)
 
     /* we'll reference emcmotStruct directly */
     emcmotCommand = &emcmotStruct->command;
+    emcmotCommandRing = &emcmotStruct->commandRing;
     emcmotStatus = &emcmotStruct->status;
+    emcmotStatusPub = &emcmotStruct->statusPub;
     emcmotConfig = &emcmotStruct->config;
     emcmotDebug = &emcmotStruct->debug;
     emcmotInternal = &emcmotStruct->internal;
     emcmotError = &emcmotStruct->error;
+    emcmotVolcomp = &emcmotStruct->volcomp;
 
     /* init error struct */
     emcmotErrorInit(emcmotError);
@@ -865,11 +905,20 @@ static int init_comm_buffers(void)
     emcmotCommand->tail = 0;
     emcmotCommand->spindlesync = 0.0;
 
+    /* init command ring */
+    emcmotCommandRing->head = 0;
+    emcmotCommandRing->tail = 0;
+    emcmotCommandRing->failSeen = 0;
+
     /* init status struct */
     emcmotStatus->head = 0;
     emcmotStatus->commandEcho = 0;
     emcmotStatus->commandNumEcho = 0;
     emcmotStatus->commandStatus = 0;
+    emcmotStatus->queuedNumEcho = 0;
+    emcmotStatus->queuedFailNum = 0;
+    emcmotStatus->queuedFailId = 0;
+    emcmotStatus->queuedFailStatus = 0;
 
     /* init more stuff */
 
@@ -889,6 +938,7 @@ static int init_comm_buffers(void)
     ZERO_EMC_POSE(emcmotStatus->carte_pos_fb);
     emcmotStatus->vel = VELOCITY;
     emcmotConfig->limitVel = VELOCITY;
+    emcmotConfig->limitJerk = 0.0;
     emcmotStatus->acc = ACCELERATION;
     emcmotStatus->feed_scale = 1.0;
     emcmotStatus->spindle_scale = 1.0;
@@ -942,23 +992,7 @@ static int init_comm_buffers(void)
 	joint->home_sequence = -1;
 	joint->backlash = 0.0;
 
-	joint->comp.entries = 0;
-	joint->comp.entry = &(joint->comp.array[0]);
-	/* the compensation code has -DBL_MAX at one end of the table
-	   and +DBL_MAX at the other so _all_ commanded positions are
-	   guaranteed to be covered by the table */
-	joint->comp.array[0].nominal = -DBL_MAX;
-	joint->comp.array[0].fwd_trim = 0.0;
-	joint->comp.array[0].rev_trim = 0.0;
-	joint->comp.array[0].fwd_slope = 0.0;
-	joint->comp.array[0].rev_slope = 0.0;
-	for ( n = 1 ; n < EMCMOT_COMP_SIZE+2 ; n++ ) {
-	    joint->comp.array[n].nominal = DBL_MAX;
-	    joint->comp.array[n].fwd_trim = 0.0;
-	    joint->comp.array[n].rev_trim = 0.0;
-	    joint->comp.array[n].fwd_slope = 0.0;
-	    joint->comp.array[n].rev_slope = 0.0;
-	}
+	emcmotCompInit(&(joint->comp));
 
 	/* init status info */
 	joint->flag = 0;
@@ -968,6 +1002,7 @@ static int init_comm_buffers(void)
 	joint->backlash_corr = 0.0;
 	joint->backlash_filt = 0.0;
 	joint->backlash_vel = 0.0;
+	joint->vol_filt = 0.0;
 	joint->motor_pos_cmd = 0.0;
 	joint->motor_pos_fb = 0.0;
 	joint->pos_fb = 0.0;
@@ -1034,8 +1069,20 @@ static int init_comm_buffers(void)
     tpSetPos(&emcmotDebug->queue, emcmotStatus->carte_pos_cmd);
     tpSetVmax(&emcmotDebug->queue, emcmotStatus->vel, emcmotStatus->vel);
     tpSetAmax(&emcmotDebug->queue, emcmotStatus->acc);
+    if (-1 == tpSetLookahead(&emcmotDebug->queue, tp_lookahead)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "MOTION: tp_lookahead %d out of range, look-ahead is off\n",
+	    tp_lookahead);
+    }
+    if (-1 == tpSetMaxFeedScale(&emcmotDebug->queue,
+	    tp_max_feed_override / 100.0)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "MOTION: tp_max_feed_override %d out of range, using %d\n",
+	    tp_max_feed_override, (int) (TP_DEFAULT_MAX_FEED_SCALE * 100));
+    }
 
     emcmotStatus->tail = 0;
+    emcmot_publish_status();
 
     rtapi_print_msg(RTAPI_MSG_INFO, "MOTION: init_comm_buffers() complete\n");
     return 0;
@@ -155,6 +155,7 @@ extern "C" {
 	EMCMOT_SET_JOINT_VEL_LIMIT,	/* set the max joint vel */
 	EMCMOT_SET_JOINT_ACC_LIMIT,	/* set the max joint accel */
 	EMCMOT_SET_ACC,		/* set the max accel for moves (tooltip) */
+	EMCMOT_SET_JERK,	/* set the max jerk for moves (tooltip) */
 	EMCMOT_SET_TERM_COND,	/* set termination condition (stop, blend) */
 	EMCMOT_SET_NUM_AXES,	/* set the number of joints */ //FIXME-AJ: function needs to get renamed
 	EMCMOT_SET_WORLD_HOME,	/* set pose for world home */
@@ -173,6 +174,7 @@ extern "C" {
 	EMCMOT_SPINDLE_ORIENT,          /* orient the spindle */
 	EMCMOT_SET_MOTOR_OFFSET,	/* set the offset between joint and motor */
 	EMCMOT_SET_JOINT_COMP,	/* set a compensation triplet for a joint (nominal, forw., rev.) */
+	EMCMOT_SET_VOLCOMP,	/* enable or disable the volumetric comp table */
         EMCMOT_SET_OFFSET, /* set tool offsets */
     } cmd_code_t;
 
@@ -190,6 +192,14 @@ extern "C" {
 #define EMCMOT_TERM_COND_STOP 1
 #define EMCMOT_TERM_COND_BLEND 2
 
+/* volumetric compensation grid, see emcmot_volcomp_t below */
+    typedef struct {
+	double origin[3];	/* X, Y, Z of the first point */
+	double step[3];		/* spacing of the points along X, Y, Z */
+	int count[3];		/* number of points along X, Y, Z */
+	double max_vel;		/* how fast the correction may change */
+    } emcmot_volcomp_grid_t;
+
 /*********************************
        COMMAND STRUCTURE
 *********************************/
@@ -214,6 +224,7 @@ extern "C" {
         int motion_type;        /* this move is because of traverse, feed, arc, or toolchange */
         double spindlesync;     /* user units per spindle revolution, 0 = no sync */
 	double acc;		/* max acceleration */
+	double jerk;		/* max jerk, 0 for none */
 	double backlash;	/* amount of backlash */
 	int id;			/* id for motion */
 	int termCond;		/* termination condition */
@@ -236,6 +247,7 @@ extern "C" {
 	unsigned char now, out, start, end;	/* these are related to synched AOUT/DOUT. now=wether now or synched, out = which gets set, start=start value, end=end value */
 	unsigned char mode;	/* used for turning overrides etc. on/off */
 	double comp_nominal, comp_forward, comp_reverse; /* compensation triplet, nominal, forward, reverse */
+	emcmot_volcomp_grid_t volcomp;	/* volumetric comp grid */
         unsigned char probe_type; /* ~1 = error if probe operation is unsuccessful (ngc default)
                                      |1 = suppress error, report in # instead
                                      ~2 = move until probe trips (ngc default)
@@ -247,6 +259,22 @@ extern "C" {
 	unsigned char tail;	/* flag count for mutex detect */
     } emcmot_command_t;
 
+/* Line and circle commands can also be queued here, without waiting for
+   each to be echoed.  Usrmot is the only writer of head and the slots,
+   the command handler the only writer of tail; both count up and wrap,
+   the slot being the count modulo EMCMOT_COMMAND_RING_LEN.  After a
+   queued command fails, the ones behind it are dropped until usrmot has
+   passed the failure on.
+*/
+    typedef struct emcmot_command_ring_t {
+	volatile unsigned int head;	/* next slot to write */
+	volatile unsigned int tail;	/* next slot to run */
+	volatile int failSeen;	/* queuedFailNum usrmot has passed on */
+	emcmot_command_t slot[EMCMOT_COMMAND_RING_LEN];
+    } emcmot_command_ring_t;
+
+#define emcmot_barrier() __sync_synchronize()
+
 /*! \todo FIXME - these packed bits might be replaced with chars
    memory is cheap, and being able to access them without those
    damn macros would be nice
@@ -381,14 +409,28 @@ Suggestion: Split this in to an Error and a Status flag register..
     } emcmot_comp_entry_t; 
 
 
-#define EMCMOT_COMP_SIZE 256
+#define EMCMOT_COMP_SIZE 1024
     typedef struct {
 	int entries;		/* number of entries in the array */
+	double step_inv;	/* 1/spacing while the entries are evenly
+				   spaced, 0 if they aren't */
 	emcmot_comp_entry_t *entry;  /* current entry in array */
 	emcmot_comp_entry_t array[EMCMOT_COMP_SIZE+2];
 	/* +2 because array has -HUGE_VAL and +HUGE_VAL entries at the ends */
     } emcmot_comp_t;
 
+/* Volumetric compensation: the X, Y and Z error of the machine on a
+   uniform grid over X, Y and Z.  Point (i, j, k) is at origin + (i, j, k)
+   * step, and is err[(k * count[1] + j) * count[0] + i].  Usrmot fills
+   err[] in place while the table is disabled, then sends the grid with
+   EMCMOT_SET_VOLCOMP to enable it; a count of 0 disables it again.
+*/
+    typedef struct emcmot_volcomp_t {
+	emcmot_volcomp_grid_t grid;	/* as last sent */
+	volatile int enabled;	/* non-zero while err[] is in use */
+	float err[EMCMOT_VOLCOMP_POINTS][3];	/* X, Y, Z error at each point */
+    } emcmot_volcomp_t;
+
 /* motion controller states */
 
     typedef enum {
@@ -500,6 +542,7 @@ Suggestion: Split this in to an Error and a Status flag register..
 	double backlash_corr;	/* correction for backlash */
 	double backlash_filt;	/* filtered backlash correction */
 	double backlash_vel;	/* backlash velocity variable */
+	double vol_filt;	/* volumetric correction, slew limited */
 	double motor_pos_cmd;	/* commanded position, with comp */
 	double motor_pos_fb;	/* position feedback, with comp */
 	double pos_fb;		/* position feedback, comp removed */
@@ -553,19 +596,22 @@ Suggestion: Split this in to an Error and a Status flag register..
 	double vel_cmd;         /* current velocity */
 	double ferror;		/* following error */
 	double ferror_high_mark;	/* max following error */
+    } emcmot_joint_status_t;
+
+/* The joint data that only changes when a command changes it, part of
+   the cold end of the status.
 
-/*! \todo FIXME - the following are not really "status", but taskintf.cc expects
-   them to be in the status structure.  I don't know how or if they are
-   used by the user space code.  Ideally they will be removed from here,
-   but each one will need to be investigated individually.
+   \todo FIXME - these are not really "status", but taskintf.cc expects
+   them to be in the status structure.  They are read on a config change.
 */
+    typedef struct {
 	double backlash;	/* amount of backlash */
 	double max_pos_limit;	/* upper soft limit on joint pos */
 	double min_pos_limit;	/* lower soft limit on joint pos */
 	double min_ferror;	/* zero speed following error limit */
 	double max_ferror;	/* max speed following error limit */
 	double home_offset;	/* dir/dist from switch to home point */
-    } emcmot_joint_status_t;
+    } emcmot_joint_settings_t;
 
 
     typedef struct {
@@ -603,11 +649,11 @@ Suggestion: Split this in to an Error and a Status flag register..
 	cmd_code_t commandEcho;	/* echo of input command */
 	int commandNumEcho;	/* echo of input command number */
 	cmd_status_t commandStatus;	/* result of most recent command */
-	/* these are config info, updated when a command changes them */
-	double feed_scale;	/* velocity scale factor for all motion */
-	double spindle_scale;	/* velocity scale factor for spindle speed */
-	unsigned char enables_new;	/* flags for FS, SS, etc */
-		/* the above set is the enables in effect for new moves */
+	/* and these when a queued one is */
+	int queuedNumEcho;	/* number of the last queued command run */
+	int queuedFailNum;	/* number of the last one that failed */
+	int queuedFailId;	/* its motion id, the line it came from */
+	cmd_status_t queuedFailStatus;	/* and how */
 	/* the rest are updated every cycle */
 	double net_feed_scale;	/* net scale factor for all motion */
 	double net_spindle_scale;	/* net scale factor for spindle */
@@ -620,7 +666,6 @@ Suggestion: Split this in to an Error and a Status flag register..
 	int carte_pos_cmd_ok;	/* non-zero if command is valid */
 	EmcPose carte_pos_fb;	/* actual Cartesian position */
 	int carte_pos_fb_ok;	/* non-zero if feedback is valid */
-	EmcPose world_home;	/* cartesean coords of home position */
 	int homing_active;	/* non-zero if any joint is homing */
 	home_sequence_state_t homingSequenceState;
 	emcmot_joint_status_t joint_status[EMCMOT_MAX_JOINTS];	/* all joint status data */
@@ -641,11 +686,6 @@ Suggestion: Split this in to an Error and a Status flag register..
         double spindleSpeedIn;  /* velocity of spindle in revolutions per minute */
 
 	spindle_status spindle;	/* data types for spindle status */
-	
-	int synch_di[EMCMOT_MAX_DIO]; /* inputs to the motion controller, queried by g-code */
-	int synch_do[EMCMOT_MAX_DIO]; /* outputs to the motion controller, queried by g-code */
-	double analog_input[EMCMOT_MAX_AIO]; /* inputs to the motion controller, queried by g-code */
-	double analog_output[EMCMOT_MAX_AIO]; /* outputs to the motion controller, queried by g-code */
 
 /*! \todo FIXME - all structure members beyond this point are in limbo */
 
@@ -653,6 +693,8 @@ Suggestion: Split this in to an Error and a Status flag register..
 	unsigned int heartbeat;
 	int config_num;		/* incremented whenever configuration
 				   changed. */
+	unsigned int cold_num;	/* incremented whenever the cold end
+				   below changed */
 	double computeTime;
 	int id;			/* id for executing motion */
 	int depth;		/* motion queue depth */
@@ -664,10 +706,6 @@ Suggestion: Split this in to an Error and a Status flag register..
 				/* 2 << (joint-num*2) = ignore pos limit */
 
 
-	/* static status-- only changes upon input commands, e.g., config */
-	double vel;		/* scalar max vel */
-	double acc;		/* scalar max accel */
-
 	int level;
         int motionType;
         double distance_to_go;  /* in this move */
@@ -676,13 +714,42 @@ Suggestion: Split this in to an Error and a Status flag register..
         double requested_vel;
 
         unsigned int tcqlen;
-        EmcPose tool_offset;
         int atspeed_next_feed;  /* at next feed move, wait for spindle to be at speed  */
         int spindle_is_atspeed; /* hal input */
+
+	/* The cold end, from joint_settings up to tail: what only changes
+	   upon input commands, e.g., config, or when a motion I/O pin does.
+	   Motion bumps cold_num when a copy it publishes differs here from
+	   the one before, readers copy it only then. */
+	emcmot_joint_settings_t joint_settings[EMCMOT_MAX_JOINTS];
+	EmcPose world_home;	/* cartesean coords of home position */
+	double feed_scale;	/* velocity scale factor for all motion */
+	double spindle_scale;	/* velocity scale factor for spindle speed */
+	unsigned char enables_new;	/* flags for FS, SS, etc */
+		/* the above set is the enables in effect for new moves */
+	double vel;		/* scalar max vel */
+	double acc;		/* scalar max accel */
+        EmcPose tool_offset;
+	int synch_di[EMCMOT_MAX_DIO]; /* inputs to the motion controller, queried by g-code */
+	int synch_do[EMCMOT_MAX_DIO]; /* outputs to the motion controller, queried by g-code */
+	double analog_input[EMCMOT_MAX_AIO]; /* inputs to the motion controller, queried by g-code */
+	double analog_output[EMCMOT_MAX_AIO]; /* outputs to the motion controller, queried by g-code */
+
 	unsigned char tail;	/* flag count for mutex detect */
         
     } emcmot_status_t;
 
+/* The status as of the end of the last servo cycle, for user space.
+   Motion fills copy[(gen + 1) % EMCMOT_STATUS_COPIES], then bumps gen,
+   so copy[gen % EMCMOT_STATUS_COPIES] is the latest and is left alone
+   until gen has gone up by EMCMOT_STATUS_COPIES - 1.  Readers use it in
+   place or copy it, and only have to check gen afterwards.
+*/
+    typedef struct emcmot_status_pub_t {
+	volatile unsigned int gen;	/* copies published so far */
+	emcmot_status_t copy[EMCMOT_STATUS_COPIES];
+    } emcmot_status_pub_t;
+
 /*********************************
         CONFIG STRUCTURE
 *********************************/
@@ -728,6 +795,7 @@ Suggestion: Split this in to an Error and a Status flag register..
 				   approx line 50 */
 
 	double limitVel;	/* scalar upper limit on vel */
+	double limitJerk;	/* scalar upper limit on jerk, 0 for none */
 	KINEMATICS_TYPE kinematics_type;
 	int debug;		/* copy of DEBUG, from .ini file */
 	unsigned char tail;	/* flag count for mutex detect */
@@ -0,0 +1,204 @@
+/********************************************************************
+* Description:  test_motion_comp.c
+*               Checks the volumetric comp lookup against a function
+*               trilinear interpolation reproduces exactly, and the
+*               indexed screw comp lookup against a walk from the
+*               start of the table.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+
+#include "rtapi.h"
+#include "hal.h"
+#include "motion.h"
+#include "mot_priv.h"
+#include "tests/unittest.h"
+
+#define LOOKUPS 100000
+
+static emcmot_volcomp_t vc;
+static emcmot_comp_t even, uneven, full;
+
+/* linear in each of x, y and z, so trilinear interpolation is exact */
+static double error_at(const double pos[3], int n)
+{
+    return 0.1 * (n + 1) + 0.2 * pos[0] - 0.3 * pos[1] + 0.05 * pos[2] +
+	0.01 * (n + 1) * pos[0] * pos[1] * pos[2];
+}
+
+static double random_in(double lo, double hi)
+{
+    return lo + (hi - lo) * rand() / RAND_MAX;
+}
+
+static void fill_grid(void)
+{
+    double pos[3];
+    int i, j, k, n, p;
+
+    vc.grid.origin[0] = -1.0;
+    vc.grid.origin[1] = 2.0;
+    vc.grid.origin[2] = 0.5;
+    vc.grid.step[0] = 0.5;
+    vc.grid.step[1] = 1.0;
+    vc.grid.step[2] = 2.0;
+    vc.grid.count[0] = 7;
+    vc.grid.count[1] = 4;
+    vc.grid.count[2] = 5;
+    for (k = 0; k < vc.grid.count[2]; k++) {
+	for (j = 0; j < vc.grid.count[1]; j++) {
+	    for (i = 0; i < vc.grid.count[0]; i++) {
+		pos[0] = vc.grid.origin[0] + i * vc.grid.step[0];
+		pos[1] = vc.grid.origin[1] + j * vc.grid.step[1];
+		pos[2] = vc.grid.origin[2] + k * vc.grid.step[2];
+		p = (k * vc.grid.count[1] + j) * vc.grid.count[0] + i;
+		for (n = 0; n < 3; n++) {
+		    vc.err[p][n] = error_at(pos, n);
+		}
+	    }
+	}
+    }
+}
+
+/* the largest difference from the function, over random positions
+   from 'margin' steps outside the grid to as far inside it */
+static double check_volcomp(double margin)
+{
+    double pos[3], clamped[3], corr[3], lo, hi, worst;
+    int l, n;
+
+    worst = 0.0;
+    for (l = 0; l < LOOKUPS; l++) {
+	for (n = 0; n < 3; n++) {
+	    lo = vc.grid.origin[n] - margin * vc.grid.step[n];
+	    hi = vc.grid.origin[n] +
+		(vc.grid.count[n] - 1 + margin) * vc.grid.step[n];
+	    pos[n] = random_in(lo, hi);
+	    /* outside the grid the edge values carry on */
+	    lo = vc.grid.origin[n];
+	    hi = vc.grid.origin[n] + (vc.grid.count[n] - 1) * vc.grid.step[n];
+	    clamped[n] = pos[n] < lo ? lo : pos[n] > hi ? hi : pos[n];
+	}
+	emcmotVolcompLookup(&vc, pos, corr);
+	for (n = 0; n < 3; n++) {
+	    if (fabs(corr[n] - error_at(clamped, n)) > worst) {
+		worst = fabs(corr[n] - error_at(clamped, n));
+	    }
+	}
+    }
+    return worst;
+}
+
+static void fill_comp(emcmot_comp_t * comp, int entries, double step,
+    double wobble)
+{
+    double nominal;
+    int n;
+
+    emcmotCompInit(comp);
+    for (n = 0; n < entries; n++) {
+	nominal = -2.0 + n * step + ((n & 1) ? wobble : 0.0);
+	emcmotCompAdd(comp, nominal, 0.01 * sin(nominal),
+	    -0.01 * cos(nominal));
+    }
+}
+
+/* the entry pos is in, walking from the start of the table */
+static emcmot_comp_entry_t *walk(emcmot_comp_t * comp, double pos)
+{
+    emcmot_comp_entry_t *entry = &(comp->array[0]);
+
+    while (pos >= (entry + 1)->nominal) {
+	entry++;
+    }
+    return entry;
+}
+
+/* lookups at random positions, around the table and on its entries,
+   that end up somewhere else than the walk */
+static int check_comp(emcmot_comp_t * comp)
+{
+    emcmot_comp_entry_t *last;
+    double lo, hi, pos;
+    int l, wrong;
+
+    lo = comp->array[1].nominal;
+    hi = comp->array[comp->entries].nominal;
+    wrong = 0;
+    for (l = 0; l < LOOKUPS; l++) {
+	if (l & 1) {
+	    pos = comp->array[1 + rand() % comp->entries].nominal;
+	} else {
+	    pos = random_in(lo - (hi - lo) / 4, hi + (hi - lo) / 4);
+	}
+	wrong += emcmotCompFind(comp, pos) != walk(comp, pos);
+	wrong += comp->entry != walk(comp, pos);
+    }
+    /* and in the ends of the table, both ways */
+    last = &(comp->array[comp->entries]);
+    wrong += emcmotCompFind(comp, -DBL_MAX / 2) != &(comp->array[0]);
+    wrong += emcmotCompFind(comp, DBL_MAX / 2) != last;
+    wrong += emcmotCompFind(comp, lo) != &(comp->array[1]);
+    wrong += emcmotCompFind(comp, hi) != last;
+    return wrong;
+}
+
+int main(void)
+{
+    emcmot_comp_entry_t *entry;
+    double pos[3], corr[3], vol_inside, vol_outside;
+    int n, even_wrong, uneven_wrong;
+
+    /* volumetric comp */
+    fill_grid();
+    vol_inside = check_volcomp(0.0);
+    vol_outside = check_volcomp(2.0);
+    CHECK(vol_inside < 1e-5);
+    CHECK(vol_outside < 1e-5);
+    /* on the last point of the grid */
+    for (n = 0; n < 3; n++) {
+	pos[n] = vc.grid.origin[n] + (vc.grid.count[n] - 1) * vc.grid.step[n];
+    }
+    emcmotVolcompLookup(&vc, pos, corr);
+    n = vc.grid.count[0] * vc.grid.count[1] * vc.grid.count[2] - 1;
+    CHECK(corr[0] == vc.err[n][0] && corr[1] == vc.err[n][1] &&
+	corr[2] == vc.err[n][2]);
+
+    /* screw comp, entries 0.1 apart are evenly spaced after rounding */
+    fill_comp(&even, 101, 0.1, 0.0);
+    CHECK(even.entries == 101 && even.step_inv > 9.99 && even.step_inv < 10.01);
+    even_wrong = check_comp(&even);
+    CHECK(even_wrong == 0);
+    fill_comp(&uneven, 101, 0.1, 0.03);
+    CHECK(uneven.entries == 101 && uneven.step_inv == 0.0);
+    uneven_wrong = check_comp(&uneven);
+    CHECK(uneven_wrong == 0);
+
+    /* the interpolation between entries meets the next entry */
+    entry = emcmotCompFind(&even, 0.55);
+    CHECK(fabs(entry->fwd_trim + entry->fwd_slope *
+	    ((entry + 1)->nominal - entry->nominal) - (entry + 1)->fwd_trim) <
+	1e-12);
+
+    /* what the table takes */
+    emcmotCompInit(&full);
+    CHECK(emcmotCompAdd(&full, 1.0, 0.0, 0.0) == 0);
+    CHECK(emcmotCompAdd(&full, 1.0, 0.0, 0.0) == -2);
+    for (n = 1; n < EMCMOT_COMP_SIZE; n++) {
+	emcmotCompAdd(&full, 1.0 + n, 0.0, 0.0);
+    }
+    CHECK(full.entries == EMCMOT_COMP_SIZE);
+    CHECK(emcmotCompAdd(&full, 1.0 + n, 0.0, 0.0) == -1);
+    CHECK(check_comp(&full) == 0);
+
+    printf("volumetric comp off by %.1g inside, %.1g outside, "
+	"screw comp %d + %d misplaced, %s\n", vol_inside, vol_outside,
+	even_wrong, uneven_wrong, CHECK_RESULT);
+    return CHECK_EXIT;
+}
@@ -0,0 +1,308 @@
+/********************************************************************
+* Description:  test_motion_queue.c
+*               Runs usrmot against the motion command handler in a
+*               servo thread, over a shared memory block of its own,
+*               and counts the servo cycles it takes to get moves and
+*               waited for commands across, and what a queued move
+*               that fails does to the ones behind it.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "rtapi.h"
+#include "posemath.h"
+#include "kinematics.h"
+#include "motion.h"
+#include "motion_debug.h"
+#include "motion_struct.h"
+#include "motion_types.h"
+#include "hal.h"
+#include "mot_priv.h"
+#include "usrmotintf.h"
+#include "tests/unittest.h"
+
+#define PERIOD 1000000		/* servo period, nsec */
+#define MOVES 1000
+#define WAITED 100
+#define JOINTS 3
+#define LIMIT 1000.0
+
+/* the shared memory block, motion's and usrmot's view of it */
+static emcmot_struct_t shmem;
+static emcmot_joint_t joint_array[EMCMOT_MAX_JOINTS];
+
+/* what command.c and tp.c expect from the rest of motion */
+emcmot_struct_t *emcmotStruct;
+emcmot_command_t *emcmotCommand;
+emcmot_command_ring_t *emcmotCommandRing;
+emcmot_status_t *emcmotStatus;
+emcmot_status_pub_t *emcmotStatusPub;
+emcmot_config_t *emcmotConfig;
+emcmot_debug_t *emcmotDebug;
+emcmot_internal_t *emcmotInternal;
+emcmot_error_t *emcmotError;
+emcmot_volcomp_t *emcmotVolcomp;
+emcmot_hal_data_t *emcmot_hal_data;
+emcmot_joint_t *joints = joint_array;
+int num_joints = JOINTS;
+int num_dio = 0;
+int num_aio = 0;
+int kinType = KINEMATICS_IDENTITY;
+int rehomeAll;
+
+static int errors;
+
+void reportError(const char *fmt, ...)
+{
+    errors++;
+}
+
+void check_stuff(const char *location)
+{
+}
+
+void emcmot_config_change(void)
+{
+}
+
+void emcmot_publish_status(void)
+{
+    unsigned int next = emcmotStatusPub->gen + 1;
+    emcmot_status_t *latest;
+    char *cold;
+
+    latest = &emcmotStatusPub->copy[emcmotStatusPub->gen % EMCMOT_STATUS_COPIES];
+    cold = (char *) emcmotStatus->joint_settings;
+    if (memcmp(cold, latest->joint_settings,
+	    (char *) &emcmotStatus->tail - cold) != 0) {
+	emcmotStatus->cold_num++;
+    }
+    emcmotStatusPub->copy[next % EMCMOT_STATUS_COPIES] = *emcmotStatus;
+    emcmot_barrier();
+    emcmotStatusPub->gen = next;
+}
+
+int kinematicsInverse(const EmcPose * pos, double *joint,
+    const KINEMATICS_INVERSE_FLAGS * iflags,
+    KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    joint[0] = pos->tran.x;
+    joint[1] = pos->tran.y;
+    joint[2] = pos->tran.z;
+    return 0;
+}
+
+/* what usrmot gets from RTAPI: the block above */
+int rtapi_init(const char *modname)
+{
+    return 1;
+}
+
+int rtapi_exit(int module_id)
+{
+    return 0;
+}
+
+int rtapi_shmem_new(int key, int module_id, unsigned long int size)
+{
+    return size == sizeof(shmem) ? 1 : -1;
+}
+
+int rtapi_shmem_delete(int shmem_id, int module_id)
+{
+    return 0;
+}
+
+int rtapi_shmem_getptr(int shmem_id, void **ptr)
+{
+    *ptr = &shmem;
+    return 0;
+}
+
+void rtapi_print(const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+void rtapi_print_msg(int level, const char *fmt, ...)
+{
+}
+
+/* the part of motion's servo thread that deals with commands */
+static volatile int done;
+
+static void *servo(void *arg)
+{
+    struct timespec next;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!done) {
+	emcmotCommandHandler(0, PERIOD);
+	tpRunCycle(&emcmotDebug->queue, PERIOD);
+	emcmotStatus->depth = tpQueueDepth(&emcmotDebug->queue);
+	emcmotStatus->queueFull = tcqFull(&emcmotDebug->queue.queue) ||
+	    tcqLen(&emcmotDebug->queue.queue) + EMCMOT_COMMAND_RING_LEN >=
+	    emcmotDebug->queue.queue.size;
+	emcmotStatus->heartbeat++;
+	emcmot_publish_status();
+	next.tv_nsec += PERIOD;
+	if (next.tv_nsec >= 1000000000) {
+	    next.tv_nsec -= 1000000000;
+	    next.tv_sec++;
+	}
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    return NULL;
+}
+
+static void setup(void)
+{
+    int n;
+
+    emcmotStruct = &shmem;
+    emcmotCommand = &shmem.command;
+    emcmotCommandRing = &shmem.commandRing;
+    emcmotStatus = &shmem.status;
+    emcmotStatusPub = &shmem.statusPub;
+    emcmotConfig = &shmem.config;
+    emcmotDebug = &shmem.debug;
+    emcmotError = &shmem.error;
+    emcmotVolcomp = &shmem.volcomp;
+    for (n = 0; n < JOINTS; n++) {
+	SET_JOINT_ACTIVE_FLAG(&joints[n], 1);
+	joints[n].max_pos_limit = LIMIT;
+	joints[n].min_pos_limit = -LIMIT;
+    }
+    SET_MOTION_COORD_FLAG(1);
+    SET_MOTION_ENABLE_FLAG(1);
+    /* no feed: moves stay in the planner queue */
+    emcmotStatus->vel = 1.0;
+    emcmotStatus->acc = 1.0;
+    emcmotConfig->trajCycleTime = PERIOD * 1e-9;
+    tpCreate(&emcmotDebug->queue, DEFAULT_TC_QUEUE_SIZE,
+	emcmotDebug->queueTcSpace);
+    tpSetCycleTime(&emcmotDebug->queue, emcmotConfig->trajCycleTime);
+    tpSetVmax(&emcmotDebug->queue, emcmotStatus->vel, emcmotStatus->vel);
+    tpSetAmax(&emcmotDebug->queue, emcmotStatus->acc);
+    emcmot_publish_status();
+}
+
+static void line(emcmot_command_t * c, int id, double x)
+{
+    memset(c, 0, sizeof(*c));
+    c->command = EMCMOT_SET_LINE;
+    c->id = id;
+    c->pos.tran.x = x;
+    c->motion_type = EMC_MOTION_TYPE_FEED;
+    /* no rotary axis to unlock */
+    c->turn = -1;
+    c->vel = c->ini_maxvel = c->acc = 1.0;
+}
+
+static void waited(emcmot_command_t * c)
+{
+    memset(c, 0, sizeof(*c));
+    c->command = EMCMOT_SET_VEL;
+    c->vel = c->ini_maxvel = 1.0;
+}
+
+/* the latest queued command motion ran */
+static int queued_echo(void)
+{
+    emcmot_status_t s;
+
+    usrmotReadEmcmotStatus(&s);
+    return s.queuedNumEcho;
+}
+
+int main(void)
+{
+    pthread_t tid;
+    emcmot_command_t c;
+    emcmot_status_t s;
+    unsigned int start, cold;
+    int n, last, bad, failed, moves_cycles, waited_cycles;
+
+    setup();
+    CHECK(usrmotInit("test_motion_queue") == 0);
+    pthread_create(&tid, NULL, servo, NULL);
+
+    /* moves go in the ring, motion takes them as fast as it can */
+    start = emcmotStatus->heartbeat;
+    for (n = 0, failed = 0; n < MOVES; n++) {
+	line(&c, n + 1, (n + 1) * 1e-3);
+	failed += usrmotWriteEmcmotCommand(&c) != EMCMOT_COMM_OK;
+    }
+    last = c.commandNum;
+    while (queued_echo() != last) {
+	sched_yield();
+    }
+    moves_cycles = emcmotStatus->heartbeat - start;
+    CHECK(failed == 0 && errors == 0);
+    CHECK(moves_cycles < MOVES);
+
+    /* anything else waits for its echo, one a cycle at best */
+    start = emcmotStatus->heartbeat;
+    for (n = 0; n < WAITED; n++) {
+	waited(&c);
+	failed += usrmotWriteEmcmotCommand(&c) != EMCMOT_COMM_OK;
+    }
+    waited_cycles = emcmotStatus->heartbeat - start;
+    CHECK(failed == 0);
+    CHECK(waited_cycles >= WAITED);
+
+    /* the cold end of the status is copied again when it changed */
+    usrmotReadEmcmotStatus(&s);
+    cold = s.cold_num;
+    CHECK(s.vel == 1.0);
+    waited(&c);
+    c.vel = 2.0;
+    CHECK(usrmotWriteEmcmotCommand(&c) == EMCMOT_COMM_OK);
+    usrmotReadEmcmotStatus(&s);
+    CHECK(s.vel == 2.0 && s.cold_num != cold);
+
+    /* a move off the limits: the ones after it are dropped, and the
+       next command written after motion got to it says so */
+    line(&c, MOVES + 1, 2 * LIMIT);
+    CHECK(usrmotWriteEmcmotCommand(&c) == EMCMOT_COMM_OK);
+    bad = c.commandNum;
+    for (n = 0; n < 3; n++) {
+	line(&c, MOVES + 2 + n, 1.0);
+	usrmotWriteEmcmotCommand(&c);
+    }
+    waited(&c);
+    CHECK(usrmotWriteEmcmotCommand(&c) == EMCMOT_COMM_ERROR_COMMAND);
+    CHECK(emcmotStatus->queuedFailNum == bad);
+    CHECK(emcmotStatus->queuedFailId == MOVES + 1);
+    CHECK(emcmotStatus->queuedFailStatus == EMCMOT_COMMAND_INVALID_PARAMS);
+    CHECK(queued_echo() == bad);
+    CHECK(errors > 0);
+
+    /* once reported, moves are taken again */
+    line(&c, MOVES + 5, 1.0);
+    CHECK(usrmotWriteEmcmotCommand(&c) == EMCMOT_COMM_OK);
+    last = c.commandNum;
+    waited(&c);
+    CHECK(usrmotWriteEmcmotCommand(&c) == EMCMOT_COMM_OK);
+    CHECK(queued_echo() == last);
+
+    done = 1;
+    pthread_join(tid, NULL);
+    usrmotExit();
+    printf("%d moves in %d servo cycles (%.1f a cycle), %d waited for "
+	"commands in %d, %s\n", MOVES, moves_cycles,
+	(double) MOVES / (moves_cycles > 0 ? moves_cycles : 1), WAITED,
+	waited_cycles, CHECK_RESULT);
+    return CHECK_EXIT;
+}
@@ -19,6 +19,7 @@
 #include <stdlib.h>		/* exit() */
 #include <sys/stat.h>
 #include <string.h>		/* memcpy() */
+#include <stddef.h>		/* offsetof() */
 #include <float.h>		/* DBL_MIN */
 #include "motion.h"		/* emcmot_status_t,CMD */
 #include "motion_debug.h"       /* emcmot_debug_t */
@@ -42,10 +43,13 @@
 static int inited = 0;		/* flag if inited */
 
 static emcmot_command_t *emcmotCommand = 0;
+static emcmot_command_ring_t *emcmotCommandRing = 0;
 static emcmot_status_t *emcmotStatus = 0;
+static emcmot_status_pub_t *emcmotStatusPub = 0;
 static emcmot_config_t *emcmotConfig = 0;
 static emcmot_debug_t *emcmotDebug = 0;
 static emcmot_error_t *emcmotError = 0;
+static emcmot_volcomp_t *emcmotVolcomp = 0;
 static emcmot_struct_t *emcmotStruct = 0;
 
 /* usrmotIniLoad() loads params (SHMEM_KEY, COMM_TIMEOUT, COMM_WAIT)
@@ -74,10 +78,77 @@ int usrmotIniLoad(const char *filename)
     return 0;
 }
 
+static int queuedFailSeen = 0;	/* last queuedFailNum reported */
+
+/* a queued command's failure, read from one status copy */
+typedef struct {
+    int num;
+    int id;
+    cmd_status_t status;
+} queued_fail_t;
+
+static void usrmotGetQueued(const emcmot_status_t * s, queued_fail_t * f)
+{
+    f->num = s->queuedFailNum;
+    f->id = s->queuedFailId;
+    f->status = s->queuedFailStatus;
+}
+
+/* passes on the failure of a queued command, once, as the result of
+   command commandNum: says which one it really was */
+static int usrmotCheckQueued(const queued_fail_t * f, int commandNum)
+{
+    if (f->num != queuedFailSeen) {
+	queuedFailSeen = f->num;
+	/* motion drops queued moves until it sees this */
+	emcmotCommandRing->failSeen = queuedFailSeen;
+	rcs_print("USRMOT: ERROR: queued command %d (line %d) failed with "
+	    "status %d, moves after it were dropped (seen at command %d)\n",
+	    f->num, f->id, f->status, commandNum);
+	return EMCMOT_COMM_ERROR_COMMAND;
+    }
+    return EMCMOT_COMM_OK;
+}
+
+/* Line and circle moves go in the command ring and aren't waited for, so
+   task can send more than one per servo cycle.  One that fails makes the
+   first command written after motion gets to it return an error. */
+static int usrmotQueueEmcmotCommand(emcmot_command_t * c, double end)
+{
+    emcmot_command_ring_t *ring = emcmotCommandRing;
+    const emcmot_status_t *s;
+    unsigned int gen;
+    queued_fail_t fail;
+
+    /* wait for a free slot */
+    while (ring->head - ring->tail >= EMCMOT_COMMAND_RING_LEN) {
+	if (etime() >= end) {
+	    rcs_print("USRMOT: ERROR: command timeout\n");
+	    return EMCMOT_COMM_ERROR_TIMEOUT;
+	}
+	esleep(25e-6);
+    }
+    ring->slot[ring->head % EMCMOT_COMMAND_RING_LEN] = *c;
+    /* the slot has to be there before the head that says so */
+    emcmot_barrier();
+    ring->head++;
+
+    s = usrmotGetEmcmotStatus(&gen);
+    usrmotGetQueued(s, &fail);
+    if (usrmotEmcmotStatusValid(gen)) {
+	return usrmotCheckQueued(&fail, c->commandNum);
+    }
+    return EMCMOT_COMM_OK;
+}
+
 /* writes command from c */
 int usrmotWriteEmcmotCommand(emcmot_command_t * c)
 {
-    emcmot_status_t s;
+    const emcmot_status_t *s;
+    unsigned int gen;
+    int numEcho;
+    cmd_status_t status;
+    queued_fail_t fail;
     static int commandNum = 0;
     static unsigned char headCount = 0;
     double end;
@@ -95,20 +166,35 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
         rcs_print("USRMOT: ERROR: can't connect to shared memory\n");
 	return EMCMOT_COMM_ERROR_CONNECT;
     }
-    /* copy entire command structure to shared memory */
-    *emcmotCommand = *c;
-    /* poll for receipt of command */
     /* set timeout for comm failure, now + timeout */
     end = etime() + EMCMOT_COMM_TIMEOUT;
-    /* now check to see if it got it */
+    if (c->command == EMCMOT_SET_LINE || c->command == EMCMOT_SET_CIRCLE) {
+	return usrmotQueueEmcmotCommand(c, end);
+    }
+    /* motion runs what is in the ring first: let it, so that this
+       command comes after the moves sent before it */
+    while (emcmotCommandRing->tail != emcmotCommandRing->head) {
+	if (etime() >= end) {
+	    rcs_print("USRMOT: ERROR: command timeout\n");
+	    return EMCMOT_COMM_ERROR_TIMEOUT;
+	}
+	esleep(25e-6);
+    }
+    /* copy entire command structure to shared memory */
+    *emcmotCommand = *c;
+    /* poll for receipt of command, looking at the status in place */
     while (etime() < end) {
-	/* update status */
-	if (( usrmotReadEmcmotStatus(&s) == 0 ) && ( s.commandNumEcho == commandNum )) {
+	s = usrmotGetEmcmotStatus(&gen);
+	numEcho = s->commandNumEcho;
+	status = s->commandStatus;
+	usrmotGetQueued(s, &fail);
+	if (usrmotEmcmotStatusValid(gen) && numEcho == commandNum) {
 	    /* now check emcmot status flag */
-	    if (s.commandStatus == EMCMOT_COMMAND_OK) {
-		return EMCMOT_COMM_OK;
+	    if (status == EMCMOT_COMMAND_OK) {
+		return usrmotCheckQueued(&fail, commandNum);
 	    } else {
-                rcs_print("USRMOT: ERROR: invalid command\n");
+                rcs_print("USRMOT: ERROR: invalid command %d, status %d\n",
+		    commandNum, status);
 		return EMCMOT_COMM_ERROR_COMMAND;
 	    }
 	}
@@ -118,25 +204,68 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
     return EMCMOT_COMM_ERROR_TIMEOUT;
 }
 
-/* copies status to s */
+const emcmot_status_t *usrmotGetEmcmotStatus(unsigned int *gen)
+{
+    /* check for shmem still around */
+    if (0 == emcmotStatusPub) {
+	return 0;
+    }
+    *gen = emcmotStatusPub->gen;
+    /* and only then look at the copy it points to */
+    emcmot_barrier();
+    return &emcmotStatusPub->copy[*gen % EMCMOT_STATUS_COPIES];
+}
+
+int usrmotEmcmotStatusValid(unsigned int gen)
+{
+    /* whatever was read from the copy comes first */
+    emcmot_barrier();
+    return emcmotStatusPub->gen - gen < EMCMOT_STATUS_COPIES - 1;
+}
+
+/* the status last copied in full, and the cold_num it had */
+static emcmot_status_t *coldTo = 0;
+static unsigned int coldSeen;
+
+/* copies status to s.  The cold end, from joint_settings up to tail,
+   is only copied when it changed since it was last copied to s */
 int usrmotReadEmcmotStatus(emcmot_status_t * s)
 {
+    const emcmot_status_t *latest;
+    unsigned int gen, queued;
     int split_read_count;
+    size_t cold = offsetof(emcmot_status_t, joint_settings);
+    size_t tail = offsetof(emcmot_status_t, tail);
     
     /* check for shmem still around */
-    if (0 == emcmotStatus) {
+    if (0 == emcmotStatusPub) {
 	return EMCMOT_COMM_ERROR_CONNECT;
     }
+    /* moves still in the command ring are part of the queue depth.  Look
+       before copying the status, so that a move motion takes out of the
+       ring in between is counted twice rather than not at all */
+    queued = emcmotCommandRing->head - emcmotCommandRing->tail;
+    emcmot_barrier();
     split_read_count = 0;
     do {
-	/* copy status struct from shmem to local memory */
-	memcpy(s, emcmotStatus, sizeof(emcmot_status_t));
-	/* got it, now check head-tail matche */
-	if (s->head == s->tail) {
-	    /* head and tail match, done */
+	/* copy the latest published status to local memory */
+	latest = usrmotGetEmcmotStatus(&gen);
+	memcpy(s, latest, cold);
+	if (s != coldTo || s->cold_num != coldSeen) {
+	    memcpy((char *) s + cold, (const char *) latest + cold,
+		tail - cold);
+	}
+	memcpy((char *) s + tail, (const char *) latest + tail,
+	    sizeof(emcmot_status_t) - tail);
+	if (usrmotEmcmotStatusValid(gen)) {
+	    coldTo = s;
+	    coldSeen = s->cold_num;
+	    s->depth += queued;
 	    return EMCMOT_COMM_OK;
 	}
-	/* inc counter and try again, max three times */
+	/* motion got round to this copy again while we were reading it:
+	   we were held up for cycles, try the new latest one */
+	coldTo = 0;
     } while ( ++split_read_count < 3 );
     return EMCMOT_COMM_SPLIT_READ_TIMEOUT;
 }
@@ -169,6 +298,8 @@ printf("ReadEmcmotConfig COMM_SPLIT_READ_TIMEOUT\n" );
 int usrmotReadEmcmotDebug(emcmot_debug_t * s)
 {
     int split_read_count;
+    size_t tc = offsetof(emcmot_debug_t, queueTcSpace);
+    size_t rest = tc + sizeof(emcmotDebug->queueTcSpace);
     
     /* check for shmem still around */
     if (0 == emcmotDebug) {
@@ -176,8 +307,12 @@ int usrmotReadEmcmotDebug(emcmot_debug_t * s)
     }
     split_read_count = 0;
     do {
-	/* copy debug struct from shmem to local memory */
-	memcpy(s, emcmotDebug, sizeof(emcmot_debug_t));
+	/* copy debug struct from shmem to local memory, all but the
+	   planner queue entries, which are most of it and are no use
+	   outside motion */
+	memcpy(s, emcmotDebug, tc);
+	memcpy((char *) s + rest, (const char *) emcmotDebug + rest,
+	    sizeof(emcmot_debug_t) - rest);
 	/* got it, now check head-tail matches */
 	if (s->head == s->tail) {
 	    /* head and tail match, done */
@@ -392,6 +527,7 @@ void usrmotPrintEmcmotConfig(emcmot_config_t c, int which)
 	printf("servo time:   \t%f\n", c.servoCycleTime);
 	printf("interp rate:  \t%d\n", c.interpolationRate);
 	printf("v limit:      \t%f\n", c.limitVel);
+	printf("j limit:      \t%f\n", c.limitJerk);
 	printf("axis vlimit:  \t");
 /*! \todo Another #if 0 */
 #if 0				/*! \todo FIXME - waiting for new structs */
@@ -478,6 +614,9 @@ void usrmotPrintEmcmotStatus(emcmot_status_t *s, int which)
 	    );
 	printf("cmd:          \t%d\n", s->commandEcho);
 	printf("cmd num:      \t%d\n", s->commandNumEcho);
+	printf("queued num:   \t%d\n", s->queuedNumEcho);
+	printf("queued fail:  \t%d (line %d)\n", s->queuedFailNum,
+	    s->queuedFailId);
 	printf("heartbeat:    \t%u\n", s->heartbeat);
 	printf("compute time: \t%f\n", s->computeTime);
 /*! \todo Another #if 0 */
@@ -705,10 +844,16 @@ int usrmotInit(const char *modname)
     }
     /* got it */
     emcmotCommand = &(emcmotStruct->command);
+    emcmotCommandRing = &(emcmotStruct->commandRing);
     emcmotStatus = &(emcmotStruct->status);
+    emcmotStatusPub = &(emcmotStruct->statusPub);
     emcmotDebug = &(emcmotStruct->debug);
     emcmotConfig = &(emcmotStruct->config);
     emcmotError = &(emcmotStruct->error);
+    emcmotVolcomp = &(emcmotStruct->volcomp);
+    /* failures from before we got here aren't ours */
+    queuedFailSeen = emcmotStatus->queuedFailNum;
+    emcmotCommandRing->failSeen = queuedFailSeen;
 
     inited = 1;
 
@@ -724,8 +869,12 @@ int usrmotExit(void)
 
     emcmotStruct = 0;
     emcmotCommand = 0;
+    emcmotCommandRing = 0;
     emcmotStatus = 0;
+    emcmotStatusPub = 0;
     emcmotError = 0;
+    emcmotVolcomp = 0;
+    coldTo = 0;
 /*! \todo Another #if 0 */
 #if 0
 /*! \todo FIXME - comp structs no longer in shmem */
@@ -797,6 +946,98 @@ int usrmotLoadComp(int joint, const char *file, int type)
 }
 
 
+/* Loads the volumetric compensation table.  Lines starting with # are
+   skipped.  The first other line holds the grid: X, Y, Z of the first
+   point, the spacing of the points along X, Y, Z, and the number of
+   points along X, Y, Z.  Then come the X, Y and Z errors at each point, one
+   point per line, X counting fastest, then Y, then Z.  The table is
+   disabled while its points are written to shared memory, and only
+   enabled again if the whole file could be read.
+*/
+int usrmotLoadVolComp(const char *file, double max_vel)
+{
+    FILE *fp;
+    char buffer[LINELEN];
+    double ex, ey, ez;
+    int n, points;
+    emcmot_volcomp_grid_t grid;
+    emcmot_command_t emcmotCommand;
+
+    if (0 == emcmotVolcomp) {
+	return -1;
+    }
+
+    /* open input comp file */
+    if (NULL == (fp = fopen(file, "r"))) {
+	fprintf(stderr, "can't open volumetric compensation file %s\n", file);
+	return -1;
+    }
+
+    /* read the grid */
+    do {
+	if (NULL == fgets(buffer, LINELEN, fp)) {
+	    buffer[0] = 0;
+	    break;
+	}
+    } while (buffer[0] == '#');
+    if (9 != sscanf(buffer, "%lf %lf %lf %lf %lf %lf %d %d %d",
+	    &grid.origin[0], &grid.origin[1], &grid.origin[2],
+	    &grid.step[0], &grid.step[1], &grid.step[2],
+	    &grid.count[0], &grid.count[1], &grid.count[2])) {
+	fprintf(stderr, "%s: no grid on the first line\n", file);
+	fclose(fp);
+	return -1;
+    }
+    points = 1;
+    for (n = 0; n < 3; n++) {
+	/* checked before multiplying, so it can't overflow */
+	if (grid.count[n] < 2 ||
+	    grid.count[n] > EMCMOT_VOLCOMP_POINTS / points) {
+	    break;
+	}
+	points *= grid.count[n];
+    }
+    if (n < 3) {
+	fprintf(stderr, "%s: need 2 to %d points along each axis, "
+	    "%d in all\n", file, EMCMOT_VOLCOMP_POINTS, EMCMOT_VOLCOMP_POINTS);
+	fclose(fp);
+	return -1;
+    }
+    grid.max_vel = max_vel;
+
+    /* stop motion using the table before writing to it */
+    memset(&emcmotCommand, 0, sizeof(emcmotCommand));
+    emcmotCommand.command = EMCMOT_SET_VOLCOMP;
+    if (0 != usrmotWriteEmcmotCommand(&emcmotCommand)) {
+	fclose(fp);
+	return -1;
+    }
+
+    n = 0;
+    while (n < points && NULL != fgets(buffer, LINELEN, fp)) {
+	if (buffer[0] == '#') {
+	    continue;
+	}
+	if (3 != sscanf(buffer, "%lf %lf %lf", &ex, &ey, &ez)) {
+	    break;
+	}
+	emcmotVolcomp->err[n][0] = ex;
+	emcmotVolcomp->err[n][1] = ey;
+	emcmotVolcomp->err[n][2] = ez;
+	n++;
+    }
+    fclose(fp);
+    if (n < points) {
+	fprintf(stderr, "%s: point %d of %d missing or bad\n", file, n + 1,
+	    points);
+	return -1;
+    }
+
+    emcmotCommand.command = EMCMOT_SET_VOLCOMP;
+    emcmotCommand.volcomp = grid;
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
 int usrmotPrintComp(int joint)
 {
 /* FIXME-AJ: comp isn't in shmem atm
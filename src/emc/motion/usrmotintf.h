@@ -18,6 +18,7 @@
 #define USRMOTINTF_H
 
 struct emcmot_status_t;
+struct emcmot_status_pub_t;
 struct emcmot_command_t;
 struct emcmot_config_t;
 struct emcmot_debug_t;
@@ -35,6 +36,13 @@ extern "C" {
    the emcmot controller and puts it in arg */
     extern int usrmotReadEmcmotStatus(emcmot_status_t * s);
 
+/* usrmotGetEmcmotStatus() returns the latest status motion published,
+   without copying it, and its generation in gen; 0 if not connected.
+   Motion leaves it alone for a couple of servo cycles: whatever was read
+   from it is good if usrmotEmcmotStatusValid(gen) says so afterwards */
+    extern const emcmot_status_t *usrmotGetEmcmotStatus(unsigned int *gen);
+    extern int usrmotEmcmotStatusValid(unsigned int gen);
+
 /* usrmotReadEmcmotConfig() gets the config info out of
    the emcmot controller and puts it in arg */
     extern int usrmotReadEmcmotConfig(emcmot_config_t * s);
@@ -81,6 +89,10 @@ extern "C" {
 /* usrmotLoadComp() loads the compensation data in file into the joint */
     extern int usrmotLoadComp(int joint, const char *file, int type);
 
+/* usrmotLoadVolComp() loads the volumetric compensation table in file,
+   the correction changing at no more than max_vel */
+    extern int usrmotLoadVolComp(const char *file, double max_vel);
+
 /* usrmotPrintComp() prints the joint compensation data for the specified joint */
     extern int usrmotPrintComp(int joint);
 
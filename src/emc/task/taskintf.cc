@@ -73,6 +73,8 @@ static int localMotionEchoSerialNumber = 0;
 static unsigned char localEmcAxisAxisType[EMCMOT_MAX_JOINTS];
 static double localEmcAxisUnits[EMCMOT_MAX_JOINTS];
 static double localEmcMaxAcceleration = DBL_MAX;
+static double localEmcMaxJerk = 0.0;
+static double localEmcAxisMaxJerk[EMCMOT_MAX_JOINTS];
 
 // axes are numbered 0..NUM-1
 
@@ -308,6 +310,39 @@ int emcAxisSetMaxAcceleration(int axis, double acc)
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+/*
+  The planner limits jerk along the path, not per joint, so it gets the
+  lowest of the [TRAJ] and [AXIS_n] values that are set.  0 means no limit.
+  */
+static int sendMaxJerk(void)
+{
+    double jerk = localEmcMaxJerk;
+    int axis;
+
+    for (axis = 0; axis < EMCMOT_MAX_JOINTS; axis++) {
+	if (localEmcAxisMaxJerk[axis] > 0.0 &&
+	    (jerk == 0.0 || localEmcAxisMaxJerk[axis] < jerk)) {
+	    jerk = localEmcAxisMaxJerk[axis];
+	}
+    }
+
+    emcmotCommand.command = EMCMOT_SET_JERK;
+    emcmotCommand.jerk = jerk;
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
+int emcAxisSetMaxJerk(int axis, double jerk)
+{
+    if (axis < 0 || axis >= EMCMOT_MAX_JOINTS) {
+	return 0;
+    }
+    if (jerk < 0.0) {
+	jerk = 0.0;
+    }
+    localEmcAxisMaxJerk[axis] = jerk;
+    return sendMaxJerk();
+}
+
 /* This function checks to see if any axis or the traj has
    been inited already.  At startup, if none have been inited,
    usrmotIniLoad and usrmotInit must be called first.  At
@@ -551,6 +586,7 @@ int emcAxisUpdate(EMC_AXIS_STAT stat[], int numAxes)
 
     int axis;
     emcmot_joint_status_t *joint;
+    emcmot_joint_settings_t *settings;
 #ifdef WATCH_FLAGS
     static int old_joint_flag[8];
 #endif
@@ -568,11 +604,12 @@ int emcAxisUpdate(EMC_AXIS_STAT stat[], int numAxes)
 	stat[axis].axisType = localEmcAxisAxisType[axis];
 	stat[axis].units = localEmcAxisUnits[axis];
 	if (new_config) {
-	    stat[axis].backlash = joint->backlash;
-	    stat[axis].minPositionLimit = joint->min_pos_limit;
-	    stat[axis].maxPositionLimit = joint->max_pos_limit;
-	    stat[axis].minFerror = joint->min_ferror;
-	    stat[axis].maxFerror = joint->max_ferror;
+	    settings = &(emcmotStatus.joint_settings[axis]);
+	    stat[axis].backlash = settings->backlash;
+	    stat[axis].minPositionLimit = settings->min_pos_limit;
+	    stat[axis].maxPositionLimit = settings->max_pos_limit;
+	    stat[axis].minFerror = settings->min_ferror;
+	    stat[axis].maxFerror = settings->max_ferror;
 	}
 	stat[axis].output = joint->pos_cmd;
 	stat[axis].input = joint->pos_fb;
@@ -766,6 +803,22 @@ int emcTrajSetMaxAcceleration(double acc)
     return 0;
 }
 
+int emcTrajSetMaxJerk(double jerk)
+{
+    if (jerk < 0.0) {
+	jerk = 0.0;
+    }
+
+    localEmcMaxJerk = jerk;
+
+    return sendMaxJerk();
+}
+
+int emcTrajLoadVolComp(const char *file, double maxVel)
+{
+    return usrmotLoadVolComp(file, maxVel);
+}
+
 int emcTrajSetHome(EmcPose home)
 {
 #ifdef ISNAN_TRAP
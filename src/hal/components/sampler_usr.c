@@ -20,7 +20,7 @@
 
     Invoking:
 
-    halsampler [-c chan_num] [-n num_samples] [-t]
+    halsampler [-c chan_num] [-n num_samples] [-t] [-b] [filename]
 
     'chan_num', if present, specifies the sampler channel to use.
     The default is channel zero.
@@ -32,6 +32,12 @@
     '-t' tells sampler to print the sample number at the start
     of each line.
 
+    '-b' writes a binary stream instead of text: a header that
+    describes the pins, then the raw fifo records, copied out of
+    the fifo a contiguous span at a time and written with a single
+    write() per span.  With '-t' each record keeps its sample number.
+    halstreamer -b reads the same format back.
+
 */
 
 /** This program is free software; you can redistribute it and/or
@@ -64,6 +70,7 @@
 #include <ctype.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include <signal.h>
 #include <time.h>
 #include <sys/types.h>
@@ -78,6 +85,8 @@
 *                  LOCAL FUNCTION DECLARATIONS                         *
 ************************************************************************/
 
+static int sample_binary(fifo_t *fifo, long int samples, int tag);
+
 /***********************************************************************
 *                         GLOBAL VARIABLES                             *
 ************************************************************************/
@@ -111,7 +120,7 @@ static void quit(int sig)
 
 int main(int argc, char **argv)
 {
-    int n, channel, retval, size, tag;
+    int n, channel, retval, size, tag, binary;
     long int samples;
     unsigned long this_sample;
     char *cp, *cp2;
@@ -125,6 +134,7 @@ int main(int argc, char **argv)
     exitval = 1;
     channel = 0;
     tag = 0;
+    binary = 0;
     samples = -1;  /* -1 means run forever */
     /* FIXME - if I wasn't so lazy I'd learn how to use getopt() here */
     for ( n = 1 ; n < argc ; n++ ) {
@@ -156,6 +166,9 @@ int main(int argc, char **argv)
 	case 't':
 	    tag = 1;
 	    break;
+	case 'b':
+	    binary = 1;
+	    break;
 	default:
 	    fprintf(stderr,"ERROR: unknown option '%s'\n", cp );
 	    exit(1);
@@ -169,7 +182,7 @@ int main(int argc, char **argv)
 	    exit(1);
 	}
 	// make stdout be the named file
-	fd = open(argv[n], O_WRONLY | O_CREAT, 0666);
+	fd = open(argv[n], O_WRONLY | O_CREAT | O_TRUNC, 0666);
 	close(1);
 	dup2(fd, 1);
     }
@@ -223,6 +236,13 @@ int main(int argc, char **argv)
 	goto out;
     }
     fifo = shmem_ptr;
+    if ( binary ) {
+	if ( sample_binary(fifo, samples, tag) == 0 ) {
+	    /* run was succesfull */
+	    exitval = 0;
+	}
+	goto out;
+    }
     data = fifo->data;
     while ( samples != 0 ) {
 	while ( fifo->in == fifo->out ) {
@@ -300,3 +320,122 @@ out:
     }
     return exitval;
 }
+
+/***********************************************************************
+*                   LOCAL FUNCTION DEFINITIONS                         *
+************************************************************************/
+
+/* most records copied out of the fifo and written in one go */
+#define BULK_RECORDS 4096
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+    const char *cp;
+    ssize_t n;
+
+    cp = buf;
+    while ( len > 0 ) {
+	n = write(fd, cp, len);
+	if ( n < 0 ) {
+	    if ( errno == EINTR ) {
+		continue;
+	    }
+	    return -1;
+	}
+	cp += n;
+	len -= n;
+    }
+    return 0;
+}
+
+static int sample_binary(fifo_t *fifo, long int samples, int tag)
+{
+    stream_header_t hdr;
+    shmem_data_t *data, *dptr, *bptr, *bulk;
+    unsigned long this_sample;
+    int n, slots, tmpin, tmpout, newout, count;
+    struct timespec delay;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = STREAM_MAGIC_NUM;
+    hdr.version = STREAM_VERSION;
+    hdr.num_pins = fifo->num_pins;
+    hdr.tagged = tag;
+    hdr.record_size = (fifo->num_pins + tag) * sizeof(shmem_data_t);
+    for ( n = 0 ; n < fifo->num_pins ; n++ ) {
+	hdr.type[n] = fifo->type[n];
+    }
+    if ( write_all(1, &hdr, sizeof(hdr)) < 0 ) {
+	fprintf(stderr, "ERROR: write failed: %s\n", strerror(errno));
+	return -1;
+    }
+    /* fifo records have one extra slot for the sample number */
+    slots = fifo->num_pins + 1;
+    bulk = malloc(BULK_RECORDS * slots * sizeof(shmem_data_t));
+    if ( bulk == NULL ) {
+	fprintf(stderr, "ERROR: out of memory\n");
+	return -1;
+    }
+    data = fifo->data;
+    while ( samples != 0 ) {
+	tmpout = fifo->out;
+	tmpin = fifo->in;
+	if ( tmpin == tmpout ) {
+            /* fifo empty, sleep for 10mS */
+	    delay.tv_sec = 0;
+	    delay.tv_nsec = 10000000;
+	    nanosleep(&delay,NULL);
+	    continue;
+	}
+	/* everything up to 'in', or up to the end of the fifo if the
+	   data wraps around, can be copied in one piece */
+	if ( tmpin > tmpout ) {
+	    count = tmpin - tmpout;
+	} else {
+	    count = fifo->depth - tmpout;
+	}
+	if ( count > BULK_RECORDS ) {
+	    count = BULK_RECORDS;
+	}
+	if (( samples > 0 ) && ( count > samples )) {
+	    count = samples;
+	}
+	memcpy(bulk, &data[tmpout * slots], count * slots * sizeof(shmem_data_t));
+	if ( fifo->out != tmpout ) {
+	    /* the fifo filled up and the oldest records were overwritten
+	       while we were reading them, so start over */
+	    continue;
+	}
+	/* update 'out' for the next span */
+	newout = tmpout + count;
+	if ( newout >= fifo->depth ) {
+	    newout = 0;
+	}
+	fifo->out = newout;
+	/* check the sample numbers, and drop them unless tagging */
+	bptr = bulk;
+	for ( n = 0 ; n < count ; n++ ) {
+	    dptr = &bulk[n * slots];
+	    this_sample = dptr[fifo->num_pins].u;
+	    if ( this_sample != ++(fifo->last_sample) ) {
+		/* stdout is binary, so the gap is reported on stderr */
+		fprintf(stderr, "overrun\n");
+		fifo->last_sample = this_sample;
+	    }
+	    if ( ! tag ) {
+		memmove(bptr, dptr, fifo->num_pins * sizeof(shmem_data_t));
+	    }
+	    bptr += fifo->num_pins + tag;
+	}
+	if ( write_all(1, bulk, count * hdr.record_size) < 0 ) {
+	    fprintf(stderr, "ERROR: write failed: %s\n", strerror(errno));
+	    free(bulk);
+	    return -1;
+	}
+	if ( samples > 0 ) {
+	    samples -= count;
+	}
+    }
+    free(bulk);
+    return 0;
+}
@@ -13,10 +13,12 @@
 #define MAX_STREAMERS		8
 #define MAX_SAMPLERS		8
 #define MAX_PINS 		20
-#define MAX_SHMEM 		128000
+#define MAX_SHMEM 		(16*1024*1024)	/* largest fifo, in bytes */
 #define STREAMER_SHMEM_KEY 	0x48535430
 #define SAMPLER_SHMEM_KEY	0x48534130
 #define FIFO_MAGIC_NUM		0x4649464F
+#define STREAM_MAGIC_NUM	0x4D525453
+#define STREAM_VERSION		1
 
 /* These structs live in the shared memory that connects the user
    space and RT parts.  They are _not_ in HAL shared memory.
@@ -40,6 +42,22 @@ typedef struct {
     shmem_data_t data[];
 } fifo_t;
 
+/* Binary streams (halsampler -b, halstreamer -b) start with this
+   header, followed by the records.  A record is 'num_pins' values,
+   plus the sample number if 'tagged', each one a shmem_data_t in the
+   byte order of the machine that wrote it.  That is the layout of the
+   fifo records, so the data can be copied in bulk without formatting.
+*/
+
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int num_pins;
+    unsigned int tagged;
+    unsigned int record_size;	/* bytes per record */
+    unsigned int type[MAX_PINS];	/* hal_type_t of each value */
+} stream_header_t;
+
 /* this struct lives in HAL shared memory */
 
 typedef union {
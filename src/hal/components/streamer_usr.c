@@ -20,13 +20,17 @@
 
     Invoking:
 
-    halstreamer [chan_num]
+    halstreamer [-c chan_num] [-b] [filename]
 
     'chan_num', if present, specifies the streamer channel to use.
     The default is channel zero.  Since hal_streamer takes its data
     from stdin, it will almost always either need to have stdin 
     redirected from a file, or have data piped into it from some
     other program.
+
+    '-b' reads a binary stream as written by halsampler -b instead
+    of text.  The header must match the pins of the channel, and the
+    records are read straight into the free part of the fifo.
 */
 
 /** This program is free software; you can redistribute it and/or
@@ -59,6 +63,7 @@
 #include <ctype.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include <signal.h>
 #include <time.h>
 #include <sys/types.h>
@@ -73,6 +78,8 @@
 *                  LOCAL FUNCTION DECLARATIONS                         *
 ************************************************************************/
 
+static int stream_binary(fifo_t *fifo);
+
 /***********************************************************************
 *                         GLOBAL VARIABLES                             *
 ************************************************************************/
@@ -107,7 +114,7 @@ static void quit(int sig)
 
 int main(int argc, char **argv)
 {
-    int n, channel, retval, size, line;
+    int n, channel, retval, size, line, binary;
     char *cp, *cp2;
     void *shmem_ptr;
     fifo_t *fifo;
@@ -120,6 +127,7 @@ int main(int argc, char **argv)
     /* set return code to "fail", clear it later if all goes well */
     exitval = 1;
     channel = 0;
+    binary = 0;
     for ( n = 1 ; n < argc ; n++ ) {
 	cp = argv[n];
 	if ( *cp != '-' ) {
@@ -136,6 +144,9 @@ int main(int argc, char **argv)
 		exit(1);
 	    }
 	    break;
+	case 'b':
+	    binary = 1;
+	    break;
 	default:
 	    fprintf(stderr,"ERROR: unknown option '%s'\n", cp );
 	    exit(1);
@@ -150,6 +161,10 @@ int main(int argc, char **argv)
 	}
 	// make stdin be the named file
 	fd = open(argv[n], O_RDONLY);
+	if ( fd < 0 ) {
+	    fprintf(stderr, "ERROR: can't open '%s': %s\n", argv[n], strerror(errno));
+	    exit(1);
+	}
 	close(0);
 	dup2(fd, 0);
     }
@@ -202,8 +217,15 @@ int main(int argc, char **argv)
 	fprintf(stderr, "ERROR: couldn't re-map user/RT shared memory\n");
 	goto out;
     }
-    line = 1;
     fifo = shmem_ptr;
+    if ( binary ) {
+	if ( stream_binary(fifo) == 0 ) {
+	    /* run was succesfull */
+	    exitval = 0;
+	}
+	goto out;
+    }
+    line = 1;
     data = fifo->data;
     while ( fgets(buf, BUF_SIZE, stdin) ) {
 	/* calculate _next_ value for in */
@@ -299,3 +321,116 @@ out:
     }
     return exitval;
 }
+
+/***********************************************************************
+*                   LOCAL FUNCTION DEFINITIONS                         *
+************************************************************************/
+
+static int read_all(int fd, void *buf, size_t len)
+{
+    char *cp;
+    ssize_t n;
+
+    cp = buf;
+    while ( len > 0 ) {
+	n = read(fd, cp, len);
+	if ( n < 0 ) {
+	    if ( errno == EINTR ) {
+		continue;
+	    }
+	    return -1;
+	}
+	if ( n == 0 ) {
+	    break;
+	}
+	cp += n;
+	len -= n;
+    }
+    return cp - (char *)buf;
+}
+
+static int stream_binary(fifo_t *fifo)
+{
+    stream_header_t hdr;
+    char *data;
+    int n, record_size, tmpin, tmpout, newin, count, partial;
+    ssize_t len;
+    struct timespec delay;
+
+    if (( read_all(0, &hdr, sizeof(hdr)) != sizeof(hdr) ) ||
+	( hdr.magic != STREAM_MAGIC_NUM )) {
+	fprintf(stderr, "ERROR: input is not a binary sample stream\n");
+	return -1;
+    }
+    if ( hdr.version != STREAM_VERSION ) {
+	fprintf(stderr, "ERROR: stream version %u, expected %d\n",
+	    hdr.version, STREAM_VERSION);
+	return -1;
+    }
+    if ( hdr.tagged ) {
+	fprintf(stderr, "ERROR: stream has sample numbers, capture it without -t\n");
+	return -1;
+    }
+    record_size = fifo->num_pins * sizeof(shmem_data_t);
+    if (( hdr.num_pins != fifo->num_pins ) || ( hdr.record_size != record_size )) {
+	fprintf(stderr, "ERROR: stream has %u pins, channel has %d\n",
+	    hdr.num_pins, fifo->num_pins);
+	return -1;
+    }
+    for ( n = 0 ; n < fifo->num_pins ; n++ ) {
+	if ( hdr.type[n] != fifo->type[n] ) {
+	    fprintf(stderr, "ERROR: stream pin %d has the wrong type\n", n);
+	    return -1;
+	}
+    }
+    data = (char *)fifo->data;
+    /* bytes of an incomplete record already read into slot 'in' */
+    partial = 0;
+    while ( 1 ) {
+	tmpin = fifo->in;
+	tmpout = fifo->out;
+	/* free slots from 'in' up to 'out' or the end of the fifo, less
+	   the one that always stays empty so that full != empty */
+	if ( tmpout > tmpin ) {
+	    count = tmpout - tmpin - 1;
+	} else {
+	    count = fifo->depth - tmpin;
+	    if ( tmpout == 0 ) {
+		count--;
+	    }
+	}
+	if ( count == 0 ) {
+	    /* fifo full, sleep for 10mS */
+	    delay.tv_sec = 0;
+	    delay.tv_nsec = 10000000;
+	    nanosleep(&delay,NULL);
+	    continue;
+	}
+	/* read straight into the fifo */
+	len = read(0, data + tmpin * record_size + partial,
+	    count * record_size - partial);
+	if ( len < 0 ) {
+	    if ( errno == EINTR ) {
+		continue;
+	    }
+	    fprintf(stderr, "ERROR: read failed: %s\n", strerror(errno));
+	    return -1;
+	}
+	if ( len == 0 ) {
+	    break;
+	}
+	/* pass the complete records on, any remainder stays at the
+	   new 'in' and the next read finishes it */
+	partial += len;
+	newin = tmpin + partial / record_size;
+	partial %= record_size;
+	if ( newin >= fifo->depth ) {
+	    newin = 0;
+	}
+	fifo->in = newin;
+    }
+    if ( partial ) {
+	fprintf(stderr, "incomplete record at end of input, skipping it\n");
+    }
+    return 0;
+}
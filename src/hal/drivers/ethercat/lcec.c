@@ -31,11 +31,19 @@
 #include "lcec_el7342.h"
 #include "lcec_el95xx.h"
 #include "lcec_stmds5k.h"
+#include "lcec_cia402.h"
+#include "lcec_timing.h"
+#include "lcec_sdo.h"
+
+#include "rtapi_app.h"
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Sascha Ittner <sascha.ittner@modusoft.de>");
 MODULE_DESCRIPTION("Driver for EtherCAT devices");
 
+static int slave_state_polls = 0;
+RTAPI_MP_INT(slave_state_polls, "number of slave states polled per master and cycle (0 = all)");
+
 typedef struct lcec_typelist {
   LCEC_SLAVE_TYPE_T type;
   uint32_t vid;
@@ -125,6 +133,9 @@ static const lcec_typelist_t types[] = {
   // stoeber MDS5000 series
   { lcecSlaveTypeStMDS5k, LCEC_STMDS5K_VID, LCEC_STMDS5K_PID, LCEC_STMDS5K_PDOS, lcec_stmds5k_init},
 
+  // generic CiA402 drive profile
+  { lcecSlaveTypeCiA402, LCEC_CIA402_VID, LCEC_CIA402_PID, LCEC_CIA402_PDOS, lcec_cia402_init},
+
   { lcecSlaveTypeInvalid }
 };
 
@@ -133,15 +144,16 @@ static lcec_master_t *last_master = NULL;
 static int comp_id = -1;
 
 static lcec_master_data_t *global_hal_data;
-static ec_master_state_t global_ms;
+static unsigned long global_publish_mutex = 0;
 
 int lcec_parse_config(void);
 void lcec_clear_config(void);
+lcec_domain_t *lcec_create_domain(lcec_master_t *master, const char *name, int divider);
 
 void lcec_request_lock(void *data);
 void lcec_release_lock(void *data);
 
-lcec_master_data_t *lcec_init_master_hal(const char *pfx);
+lcec_master_data_t *lcec_init_master_hal(const char *pfx, int global);
 lcec_slave_state_t *lcec_init_slave_state_hal(char *master_name, char *slave_name);
 void lcec_update_master_hal(lcec_master_data_t *hal_data, ec_master_state_t *ms);
 void lcec_update_slave_state_hal(lcec_slave_state_t *hal_data, ec_slave_config_state_t *ss);
@@ -150,13 +162,20 @@ void lcec_read_all(void *arg, long period);
 void lcec_write_all(void *arg, long period);
 void lcec_read_master(void *arg, long period);
 void lcec_write_master(void *arg, long period);
+void lcec_read_master_data(lcec_master_t *master, long period);
+void lcec_read_domain(void *arg, long period);
+void lcec_write_domain(void *arg, long period);
+void lcec_read_domain_data(lcec_domain_t *domain, long period, int receive);
+void lcec_write_domain_data(lcec_domain_t *domain, long period, int send);
+void lcec_poll_slave_states(lcec_master_t *master);
+void lcec_publish_global(void);
 
 int rtapi_app_main(void) {
   int slave_count;
   lcec_master_t *master;
+  lcec_domain_t *domain;
   lcec_slave_t *slave;
   char name[HAL_NAME_LEN + 1];
-  ec_pdo_entry_reg_t *pdo_entry_regs;
   lcec_slave_sdoconf_t *sdo_config;
 
   // connect to the HAL
@@ -171,7 +190,7 @@ int rtapi_app_main(void) {
   }
 
   // init global hal data
-  if ((global_hal_data = lcec_init_master_hal(LCEC_MODULE_NAME)) == NULL) {
+  if ((global_hal_data = lcec_init_master_hal(LCEC_MODULE_NAME, 1)) == NULL) {
     goto fail2;
   }
 
@@ -188,14 +207,16 @@ int rtapi_app_main(void) {
     ecrt_master_callbacks(master->master, lcec_request_lock, lcec_release_lock, master);
 #endif
 
-    // create domain
-    if (!(master->domain = ecrt_master_create_domain(master->master))) {
-      rtapi_print_msg (RTAPI_MSG_ERR, LCEC_MSG_PFX "master %s domain creation failed\n", master->name);
-      goto fail2;
+    // create domains
+    for (domain = master->first_domain; domain != NULL; domain = domain->next) {
+      if (!(domain->domain = ecrt_master_create_domain(master->master))) {
+        rtapi_print_msg (RTAPI_MSG_ERR, LCEC_MSG_PFX "master %s domain %s creation failed\n", master->name, domain->name);
+        goto fail2;
+      }
+      domain->pdo_entry_fill = domain->pdo_entry_regs;
     }
 
     // initialize slaves
-    pdo_entry_regs = master->pdo_entry_regs;
     for (slave = master->first_slave; slave != NULL; slave = slave->next) {
       // read slave config
       if (!(slave->config = ecrt_master_slave_config(master->master, 0, slave->index, slave->vid, slave->pid))) {
@@ -218,13 +239,20 @@ int rtapi_app_main(void) {
         }
       }
 
+      // create runtime sdo channels
+      if (slave->sdo_chan_count > 0) {
+        if ((slave->sdo_chans = lcec_init_sdo_chans(comp_id, slave, slave->sdo_chan_count)) == NULL) {
+          goto fail2;
+        }
+      }
+
       // setup pdos
       if (slave->proc_init != NULL) {
-        if ((slave->proc_init(comp_id, slave, pdo_entry_regs)) != 0) {
+        if ((slave->proc_init(comp_id, slave, slave->domain->pdo_entry_fill)) != 0) {
           goto fail2;
         }
       }
-      pdo_entry_regs += slave->pdo_entry_count;
+      slave->domain->pdo_entry_fill += slave->pdo_entry_count;
 
       // configure dc for this slave
       if (slave->dc_conf != NULL) {
@@ -235,6 +263,7 @@ int rtapi_app_main(void) {
           master->name, slave->name, slave->dc_conf->assignActivate,
           slave->dc_conf->sync0Cycle, slave->dc_conf->sync0Shift,
           slave->dc_conf->sync1Cycle, slave->dc_conf->sync1Shift);
+        master->dc_used = 1;
       }
 
       // Configure the slave's watchdog times.
@@ -256,13 +285,24 @@ int rtapi_app_main(void) {
       }
     }
 
-    // terminate POD entries
-    pdo_entry_regs->index = 0;
+    for (domain = master->first_domain; domain != NULL; domain = domain->next) {
+      // terminate POD entries
+      domain->pdo_entry_fill->index = 0;
 
-    // register PDO entries
-    if (ecrt_domain_reg_pdo_entry_list(master->domain, master->pdo_entry_regs)) {
-      rtapi_print_msg (RTAPI_MSG_ERR, LCEC_MSG_PFX "master %s PDO entry registration failed\n", master->name);
-      goto fail2;
+      // register PDO entries
+      if (ecrt_domain_reg_pdo_entry_list(domain->domain, domain->pdo_entry_regs)) {
+        rtapi_print_msg (RTAPI_MSG_ERR, LCEC_MSG_PFX "master %s PDO entry registration failed\n", master->name);
+        goto fail2;
+      }
+    }
+
+    // PDO offsets are valid now, finish slave setup
+    for (slave = master->first_slave; slave != NULL; slave = slave->next) {
+      if (slave->proc_postinit != NULL) {
+        if ((slave->proc_postinit(slave)) != 0) {
+          goto fail2;
+        }
+      }
     }
 
     // activating master
@@ -271,13 +311,18 @@ int rtapi_app_main(void) {
       goto fail2;
     }
 
-    // Get internal process data for domain
-    master->process_data = ecrt_domain_data(master->domain);
-    master->process_data_len = ecrt_domain_size(master->domain);
+    // Get internal process data for domains
+    for (domain = master->first_domain; domain != NULL; domain = domain->next) {
+      domain->process_data = ecrt_domain_data(domain->domain);
+      domain->process_data_len = ecrt_domain_size(domain->domain);
+    }
 
     // init hal data
     rtapi_snprintf(name, HAL_NAME_LEN, "%s.%s", LCEC_MODULE_NAME, master->name);
-    if ((master->hal_data = lcec_init_master_hal(name)) == NULL) {
+    if ((master->hal_data = lcec_init_master_hal(name, 0)) == NULL) {
+      goto fail2;
+    }
+    if ((master->timing = lcec_init_timing_hal(comp_id, name)) == NULL) {
       goto fail2;
     }
 
@@ -293,6 +338,20 @@ int rtapi_app_main(void) {
       rtapi_print_msg (RTAPI_MSG_ERR, LCEC_MSG_PFX "master %s write funct export failed\n", master->name);
       goto fail2;
     }
+
+    // export read/write functions of additional domains
+    for (domain = master->first_domain->next; domain != NULL; domain = domain->next) {
+      rtapi_snprintf(name, HAL_NAME_LEN, "%s.%s.%s.read", LCEC_MODULE_NAME, master->name, domain->name);
+      if (hal_export_funct(name, lcec_read_domain, domain, 0, 0, comp_id) != 0) {
+        rtapi_print_msg (RTAPI_MSG_ERR, LCEC_MSG_PFX "domain %s.%s read funct export failed\n", master->name, domain->name);
+        goto fail2;
+      }
+      rtapi_snprintf(name, HAL_NAME_LEN, "%s.%s.%s.write", LCEC_MODULE_NAME, master->name, domain->name);
+      if (hal_export_funct(name, lcec_write_domain, domain, 0, 0, comp_id) != 0) {
+        rtapi_print_msg (RTAPI_MSG_ERR, LCEC_MSG_PFX "domain %s.%s write funct export failed\n", master->name, domain->name);
+        goto fail2;
+      }
+    }
   }
 
   // export read-all function
@@ -341,12 +400,14 @@ int lcec_parse_config(void) {
   int slave_count;
   const lcec_typelist_t *type;
   lcec_master_t *master;
+  lcec_domain_t *domain;
   lcec_slave_t *slave;
   lcec_slave_dc_t *dc;
   lcec_slave_watchdog_t *wd;
   ec_pdo_entry_reg_t *pdo_entry_regs;
   LCEC_CONF_TYPE_T conf_type;
   LCEC_CONF_MASTER_T *master_conf;
+  LCEC_CONF_DOMAIN_T *domain_conf;
   LCEC_CONF_SLAVE_T *slave_conf;
   LCEC_CONF_DC_T *dc_conf;
   LCEC_CONF_WATCHDOG_T *wd_conf;
@@ -429,6 +490,7 @@ int lcec_parse_config(void) {
         strncpy(master->name, master_conf->name, LCEC_CONF_STR_MAXLEN);
         master->name[LCEC_CONF_STR_MAXLEN - 1] = 0;
         master->mutex = 0;
+        master->state = 0;
         master->app_time = 0;
         master->app_time_period = master_conf->appTimePeriod;
         master->sync_ref_cnt = 0;
@@ -436,6 +498,36 @@ int lcec_parse_config(void) {
 
         // add master to list
         LCEC_LIST_APPEND(first_master, last_master, master);
+
+        // create default domain
+        if (lcec_create_domain(master, "", 1) == NULL) {
+          goto fail2;
+        }
+        break;
+
+      case lcecConfTypeDomain:
+        // get config token
+        domain_conf = (LCEC_CONF_DOMAIN_T *)conf;
+        conf += sizeof(LCEC_CONF_DOMAIN_T);
+
+        // check for master
+        if (master == NULL) {
+          rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "Master node for domain missing\n");
+          goto fail2;
+        }
+
+        // check for duplicate name
+        for (domain = master->first_domain; domain != NULL; domain = domain->next) {
+          if (strcmp(domain->name, domain_conf->name) == 0) {
+            rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "Duplicate domain %s.%s\n", master->name, domain_conf->name);
+            goto fail2;
+          }
+        }
+
+        // create domain
+        if (lcec_create_domain(master, domain_conf->name, domain_conf->divider) == NULL) {
+          goto fail2;
+        }
         break;
 
       case lcecConfTypeSlave:
@@ -449,6 +541,16 @@ int lcec_parse_config(void) {
           goto fail2;
         }
 
+        // find slave's domain (default domain if not given)
+        domain = master->first_domain;
+        if (slave_conf->domain[0] != 0) {
+          for (domain = master->first_domain; domain != NULL && strcmp(domain->name, slave_conf->domain) != 0; domain = domain->next);
+          if (domain == NULL) {
+            rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "Unknown domain %s for slave %s.%s\n", slave_conf->domain, master->name, slave_conf->name);
+            goto fail2;
+          }
+        }
+
         // check for valid slave type
         if (slave_conf->type == lcecSlaveTypeGeneric) {
           type = NULL;
@@ -479,14 +581,21 @@ int lcec_parse_config(void) {
         strncpy(slave->name, slave_conf->name, LCEC_CONF_STR_MAXLEN);
         slave->name[LCEC_CONF_STR_MAXLEN - 1] = 0;
         slave->master = master;
+        slave->domain = domain;
 
         // add slave to list
         LCEC_LIST_APPEND(master->first_slave, master->last_slave, slave);
+        master->slave_count++;
 
         if (type != NULL) {
-          // normal slave
-          slave->vid = type->vid;
-          slave->pid = type->pid;
+          // normal slave, profile types without own ids use the configured ones
+          if (type->vid != 0) {
+            slave->vid = type->vid;
+            slave->pid = type->pid;
+          } else {
+            slave->vid = slave_conf->vid;
+            slave->pid = slave_conf->pid;
+          }
           slave->pdo_entry_count = type->pdo_entry_count;
           slave->proc_init = type->proc_init;
         } else {
@@ -543,11 +652,12 @@ int lcec_parse_config(void) {
           slave->sync_info = generic_sync_managers;
         }
         slave->sdo_config = sdo_config;
+        slave->sdo_chan_count = slave_conf->sdoChannels;
         slave->dc_conf = NULL;
         slave->wd_conf = NULL;
 
-        // update master's POD entry count
-        master->pdo_entry_count += slave->pdo_entry_count;
+        // update domain's POD entry count
+        domain->pdo_entry_count += slave->pdo_entry_count;
 
         // update slave count
         slave_count++;
@@ -759,12 +869,14 @@ int lcec_parse_config(void) {
 
   // allocate PDO entity memory
   for (master = first_master; master != NULL; master = master->next) {
-    pdo_entry_regs = kzalloc(sizeof(ec_pdo_entry_reg_t) * (master->pdo_entry_count + 1), GFP_KERNEL);
-    if (pdo_entry_regs == NULL) {
-      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "Unable to allocate master %s PDO entry memory\n", master->name);
-      goto fail2;
+    for (domain = master->first_domain; domain != NULL; domain = domain->next) {
+      pdo_entry_regs = kzalloc(sizeof(ec_pdo_entry_reg_t) * (domain->pdo_entry_count + 1), GFP_KERNEL);
+      if (pdo_entry_regs == NULL) {
+        rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "Unable to allocate master %s PDO entry memory\n", master->name);
+        goto fail2;
+      }
+      domain->pdo_entry_regs = pdo_entry_regs;
     }
-    master->pdo_entry_regs = pdo_entry_regs;
   }
 
   return slave_count;
@@ -779,6 +891,7 @@ fail0:
 
 void lcec_clear_config(void) {
   lcec_master_t *master, *prev_master;
+  lcec_domain_t *domain, *prev_domain;
   lcec_slave_t *slave, *prev_slave;
 
   // iterate all masters
@@ -824,9 +937,15 @@ void lcec_clear_config(void) {
       ecrt_release_master(master->master);
     }
 
-    // free PDO entry memory
-    if (master->pdo_entry_regs != NULL) {
-      kfree(master->pdo_entry_regs);
+    // free domains and their PDO entry memory
+    domain = master->last_domain;
+    while (domain != NULL) {
+      prev_domain = domain->prev;
+      if (domain->pdo_entry_regs != NULL) {
+        kfree(domain->pdo_entry_regs);
+      }
+      kfree(domain);
+      domain = prev_domain;
     }
 
     // free master
@@ -835,6 +954,27 @@ void lcec_clear_config(void) {
   }
 }
 
+lcec_domain_t *lcec_create_domain(lcec_master_t *master, const char *name, int divider) {
+  lcec_domain_t *domain;
+
+  // alloc domain memory
+  domain = kzalloc(sizeof(lcec_domain_t), GFP_KERNEL);
+  if (domain == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "Unable to allocate domain %s.%s structure memory\n", master->name, name);
+    return NULL;
+  }
+
+  // initialize domain
+  domain->master = master;
+  strncpy(domain->name, name, LCEC_CONF_STR_MAXLEN);
+  domain->name[LCEC_CONF_STR_MAXLEN - 1] = 0;
+  domain->divider = divider;
+
+  // add domain to list
+  LCEC_LIST_APPEND(master->first_domain, master->last_domain, domain);
+  return domain;
+}
+
 void lcec_request_lock(void *data) {
   lcec_master_t *master = (lcec_master_t *) data;
   rtapi_mutex_get(&master->mutex);
@@ -845,7 +985,7 @@ void lcec_release_lock(void *data) {
   rtapi_mutex_give(&master->mutex);
 }
 
-lcec_master_data_t *lcec_init_master_hal(const char *pfx) {
+lcec_master_data_t *lcec_init_master_hal(const char *pfx, int global) {
   lcec_master_data_t *hal_data;
 
   // alloc hal data
@@ -880,6 +1020,13 @@ lcec_master_data_t *lcec_init_master_hal(const char *pfx) {
     rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.link-up failed\n", pfx);
     return NULL;
   }
+  if (!global) {
+    if (hal_pin_u32_newf(HAL_OUT, &(hal_data->slave_state_age), comp_id, "%s.slave-state-age", pfx) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.slave-state-age failed\n", pfx);
+      return NULL;
+    }
+    *(hal_data->slave_state_age) = 0;
+  }
 
   // initialize pins
   *(hal_data->slaves_responding) = 0;
@@ -900,7 +1047,7 @@ lcec_slave_state_t *lcec_init_slave_state_hal(char *master_name, char *slave_nam
     rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "hal_malloc() for %s.%s.%s failed\n", LCEC_MODULE_NAME, master_name, slave_name);
     return NULL;
   }
-  memset(hal_data, 0, sizeof(lcec_master_data_t));
+  memset(hal_data, 0, sizeof(lcec_slave_state_t));
 
   // export pins
   if (hal_pin_bit_newf(HAL_OUT, &(hal_data->online), comp_id, "%s.%s.%s.slave-online", LCEC_MODULE_NAME, master_name, slave_name) != 0) {
@@ -959,72 +1106,237 @@ void lcec_update_slave_state_hal(lcec_slave_state_t *hal_data, ec_slave_config_s
 
 void lcec_read_all(void *arg, long period) {
   lcec_master_t *master;
+  lcec_domain_t *domain;
 
-  // initialize global state
-  global_ms.slaves_responding = 0;
-  global_ms.al_states = 0;
-  global_ms.link_up = (first_master != NULL);
-
-  // process slaves
+  // process slaves, additional domains use the frames just received
   for (master = first_master; master != NULL; master = master->next) {
-    lcec_read_master(master, period);
+    lcec_read_master_data(master, period);
+    for (domain = master->first_domain->next; domain != NULL; domain = domain->next) {
+      lcec_read_domain_data(domain, period, 0);
+    }
   }
 
   // update global state pins
-  lcec_update_master_hal(global_hal_data, &global_ms);
+  lcec_publish_global();
 }
 
 void lcec_write_all(void *arg, long period) {
   lcec_master_t *master;
+  lcec_domain_t *domain;
 
-  // process slaves
+  // process slaves, additional domains are sent along with the default one
   for (master = first_master; master != NULL; master = master->next) {
+    for (domain = master->first_domain->next; domain != NULL; domain = domain->next) {
+      lcec_write_domain_data(domain, period, 0);
+    }
     lcec_write_master(master, period);
   }
 }
 
 void lcec_read_master(void *arg, long period) {
   lcec_master_t *master = (lcec_master_t *) arg;
+
+  // masters may run in different threads, so each of them
+  // refreshes the global state after its own one was published
+  lcec_read_master_data(master, period);
+  lcec_publish_global();
+}
+
+void lcec_read_master_data(lcec_master_t *master, long period) {
+  lcec_domain_t *domain = master->first_domain;
   lcec_slave_t *slave;
   ec_master_state_t ms;
-
-  // receive process data & master state
+  ec_domain_state_t ds;
+  long long start;
+  uint32_t recv_time;
+  uint32_t dc_ref_time = 0;
+  uint32_t dc_sync_error = 0;
+  int dc_valid = 0;
+
+  // receive process data, master state and slave states
   rtapi_mutex_get(&master->mutex);
+  start = rtapi_get_time();
   ecrt_master_receive(master->master);
-  ecrt_domain_process(master->domain);
+  ecrt_domain_process(domain->domain);
+  recv_time = rtapi_get_time() - start;
+  ecrt_domain_state(domain->domain, &ds);
   ecrt_master_state(master->master, &ms);
+  if (master->dc_used) {
+    dc_sync_error = ecrt_master_sync_monitor_process(master->master);
+    dc_valid = (dc_sync_error != 0xffffffff) && (ecrt_master_reference_clock_time(master->master, &dc_ref_time) == 0);
+  }
+  lcec_poll_slave_states(master);
   rtapi_mutex_give(&master->mutex);
 
+  // update timing pins, the reference clock was read with the last
+  // application time sent
+  lcec_timing_update_read(master->timing, recv_time, &ds, dc_valid, (int32_t) (dc_ref_time - (uint32_t) master->app_time), dc_sync_error);
+
   // update state pins
   lcec_update_master_hal(master->hal_data, &ms);
 
-  // update global state
-  global_ms.slaves_responding += ms.slaves_responding;
-  global_ms.al_states |= ms.al_states;
-  global_ms.link_up = global_ms.link_up && ms.link_up;
+  // publish state for global pins (single word store)
+  master->state = LCEC_MASTER_STATE_PACK(&ms);
+
+  // age of the oldest slave state (the next one to poll)
+  if (master->state_poll_slave != NULL) {
+    *(master->hal_data->slave_state_age) = master->cycle - master->state_poll_slave->state_cycle;
+  }
 
   // process slaves
   for (slave = master->first_slave; slave != NULL; slave = slave->next) {
-    // get slaves state
-    rtapi_mutex_get(&master->mutex);
-    ecrt_slave_config_state(slave->config, &slave->state);
-    rtapi_mutex_give(&master->mutex);
-    lcec_update_slave_state_hal(slave->hal_state_data, &slave->state);
+    // update state pins on change only
+    if (slave->state_changed) {
+      slave->state_changed = 0;
+      lcec_update_slave_state_hal(slave->hal_state_data, &slave->state);
+    }
+
+    // poll/start runtime sdo requests (mailbox traffic is independent of domains)
+    if (slave->sdo_chans != NULL) {
+      lcec_update_sdo_chans(slave);
+    }
 
     // process read function
-    if (slave->proc_read != NULL) {
+    if (slave->domain == domain && slave->proc_read != NULL) {
       slave->proc_read(slave, period);
     }
   }
 }
 
+void lcec_read_domain(void *arg, long period) {
+  lcec_domain_t *domain = (lcec_domain_t *) arg;
+  lcec_read_domain_data(domain, period, 1);
+}
+
+void lcec_write_domain(void *arg, long period) {
+  lcec_domain_t *domain = (lcec_domain_t *) arg;
+  lcec_write_domain_data(domain, period, 1);
+}
+
+void lcec_read_domain_data(lcec_domain_t *domain, long period, int receive) {
+  lcec_master_t *master = domain->master;
+  lcec_slave_t *slave;
+
+  // skip cycles according to divider
+  if (domain->read_cnt > 0) {
+    domain->read_cnt--;
+    return;
+  }
+  domain->read_cnt = domain->divider - 1;
+
+  // receive process data
+  rtapi_mutex_get(&master->mutex);
+  if (receive) {
+    ecrt_master_receive(master->master);
+  }
+  ecrt_domain_process(domain->domain);
+  rtapi_mutex_give(&master->mutex);
+
+  // process slaves, they see the domain's own cycle time
+  for (slave = master->first_slave; slave != NULL; slave = slave->next) {
+    if (slave->domain == domain && slave->proc_read != NULL) {
+      slave->proc_read(slave, period * domain->divider);
+    }
+  }
+}
+
+void lcec_write_domain_data(lcec_domain_t *domain, long period, int send) {
+  lcec_master_t *master = domain->master;
+  lcec_slave_t *slave;
+
+  // skip cycles according to divider
+  if (domain->write_cnt > 0) {
+    domain->write_cnt--;
+    return;
+  }
+  domain->write_cnt = domain->divider - 1;
+
+  // process slaves
+  for (slave = master->first_slave; slave != NULL; slave = slave->next) {
+    if (slave->domain == domain && slave->proc_write != NULL) {
+      slave->proc_write(slave, period * domain->divider);
+    }
+  }
+
+  // queue (and send) process data
+  rtapi_mutex_get(&master->mutex);
+  ecrt_domain_queue(domain->domain);
+  if (send) {
+    ecrt_master_send(master->master);
+  }
+  rtapi_mutex_give(&master->mutex);
+}
+
+void lcec_poll_slave_states(lcec_master_t *master) {
+  lcec_slave_t *slave;
+  ec_slave_config_state_t ss;
+  int i, count;
+
+  master->cycle++;
+
+  // poll slave_state_polls slaves per cycle, round robin
+  count = slave_state_polls;
+  if (count <= 0 || count > master->slave_count) {
+    count = master->slave_count;
+  }
+
+  slave = master->state_poll_slave;
+  if (slave == NULL) {
+    slave = master->first_slave;
+  }
+  for (i = 0; i < count; i++) {
+    ecrt_slave_config_state(slave->config, &ss);
+    if (ss.online != slave->state.online || ss.operational != slave->state.operational || ss.al_state != slave->state.al_state) {
+      slave->state = ss;
+      slave->state_changed = 1;
+    }
+    slave->state_cycle = master->cycle;
+
+    slave = slave->next;
+    if (slave == NULL) {
+      slave = master->first_slave;
+    }
+  }
+  master->state_poll_slave = slave;
+}
+
+void lcec_publish_global(void) {
+  lcec_master_t *master;
+  ec_master_state_t global_ms;
+  uint32_t state;
+
+  // another thread is just publishing, it will be refreshed next cycle
+  if (rtapi_mutex_try(&global_publish_mutex)) {
+    return;
+  }
+
+  // aggregate the last published state of all masters
+  global_ms.slaves_responding = 0;
+  global_ms.al_states = 0;
+  global_ms.link_up = (first_master != NULL);
+  for (master = first_master; master != NULL; master = master->next) {
+    state = master->state;
+    global_ms.slaves_responding += LCEC_MASTER_STATE_SLAVES(state);
+    global_ms.al_states |= LCEC_MASTER_STATE_AL_STATES(state);
+    global_ms.link_up = global_ms.link_up && LCEC_MASTER_STATE_LINK_UP(state);
+  }
+
+  // update global state pins
+  lcec_update_master_hal(global_hal_data, &global_ms);
+
+  rtapi_mutex_give(&global_publish_mutex);
+}
+
 void lcec_write_master(void *arg, long period) {
   lcec_master_t *master = (lcec_master_t *) arg;
+  lcec_domain_t *domain = master->first_domain;
   lcec_slave_t *slave;
+  long long start;
+  uint32_t send_time;
 
   // process slaves
   for (slave = master->first_slave; slave != NULL; slave = slave->next) {
-    if (slave->proc_write != NULL) {
+    if (slave->domain == domain && slave->proc_write != NULL) {
       slave->proc_write(slave, period);
     }
   }
@@ -1046,10 +1358,20 @@ void lcec_write_master(void *arg, long period) {
   // sync slaves to ref clock
   ecrt_master_sync_slave_clocks(master->master);
 
+  // queue dc sync monitoring
+  if (master->dc_used) {
+    ecrt_master_sync_monitor_queue(master->master);
+  }
+
   // send domain data
-  ecrt_domain_queue(master->domain);
+  start = rtapi_get_time();
+  ecrt_domain_queue(domain->domain);
   ecrt_master_send(master->master);
+  send_time = rtapi_get_time() - start;
   rtapi_mutex_give(&master->mutex);
+
+  // update timing pins
+  lcec_timing_update_write(master->timing, send_time);
 }
 
 ec_sdo_request_t *lcec_read_sdo(struct lcec_slave *slave, uint16_t index, uint8_t subindex, size_t size) {
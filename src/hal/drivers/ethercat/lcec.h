@@ -18,20 +18,34 @@
 #ifndef _LCEC_H_
 #define _LCEC_H_
 
+#ifdef SIM
+#include <stdlib.h>
+#include <sched.h>
+#else
 #include <linux/ctype.h>
 #include <linux/slab.h>
+#endif
 
 #include "hal.h"
 
 #include "rtapi.h"
 #include "rtapi_ctype.h"
-#include "rtapi_app.h"
 #include "rtapi_string.h"
 #include "rtapi_math.h"
 
 #include "ecrt.h"
 #include "lcec_conf.h"
 
+// kernel services used by the driver, simulator builds run in userspace
+#ifdef SIM
+#define GFP_KERNEL 0
+#define kzalloc(size, flags) calloc(1, (size))
+#define kfree(ptr) free(ptr)
+#define HZ 1000
+#define jiffies ((unsigned long) (rtapi_get_time() / 1000000))
+#define schedule() sched_yield()
+#endif
+
 // list macros
 #define LCEC_LIST_APPEND(first, last, item) \
 do {                             \
@@ -63,13 +77,24 @@ do {                        \
 #define LCEC_BECKHOFF_VID 0x00000002
 #define LCEC_STOEBER_VID  0x000000b9
 
-// SDO request timeout (ms)
+// packed master state, published by the master's read function
+#define LCEC_MASTER_STATE_PACK(ms) (((ms)->slaves_responding << 5) | ((ms)->link_up << 4) | (ms)->al_states)
+#define LCEC_MASTER_STATE_SLAVES(st) ((st) >> 5)
+#define LCEC_MASTER_STATE_LINK_UP(st) (((st) >> 4) & 0x01)
+#define LCEC_MASTER_STATE_AL_STATES(st) ((st) & 0x0f)
+
+// SDO request timeout (ms), also used for runtime SDO channels
 #define LCEC_SDO_REQ_TIMEOUT 1000
 
 struct lcec_master;
+struct lcec_domain;
 struct lcec_slave;
+struct lcec_generic_plan;
+struct lcec_timing;
+struct lcec_sdo_chan;
 
 typedef int (*lcec_slave_init_t) (int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t *pdo_entry_regs);
+typedef int (*lcec_slave_postinit_t) (struct lcec_slave *slave);
 typedef void (*lcec_slave_cleanup_t) (struct lcec_slave *slave);
 typedef void (*lcec_slave_rw_t) (struct lcec_slave *slave, long period);
 
@@ -80,6 +105,7 @@ typedef struct lcec_master_data {
   hal_bit_t *state_safeop;
   hal_bit_t *state_op;
   hal_bit_t *link_up;
+  hal_u32_t *slave_state_age;
 } lcec_master_data_t;
 
 typedef struct lcec_slave_state {
@@ -91,6 +117,22 @@ typedef struct lcec_slave_state {
   hal_bit_t *state_op;
 } lcec_slave_state_t;
 
+typedef struct lcec_domain {
+  struct lcec_domain *prev;
+  struct lcec_domain *next;
+  struct lcec_master *master;
+  char name[LCEC_CONF_STR_MAXLEN];
+  int divider;
+  int read_cnt;
+  int write_cnt;
+  int pdo_entry_count;
+  ec_pdo_entry_reg_t *pdo_entry_regs;
+  ec_pdo_entry_reg_t *pdo_entry_fill;
+  ec_domain_t *domain;
+  uint8_t *process_data;
+  int process_data_len;
+} lcec_domain_t;
+
 typedef struct lcec_master {
   struct lcec_master *prev;
   struct lcec_master *next;
@@ -98,18 +140,22 @@ typedef struct lcec_master {
   char name[LCEC_CONF_STR_MAXLEN];
   ec_master_t *master;
   unsigned long mutex;
-  int pdo_entry_count;
-  ec_pdo_entry_reg_t *pdo_entry_regs;
-  ec_domain_t *domain;
-  uint8_t *process_data;
-  int process_data_len;
+  // the first domain is the default one, exchanged by the master's read/write functions
+  struct lcec_domain *first_domain;
+  struct lcec_domain *last_domain;
   struct lcec_slave *first_slave;
   struct lcec_slave *last_slave;
+  int slave_count;
+  struct lcec_slave *state_poll_slave;
+  uint32_t cycle;
   lcec_master_data_t *hal_data;
+  struct lcec_timing *timing;
+  volatile uint32_t state;
   uint64_t app_time;
   uint32_t app_time_period;
   int sync_ref_cnt;
   int sync_ref_cycles;
+  int dc_used;
 } lcec_master_t;
 
 typedef struct {
@@ -136,6 +182,7 @@ typedef struct lcec_slave {
   struct lcec_slave *prev;
   struct lcec_slave *next;
   struct lcec_master *master;
+  struct lcec_domain *domain;
   int index;
   char name[LCEC_CONF_STR_MAXLEN];
   uint32_t vid;
@@ -144,9 +191,12 @@ typedef struct lcec_slave {
   ec_sync_info_t *sync_info;
   ec_slave_config_t *config;
   ec_slave_config_state_t state;
+  int state_changed;
+  uint32_t state_cycle;
   lcec_slave_dc_t *dc_conf;
   lcec_slave_watchdog_t *wd_conf;
   lcec_slave_init_t proc_init;
+  lcec_slave_postinit_t proc_postinit;
   lcec_slave_cleanup_t proc_cleanup;
   lcec_slave_rw_t proc_read;
   lcec_slave_rw_t proc_write;
@@ -155,7 +205,10 @@ typedef struct lcec_slave {
   ec_pdo_entry_info_t *generic_pdo_entries;
   ec_pdo_info_t *generic_pdos;
   ec_sync_info_t *generic_sync_managers;
+  struct lcec_generic_plan *generic_plan;
   lcec_slave_sdoconf_t *sdo_config;
+  int sdo_chan_count;
+  struct lcec_sdo_chan *sdo_chans;
 } lcec_slave_t;
 
 ec_sdo_request_t *lcec_read_sdo(struct lcec_slave *slave, uint16_t index, uint8_t subindex, size_t size);
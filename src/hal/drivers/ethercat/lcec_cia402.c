@@ -0,0 +1,503 @@
+//
+//    Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+#include "lcec.h"
+#include "lcec_cia402.h"
+
+// modes of operation (0x6060/0x6061)
+#define CIA402_MODE_CSP 8
+#define CIA402_MODE_CSV 9
+#define CIA402_MODE_CST 10
+
+// statusword state decoding (0x6041)
+#define CIA402_SW_MASK_SHORT      0x004f
+#define CIA402_SW_MASK_LONG       0x006f
+#define CIA402_SW_NOT_READY       0x0000
+#define CIA402_SW_SWITCH_DISABLED 0x0040
+#define CIA402_SW_READY           0x0021
+#define CIA402_SW_SWITCHED_ON     0x0023
+#define CIA402_SW_OP_ENABLED      0x0027
+#define CIA402_SW_QUICK_STOP      0x0007
+#define CIA402_SW_FAULT_REACTION  0x000f
+#define CIA402_SW_FAULT           0x0008
+
+#define CIA402_SW_BIT_WARNING        7
+#define CIA402_SW_BIT_TARGET_REACHED 10
+
+// controlword commands (0x6040)
+#define CIA402_CW_DISABLE_VOLTAGE 0x0000
+#define CIA402_CW_SHUTDOWN        0x0006
+#define CIA402_CW_SWITCH_ON       0x0007
+#define CIA402_CW_ENABLE_OP       0x000f
+#define CIA402_CW_FAULT_RESET     0x0080
+
+// torque is transferred in 0.1% of rated torque
+#define CIA402_TORQUE_FACTOR 10.0
+#define CIA402_TORQUE_DIV    0.1
+
+typedef enum {
+  lcecCia402StateNotReady,
+  lcecCia402StateSwitchDisabled,
+  lcecCia402StateReady,
+  lcecCia402StateSwitchedOn,
+  lcecCia402StateOpEnabled,
+  lcecCia402StateQuickStop,
+  lcecCia402StateFaultReaction,
+  lcecCia402StateFault
+} LCEC_CIA402_STATE_T;
+
+typedef struct {
+  int do_init;
+
+  long long pos_cnt;
+  int32_t last_pos_cnt;
+  LCEC_CIA402_STATE_T state;
+  int8_t mode_act;
+
+  hal_bit_t *enable;
+  hal_bit_t *fault_reset;
+  hal_bit_t *mode_csv;
+  hal_bit_t *mode_cst;
+  hal_float_t *pos_cmd;
+  hal_float_t *vel_cmd;
+  hal_float_t *torque_cmd;
+  hal_float_t *pos_fb;
+  hal_float_t *vel_fb;
+  hal_float_t *torque_fb;
+  hal_s32_t *enc_raw;
+  hal_u32_t *pos_raw_hi;
+  hal_u32_t *pos_raw_lo;
+  hal_bit_t *ready;
+  hal_bit_t *enabled;
+  hal_bit_t *fault;
+  hal_bit_t *warning;
+  hal_bit_t *target_reached;
+  hal_s32_t *mode_fb;
+  hal_u32_t *statusword;
+  hal_u32_t *controlword;
+
+  hal_float_t pos_scale;
+  double pos_scale_old;
+  double pos_scale_rcpt;
+
+  unsigned int controlword_pdo_os;
+  unsigned int mode_pdo_os;
+  unsigned int target_pos_pdo_os;
+  unsigned int target_vel_pdo_os;
+  unsigned int target_torque_pdo_os;
+  unsigned int statusword_pdo_os;
+  unsigned int mode_disp_pdo_os;
+  unsigned int pos_act_pdo_os;
+  unsigned int vel_act_pdo_os;
+  unsigned int torque_act_pdo_os;
+
+} lcec_cia402_data_t;
+
+// default profile mapping, drives with fixed PDO assignment
+// have to offer these objects in their 0x1600/0x1a00 PDOs
+static ec_pdo_entry_info_t lcec_cia402_rx[] = {
+    {0x6040, 0x00, 16}, // controlword
+    {0x6060, 0x00,  8}, // modes of operation
+    {0x607a, 0x00, 32}, // target position
+    {0x60ff, 0x00, 32}, // target velocity
+    {0x6071, 0x00, 16}  // target torque
+};
+
+static ec_pdo_entry_info_t lcec_cia402_tx[] = {
+    {0x6041, 0x00, 16}, // statusword
+    {0x6061, 0x00,  8}, // modes of operation display
+    {0x6064, 0x00, 32}, // position actual value
+    {0x606c, 0x00, 32}, // velocity actual value
+    {0x6077, 0x00, 16}  // torque actual value
+};
+
+static ec_pdo_info_t lcec_cia402_pdos_out[] = {
+    {0x1600, 5, lcec_cia402_rx}
+};
+
+static ec_pdo_info_t lcec_cia402_pdos_in[] = {
+    {0x1a00, 5, lcec_cia402_tx}
+};
+
+static ec_sync_info_t lcec_cia402_syncs[] = {
+    {0, EC_DIR_OUTPUT, 0, NULL},
+    {1, EC_DIR_INPUT,  0, NULL},
+    {2, EC_DIR_OUTPUT, 1, lcec_cia402_pdos_out},
+    {3, EC_DIR_INPUT,  1, lcec_cia402_pdos_in},
+    {0xff}
+};
+
+void lcec_cia402_check_scales(lcec_cia402_data_t *hal_data);
+LCEC_CIA402_STATE_T lcec_cia402_decode_state(uint16_t sw);
+uint16_t lcec_cia402_controlword(lcec_cia402_data_t *hal_data);
+
+void lcec_cia402_read(struct lcec_slave *slave, long period);
+void lcec_cia402_write(struct lcec_slave *slave, long period);
+
+int lcec_cia402_init(int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t *pdo_entry_regs) {
+  lcec_master_t *master = slave->master;
+  lcec_cia402_data_t *hal_data;
+  int err;
+
+  // initialize callbacks
+  slave->proc_read = lcec_cia402_read;
+  slave->proc_write = lcec_cia402_write;
+
+  // alloc hal memory
+  if ((hal_data = hal_malloc(sizeof(lcec_cia402_data_t))) == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "hal_malloc() for slave %s.%s failed\n", master->name, slave->name);
+    return -EIO;
+  }
+  memset(hal_data, 0, sizeof(lcec_cia402_data_t));
+  slave->hal_data = hal_data;
+
+  // initialize sync info
+  slave->sync_info = lcec_cia402_syncs;
+
+  // initialize POD entries
+  LCEC_PDO_INIT(pdo_entry_regs, slave->index, slave->vid, slave->pid, 0x6040, 0x00, &hal_data->controlword_pdo_os, NULL);
+  LCEC_PDO_INIT(pdo_entry_regs, slave->index, slave->vid, slave->pid, 0x6060, 0x00, &hal_data->mode_pdo_os, NULL);
+  LCEC_PDO_INIT(pdo_entry_regs, slave->index, slave->vid, slave->pid, 0x607a, 0x00, &hal_data->target_pos_pdo_os, NULL);
+  LCEC_PDO_INIT(pdo_entry_regs, slave->index, slave->vid, slave->pid, 0x60ff, 0x00, &hal_data->target_vel_pdo_os, NULL);
+  LCEC_PDO_INIT(pdo_entry_regs, slave->index, slave->vid, slave->pid, 0x6071, 0x00, &hal_data->target_torque_pdo_os, NULL);
+  LCEC_PDO_INIT(pdo_entry_regs, slave->index, slave->vid, slave->pid, 0x6041, 0x00, &hal_data->statusword_pdo_os, NULL);
+  LCEC_PDO_INIT(pdo_entry_regs, slave->index, slave->vid, slave->pid, 0x6061, 0x00, &hal_data->mode_disp_pdo_os, NULL);
+  LCEC_PDO_INIT(pdo_entry_regs, slave->index, slave->vid, slave->pid, 0x6064, 0x00, &hal_data->pos_act_pdo_os, NULL);
+  LCEC_PDO_INIT(pdo_entry_regs, slave->index, slave->vid, slave->pid, 0x606c, 0x00, &hal_data->vel_act_pdo_os, NULL);
+  LCEC_PDO_INIT(pdo_entry_regs, slave->index, slave->vid, slave->pid, 0x6077, 0x00, &hal_data->torque_act_pdo_os, NULL);
+
+  // export pins
+  if ((err = hal_pin_bit_newf(HAL_IN, &(hal_data->enable), comp_id, "%s.%s.%s.srv-enable", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-enable failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_bit_newf(HAL_IN, &(hal_data->fault_reset), comp_id, "%s.%s.%s.srv-fault-reset", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-fault-reset failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_bit_newf(HAL_IN, &(hal_data->mode_csv), comp_id, "%s.%s.%s.srv-mode-csv", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-mode-csv failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_bit_newf(HAL_IN, &(hal_data->mode_cst), comp_id, "%s.%s.%s.srv-mode-cst", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-mode-cst failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_float_newf(HAL_IN, &(hal_data->pos_cmd), comp_id, "%s.%s.%s.srv-pos-cmd", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-pos-cmd failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_float_newf(HAL_IN, &(hal_data->vel_cmd), comp_id, "%s.%s.%s.srv-vel-cmd", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-vel-cmd failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_float_newf(HAL_IN, &(hal_data->torque_cmd), comp_id, "%s.%s.%s.srv-torque-cmd", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-torque-cmd failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_float_newf(HAL_OUT, &(hal_data->pos_fb), comp_id, "%s.%s.%s.srv-pos-fb", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-pos-fb failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_float_newf(HAL_OUT, &(hal_data->vel_fb), comp_id, "%s.%s.%s.srv-vel-fb", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-vel-fb failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_float_newf(HAL_OUT, &(hal_data->torque_fb), comp_id, "%s.%s.%s.srv-torque-fb", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-torque-fb failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_s32_newf(HAL_OUT, &(hal_data->enc_raw), comp_id, "%s.%s.%s.srv-enc-raw", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-enc-raw failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(hal_data->pos_raw_hi), comp_id, "%s.%s.%s.srv-pos-raw-hi", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-pos-raw-hi failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(hal_data->pos_raw_lo), comp_id, "%s.%s.%s.srv-pos-raw-lo", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-pos-raw-lo failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_bit_newf(HAL_OUT, &(hal_data->ready), comp_id, "%s.%s.%s.srv-ready", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-ready failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_bit_newf(HAL_OUT, &(hal_data->enabled), comp_id, "%s.%s.%s.srv-enabled", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-enabled failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_bit_newf(HAL_OUT, &(hal_data->fault), comp_id, "%s.%s.%s.srv-fault", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-fault failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_bit_newf(HAL_OUT, &(hal_data->warning), comp_id, "%s.%s.%s.srv-warning", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-warning failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_bit_newf(HAL_OUT, &(hal_data->target_reached), comp_id, "%s.%s.%s.srv-target-reached", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-target-reached failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_s32_newf(HAL_OUT, &(hal_data->mode_fb), comp_id, "%s.%s.%s.srv-mode-fb", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-mode-fb failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(hal_data->statusword), comp_id, "%s.%s.%s.srv-statusword", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-statusword failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+  if ((err = hal_pin_u32_newf(HAL_OUT, &(hal_data->controlword), comp_id, "%s.%s.%s.srv-controlword", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-controlword failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+
+  // export parameters
+  if ((err = hal_param_float_newf(HAL_RW, &(hal_data->pos_scale), comp_id, "%s.%s.%s.srv-pos-scale", LCEC_MODULE_NAME, master->name, slave->name)) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.srv-pos-scale failed\n", LCEC_MODULE_NAME, master->name, slave->name);
+    return err;
+  }
+
+  // set default pin values
+  *(hal_data->enable) = 0;
+  *(hal_data->fault_reset) = 0;
+  *(hal_data->mode_csv) = 0;
+  *(hal_data->mode_cst) = 0;
+  *(hal_data->pos_cmd) = 0.0;
+  *(hal_data->vel_cmd) = 0.0;
+  *(hal_data->torque_cmd) = 0.0;
+  *(hal_data->pos_fb) = 0.0;
+  *(hal_data->vel_fb) = 0.0;
+  *(hal_data->torque_fb) = 0.0;
+  *(hal_data->enc_raw) = 0;
+  *(hal_data->pos_raw_hi) = 0;
+  *(hal_data->pos_raw_lo) = 0;
+  *(hal_data->ready) = 0;
+  *(hal_data->enabled) = 0;
+  *(hal_data->fault) = 0;
+  *(hal_data->warning) = 0;
+  *(hal_data->target_reached) = 0;
+  *(hal_data->mode_fb) = 0;
+  *(hal_data->statusword) = 0;
+  *(hal_data->controlword) = 0;
+
+  // initialize variables
+  hal_data->pos_scale = 1.0;
+  hal_data->do_init = 1;
+  hal_data->pos_cnt = 0;
+  hal_data->last_pos_cnt = 0;
+  hal_data->state = lcecCia402StateNotReady;
+  hal_data->mode_act = 0;
+  hal_data->pos_scale_old = hal_data->pos_scale + 1.0;
+  hal_data->pos_scale_rcpt = 1.0;
+
+  return 0;
+}
+
+void lcec_cia402_check_scales(lcec_cia402_data_t *hal_data) {
+  // check for change in scale value
+  if (hal_data->pos_scale != hal_data->pos_scale_old) {
+    // scale value has changed, test and update it
+    if ((hal_data->pos_scale < 1e-20) && (hal_data->pos_scale > -1e-20)) {
+      // value too small, divide by zero is a bad thing
+      hal_data->pos_scale = 1.0;
+    }
+    // save new scale to detect future changes
+    hal_data->pos_scale_old = hal_data->pos_scale;
+    // we actually want the reciprocal
+    hal_data->pos_scale_rcpt = 1.0 / hal_data->pos_scale;
+  }
+}
+
+LCEC_CIA402_STATE_T lcec_cia402_decode_state(uint16_t sw) {
+  switch (sw & CIA402_SW_MASK_LONG) {
+    case CIA402_SW_READY:
+      return lcecCia402StateReady;
+    case CIA402_SW_SWITCHED_ON:
+      return lcecCia402StateSwitchedOn;
+    case CIA402_SW_OP_ENABLED:
+      return lcecCia402StateOpEnabled;
+    case CIA402_SW_QUICK_STOP:
+      return lcecCia402StateQuickStop;
+  }
+
+  switch (sw & CIA402_SW_MASK_SHORT) {
+    case CIA402_SW_SWITCH_DISABLED:
+      return lcecCia402StateSwitchDisabled;
+    case CIA402_SW_FAULT_REACTION:
+      return lcecCia402StateFaultReaction;
+    case CIA402_SW_FAULT:
+      return lcecCia402StateFault;
+  }
+
+  return lcecCia402StateNotReady;
+}
+
+uint16_t lcec_cia402_controlword(lcec_cia402_data_t *hal_data) {
+  // fault reset is triggered by the rising edge of bit 7,
+  // so holding fault-reset produces exactly one edge
+  if (hal_data->state == lcecCia402StateFault) {
+    return *(hal_data->fault_reset) ? CIA402_CW_FAULT_RESET : CIA402_CW_DISABLE_VOLTAGE;
+  }
+
+  // disabled: leave quick stop, otherwise park in ready to switch on
+  if (! *(hal_data->enable)) {
+    if (hal_data->state == lcecCia402StateQuickStop) {
+      return CIA402_CW_DISABLE_VOLTAGE;
+    }
+    return CIA402_CW_SHUTDOWN;
+  }
+
+  // enabled: walk up the state machine one transition per cycle
+  switch (hal_data->state) {
+    case lcecCia402StateSwitchDisabled:
+      return CIA402_CW_SHUTDOWN;
+    case lcecCia402StateReady:
+      return CIA402_CW_SWITCH_ON;
+    case lcecCia402StateSwitchedOn:
+    case lcecCia402StateOpEnabled:
+      return CIA402_CW_ENABLE_OP;
+    default:
+      return CIA402_CW_DISABLE_VOLTAGE;
+  }
+}
+
+void lcec_cia402_read(struct lcec_slave *slave, long period) {
+  lcec_cia402_data_t *hal_data = (lcec_cia402_data_t *) slave->hal_data;
+  uint8_t *pd = slave->domain->process_data;
+  uint16_t sw;
+  int32_t pos_cnt, pos_cnt_diff;
+
+  // wait for slave to be operational, the drive may come
+  // back with a new position so restart the extension then
+  if (!slave->state.operational) {
+    hal_data->do_init = 1;
+    hal_data->state = lcecCia402StateNotReady;
+    *(hal_data->ready) = 0;
+    *(hal_data->enabled) = 0;
+    return;
+  }
+
+  // check for change in scale value
+  lcec_cia402_check_scales(hal_data);
+
+  // read statusword
+  sw = EC_READ_U16(&pd[hal_data->statusword_pdo_os]);
+  hal_data->state = lcec_cia402_decode_state(sw);
+  *(hal_data->statusword) = sw;
+  *(hal_data->ready) = (hal_data->state == lcecCia402StateReady || hal_data->state == lcecCia402StateSwitchedOn || hal_data->state == lcecCia402StateOpEnabled);
+  *(hal_data->enabled) = (hal_data->state == lcecCia402StateOpEnabled);
+  *(hal_data->fault) = (hal_data->state == lcecCia402StateFault || hal_data->state == lcecCia402StateFaultReaction);
+  *(hal_data->warning) = (sw >> CIA402_SW_BIT_WARNING) & 0x01;
+  *(hal_data->target_reached) = (sw >> CIA402_SW_BIT_TARGET_REACHED) & 0x01;
+
+  // read active mode
+  hal_data->mode_act = EC_READ_S8(&pd[hal_data->mode_disp_pdo_os]);
+  *(hal_data->mode_fb) = hal_data->mode_act;
+
+  // update position counter, the drive's 32 bit value
+  // is extended to 64 bit to survive the wrap around
+  pos_cnt = EC_READ_S32(&pd[hal_data->pos_act_pdo_os]);
+  *(hal_data->enc_raw) = pos_cnt;
+  if (hal_data->do_init) {
+    hal_data->do_init = 0;
+    hal_data->pos_cnt = pos_cnt;
+  } else {
+    pos_cnt_diff = (int32_t)((uint32_t)pos_cnt - (uint32_t)hal_data->last_pos_cnt);
+    hal_data->pos_cnt += pos_cnt_diff;
+  }
+  hal_data->last_pos_cnt = pos_cnt;
+
+  // update raw counter pins
+  *(hal_data->pos_raw_hi) = (hal_data->pos_cnt >> 32) & 0xffffffff;
+  *(hal_data->pos_raw_lo) = hal_data->pos_cnt & 0xffffffff;
+
+  // scale counts to make floating point values
+  *(hal_data->pos_fb) = (double)hal_data->pos_cnt * hal_data->pos_scale_rcpt;
+  *(hal_data->vel_fb) = (double)EC_READ_S32(&pd[hal_data->vel_act_pdo_os]) * hal_data->pos_scale_rcpt;
+  *(hal_data->torque_fb) = (double)EC_READ_S16(&pd[hal_data->torque_act_pdo_os]) * CIA402_TORQUE_DIV;
+}
+
+void lcec_cia402_write(struct lcec_slave *slave, long period) {
+  lcec_cia402_data_t *hal_data = (lcec_cia402_data_t *) slave->hal_data;
+  uint8_t *pd = slave->domain->process_data;
+  uint16_t cw;
+  int8_t mode;
+  int active;
+  long long pos_cmd_cnt;
+  double vel_raw, torque_raw;
+
+  // check for change in scale value
+  lcec_cia402_check_scales(hal_data);
+
+  // run state machine
+  cw = lcec_cia402_controlword(hal_data);
+  *(hal_data->controlword) = cw;
+  EC_WRITE_U16(&pd[hal_data->controlword_pdo_os], cw);
+
+  // select mode, csp if nothing else is requested
+  if (*(hal_data->mode_cst)) {
+    mode = CIA402_MODE_CST;
+  } else if (*(hal_data->mode_csv)) {
+    mode = CIA402_MODE_CSV;
+  } else {
+    mode = CIA402_MODE_CSP;
+  }
+  EC_WRITE_S8(&pd[hal_data->mode_pdo_os], mode);
+
+  // setpoints are only passed once the drive runs in the requested
+  // mode, otherwise the targets follow the actual values so the
+  // mode switch (and enable) is bumpless
+  active = (hal_data->state == lcecCia402StateOpEnabled && hal_data->mode_act == mode);
+
+  // target position, computed in 64 bit and truncated to the
+  // drive's 32 bit range which wraps like the actual value
+  if (active && mode == CIA402_MODE_CSP) {
+    pos_cmd_cnt = (long long)(*(hal_data->pos_cmd) * hal_data->pos_scale + (*(hal_data->pos_cmd) < 0.0 ? -0.5 : 0.5));
+  } else {
+    pos_cmd_cnt = hal_data->pos_cnt;
+  }
+  EC_WRITE_U32(&pd[hal_data->target_pos_pdo_os], (uint32_t)(pos_cmd_cnt & 0xffffffff));
+
+  // target velocity
+  vel_raw = 0.0;
+  if (active && mode == CIA402_MODE_CSV) {
+    vel_raw = *(hal_data->vel_cmd) * hal_data->pos_scale;
+    if (vel_raw > (double)0x7fffffff) {
+      vel_raw = (double)0x7fffffff;
+    }
+    if (vel_raw < (double)-0x7fffffff) {
+      vel_raw = (double)-0x7fffffff;
+    }
+  }
+  EC_WRITE_S32(&pd[hal_data->target_vel_pdo_os], (int32_t)vel_raw);
+
+  // target torque
+  torque_raw = 0.0;
+  if (active && mode == CIA402_MODE_CST) {
+    torque_raw = *(hal_data->torque_cmd) * CIA402_TORQUE_FACTOR;
+    if (torque_raw > (double)0x7fff) {
+      torque_raw = (double)0x7fff;
+    }
+    if (torque_raw < (double)-0x7fff) {
+      torque_raw = (double)-0x7fff;
+    }
+  }
+  EC_WRITE_S16(&pd[hal_data->target_torque_pdo_os], (int16_t)torque_raw);
+}
+
@@ -27,6 +27,7 @@
 #include "hal.h"
 
 #include "lcec_conf.h"
+#include "lcec_conf_image.h"
 
 #define BUFFSIZE 8192
 
@@ -124,6 +125,9 @@ static const LCEC_CONF_TYPELIST_T slaveTypes[] = {
   // stoeber MDS5000 series
   { "StMDS5k", lcecSlaveTypeStMDS5k },
 
+  // generic CiA402 drive profile
+  { "CiA402", lcecSlaveTypeCiA402 },
+
   { NULL }
 };
 
@@ -132,6 +136,8 @@ int hal_comp_id;
 LCEC_CONF_HAL_T *conf_hal_data;
 
 int exitEvent;
+int masterCount;
+int slaveCount;
 
 XML_Parser parser;
 int currConfType;
@@ -151,10 +157,13 @@ void xml_start_handler(void *data, const char *el, const char **attr);
 void xml_end_handler(void *data, const char *el);
 
 void *getOutputBuffer(size_t len);
+int parseConfigFile(const char *filename);
+uint32_t getImageLayout(void);
 
 int parseHexdump(const char *str, uint8_t *buf);
 
 void parseMasterAttrs(const char **attr);
+void parseDomainAttrs(const char **attr);
 void parseSlaveAttrs(const char **attr);
 void parseDcConfAttrs(const char **attr);
 void parseWatchdogAttrs(const char **attr);
@@ -176,14 +185,25 @@ static void exitHandler(int sig) {
 int main(int argc, char **argv) {
   int ret = 1;
   char *filename;
-  int done;
-  char buffer[BUFFSIZE];
-  FILE *file;
-  LCEC_CONF_NULL_T *end;
   void *shmem_ptr;
   LCEC_CONF_HEADER_T *header;
+  LCEC_CONF_IMAGE_T image;
+  const void *conf;
+  size_t confLength;
   uint64_t u;
 
+  // compile mode: parse xml and write binary image, no HAL involved
+  if (argc == 4 && strcmp(argv[1], "--compile") == 0) {
+    if (parseConfigFile(argv[2]) != 0) {
+      goto fail0;
+    }
+    if (lcecConfWriteImage(argv[3], outputBuffer, outputBufferPos, getImageLayout(), masterCount, slaveCount) == 0) {
+      ret = 0;
+    }
+    free(outputBuffer);
+    goto fail0;
+  }
+
   // initialize component
   hal_comp_id = hal_init(modname);
   if (hal_comp_id < 1) {
@@ -226,18 +246,98 @@ int main(int argc, char **argv) {
   }
   filename = argv[1];
 
+  // use precompiled image if given, parse xml otherwise
+  memset(&image, 0, sizeof(image));
+  if (lcecConfIsImage(filename)) {
+    if (lcecConfMapImage(filename, getImageLayout(), &image) != 0) {
+      goto fail2;
+    }
+    conf = image.data;
+    confLength = image.length;
+    masterCount = image.header->masterCount;
+    slaveCount = image.header->slaveCount;
+  } else {
+    if (parseConfigFile(filename) != 0) {
+      goto fail2;
+    }
+    conf = outputBuffer;
+    confLength = outputBufferPos;
+  }
+
+  // setup shared mem for config
+  shmem_id = rtapi_shmem_new(LCEC_CONF_SHMEM_KEY, hal_comp_id, sizeof(LCEC_CONF_HEADER_T) + confLength);
+  if ( shmem_id < 0 ) {
+    fprintf(stderr, "%s: ERROR: couldn't allocate user/RT shared memory\n", modname);
+    goto fail3;
+  }
+  if (rtapi_shmem_getptr(shmem_id, &shmem_ptr) < 0) {
+    fprintf(stderr, "%s: ERROR: couldn't map user/RT shared memory\n", modname);
+    goto fail4;
+  }
+
+  // setup header
+  header = shmem_ptr;
+  shmem_ptr += sizeof(LCEC_CONF_HEADER_T);
+  header->magic = LCEC_CONF_SHMEM_MAGIC;
+  header->length = confLength;
+
+  // copy data
+  memcpy(shmem_ptr, conf, confLength);
+
+  // free build buffer / image mapping
+  if (outputBuffer != NULL) {
+    free(outputBuffer);
+    outputBuffer = NULL;
+  }
+  lcecConfUnmapImage(&image);
+
+  // update pins
+  *conf_hal_data->master_count = masterCount;
+  *conf_hal_data->slave_count = slaveCount;
+
+  // everything is fine
+  ret = 0;
+  hal_ready(hal_comp_id);
+
+  // wait for SIGTERM
+  if (read(exitEvent, &u, sizeof(uint64_t)) < 0) {
+    fprintf(stderr, "%s: ERROR: error reading exit event\n", modname);
+  }
+
+fail4:
+  rtapi_shmem_delete(shmem_id, hal_comp_id);
+fail3:
+  if (outputBuffer != NULL) {
+    free(outputBuffer);
+  }
+  lcecConfUnmapImage(&image);
+fail2:
+  close(exitEvent);
+fail1:
+  hal_exit(hal_comp_id);
+fail0:
+  return ret;
+}
+
+int parseConfigFile(const char *filename) {
+  int ret = -1;
+  int done;
+  char buffer[BUFFSIZE];
+  FILE *file;
+  LCEC_CONF_NULL_T *end;
+
   // open file
   file = fopen(filename, "r");
   if (file == NULL) {
     fprintf(stderr, "%s: ERROR: unable to open config file %s\n", modname, filename);
-    goto fail2;
+    goto fail0;
   }
 
   // create xml parser
   parser = XML_ParserCreate(NULL);
   if (parser == NULL) {
     fprintf(stderr, "%s: ERROR: Couldn't allocate memory for parser\n", modname);
-    goto fail3;
+    goto fail1;
   }
 
   // setup handlers
@@ -252,12 +352,14 @@ int main(int argc, char **argv) {
   currSyncManager = NULL;
   currPdo = NULL;
   currSdoConf = NULL;
+  masterCount = 0;
+  slaveCount = 0;
   for (done=0; !done;) {
     // read block
     int len = fread(buffer, 1, BUFFSIZE, file);
     if (ferror(file)) {
       fprintf(stderr, "%s: ERROR: Couldn't read from file %s\n", modname, filename);
-      goto fail4;
+      goto fail2;
     }
 
     // check for EOF
@@ -268,67 +370,51 @@ int main(int argc, char **argv) {
       fprintf(stderr, "%s: ERROR: Parse error at line %u: %s\n", modname,
         (unsigned int)XML_GetCurrentLineNumber(parser),
         XML_ErrorString(XML_GetErrorCode(parser)));
-      goto fail4;
+      goto fail2;
     }
   }
 
   // set end marker
   end = getOutputBuffer(sizeof(LCEC_CONF_NULL_T));
   if (end == NULL) {
-      goto fail4;
+      goto fail2;
   }
   end->confType = lcecConfTypeNone;
 
-  // setup shared mem for config
-  shmem_id = rtapi_shmem_new(LCEC_CONF_SHMEM_KEY, hal_comp_id, sizeof(LCEC_CONF_HEADER_T) + outputBufferPos);
-  if ( shmem_id < 0 ) {
-    fprintf(stderr, "%s: ERROR: couldn't allocate user/RT shared memory\n", modname);
-    goto fail4;
-  }
-  if (rtapi_shmem_getptr(shmem_id, &shmem_ptr) < 0) {
-    fprintf(stderr, "%s: ERROR: couldn't map user/RT shared memory\n", modname);
-    goto fail5;
-  }
-
-  // setup header
-  header = shmem_ptr;
-  shmem_ptr += sizeof(LCEC_CONF_HEADER_T);
-  header->magic = LCEC_CONF_SHMEM_MAGIC;
-  header->length = outputBufferPos;
-
-  // copy data
-  memcpy(shmem_ptr, outputBuffer, outputBufferPos);
-
-  // free build buffer
-  free(outputBuffer);
-  outputBuffer = NULL;
-
-  // everything is fine
   ret = 0;
-  hal_ready(hal_comp_id);
-
-  // wait for SIGTERM
-  if (read(exitEvent, &u, sizeof(uint64_t)) < 0) {
-    fprintf(stderr, "%s: ERROR: error reading exit event\n", modname);
-  }
 
-fail5:
-  rtapi_shmem_delete(shmem_id, hal_comp_id);
-fail4:
-  if (outputBuffer != NULL) {
+fail2:
+  if (ret != 0 && outputBuffer != NULL) {
     free(outputBuffer);
+    outputBuffer = NULL;
   }
   XML_ParserFree(parser);
-fail3:
-  fclose(file);
-fail2:
-  close(exitEvent);
 fail1:
-  hal_exit(hal_comp_id);
+  fclose(file);
 fail0:
   return ret;
 }
 
+uint32_t getImageLayout(void) {
+  const LCEC_CONF_TYPELIST_T *slaveType;
+  uint32_t crc;
+  const uint32_t layout[] = {
+    sizeof(void *), sizeof(size_t), LCEC_CONF_STR_MAXLEN,
+    sizeof(LCEC_CONF_MASTER_T), sizeof(LCEC_CONF_DOMAIN_T), sizeof(LCEC_CONF_SLAVE_T),
+    sizeof(LCEC_CONF_DC_T), sizeof(LCEC_CONF_WATCHDOG_T), sizeof(LCEC_CONF_SYNCMANAGER_T),
+    sizeof(LCEC_CONF_PDO_T), sizeof(LCEC_CONF_PDOENTRY_T), sizeof(LCEC_CONF_SDOCONF_T),
+    lcecConfTypeSdoDataRaw
+  };
+
+  // record sizes and slave type ids must match the RT module's view
+  crc = lcecConfCrc32(0, layout, sizeof(layout));
+  for (slaveType = slaveTypes; slaveType->name != NULL; slaveType++) {
+    crc = lcecConfCrc32(crc, slaveType->name, strlen(slaveType->name));
+    crc = lcecConfCrc32(crc, &slaveType->type, sizeof(slaveType->type));
+  }
+  return crc;
+}
+
 void xml_start_handler(void *data, const char *el, const char **attr) {
   switch (currConfType) {
     case lcecConfTypeNone:
@@ -339,6 +425,11 @@ void xml_start_handler(void *data, const char *el, const char **attr) {
       }
       break;
     case lcecConfTypeMaster:
+      if (strcmp(el, "domain") == 0) {
+        currConfType = lcecConfTypeDomain;
+        parseDomainAttrs(attr);
+        return;
+      }
       if (strcmp(el, "slave") == 0) {
         currConfType = lcecConfTypeSlave;
         parseSlaveAttrs(attr);
@@ -402,6 +493,12 @@ void xml_end_handler(void *data, const char *el) {
         return;
       }
       break;
+    case lcecConfTypeDomain:
+      if (strcmp(el, "domain") == 0) {
+        currConfType = lcecConfTypeMaster;
+        return;
+      }
+      break;
     case lcecConfTypeSlave:
       if (strcmp(el, "slave") == 0) {
         currConfType = lcecConfTypeMaster;
@@ -456,12 +553,24 @@ void xml_end_handler(void *data, const char *el) {
   XML_StopParser(parser, 0);
 }
 
+#define TOKEN_POS(p) ((p) == NULL ? -1 : (ssize_t)((void *)(p) - outputBuffer))
+#define TOKEN_PTR(pos) ((pos) < 0 ? NULL : outputBuffer + (pos))
+
 void *getOutputBuffer(size_t len) {
   void *p;
+  ssize_t masterPos, slavePos, syncManagerPos, pdoPos, sdoConfPos;
 
   // reallocate if len do not fit into current buffer
   while ((outputBufferLen - outputBufferPos) < len) {
     size_t new = outputBufferLen + BUFFSIZE;
+
+    // the current tokens move along with the buffer
+    masterPos = TOKEN_POS(currMaster);
+    slavePos = TOKEN_POS(currSlave);
+    syncManagerPos = TOKEN_POS(currSyncManager);
+    pdoPos = TOKEN_POS(currPdo);
+    sdoConfPos = TOKEN_POS(currSdoConf);
+
     outputBuffer = realloc(outputBuffer, new);
     if (outputBuffer == NULL) {
       fprintf(stderr, "%s: ERROR: Couldn't allocate memory for config token\n", modname);
@@ -469,6 +578,12 @@ void *getOutputBuffer(size_t len) {
       return NULL;
     }
     outputBufferLen = new;
+
+    currMaster = TOKEN_PTR(masterPos);
+    currSlave = TOKEN_PTR(slavePos);
+    currSyncManager = TOKEN_PTR(syncManagerPos);
+    currPdo = TOKEN_PTR(pdoPos);
+    currSdoConf = TOKEN_PTR(sdoConfPos);
   }
 
   // initialize memory
@@ -571,10 +686,56 @@ void parseMasterAttrs(const char **attr) {
     snprintf(p->name, LCEC_CONF_STR_MAXLEN, "%d", p->index);
   }
 
-  (*(conf_hal_data->master_count))++;
+  masterCount++;
   currMaster = p;
 }
 
+void parseDomainAttrs(const char **attr) {
+  LCEC_CONF_DOMAIN_T *p = getOutputBuffer(sizeof(LCEC_CONF_DOMAIN_T));
+  if (p == NULL) {
+    return;
+  }
+
+  p->confType = lcecConfTypeDomain;
+  p->divider = 1;
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse name
+    if (strcmp(name, "name") == 0) {
+      strncpy(p->name, val, LCEC_CONF_STR_MAXLEN);
+      p->name[LCEC_CONF_STR_MAXLEN - 1] = 0;
+      continue;
+    }
+
+    // parse divider
+    if (strcmp(name, "divider") == 0) {
+      p->divider = atoi(val);
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid domain attribute %s\n", modname, name);
+    XML_StopParser(parser, 0);
+    return;
+  }
+
+  // name is required
+  if (p->name[0] == 0) {
+    fprintf(stderr, "%s: ERROR: Domain has no name attribute\n", modname);
+    XML_StopParser(parser, 0);
+    return;
+  }
+
+  // check divider
+  if (p->divider < 1) {
+    fprintf(stderr, "%s: ERROR: Invalid divider %d for domain %s\n", modname, p->divider, p->name);
+    XML_StopParser(parser, 0);
+    return;
+  }
+}
+
 void parseSlaveAttrs(const char **attr) {
   LCEC_CONF_SLAVE_T *p = getOutputBuffer(sizeof(LCEC_CONF_SLAVE_T));
   if (p == NULL) {
@@ -617,8 +778,26 @@ void parseSlaveAttrs(const char **attr) {
       continue;
     }
 
-    // generic only attributes
-    if (p->type == lcecSlaveTypeGeneric) {
+    // parse domain
+    if (strcmp(name, "domain") == 0) {
+      strncpy(p->domain, val, LCEC_CONF_STR_MAXLEN);
+      p->domain[LCEC_CONF_STR_MAXLEN - 1] = 0;
+      continue;
+    }
+
+    // parse sdoChannels
+    if (strcmp(name, "sdoChannels") == 0) {
+      p->sdoChannels = atoi(val);
+      if (p->sdoChannels < 0 || p->sdoChannels > LCEC_CONF_SDO_CHANNELS_MAX) {
+        fprintf(stderr, "%s: ERROR: Invalid sdoChannels %d (max %d)\n", modname, p->sdoChannels, LCEC_CONF_SDO_CHANNELS_MAX);
+        XML_StopParser(parser, 0);
+        return;
+      }
+      continue;
+    }
+
+    // vendor neutral types take vid/pid from config
+    if (p->type == lcecSlaveTypeGeneric || p->type == lcecSlaveTypeCiA402) {
       // parse vid (hex value)
       if (strcmp(name, "vid") == 0) {
         p->vid = strtol(val, NULL, 16);
@@ -630,7 +809,10 @@ void parseSlaveAttrs(const char **attr) {
         p->pid = strtol(val, NULL, 16);
         continue;
       }
+    }
 
+    // generic only attributes
+    if (p->type == lcecSlaveTypeGeneric) {
       // parse configPdos
       if (strcmp(name, "configPdos") == 0) {
         p->configPdos = (strcasecmp(val, "true") == 0);
@@ -656,7 +838,14 @@ void parseSlaveAttrs(const char **attr) {
     return;
   }
 
-  (*(conf_hal_data->slave_count))++;
+  // CiA402 slaves need the drive's identity
+  if (p->type == lcecSlaveTypeCiA402 && (p->vid == 0 || p->pid == 0)) {
+    fprintf(stderr, "%s: ERROR: CiA402 slave %s needs vid and pid attributes\n", modname, p->name);
+    XML_StopParser(parser, 0);
+    return;
+  }
+
+  slaveCount++;
   currSlave = p;
 }
 
@@ -987,7 +1176,7 @@ void parsePdoEntryAttrs(const char **attr) {
     // parse bitLen
     if (strcmp(name, "bitLen") == 0) {
       tmp = atoi(val);
-      if (tmp <= 0 || tmp > 32) {
+      if (tmp <= 0 || tmp > 64) {
         fprintf(stderr, "%s: ERROR: Invalid pdoEntry bitLen %d\n", modname, tmp);
         XML_StopParser(parser, 0);
         return;
@@ -1059,6 +1248,13 @@ void parsePdoEntryAttrs(const char **attr) {
     return;
   }
 
+  // entries above 32 bits can be mapped, but not connected to a pin
+  if (p->bitLength > 32 && p->halPin[0] != 0) {
+    fprintf(stderr, "%s: ERROR: pdoEntry %04x:%02x with bitLen %d can't have a halPin\n", modname, p->index, p->subindex, p->bitLength);
+    XML_StopParser(parser, 0);
+    return;
+  }
+
   (currSlave->pdoEntryCount)++;
   if (p->halPin[0] != 0) {
     (currSlave->pdoMappingCount)++;
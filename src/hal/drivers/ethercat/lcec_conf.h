@@ -28,9 +28,12 @@
 
 #define LCEC_CONF_STR_MAXLEN 32
 
+#define LCEC_CONF_SDO_CHANNELS_MAX 16
+
 typedef enum {
   lcecConfTypeNone,
   lcecConfTypeMaster,
+  lcecConfTypeDomain,
   lcecConfTypeSlave,
   lcecConfTypeDcConf,
   lcecConfTypeWatchdog,
@@ -101,7 +104,8 @@ typedef enum {
   lcecSlaveTypeEL9510,
   lcecSlaveTypeEL9512,
   lcecSlaveTypeEL9515,
-  lcecSlaveTypeStMDS5k
+  lcecSlaveTypeStMDS5k,
+  lcecSlaveTypeCiA402
 } LCEC_SLAVE_TYPE_T;
 
 typedef struct {
@@ -117,6 +121,12 @@ typedef struct {
   char name[LCEC_CONF_STR_MAXLEN];
 } LCEC_CONF_MASTER_T;
 
+typedef struct {
+  LCEC_CONF_TYPE_T confType;
+  int divider;
+  char name[LCEC_CONF_STR_MAXLEN];
+} LCEC_CONF_DOMAIN_T;
+
 typedef struct {
   LCEC_CONF_TYPE_T confType;
   int index;
@@ -129,7 +139,9 @@ typedef struct {
   unsigned int pdoEntryCount;
   unsigned int pdoMappingCount;
   size_t sdoConfigLength;
+  int sdoChannels;
   char name[LCEC_CONF_STR_MAXLEN];
+  char domain[LCEC_CONF_STR_MAXLEN];
 } LCEC_CONF_SLAVE_T;
 
 typedef struct {
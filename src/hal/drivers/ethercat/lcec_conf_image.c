@@ -0,0 +1,276 @@
+//
+//  Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lcec_conf_image.h"
+
+extern char *modname;
+
+uint32_t lcecConfCrc32(uint32_t crc, const void *buf, size_t len) {
+  static uint32_t table[256];
+  static int tableValid = 0;
+  const uint8_t *p = buf;
+  uint32_t c;
+  int i, j;
+
+  // build table on first use (reflected CRC-32, polynom 0xedb88320)
+  if (!tableValid) {
+    for (i = 0; i < 256; i++) {
+      c = i;
+      for (j = 0; j < 8; j++) {
+        c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+      }
+      table[i] = c;
+    }
+    tableValid = 1;
+  }
+
+  crc = ~crc;
+  while (len--) {
+    crc = table[(crc ^ *(p++)) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+size_t lcecConfRecordSize(const void *rec, size_t avail) {
+  const LCEC_CONF_SDOCONF_T *sdo;
+  size_t size;
+
+  if (avail < sizeof(LCEC_CONF_NULL_T)) {
+    return 0;
+  }
+
+  switch (((const LCEC_CONF_NULL_T *)rec)->confType) {
+    case lcecConfTypeNone:
+      size = sizeof(LCEC_CONF_NULL_T);
+      break;
+    case lcecConfTypeMaster:
+      size = sizeof(LCEC_CONF_MASTER_T);
+      break;
+    case lcecConfTypeDomain:
+      size = sizeof(LCEC_CONF_DOMAIN_T);
+      break;
+    case lcecConfTypeSlave:
+      size = sizeof(LCEC_CONF_SLAVE_T);
+      break;
+    case lcecConfTypeDcConf:
+      size = sizeof(LCEC_CONF_DC_T);
+      break;
+    case lcecConfTypeWatchdog:
+      size = sizeof(LCEC_CONF_WATCHDOG_T);
+      break;
+    case lcecConfTypeSyncManager:
+      size = sizeof(LCEC_CONF_SYNCMANAGER_T);
+      break;
+    case lcecConfTypePdo:
+      size = sizeof(LCEC_CONF_PDO_T);
+      break;
+    case lcecConfTypePdoEntry:
+      size = sizeof(LCEC_CONF_PDOENTRY_T);
+      break;
+    case lcecConfTypeSdoConfig:
+      // variable length, data follows the record
+      if (avail < sizeof(LCEC_CONF_SDOCONF_T)) {
+        return 0;
+      }
+      sdo = rec;
+      if (sdo->length > avail - sizeof(LCEC_CONF_SDOCONF_T)) {
+        return 0;
+      }
+      size = sizeof(LCEC_CONF_SDOCONF_T) + sdo->length;
+      break;
+    default:
+      return 0;
+  }
+
+  if (size > avail) {
+    return 0;
+  }
+  return size;
+}
+
+int lcecConfValidate(const void *data, size_t length) {
+  const void *p = data;
+  size_t avail = length;
+  size_t size;
+
+  // walk records, the stream must end with the terminator exactly
+  while ((size = lcecConfRecordSize(p, avail)) > 0) {
+    if (((const LCEC_CONF_NULL_T *)p)->confType == lcecConfTypeNone) {
+      return (size == avail) ? 0 : -1;
+    }
+    p += size;
+    avail -= size;
+  }
+
+  return -1;
+}
+
+int lcecConfIsImage(const char *filename) {
+  FILE *file;
+  uint32_t magic;
+  int ret;
+
+  file = fopen(filename, "r");
+  if (file == NULL) {
+    return 0;
+  }
+  ret = (fread(&magic, sizeof(magic), 1, file) == 1 && magic == LCEC_CONF_IMAGE_MAGIC);
+  fclose(file);
+  return ret;
+}
+
+int lcecConfWriteImage(const char *filename, const void *data, size_t length, uint32_t layout, uint32_t masterCount, uint32_t slaveCount) {
+  LCEC_CONF_IMAGE_HEADER_T header;
+  char *tmpname;
+  FILE *file;
+
+  // never write something the loader would reject
+  if (lcecConfValidate(data, length) != 0) {
+    fprintf(stderr, "%s: ERROR: invalid config record stream\n", modname);
+    return -1;
+  }
+
+  // setup header
+  memset(&header, 0, sizeof(header));
+  header.magic = LCEC_CONF_IMAGE_MAGIC;
+  header.version = LCEC_CONF_IMAGE_VERSION;
+  header.headerSize = sizeof(header);
+  header.layout = layout;
+  header.length = length;
+  header.checksum = lcecConfCrc32(0, data, length);
+  header.masterCount = masterCount;
+  header.slaveCount = slaveCount;
+
+  // write to temp file and rename, so a running loader never sees a partial image
+  tmpname = malloc(strlen(filename) + 5);
+  if (tmpname == NULL) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for file name\n", modname);
+    return -1;
+  }
+  sprintf(tmpname, "%s.tmp", filename);
+
+  file = fopen(tmpname, "w");
+  if (file == NULL) {
+    fprintf(stderr, "%s: ERROR: unable to create image file %s\n", modname, tmpname);
+    goto fail0;
+  }
+  if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(data, length, 1, file) != 1) {
+    fprintf(stderr, "%s: ERROR: Couldn't write to file %s\n", modname, tmpname);
+    fclose(file);
+    goto fail1;
+  }
+  if (fclose(file) != 0) {
+    fprintf(stderr, "%s: ERROR: Couldn't write to file %s\n", modname, tmpname);
+    goto fail1;
+  }
+  if (rename(tmpname, filename) != 0) {
+    fprintf(stderr, "%s: ERROR: unable to rename %s to %s\n", modname, tmpname, filename);
+    goto fail1;
+  }
+
+  free(tmpname);
+  return 0;
+
+fail1:
+  unlink(tmpname);
+fail0:
+  free(tmpname);
+  return -1;
+}
+
+int lcecConfMapImage(const char *filename, uint32_t layout, LCEC_CONF_IMAGE_T *image) {
+  int fd;
+  struct stat st;
+  const LCEC_CONF_IMAGE_HEADER_T *header;
+
+  memset(image, 0, sizeof(LCEC_CONF_IMAGE_T));
+
+  // map file
+  fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "%s: ERROR: unable to open image file %s\n", modname, filename);
+    return -1;
+  }
+  if (fstat(fd, &st) != 0 || st.st_size < sizeof(LCEC_CONF_IMAGE_HEADER_T)) {
+    fprintf(stderr, "%s: ERROR: image file %s is too short\n", modname, filename);
+    close(fd);
+    return -1;
+  }
+  image->mapLength = st.st_size;
+  image->map = mmap(NULL, image->mapLength, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (image->map == MAP_FAILED) {
+    fprintf(stderr, "%s: ERROR: unable to map image file %s\n", modname, filename);
+    image->map = NULL;
+    return -1;
+  }
+
+  // check header
+  header = image->map;
+  if (header->magic != LCEC_CONF_IMAGE_MAGIC) {
+    fprintf(stderr, "%s: ERROR: %s is not a config image\n", modname, filename);
+    goto fail;
+  }
+  if (header->version != LCEC_CONF_IMAGE_VERSION || header->headerSize != sizeof(LCEC_CONF_IMAGE_HEADER_T)) {
+    fprintf(stderr, "%s: ERROR: image %s has unsupported version %u\n", modname, filename, header->version);
+    goto fail;
+  }
+  if (header->layout != layout) {
+    fprintf(stderr, "%s: ERROR: image %s was built for another lcec_conf version, please recompile it\n", modname, filename);
+    goto fail;
+  }
+  if (header->length != image->mapLength - sizeof(LCEC_CONF_IMAGE_HEADER_T)) {
+    fprintf(stderr, "%s: ERROR: image %s has invalid length\n", modname, filename);
+    goto fail;
+  }
+
+  // check data
+  image->header = header;
+  image->data = image->map + sizeof(LCEC_CONF_IMAGE_HEADER_T);
+  image->length = header->length;
+  if (lcecConfCrc32(0, image->data, image->length) != header->checksum) {
+    fprintf(stderr, "%s: ERROR: image %s checksum mismatch\n", modname, filename);
+    goto fail;
+  }
+  if (lcecConfValidate(image->data, image->length) != 0) {
+    fprintf(stderr, "%s: ERROR: image %s contains invalid records\n", modname, filename);
+    goto fail;
+  }
+
+  return 0;
+
+fail:
+  lcecConfUnmapImage(image);
+  return -1;
+}
+
+void lcecConfUnmapImage(LCEC_CONF_IMAGE_T *image) {
+  if (image->map != NULL) {
+    munmap(image->map, image->mapLength);
+  }
+  memset(image, 0, sizeof(LCEC_CONF_IMAGE_T));
+}
+
@@ -0,0 +1,65 @@
+//
+//  Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+#ifndef _LCEC_CONF_IMAGE_H_
+#define _LCEC_CONF_IMAGE_H_
+
+#include "lcec_conf.h"
+
+// Precompiled configuration image, written by "lcec_conf --compile".
+//
+// The file holds a header followed by the LCEC_CONF_* record stream
+// exactly as it is passed to the RT module (terminated by a
+// lcecConfTypeNone record). The records are raw host structs, so the
+// image is only valid for the lcec_conf binary layout it was built with:
+// the header carries a layout signature and must be rebuilt whenever the
+// signature changes. All header fields are in host byte order.
+
+#define LCEC_CONF_IMAGE_MAGIC   0x4345434c // "LCEC"
+#define LCEC_CONF_IMAGE_VERSION 1
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t layout;
+  uint64_t length;
+  uint32_t checksum;
+  uint32_t masterCount;
+  uint32_t slaveCount;
+  uint32_t reserved;
+} LCEC_CONF_IMAGE_HEADER_T;
+
+typedef struct {
+  void *map;
+  size_t mapLength;
+  const LCEC_CONF_IMAGE_HEADER_T *header;
+  const void *data;
+  size_t length;
+} LCEC_CONF_IMAGE_T;
+
+uint32_t lcecConfCrc32(uint32_t crc, const void *buf, size_t len);
+size_t lcecConfRecordSize(const void *rec, size_t avail);
+int lcecConfValidate(const void *data, size_t length);
+
+int lcecConfIsImage(const char *filename);
+int lcecConfWriteImage(const char *filename, const void *data, size_t length, uint32_t layout, uint32_t masterCount, uint32_t slaveCount);
+int lcecConfMapImage(const char *filename, uint32_t layout, LCEC_CONF_IMAGE_T *image);
+void lcecConfUnmapImage(LCEC_CONF_IMAGE_T *image);
+
+#endif
+
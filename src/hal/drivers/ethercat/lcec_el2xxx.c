@@ -70,9 +70,8 @@ int lcec_el2xxx_init(int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t *
 }
 
 void lcec_el2xxx_write(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_el2xxx_pin_t *hal_data = (lcec_el2xxx_pin_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   lcec_el2xxx_pin_t *pin;
   int i, s;
 
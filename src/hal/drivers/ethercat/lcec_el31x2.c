@@ -133,9 +133,8 @@ int lcec_el31x2_init(int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t *
 }
 
 void lcec_el31x2_read(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_el31x2_data_t *hal_data = (lcec_el31x2_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   int i;
   lcec_el31x2_chan_t *chan;
   uint8_t state;
@@ -162,9 +162,8 @@ int lcec_el41x2_init(int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t *
 }
 
 void lcec_el41x2_write(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_el41x2_data_t *hal_data = (lcec_el41x2_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   int i;
   lcec_el41x2_chan_t *chan;
   double tmpval, tmpdc, raw_val;
@@ -261,9 +261,8 @@ int lcec_el5101_init(int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t *
 }
 
 void lcec_el5101_read(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_el5101_data_t *hal_data = (lcec_el5101_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   uint8_t raw_status;
   int16_t raw_count, raw_latch, raw_delta;
   uint16_t raw_period, raw_window;
@@ -360,9 +359,8 @@ void lcec_el5101_read(struct lcec_slave *slave, long period) {
 }
 
 void lcec_el5101_write(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_el5101_data_t *hal_data = (lcec_el5101_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   uint8_t raw_ctrl;
 
   // build control byte
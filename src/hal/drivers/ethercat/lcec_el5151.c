@@ -304,9 +304,8 @@ int lcec_el5151_init(int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t *
 }
 
 void lcec_el5151_read(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_el5151_data_t *hal_data = (lcec_el5151_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   int32_t raw_count, raw_latch, raw_delta;
   uint32_t raw_period;
 
@@ -399,9 +398,8 @@ void lcec_el5151_read(struct lcec_slave *slave, long period) {
 }
 
 void lcec_el5151_write(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_el5151_data_t *hal_data = (lcec_el5151_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
 
   // set output data
   EC_WRITE_BIT(&pd[hal_data->set_count_pdo_os], hal_data->set_count_pdo_bp, *(hal_data->set_raw_count));
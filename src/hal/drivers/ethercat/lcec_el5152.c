@@ -275,9 +275,8 @@ int lcec_el5152_init(int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t *
 }
 
 void lcec_el5152_read(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_el5152_data_t *hal_data = (lcec_el5152_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   int i, idx_flag;
   lcec_el5152_chan_t *chan;
   int32_t idx_count, raw_count, raw_delta;
@@ -373,9 +372,8 @@ void lcec_el5152_read(struct lcec_slave *slave, long period) {
 }
 
 void lcec_el5152_write(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_el5152_data_t *hal_data = (lcec_el5152_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   int i;
   lcec_el5152_chan_t *chan;
 
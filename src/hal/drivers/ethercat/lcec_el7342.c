@@ -663,9 +663,8 @@ int lcec_el7342_init(int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t *
 }
 
 void lcec_el7342_read(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_el7342_data_t *hal_data = (lcec_el7342_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   int i;
   lcec_el7342_chan_t *chan;
   int16_t raw_count, raw_latch, raw_delta;
@@ -773,9 +772,8 @@ void lcec_el7342_read(struct lcec_slave *slave, long period) {
 }
 
 void lcec_el7342_write(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_el7342_data_t *hal_data = (lcec_el7342_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   int i;
   lcec_el7342_chan_t *chan;
   double tmpval, tmpdc, raw_val;
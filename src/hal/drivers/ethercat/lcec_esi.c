@@ -0,0 +1,791 @@
+//
+//  Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <expat.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lcec_esi.h"
+
+#define BUFFSIZE 65536
+
+#define ESI_MAX_DEPTH 32
+#define ESI_TAG_LEN 32
+#define ESI_TEXT_LEN 256
+
+// longest generated HAL pin name, leaves room for lcec.<master>.<slave>.
+#define ESI_PIN_LEN 20
+
+extern char *modname;
+
+typedef enum {
+  esiModeIndex,
+  esiModeDevice
+} ESI_MODE_T;
+
+typedef struct {
+  ESI_MODE_T mode;
+  XML_Parser parser;
+  int error;
+  int done;
+
+  // element path and text of the current element
+  int depth;
+  char path[ESI_MAX_DEPTH][ESI_TAG_LEN];
+  char text[ESI_TEXT_LEN];
+  size_t textLen;
+
+  // index mode
+  uint32_t vid;
+  uint32_t fileIdx;
+  char encoding[LCEC_CONF_STR_MAXLEN];
+  LCEC_ESI_INDEX_ENTRY_T *entries;
+  size_t entryCount;
+  size_t entrySize;
+  LCEC_ESI_INDEX_ENTRY_T curr;
+  int deviceDepth;
+
+  // device mode
+  LCEC_ESI_DEVICE_T *device;
+  LCEC_ESI_PDO_T *pdo;
+  LCEC_ESI_ENTRY_T *entry;
+} ESI_PARSER_T;
+
+static void esiStartHandler(void *data, const char *el, const char **attr);
+static void esiEndHandler(void *data, const char *el);
+static void esiTextHandler(void *data, const char *s, int len);
+static void esiXmlDeclHandler(void *data, const char *version, const char *encoding, int standalone);
+static int esiParentIs(ESI_PARSER_T *st, const char *name);
+static uint32_t esiParseNumber(const char *s);
+static const char *esiGetAttr(const char **attr, const char *name);
+static int esiCompareEntries(const void *a, const void *b);
+static void esiCopyStr(char *dst, size_t size, const char *src);
+static void esiPinName(char *dst, const char *src);
+static const char *esiHalType(const LCEC_ESI_ENTRY_T *entry);
+
+int lcecEsiBuildIndex(const char *indexFile, int fileCount, char **files) {
+  ESI_PARSER_T st;
+  LCEC_ESI_INDEX_HEADER_T header;
+  LCEC_ESI_INDEX_FILE_T *fileTable;
+  char *buffer;
+  char *tmpname = NULL;
+  char resolved[PATH_MAX];
+  FILE *file, *out;
+  int i, ret = -1;
+  size_t len;
+
+  memset(&st, 0, sizeof(st));
+  st.mode = esiModeIndex;
+
+  buffer = malloc(BUFFSIZE);
+  fileTable = calloc(fileCount, sizeof(LCEC_ESI_INDEX_FILE_T));
+  if (buffer == NULL || fileTable == NULL) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for index\n", modname);
+    goto fail0;
+  }
+
+  // stream through all files, only device headers are kept
+  for (i = 0; i < fileCount; i++) {
+    if (realpath(files[i], resolved) == NULL || strlen(resolved) >= LCEC_ESI_PATH_LEN) {
+      fprintf(stderr, "%s: ERROR: unable to resolve ESI file %s\n", modname, files[i]);
+      goto fail0;
+    }
+    strcpy(fileTable[i].path, resolved);
+
+    file = fopen(files[i], "r");
+    if (file == NULL) {
+      fprintf(stderr, "%s: ERROR: unable to open ESI file %s\n", modname, files[i]);
+      goto fail0;
+    }
+
+    st.parser = XML_ParserCreate(NULL);
+    if (st.parser == NULL) {
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for parser\n", modname);
+      fclose(file);
+      goto fail0;
+    }
+    XML_SetUserData(st.parser, &st);
+    XML_SetElementHandler(st.parser, esiStartHandler, esiEndHandler);
+    XML_SetCharacterDataHandler(st.parser, esiTextHandler);
+    XML_SetXmlDeclHandler(st.parser, esiXmlDeclHandler);
+    st.depth = 0;
+    st.vid = 0;
+    st.fileIdx = i;
+    st.encoding[0] = 0;
+    st.deviceDepth = -1;
+
+    do {
+      len = fread(buffer, 1, BUFFSIZE, file);
+      if (ferror(file)) {
+        fprintf(stderr, "%s: ERROR: Couldn't read from file %s\n", modname, files[i]);
+        st.error = 1;
+        break;
+      }
+      if (!XML_Parse(st.parser, buffer, len, feof(file))) {
+        if (!st.error) {
+          fprintf(stderr, "%s: ERROR: %s: Parse error at line %u: %s\n", modname, files[i],
+            (unsigned int)XML_GetCurrentLineNumber(st.parser),
+            XML_ErrorString(XML_GetErrorCode(st.parser)));
+        }
+        st.error = 1;
+        break;
+      }
+    } while (!feof(file));
+
+    strcpy(fileTable[i].encoding, st.encoding);
+    XML_ParserFree(st.parser);
+    fclose(file);
+    if (st.error) {
+      goto fail0;
+    }
+  }
+
+  // sort for binary search
+  qsort(st.entries, st.entryCount, sizeof(LCEC_ESI_INDEX_ENTRY_T), esiCompareEntries);
+
+  // write to temp file and rename
+  tmpname = malloc(strlen(indexFile) + 5);
+  if (tmpname == NULL) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for file name\n", modname);
+    goto fail0;
+  }
+  sprintf(tmpname, "%s.tmp", indexFile);
+  out = fopen(tmpname, "w");
+  if (out == NULL) {
+    fprintf(stderr, "%s: ERROR: unable to create index file %s\n", modname, tmpname);
+    goto fail0;
+  }
+  header.magic = LCEC_ESI_INDEX_MAGIC;
+  header.version = LCEC_ESI_INDEX_VERSION;
+  header.fileCount = fileCount;
+  header.entryCount = st.entryCount;
+  if (fwrite(&header, sizeof(header), 1, out) != 1 ||
+      fwrite(fileTable, sizeof(LCEC_ESI_INDEX_FILE_T), fileCount, out) != fileCount ||
+      fwrite(st.entries, sizeof(LCEC_ESI_INDEX_ENTRY_T), st.entryCount, out) != st.entryCount) {
+    fprintf(stderr, "%s: ERROR: Couldn't write to file %s\n", modname, tmpname);
+    fclose(out);
+    unlink(tmpname);
+    goto fail0;
+  }
+  if (fclose(out) != 0 || rename(tmpname, indexFile) != 0) {
+    fprintf(stderr, "%s: ERROR: Couldn't write to file %s\n", modname, indexFile);
+    unlink(tmpname);
+    goto fail0;
+  }
+
+  ret = st.entryCount;
+
+fail0:
+  free(tmpname);
+  free(st.entries);
+  free(fileTable);
+  free(buffer);
+  return ret;
+}
+
+int lcecEsiOpenIndex(const char *indexFile, LCEC_ESI_INDEX_T *index) {
+  int fd;
+  struct stat st;
+  const LCEC_ESI_INDEX_HEADER_T *header;
+
+  memset(index, 0, sizeof(LCEC_ESI_INDEX_T));
+
+  fd = open(indexFile, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "%s: ERROR: unable to open index file %s\n", modname, indexFile);
+    return -1;
+  }
+  if (fstat(fd, &st) != 0 || st.st_size < sizeof(LCEC_ESI_INDEX_HEADER_T)) {
+    fprintf(stderr, "%s: ERROR: index file %s is too short\n", modname, indexFile);
+    close(fd);
+    return -1;
+  }
+  index->mapLength = st.st_size;
+  index->map = mmap(NULL, index->mapLength, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (index->map == MAP_FAILED) {
+    fprintf(stderr, "%s: ERROR: unable to map index file %s\n", modname, indexFile);
+    index->map = NULL;
+    return -1;
+  }
+
+  header = index->map;
+  if (header->magic != LCEC_ESI_INDEX_MAGIC || header->version != LCEC_ESI_INDEX_VERSION ||
+      index->mapLength != sizeof(LCEC_ESI_INDEX_HEADER_T) + header->fileCount * sizeof(LCEC_ESI_INDEX_FILE_T) + header->entryCount * sizeof(LCEC_ESI_INDEX_ENTRY_T)) {
+    fprintf(stderr, "%s: ERROR: %s is not a valid ESI index, please rebuild it\n", modname, indexFile);
+    lcecEsiCloseIndex(index);
+    return -1;
+  }
+
+  index->header = header;
+  index->files = index->map + sizeof(LCEC_ESI_INDEX_HEADER_T);
+  index->entries = (const LCEC_ESI_INDEX_ENTRY_T *) (index->files + header->fileCount);
+  return 0;
+}
+
+void lcecEsiCloseIndex(LCEC_ESI_INDEX_T *index) {
+  if (index->map != NULL) {
+    munmap(index->map, index->mapLength);
+  }
+  memset(index, 0, sizeof(LCEC_ESI_INDEX_T));
+}
+
+const LCEC_ESI_INDEX_ENTRY_T *lcecEsiLookup(const LCEC_ESI_INDEX_T *index, uint32_t vid, uint32_t pid, uint32_t revision) {
+  const LCEC_ESI_INDEX_ENTRY_T *e = index->entries;
+  const LCEC_ESI_INDEX_ENTRY_T *end = e + index->header->entryCount;
+  LCEC_ESI_INDEX_ENTRY_T key;
+  size_t lo, hi, mid;
+
+  // find first entry >= vid/pid/revision (any revision starts at 0)
+  key.vid = vid;
+  key.pid = pid;
+  key.revision = (revision == LCEC_ESI_ANY_REVISION) ? 0 : revision;
+  lo = 0;
+  hi = index->header->entryCount;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (esiCompareEntries(&e[mid], &key) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  e += lo;
+
+  if (e == end || e->vid != vid || e->pid != pid) {
+    return NULL;
+  }
+  if (revision != LCEC_ESI_ANY_REVISION) {
+    return (e->revision == revision) ? e : NULL;
+  }
+
+  // highest revision
+  while ((e + 1) < end && e[1].vid == vid && e[1].pid == pid) {
+    e++;
+  }
+  return e;
+}
+
+int lcecEsiReadDevice(const LCEC_ESI_INDEX_T *index, const LCEC_ESI_INDEX_ENTRY_T *entry, LCEC_ESI_DEVICE_T *device) {
+  ESI_PARSER_T st;
+  const LCEC_ESI_INDEX_FILE_T *esiFile = &index->files[entry->fileIdx];
+  char *buffer;
+  FILE *file;
+  size_t len;
+  int ret = -1;
+
+  memset(&st, 0, sizeof(st));
+  memset(device, 0, sizeof(LCEC_ESI_DEVICE_T));
+  st.mode = esiModeDevice;
+  st.device = device;
+  device->vid = entry->vid;
+
+  buffer = malloc(BUFFSIZE);
+  if (buffer == NULL) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for parser\n", modname);
+    return -1;
+  }
+
+  // parse the device element only, using the document's encoding
+  file = fopen(esiFile->path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "%s: ERROR: unable to open ESI file %s\n", modname, esiFile->path);
+    goto fail0;
+  }
+  if (fseek(file, entry->offset, SEEK_SET) != 0) {
+    fprintf(stderr, "%s: ERROR: unable to seek in ESI file %s\n", modname, esiFile->path);
+    goto fail1;
+  }
+  st.parser = XML_ParserCreate(esiFile->encoding[0] != 0 ? esiFile->encoding : NULL);
+  if (st.parser == NULL) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for parser\n", modname);
+    goto fail1;
+  }
+  XML_SetUserData(st.parser, &st);
+  XML_SetElementHandler(st.parser, esiStartHandler, esiEndHandler);
+  XML_SetCharacterDataHandler(st.parser, esiTextHandler);
+
+  while (!st.done && !st.error) {
+    len = fread(buffer, 1, BUFFSIZE, file);
+    if (ferror(file)) {
+      fprintf(stderr, "%s: ERROR: Couldn't read from file %s\n", modname, esiFile->path);
+      goto fail2;
+    }
+    if (!XML_Parse(st.parser, buffer, len, feof(file)) && !st.done) {
+      if (!st.error) {
+        fprintf(stderr, "%s: ERROR: %s: Parse error in device at offset %llu: %s\n", modname, esiFile->path,
+          (unsigned long long) entry->offset, XML_ErrorString(XML_GetErrorCode(st.parser)));
+      }
+      goto fail2;
+    }
+    if (feof(file) && !st.done) {
+      fprintf(stderr, "%s: ERROR: %s: unexpected end of device at offset %llu\n", modname, esiFile->path, (unsigned long long) entry->offset);
+      goto fail2;
+    }
+  }
+
+  // index is stale if the device does not match anymore
+  if (st.error || device->pid != entry->pid || device->revision != entry->revision) {
+    if (!st.error) {
+      fprintf(stderr, "%s: ERROR: %s has changed, please rebuild the ESI index\n", modname, esiFile->path);
+    }
+    goto fail2;
+  }
+
+  ret = 0;
+
+fail2:
+  XML_ParserFree(st.parser);
+fail1:
+  fclose(file);
+fail0:
+  free(buffer);
+  return ret;
+}
+
+void lcecEsiWriteSlave(FILE *out, const LCEC_ESI_DEVICE_T *device, int slaveIdx, const char *name) {
+  char pins[LCEC_ESI_MAX_ENTRIES][LCEC_CONF_STR_MAXLEN];
+  char pin[LCEC_CONF_STR_MAXLEN];
+  const LCEC_ESI_PDO_T *pdo;
+  const LCEC_ESI_ENTRY_T *entry;
+  const char *halType;
+  char suffix[16];
+  int sm, i, j, k, m, n, len, pinCount, dup, used;
+
+  fprintf(out, "  <!-- %s revision %08x, generated from ESI -->\n", device->type, device->revision);
+  fprintf(out, "  <slave idx=\"%d\" type=\"generic\" vid=\"%08x\" pid=\"%08x\" configPdos=\"true\"", slaveIdx, device->vid, device->pid);
+  if (name != NULL) {
+    fprintf(out, " name=\"%s\"", name);
+  }
+  fprintf(out, ">\n");
+
+  pinCount = 0;
+  for (sm = 0; sm < device->smCount; sm++) {
+    if (device->smDir[sm] == EC_DIR_INVALID) {
+      continue;
+    }
+
+    // mailbox sync managers carry no pdos
+    for (i = 0, used = 0; i < device->pdoCount && !used; i++) {
+      used = (device->pdos[i].sm == sm);
+    }
+    if (!used) {
+      continue;
+    }
+    fprintf(out, "    <syncManager idx=\"%d\" dir=\"%s\">\n", sm, device->smDir[sm] == EC_DIR_INPUT ? "in" : "out");
+
+    for (i = 0, pdo = device->pdos; i < device->pdoCount; i++, pdo++) {
+      if (pdo->sm != sm) {
+        continue;
+      }
+      fprintf(out, "      <pdo idx=\"%04x\">\n", pdo->index);
+
+      for (j = 0, entry = &device->entries[pdo->firstEntry]; j < pdo->entryCount; j++, entry++) {
+        fprintf(out, "        <pdoEntry idx=\"%04x\" subIdx=\"%02x\" bitLen=\"%d\"", entry->index, entry->subindex, entry->bitLength);
+
+        // gaps and unsupported types are mapped without pin
+        halType = esiHalType(entry);
+        if (halType == NULL && entry->index != 0) {
+          fprintf(stderr, "%s: WARNING: no HAL pin for %04x:%02x (%s, %d bits)\n",
+            modname, entry->index, entry->subindex, entry->dataType, entry->bitLength);
+        }
+        if (halType != NULL && pinCount < LCEC_ESI_MAX_ENTRIES) {
+          esiPinName(pin, entry->name);
+          if (pin[0] == 0) {
+            snprintf(pin, ESI_PIN_LEN + 1, "%04x-%02x", entry->index, entry->subindex);
+          }
+
+          // make pin names unique (channels share entry names)
+          n = strlen(pin);
+          for (k = 1, dup = 1; dup; k++) {
+            dup = 0;
+            for (m = 0; m < pinCount && !dup; m++) {
+              dup = (strcmp(pins[m], pin) == 0);
+            }
+            if (dup) {
+              len = snprintf(suffix, sizeof(suffix), "-%d", k);
+              strcpy(pin + (n > ESI_PIN_LEN - len ? ESI_PIN_LEN - len : n), suffix);
+            }
+          }
+          strcpy(pins[pinCount++], pin);
+          fprintf(out, " halPin=\"%s\" halType=\"%s\"", pin, halType);
+        }
+        fprintf(out, "/>\n");
+      }
+
+      fprintf(out, "      </pdo>\n");
+    }
+
+    fprintf(out, "    </syncManager>\n");
+  }
+
+  fprintf(out, "  </slave>\n");
+}
+
+static void esiStartHandler(void *data, const char *el, const char **attr) {
+  ESI_PARSER_T *st = data;
+  LCEC_ESI_DEVICE_T *device = st->device;
+  const char *val;
+  int sm;
+
+  if (st->depth >= ESI_MAX_DEPTH) {
+    fprintf(stderr, "%s: ERROR: ESI nesting too deep\n", modname);
+    st->error = 1;
+    XML_StopParser(st->parser, 0);
+    return;
+  }
+  esiCopyStr(st->path[st->depth], sizeof(st->path[st->depth]), el);
+  st->depth++;
+  st->textLen = 0;
+  st->text[0] = 0;
+
+  if (st->mode == esiModeIndex) {
+    // device header, pid and revision follow in <Type>
+    if (strcmp(el, "Device") == 0 && esiParentIs(st, "Devices")) {
+      memset(&st->curr, 0, sizeof(st->curr));
+      st->curr.vid = st->vid;
+      st->curr.fileIdx = st->fileIdx;
+      st->curr.offset = XML_GetCurrentByteIndex(st->parser);
+      st->deviceDepth = st->depth;
+      return;
+    }
+    if (strcmp(el, "Type") == 0 && st->depth == st->deviceDepth + 1) {
+      if ((val = esiGetAttr(attr, "ProductCode")) != NULL) {
+        st->curr.pid = esiParseNumber(val);
+      }
+      if ((val = esiGetAttr(attr, "RevisionNo")) != NULL) {
+        st->curr.revision = esiParseNumber(val);
+      }
+    }
+    return;
+  }
+
+  // device mode, the device element is the root
+  if (st->depth == 2 && strcmp(el, "Type") == 0) {
+    if ((val = esiGetAttr(attr, "ProductCode")) != NULL) {
+      device->pid = esiParseNumber(val);
+    }
+    if ((val = esiGetAttr(attr, "RevisionNo")) != NULL) {
+      device->revision = esiParseNumber(val);
+    }
+    return;
+  }
+
+  if (st->depth == 2 && (strcmp(el, "RxPdo") == 0 || strcmp(el, "TxPdo") == 0)) {
+    // only pdos assigned by default are mapped
+    st->pdo = NULL;
+    if ((val = esiGetAttr(attr, "Sm")) == NULL) {
+      return;
+    }
+    sm = atoi(val);
+    if (sm < 0 || sm >= EC_MAX_SYNC_MANAGERS) {
+      fprintf(stderr, "%s: ERROR: Invalid Sm %d for pdo\n", modname, sm);
+      st->error = 1;
+      XML_StopParser(st->parser, 0);
+      return;
+    }
+    if (device->pdoCount >= LCEC_ESI_MAX_PDOS) {
+      fprintf(stderr, "%s: ERROR: too many pdos (max %d)\n", modname, LCEC_ESI_MAX_PDOS);
+      st->error = 1;
+      XML_StopParser(st->parser, 0);
+      return;
+    }
+    st->pdo = &device->pdos[device->pdoCount++];
+    st->pdo->sm = sm;
+    st->pdo->dir = (el[0] == 'R') ? EC_DIR_OUTPUT : EC_DIR_INPUT;
+    st->pdo->firstEntry = device->entryCount;
+    return;
+  }
+
+  if (st->depth == 3 && st->pdo != NULL && strcmp(el, "Entry") == 0) {
+    if (device->entryCount >= LCEC_ESI_MAX_ENTRIES) {
+      fprintf(stderr, "%s: ERROR: too many pdo entries (max %d)\n", modname, LCEC_ESI_MAX_ENTRIES);
+      st->error = 1;
+      XML_StopParser(st->parser, 0);
+      return;
+    }
+    st->entry = &device->entries[device->entryCount++];
+    st->pdo->entryCount++;
+    return;
+  }
+}
+
+static void esiEndHandler(void *data, const char *el) {
+  ESI_PARSER_T *st = data;
+  LCEC_ESI_DEVICE_T *device = st->device;
+  const char *text = st->text;
+  size_t size;
+  int i;
+
+  // trim text
+  while (st->textLen > 0 && isspace((unsigned char) st->text[st->textLen - 1])) {
+    st->text[--st->textLen] = 0;
+  }
+  while (isspace((unsigned char) *text)) {
+    text++;
+  }
+
+  st->depth--;
+
+  if (st->mode == esiModeIndex) {
+    if (strcmp(el, "Id") == 0 && st->depth > 0 && strcmp(st->path[st->depth - 1], "Vendor") == 0) {
+      st->vid = esiParseNumber(text);
+      return;
+    }
+    if (strcmp(el, "Type") == 0 && st->depth == st->deviceDepth) {
+      esiCopyStr(st->curr.type, sizeof(st->curr.type), text);
+      return;
+    }
+    if (st->depth == st->deviceDepth - 1 && strcmp(el, "Device") == 0) {
+      st->deviceDepth = -1;
+
+      // grow entry table
+      if (st->entryCount >= st->entrySize) {
+        size = st->entrySize ? st->entrySize * 2 : 256;
+        st->entries = realloc(st->entries, size * sizeof(LCEC_ESI_INDEX_ENTRY_T));
+        if (st->entries == NULL) {
+          fprintf(stderr, "%s: ERROR: Couldn't allocate memory for index\n", modname);
+          st->error = 1;
+          XML_StopParser(st->parser, 0);
+          return;
+        }
+        st->entrySize = size;
+      }
+      st->entries[st->entryCount++] = st->curr;
+    }
+    return;
+  }
+
+  // device mode
+  switch (st->depth) {
+    case 0:
+      // end of device
+      st->done = 1;
+      XML_StopParser(st->parser, 0);
+      return;
+
+    case 1:
+      if (strcmp(el, "Type") == 0) {
+        esiCopyStr(device->type, sizeof(device->type), text);
+        return;
+      }
+      if (strcmp(el, "Sm") == 0 && device->smCount < EC_MAX_SYNC_MANAGERS) {
+        if (strcmp(text, "MBoxOut") == 0 || strcmp(text, "Outputs") == 0) {
+          device->smDir[device->smCount++] = EC_DIR_OUTPUT;
+        } else if (strcmp(text, "MBoxIn") == 0 || strcmp(text, "Inputs") == 0) {
+          device->smDir[device->smCount++] = EC_DIR_INPUT;
+        } else {
+          device->smDir[device->smCount++] = EC_DIR_INVALID;
+        }
+        return;
+      }
+      if (strcmp(el, "RxPdo") == 0 || strcmp(el, "TxPdo") == 0) {
+        // sync managers without type take the pdo's direction
+        if (st->pdo != NULL) {
+          while (device->smCount <= st->pdo->sm) {
+            device->smDir[device->smCount++] = EC_DIR_INVALID;
+          }
+          if (device->smDir[st->pdo->sm] == EC_DIR_INVALID) {
+            device->smDir[st->pdo->sm] = st->pdo->dir;
+          }
+        }
+        st->pdo = NULL;
+        return;
+      }
+      return;
+
+    case 2:
+      if (st->pdo == NULL) {
+        return;
+      }
+      if (strcmp(el, "Index") == 0) {
+        st->pdo->index = esiParseNumber(text);
+        return;
+      }
+      if (strcmp(el, "Name") == 0 && st->pdo->name[0] == 0) {
+        esiCopyStr(st->pdo->name, sizeof(st->pdo->name), text);
+        return;
+      }
+      if (strcmp(el, "Entry") == 0) {
+        // bit length is required
+        if (st->entry->bitLength == 0) {
+          fprintf(stderr, "%s: ERROR: pdo %04x entry has no BitLen\n", modname, st->pdo->index);
+          st->error = 1;
+          XML_StopParser(st->parser, 0);
+        }
+        st->entry = NULL;
+      }
+      return;
+
+    case 3:
+      if (st->pdo == NULL || st->entry == NULL) {
+        return;
+      }
+      if (strcmp(el, "Index") == 0) {
+        st->entry->index = esiParseNumber(text);
+        return;
+      }
+      if (strcmp(el, "SubIndex") == 0) {
+        st->entry->subindex = esiParseNumber(text);
+        return;
+      }
+      if (strcmp(el, "BitLen") == 0) {
+        i = esiParseNumber(text);
+        if (i <= 0 || i > 64) {
+          fprintf(stderr, "%s: ERROR: Invalid BitLen %d in pdo %04x\n", modname, i, st->pdo->index);
+          st->error = 1;
+          XML_StopParser(st->parser, 0);
+          return;
+        }
+        st->entry->bitLength = i;
+        return;
+      }
+      if (strcmp(el, "Name") == 0 && st->entry->name[0] == 0) {
+        esiCopyStr(st->entry->name, sizeof(st->entry->name), text);
+        return;
+      }
+      if (strcmp(el, "DataType") == 0) {
+        esiCopyStr(st->entry->dataType, sizeof(st->entry->dataType), text);
+        return;
+      }
+      return;
+  }
+}
+
+static void esiTextHandler(void *data, const char *s, int len) {
+  ESI_PARSER_T *st = data;
+
+  // texts of interest are short, cut anything else
+  if (len > ESI_TEXT_LEN - 1 - st->textLen) {
+    len = ESI_TEXT_LEN - 1 - st->textLen;
+  }
+  memcpy(st->text + st->textLen, s, len);
+  st->textLen += len;
+  st->text[st->textLen] = 0;
+}
+
+static void esiXmlDeclHandler(void *data, const char *version, const char *encoding, int standalone) {
+  ESI_PARSER_T *st = data;
+
+  if (encoding != NULL) {
+    esiCopyStr(st->encoding, sizeof(st->encoding), encoding);
+  }
+}
+
+static int esiParentIs(ESI_PARSER_T *st, const char *name) {
+  return st->depth >= 2 && strcmp(st->path[st->depth - 2], name) == 0;
+}
+
+static uint32_t esiParseNumber(const char *s) {
+  while (isspace((unsigned char) *s)) {
+    s++;
+  }
+
+  // ESI hex values are written as #x...
+  if (s[0] == '#' && (s[1] == 'x' || s[1] == 'X')) {
+    return strtoul(s + 2, NULL, 16);
+  }
+  return strtoul(s, NULL, 0);
+}
+
+static const char *esiGetAttr(const char **attr, const char *name) {
+  for (; *attr; attr += 2) {
+    if (strcmp(attr[0], name) == 0) {
+      return attr[1];
+    }
+  }
+  return NULL;
+}
+
+static int esiCompareEntries(const void *a, const void *b) {
+  const LCEC_ESI_INDEX_ENTRY_T *ea = a;
+  const LCEC_ESI_INDEX_ENTRY_T *eb = b;
+
+  if (ea->vid != eb->vid) {
+    return ea->vid < eb->vid ? -1 : 1;
+  }
+  if (ea->pid != eb->pid) {
+    return ea->pid < eb->pid ? -1 : 1;
+  }
+  if (ea->revision != eb->revision) {
+    return ea->revision < eb->revision ? -1 : 1;
+  }
+  return 0;
+}
+
+static void esiCopyStr(char *dst, size_t size, const char *src) {
+  size_t len = strlen(src);
+
+  // cut to fit, always terminated
+  if (len > size - 1) {
+    len = size - 1;
+  }
+  memcpy(dst, src, len);
+  dst[len] = 0;
+}
+
+static void esiPinName(char *dst, const char *src) {
+  int len = 0;
+  int sep = 0;
+
+  // lower case alnum words, joined by '-'
+  for (; *src && len < ESI_PIN_LEN; src++) {
+    if (isalnum((unsigned char) *src)) {
+      if (sep && len > 0 && len < ESI_PIN_LEN - 1) {
+        dst[len++] = '-';
+      }
+      dst[len++] = tolower((unsigned char) *src);
+      sep = 0;
+    } else {
+      sep = 1;
+    }
+  }
+  dst[len] = 0;
+}
+
+static const char *esiHalType(const LCEC_ESI_ENTRY_T *entry) {
+  const char *t = entry->dataType;
+
+  // gaps and widths the generic slave can't copy get no pin
+  switch (entry->index == 0 ? 0 : entry->bitLength) {
+    case 1:
+      return "bit";
+    case 8:
+    case 16:
+    case 32:
+      break;
+    default:
+      return NULL;
+  }
+
+  if (strcmp(t, "SINT") == 0 || strcmp(t, "INT") == 0 || strcmp(t, "DINT") == 0) {
+    return "s32";
+  }
+  if (strcmp(t, "REAL") == 0) {
+    return NULL;
+  }
+  return "u32";
+}
+
@@ -0,0 +1,111 @@
+//
+//  Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+#ifndef _LCEC_ESI_H_
+#define _LCEC_ESI_H_
+
+#include <stdio.h>
+
+#include "lcec_conf.h"
+
+// EtherCAT Slave Information (ESI) import for generic slaves.
+//
+// lcecEsiBuildIndex() streams through any number of vendor ESI files and
+// writes an index of all devices, sorted by vid/pid/revision. Each entry
+// keeps the file and the byte offset of the <Device> element, so
+// lcecEsiReadDevice() parses nothing but that device.
+
+#define LCEC_ESI_INDEX_MAGIC   0x45534949 // "IISE"
+#define LCEC_ESI_INDEX_VERSION 1
+
+#define LCEC_ESI_PATH_LEN  256
+#define LCEC_ESI_NAME_LEN  64
+
+#define LCEC_ESI_MAX_PDOS    64
+#define LCEC_ESI_MAX_ENTRIES 512
+
+// match any revision in lookups (the highest one is used)
+#define LCEC_ESI_ANY_REVISION 0xffffffff
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t fileCount;
+  uint32_t entryCount;
+} LCEC_ESI_INDEX_HEADER_T;
+
+typedef struct {
+  char path[LCEC_ESI_PATH_LEN];
+  char encoding[LCEC_CONF_STR_MAXLEN];
+} LCEC_ESI_INDEX_FILE_T;
+
+typedef struct {
+  uint32_t vid;
+  uint32_t pid;
+  uint32_t revision;
+  uint32_t fileIdx;
+  uint64_t offset;
+  char type[LCEC_CONF_STR_MAXLEN];
+} LCEC_ESI_INDEX_ENTRY_T;
+
+typedef struct {
+  uint16_t index;
+  uint8_t subindex;
+  uint8_t bitLength;
+  char name[LCEC_ESI_NAME_LEN];
+  char dataType[LCEC_CONF_STR_MAXLEN];
+} LCEC_ESI_ENTRY_T;
+
+typedef struct {
+  uint16_t index;
+  int sm;
+  ec_direction_t dir;
+  int firstEntry;
+  int entryCount;
+  char name[LCEC_ESI_NAME_LEN];
+} LCEC_ESI_PDO_T;
+
+typedef struct {
+  uint32_t vid;
+  uint32_t pid;
+  uint32_t revision;
+  char type[LCEC_CONF_STR_MAXLEN];
+  int smCount;
+  ec_direction_t smDir[EC_MAX_SYNC_MANAGERS];
+  int pdoCount;
+  LCEC_ESI_PDO_T pdos[LCEC_ESI_MAX_PDOS];
+  int entryCount;
+  LCEC_ESI_ENTRY_T entries[LCEC_ESI_MAX_ENTRIES];
+} LCEC_ESI_DEVICE_T;
+
+typedef struct {
+  void *map;
+  size_t mapLength;
+  const LCEC_ESI_INDEX_HEADER_T *header;
+  const LCEC_ESI_INDEX_FILE_T *files;
+  const LCEC_ESI_INDEX_ENTRY_T *entries;
+} LCEC_ESI_INDEX_T;
+
+int lcecEsiBuildIndex(const char *indexFile, int fileCount, char **files);
+int lcecEsiOpenIndex(const char *indexFile, LCEC_ESI_INDEX_T *index);
+void lcecEsiCloseIndex(LCEC_ESI_INDEX_T *index);
+const LCEC_ESI_INDEX_ENTRY_T *lcecEsiLookup(const LCEC_ESI_INDEX_T *index, uint32_t vid, uint32_t pid, uint32_t revision);
+int lcecEsiReadDevice(const LCEC_ESI_INDEX_T *index, const LCEC_ESI_INDEX_ENTRY_T *entry, LCEC_ESI_DEVICE_T *device);
+void lcecEsiWriteSlave(FILE *out, const LCEC_ESI_DEVICE_T *device, int slaveIdx, const char *name);
+
+#endif
+
@@ -0,0 +1,98 @@
+//
+//  Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lcec_esi.h"
+
+char *modname = "lcec_esi";
+
+static void usage(void) {
+  fprintf(stderr, "usage: %s index <index-file> <esi-file>...\n", modname);
+  fprintf(stderr, "       %s list <index-file>\n", modname);
+  fprintf(stderr, "       %s slave <index-file> <slave-idx> <vid> <pid> [<revision>]\n", modname);
+  fprintf(stderr, "  vid, pid and revision are hex values like in the lcec_conf XML\n");
+}
+
+int main(int argc, char **argv) {
+  LCEC_ESI_INDEX_T index;
+  const LCEC_ESI_INDEX_ENTRY_T *entry;
+  LCEC_ESI_DEVICE_T *device;
+  uint32_t revision;
+  int i, ret;
+
+  if (argc < 3) {
+    usage();
+    return 1;
+  }
+
+  // build index from ESI files
+  if (strcmp(argv[1], "index") == 0 && argc >= 4) {
+    ret = lcecEsiBuildIndex(argv[2], argc - 3, &argv[3]);
+    if (ret < 0) {
+      return 1;
+    }
+    fprintf(stderr, "%s: indexed %d devices\n", modname, ret);
+    return 0;
+  }
+
+  // list indexed devices
+  if (strcmp(argv[1], "list") == 0 && argc == 3) {
+    if (lcecEsiOpenIndex(argv[2], &index) != 0) {
+      return 1;
+    }
+    for (i = 0, entry = index.entries; i < index.header->entryCount; i++, entry++) {
+      printf("%08x %08x %08x %-20s %s\n", entry->vid, entry->pid, entry->revision, entry->type, index.files[entry->fileIdx].path);
+    }
+    lcecEsiCloseIndex(&index);
+    return 0;
+  }
+
+  // generate generic slave config
+  if (strcmp(argv[1], "slave") == 0 && (argc == 6 || argc == 7)) {
+    revision = (argc == 7) ? strtoul(argv[6], NULL, 16) : LCEC_ESI_ANY_REVISION;
+    if (lcecEsiOpenIndex(argv[2], &index) != 0) {
+      return 1;
+    }
+    entry = lcecEsiLookup(&index, strtoul(argv[4], NULL, 16), strtoul(argv[5], NULL, 16), revision);
+    if (entry == NULL) {
+      fprintf(stderr, "%s: ERROR: device vid=%s pid=%s not found in index\n", modname, argv[4], argv[5]);
+      lcecEsiCloseIndex(&index);
+      return 1;
+    }
+    device = malloc(sizeof(LCEC_ESI_DEVICE_T));
+    if (device == NULL) {
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for device\n", modname);
+      lcecEsiCloseIndex(&index);
+      return 1;
+    }
+    ret = lcecEsiReadDevice(&index, entry, device);
+    if (ret == 0) {
+      lcecEsiWriteSlave(stdout, device, atoi(argv[3]), NULL);
+    }
+    free(device);
+    lcecEsiCloseIndex(&index);
+    return ret ? 1 : 0;
+  }
+
+  usage();
+  return 1;
+}
+
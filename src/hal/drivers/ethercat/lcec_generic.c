@@ -19,6 +19,7 @@
 #include "lcec.h"
 #include "lcec_generic.h"
 
+int lcec_generic_postinit(struct lcec_slave *slave);
 void lcec_generic_read(struct lcec_slave *slave, long period);
 void lcec_generic_write(struct lcec_slave *slave, long period);
 
@@ -27,8 +28,10 @@ int lcec_generic_init(int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t
   lcec_generic_pin_t *hal_data = (lcec_generic_pin_t *) slave->hal_data;
   int i, j;
   int err;
+  int plan_vals;
 
   // initialize callbacks
+  slave->proc_postinit = lcec_generic_postinit;
   slave->proc_read = lcec_generic_read;
   slave->proc_write = lcec_generic_write;
 
@@ -139,165 +142,29 @@ int lcec_generic_init(int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t
     }
   }
 
+  // alloc copy plan memory, the plan itself is built after PDO registration
+  plan_vals = lcec_generic_plan_count((lcec_generic_pin_t *) slave->hal_data, slave->pdo_entry_count);
+  if ((slave->generic_plan = hal_malloc(lcec_generic_plan_size(plan_vals))) == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "hal_malloc() for slave %s.%s copy plan failed\n", master->name, slave->name);
+    return -EIO;
+  }
+  slave->generic_plan->val_count = plan_vals;
+
   return 0;
 }
 
-void lcec_generic_read(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
-  lcec_generic_pin_t *hal_data = (lcec_generic_pin_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
-  int i, j, offset;
-  hal_float_t *fval;
-  hal_u32_t *uval;
-  hal_s32_t *sval;
-  hal_u32_t temp;
-
-
-
-  // read data
-  for (i=0; i < slave->pdo_entry_count; i++, hal_data++) {
-    // skip wrong direction and uninitialized pins
-    if (hal_data->dir != HAL_OUT || hal_data->pin[0] == NULL) {
-      continue;
-    }
-
-    switch (hal_data->type) {
-      case HAL_BIT:
-        offset = hal_data->pdo_os << 3 | (hal_data->pdo_bp & 0x07);
-        for (j=0; j < LCEC_GENERIC_MAX_SUBPINS && hal_data->pin[j] != NULL; j++, offset++) {
-          *((hal_bit_t *) hal_data->pin[j]) = EC_READ_BIT(&pd[offset >> 3], offset & 0x07);
-        }
-        break;
-
-      case HAL_S32:
-        sval = (hal_s32_t *) hal_data->pin[0];
-        switch (hal_data->pdo_len) {
-          case 8:
-            *sval = EC_READ_S8(&pd[hal_data->pdo_os]);
-            break;
-          case 16:
-            *sval = EC_READ_S16(&pd[hal_data->pdo_os]);
-            break;
-          case 32:
-            *sval = EC_READ_S32(&pd[hal_data->pdo_os]);
-            break;
-          default:
-            *sval = 0;
-        }
-        break;
-
-      case HAL_U32:
-        uval = (hal_u32_t *) hal_data->pin[0];
-        switch (hal_data->pdo_len) {
-          case 8:
-            *uval = EC_READ_U8(&pd[hal_data->pdo_os]);
-            break;
-          case 16:
-            *uval = EC_READ_U16(&pd[hal_data->pdo_os]);
-            break;
-          case 32:
-            *uval = EC_READ_U32(&pd[hal_data->pdo_os]);
-            break;
-          default:
-            *uval = 0;
-        }
-        break;
+int lcec_generic_postinit(struct lcec_slave *slave) {
+  lcec_generic_plan_t *plan = slave->generic_plan;
 
-      case HAL_SPECIAL_U32:
-        fval = (hal_float_t *) hal_data->pin[0];
-        switch (hal_data->pdo_len) {
-          case 8:
-            temp = EC_READ_U8(&pd[hal_data->pdo_os]);
-            break;
-          case 16:
-            temp = EC_READ_S16(&pd[hal_data->pdo_os]);
-            *fval = ((hal_s32_t)temp) / hal_data->scale;
-            break;
-          case 32:
-            temp = EC_READ_S32(&pd[hal_data->pdo_os]);
-            *fval = ((hal_s32_t)temp) / hal_data->scale;
-            break;
-          default:
-            *fval = 0.0;
-        }
-        //*fval = temp;
-        //*fval = *uval;
-        break;
+  lcec_generic_plan_build(plan, plan->val_count, (lcec_generic_pin_t *) slave->hal_data, slave->pdo_entry_count);
+  return 0;
+}
 
-      default:
-        continue;
-    }
-  }
+void lcec_generic_read(struct lcec_slave *slave, long period) {
+  lcec_generic_plan_read(slave->generic_plan, slave->domain->process_data);
 }
 
 void lcec_generic_write(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
-  lcec_generic_pin_t *hal_data = (lcec_generic_pin_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
-  int i, j, offset;
-  hal_u32_t uval;
-  hal_s32_t sval;
-  hal_float_t fval;
-
-  // write data
-  for (i=0; i<slave->pdo_entry_count; i++, hal_data++) {
-    // skip wrong direction and uninitialized pins
-    if (hal_data->dir != HAL_IN || hal_data->pin[0] == NULL) {
-      continue;
-    }
-
-    switch (hal_data->type) {
-      case HAL_BIT:
-        offset = hal_data->pdo_os << 3 | (hal_data->pdo_bp & 0x07);
-        for (j=0; j < LCEC_GENERIC_MAX_SUBPINS && hal_data->pin[j] != NULL; j++, offset++) {
-          EC_WRITE_BIT(&pd[offset >> 3], offset & 0x07, *((hal_bit_t *) hal_data->pin[j]));
-        }
-        break;
-
-      case HAL_S32:
-        sval = *((hal_s32_t *) hal_data->pin[0]);
-        switch (hal_data->pdo_len) {
-          case 8:
-            if (sval > 0x7f) sval = 0x7f;
-            if (sval < -0x80) sval = -0x80;
-            EC_WRITE_S8(&pd[hal_data->pdo_os], sval);
-            break;
-          case 16:
-            if (sval > 0x7fff) sval = 0x7fff;
-            if (sval < -0x8000) sval = -0x8000;
-            EC_WRITE_S16(&pd[hal_data->pdo_os], sval);
-            break;
-          case 32:
-            EC_WRITE_S32(&pd[hal_data->pdo_os], sval);
-            break;
-        }
-        break;
-
-      case HAL_U32:
-        uval = *((hal_u32_t *) hal_data->pin[0]);
-        switch (hal_data->pdo_len) {
-          case 8:
-            if (uval > 0xff) uval = 0xff;
-            EC_WRITE_U8(&pd[hal_data->pdo_os], uval);
-            break;
-          case 16:
-            if (uval > 0xffff) uval = 0xffff;
-            EC_WRITE_U16(&pd[hal_data->pdo_os], uval);
-            break;
-          case 32:
-            EC_WRITE_U32(&pd[hal_data->pdo_os], uval);
-            break;
-        }
-        break;
-
-        case HAL_SPECIAL_U32:
-        fval = *((hal_float_t *) hal_data->pin[0]);
-        EC_WRITE_U32(&pd[hal_data->pdo_os], (hal_u32_t) (fval*hal_data->scale));
-        break;
-
-      default:
-        continue;
-    }
-  }
+  lcec_generic_plan_write(slave->generic_plan, slave->domain->process_data);
 }
 
@@ -18,11 +18,12 @@
 #ifndef _LCEC_GENERIC_H_
 #define _LCEC_GENERIC_H_
 
-#include "lcec.h"
 #include "lcec_conf.h"
 
 #define LCEC_GENERIC_MAX_SUBPINS 32
 
+struct lcec_slave;
+
 typedef struct {
   char name[LCEC_CONF_STR_MAXLEN];
   hal_type_t type;
@@ -36,7 +37,58 @@ typedef struct {
   float scale;
 } lcec_generic_pin_t;
 
+// copy plan operations, one per conversion kind
+typedef enum {
+  lcecGenericOpBit8,
+  lcecGenericOpBit16,
+  lcecGenericOpBit32,
+  lcecGenericOpS8,
+  lcecGenericOpS16,
+  lcecGenericOpS32,
+  lcecGenericOpU8,
+  lcecGenericOpU16,
+  lcecGenericOpU32,
+  lcecGenericOpFloat8,
+  lcecGenericOpFloat16,
+  lcecGenericOpFloat32,
+  lcecGenericOpCount
+} LCEC_GENERIC_OP_T;
+
+typedef struct {
+  void *pin;
+  double scale;
+  unsigned int bitpos;
+  uint8_t shift;
+  uint8_t op;
+} lcec_generic_plan_val_t;
+
+typedef struct {
+  unsigned int pdo_os;
+  uint32_t mask;
+  int count;
+  lcec_generic_plan_val_t *vals;
+} lcec_generic_plan_run_t;
+
+typedef struct {
+  lcec_generic_plan_run_t *runs[lcecGenericOpCount];
+  int run_count[lcecGenericOpCount];
+} lcec_generic_plan_dir_t;
+
+typedef struct lcec_generic_plan {
+  lcec_generic_plan_dir_t read;
+  lcec_generic_plan_dir_t write;
+  int val_count;
+  lcec_generic_plan_val_t *vals;
+  lcec_generic_plan_run_t *runs;
+} lcec_generic_plan_t;
+
 int lcec_generic_init(int comp_id, struct lcec_slave *slave, ec_pdo_entry_reg_t *pdo_entry_regs);
 
+int lcec_generic_plan_count(const lcec_generic_pin_t *pins, int count);
+size_t lcec_generic_plan_size(int val_count);
+lcec_generic_plan_t *lcec_generic_plan_build(void *mem, int val_count, const lcec_generic_pin_t *pins, int count);
+void lcec_generic_plan_read(const lcec_generic_plan_t *plan, uint8_t *pd);
+void lcec_generic_plan_write(const lcec_generic_plan_t *plan, uint8_t *pd);
+
 #endif
 
@@ -0,0 +1,390 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// The copy plan is compiled once after PDO registration (offsets are
+// known then) and turns the generic pin list into runs of identical
+// conversions. Each run covers contiguous process data of one kind, bit
+// pins are packed into 8/16/32 bit words that are read or masked and
+// written back in one operation. This file has no kernel dependencies
+// so it can be linked into the userspace test program.
+
+#include "lcec_generic.h"
+
+// pseudo op used while sorting bit values before they are grouped
+#define LCEC_GENERIC_OP_BIT lcecGenericOpBit8
+
+static const int op_width[lcecGenericOpCount] = {
+  1, 2, 4, // bits
+  1, 2, 4, // s32
+  1, 2, 4, // u32
+  1, 2, 4  // float
+};
+
+static int lcec_generic_plan_op(const lcec_generic_pin_t *pin);
+static lcec_generic_plan_val_t *lcec_generic_plan_collect(lcec_generic_plan_val_t *val, lcec_generic_plan_val_t *end, const lcec_generic_pin_t *pins, int count, hal_pin_dir_t dir);
+static void lcec_generic_plan_sort_vals(lcec_generic_plan_val_t *vals, int count);
+static int lcec_generic_plan_build_dir(lcec_generic_plan_dir_t *dir, lcec_generic_plan_val_t *vals, int val_count, lcec_generic_plan_run_t *runs);
+
+int lcec_generic_plan_count(const lcec_generic_pin_t *pins, int count) {
+  int i, j;
+  int val_count = 0;
+
+  for (i=0; i < count; i++, pins++) {
+    if (pins->pin[0] == NULL || lcec_generic_plan_op(pins) < 0) {
+      continue;
+    }
+
+    if (pins->type == HAL_BIT) {
+      for (j=0; j < LCEC_GENERIC_MAX_SUBPINS && pins->pin[j] != NULL; j++) {
+        val_count++;
+      }
+    } else {
+      val_count++;
+    }
+  }
+
+  return val_count;
+}
+
+size_t lcec_generic_plan_size(int val_count) {
+  return sizeof(lcec_generic_plan_t) + (sizeof(lcec_generic_plan_val_t) + sizeof(lcec_generic_plan_run_t)) * val_count;
+}
+
+lcec_generic_plan_t *lcec_generic_plan_build(void *mem, int val_count, const lcec_generic_pin_t *pins, int count) {
+  lcec_generic_plan_t *plan = (lcec_generic_plan_t *) mem;
+  lcec_generic_plan_val_t *val, *end;
+  int in_count, run_count;
+
+  plan->val_count = val_count;
+  plan->vals = (lcec_generic_plan_val_t *) (plan + 1);
+  plan->runs = (lcec_generic_plan_run_t *) (plan->vals + val_count);
+
+  // collect values, read (HAL_OUT) first, then write (HAL_IN)
+  end = plan->vals + val_count;
+  val = lcec_generic_plan_collect(plan->vals, end, pins, count, HAL_OUT);
+  in_count = val - plan->vals;
+  val = lcec_generic_plan_collect(val, end, pins, count, HAL_IN);
+  plan->val_count = val - plan->vals;
+
+  // sort by op and process data position
+  lcec_generic_plan_sort_vals(plan->vals, in_count);
+  lcec_generic_plan_sort_vals(plan->vals + in_count, plan->val_count - in_count);
+
+  // build runs
+  run_count = lcec_generic_plan_build_dir(&plan->read, plan->vals, in_count, plan->runs);
+  lcec_generic_plan_build_dir(&plan->write, plan->vals + in_count, plan->val_count - in_count, plan->runs + run_count);
+
+  return plan;
+}
+
+static lcec_generic_plan_val_t *lcec_generic_plan_collect(lcec_generic_plan_val_t *val, lcec_generic_plan_val_t *end, const lcec_generic_pin_t *pins, int count, hal_pin_dir_t dir) {
+  int i, j, op;
+
+  for (i=0; i < count; i++, pins++) {
+    // skip wrong direction and uninitialized pins
+    if (pins->dir != dir || pins->pin[0] == NULL || (op = lcec_generic_plan_op(pins)) < 0) {
+      continue;
+    }
+
+    for (j=0; j < LCEC_GENERIC_MAX_SUBPINS && pins->pin[j] != NULL && val < end; j++, val++) {
+      val->pin = pins->pin[j];
+      val->scale = pins->scale;
+      val->bitpos = ((pins->pdo_os << 3) | (pins->pdo_bp & 0x07)) + j;
+      val->shift = 0;
+      val->op = op;
+
+      // only bit pins have sub pins
+      if (op != LCEC_GENERIC_OP_BIT) {
+        val++;
+        break;
+      }
+    }
+  }
+
+  return val;
+}
+
+static void lcec_generic_plan_sort_vals(lcec_generic_plan_val_t *vals, int count) {
+  lcec_generic_plan_val_t tmp, *sort;
+  int i;
+
+  // insertion sort, counts are small and this runs only once
+  for (i=1; i < count; i++) {
+    tmp = vals[i];
+    for (sort = &vals[i]; sort > vals; sort--) {
+      if (sort[-1].op < tmp.op || (sort[-1].op == tmp.op && sort[-1].bitpos <= tmp.bitpos)) {
+        break;
+      }
+      *sort = sort[-1];
+    }
+    *sort = tmp;
+  }
+}
+
+static int lcec_generic_plan_op(const lcec_generic_pin_t *pin) {
+  int base;
+
+  switch (pin->type) {
+    case HAL_BIT:
+      return LCEC_GENERIC_OP_BIT;
+    case HAL_S32:
+      base = lcecGenericOpS8;
+      break;
+    case HAL_U32:
+      base = lcecGenericOpU8;
+      break;
+    case HAL_SPECIAL_U32:
+      base = lcecGenericOpFloat8;
+      break;
+    default:
+      return -1;
+  }
+
+  switch (pin->pdo_len) {
+    case 8:
+      return base;
+    case 16:
+      return base + 1;
+    case 32:
+      return base + 2;
+  }
+
+  return -1;
+}
+
+static int lcec_generic_plan_build_dir(lcec_generic_plan_dir_t *dir, lcec_generic_plan_val_t *vals, int val_count, lcec_generic_plan_run_t *runs) {
+  lcec_generic_plan_val_t *val, *end;
+  lcec_generic_plan_run_t *run, tmp, *sort;
+  unsigned int first, span;
+  int i, op, run_count;
+
+  // group values into runs
+  run = runs;
+  end = vals + val_count;
+  for (val = vals; val < end; run++) {
+    run->vals = val;
+    run->count = 0;
+    run->mask = 0;
+
+    if (val->op == LCEC_GENERIC_OP_BIT) {
+      // pack bits of up to 4 bytes into one word, 3 byte spans are
+      // not allowed to avoid accessing data behind the last pdo
+      first = val->bitpos >> 3;
+      span = 1;
+      for (; val < end && val->op == LCEC_GENERIC_OP_BIT; val++, run->count++) {
+        i = (val->bitpos >> 3) - first + 1;
+        if (i > 4 || i == 3) {
+          break;
+        }
+        span = i;
+        val->shift = val->bitpos - (first << 3);
+        run->mask |= (uint32_t) 1 << val->shift;
+      }
+      run->pdo_os = first;
+      op = (span == 1) ? lcecGenericOpBit8 : ((span == 2) ? lcecGenericOpBit16 : lcecGenericOpBit32);
+      for (i=0; i < run->count; i++) {
+        run->vals[i].op = op;
+      }
+      continue;
+    }
+
+    // merge values with contiguous offsets
+    op = val->op;
+    run->pdo_os = val->bitpos >> 3;
+    for (; val < end && val->op == op && (val->bitpos >> 3) == run->pdo_os + run->count * op_width[op]; val++) {
+      run->count++;
+    }
+  }
+  run_count = run - runs;
+
+  // sort runs by op, the value order inside each run is kept
+  for (i=1; i < run_count; i++) {
+    tmp = runs[i];
+    for (sort = &runs[i]; sort > runs && sort[-1].vals->op > tmp.vals->op; sort--) {
+      *sort = sort[-1];
+    }
+    *sort = tmp;
+  }
+
+  // set up op tables
+  for (op=0; op < lcecGenericOpCount; op++) {
+    dir->runs[op] = NULL;
+    dir->run_count[op] = 0;
+  }
+  for (run = runs; run < runs + run_count; run++) {
+    op = run->vals->op;
+    if (dir->runs[op] == NULL) {
+      dir->runs[op] = run;
+    }
+    dir->run_count[op]++;
+  }
+
+  return run_count;
+}
+
+#define LCEC_GENERIC_PLAN_FOREACH(dir, op, pd, width) \
+  for (run = (dir)->runs[op], run_end = run + (dir)->run_count[op]; run < run_end; run++) \
+    for (val = run->vals, val_end = val + run->count, p = (pd) + run->pdo_os; val < val_end; val++, p += (width))
+
+void lcec_generic_plan_read(const lcec_generic_plan_t *plan, uint8_t *pd) {
+  const lcec_generic_plan_dir_t *dir = &plan->read;
+  const lcec_generic_plan_run_t *run, *run_end;
+  const lcec_generic_plan_val_t *val, *val_end;
+  uint8_t *p;
+  uint32_t w;
+
+  // bits
+  for (run = dir->runs[lcecGenericOpBit8], run_end = run + dir->run_count[lcecGenericOpBit8]; run < run_end; run++) {
+    w = EC_READ_U8(&pd[run->pdo_os]);
+    for (val = run->vals, val_end = val + run->count; val < val_end; val++) {
+      *((hal_bit_t *) val->pin) = (w >> val->shift) & 0x01;
+    }
+  }
+  for (run = dir->runs[lcecGenericOpBit16], run_end = run + dir->run_count[lcecGenericOpBit16]; run < run_end; run++) {
+    w = EC_READ_U16(&pd[run->pdo_os]);
+    for (val = run->vals, val_end = val + run->count; val < val_end; val++) {
+      *((hal_bit_t *) val->pin) = (w >> val->shift) & 0x01;
+    }
+  }
+  for (run = dir->runs[lcecGenericOpBit32], run_end = run + dir->run_count[lcecGenericOpBit32]; run < run_end; run++) {
+    w = EC_READ_U32(&pd[run->pdo_os]);
+    for (val = run->vals, val_end = val + run->count; val < val_end; val++) {
+      *((hal_bit_t *) val->pin) = (w >> val->shift) & 0x01;
+    }
+  }
+
+  // s32
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpS8, pd, 1) {
+    *((hal_s32_t *) val->pin) = EC_READ_S8(p);
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpS16, pd, 2) {
+    *((hal_s32_t *) val->pin) = EC_READ_S16(p);
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpS32, pd, 4) {
+    *((hal_s32_t *) val->pin) = EC_READ_S32(p);
+  }
+
+  // u32
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpU8, pd, 1) {
+    *((hal_u32_t *) val->pin) = EC_READ_U8(p);
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpU16, pd, 2) {
+    *((hal_u32_t *) val->pin) = EC_READ_U16(p);
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpU32, pd, 4) {
+    *((hal_u32_t *) val->pin) = EC_READ_U32(p);
+  }
+
+  // scaled float
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpFloat8, pd, 1) {
+    *((hal_float_t *) val->pin) = ((double) EC_READ_U8(p)) / val->scale;
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpFloat16, pd, 2) {
+    *((hal_float_t *) val->pin) = ((double) EC_READ_S16(p)) / val->scale;
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpFloat32, pd, 4) {
+    *((hal_float_t *) val->pin) = ((double) EC_READ_S32(p)) / val->scale;
+  }
+}
+
+void lcec_generic_plan_write(const lcec_generic_plan_t *plan, uint8_t *pd) {
+  const lcec_generic_plan_dir_t *dir = &plan->write;
+  const lcec_generic_plan_run_t *run, *run_end;
+  const lcec_generic_plan_val_t *val, *val_end;
+  uint8_t *p;
+  uint32_t w;
+  hal_s32_t sval;
+  hal_u32_t uval;
+  double fval;
+
+  // bits, masked read-modify-write of the whole word
+  for (run = dir->runs[lcecGenericOpBit8], run_end = run + dir->run_count[lcecGenericOpBit8]; run < run_end; run++) {
+    for (w = 0, val = run->vals, val_end = val + run->count; val < val_end; val++) {
+      w |= ((uint32_t) (*((hal_bit_t *) val->pin) != 0)) << val->shift;
+    }
+    p = &pd[run->pdo_os];
+    EC_WRITE_U8(p, (EC_READ_U8(p) & ~run->mask) | w);
+  }
+  for (run = dir->runs[lcecGenericOpBit16], run_end = run + dir->run_count[lcecGenericOpBit16]; run < run_end; run++) {
+    for (w = 0, val = run->vals, val_end = val + run->count; val < val_end; val++) {
+      w |= ((uint32_t) (*((hal_bit_t *) val->pin) != 0)) << val->shift;
+    }
+    p = &pd[run->pdo_os];
+    EC_WRITE_U16(p, (EC_READ_U16(p) & ~run->mask) | w);
+  }
+  for (run = dir->runs[lcecGenericOpBit32], run_end = run + dir->run_count[lcecGenericOpBit32]; run < run_end; run++) {
+    for (w = 0, val = run->vals, val_end = val + run->count; val < val_end; val++) {
+      w |= ((uint32_t) (*((hal_bit_t *) val->pin) != 0)) << val->shift;
+    }
+    p = &pd[run->pdo_os];
+    EC_WRITE_U32(p, (EC_READ_U32(p) & ~run->mask) | w);
+  }
+
+  // s32, saturated to the pdo size
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpS8, pd, 1) {
+    sval = *((hal_s32_t *) val->pin);
+    if (sval > 0x7f) sval = 0x7f;
+    if (sval < -0x80) sval = -0x80;
+    EC_WRITE_S8(p, sval);
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpS16, pd, 2) {
+    sval = *((hal_s32_t *) val->pin);
+    if (sval > 0x7fff) sval = 0x7fff;
+    if (sval < -0x8000) sval = -0x8000;
+    EC_WRITE_S16(p, sval);
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpS32, pd, 4) {
+    EC_WRITE_S32(p, *((hal_s32_t *) val->pin));
+  }
+
+  // u32, saturated to the pdo size
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpU8, pd, 1) {
+    uval = *((hal_u32_t *) val->pin);
+    if (uval > 0xff) uval = 0xff;
+    EC_WRITE_U8(p, uval);
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpU16, pd, 2) {
+    uval = *((hal_u32_t *) val->pin);
+    if (uval > 0xffff) uval = 0xffff;
+    EC_WRITE_U16(p, uval);
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpU32, pd, 4) {
+    EC_WRITE_U32(p, *((hal_u32_t *) val->pin));
+  }
+
+  // scaled float, same representation as on read
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpFloat8, pd, 1) {
+    fval = *((hal_float_t *) val->pin) * val->scale;
+    if (fval > 255.0) fval = 255.0;
+    if (fval < 0.0) fval = 0.0;
+    EC_WRITE_U8(p, (hal_u32_t) fval);
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpFloat16, pd, 2) {
+    fval = *((hal_float_t *) val->pin) * val->scale;
+    if (fval > 32767.0) fval = 32767.0;
+    if (fval < -32768.0) fval = -32768.0;
+    EC_WRITE_S16(p, (hal_s32_t) fval);
+  }
+  LCEC_GENERIC_PLAN_FOREACH(dir, lcecGenericOpFloat32, pd, 4) {
+    fval = *((hal_float_t *) val->pin) * val->scale;
+    if (fval > 2147483647.0) fval = 2147483647.0;
+    if (fval < -2147483648.0) fval = -2147483648.0;
+    EC_WRITE_S32(p, (hal_s32_t) fval);
+  }
+}
+
@@ -0,0 +1,208 @@
+//
+//    Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+#include "lcec.h"
+#include "lcec_sdo.h"
+
+static const size_t chan_sizes[LCEC_SDO_CHAN_SIZES] = { 1, 2, 4 };
+
+static void lcec_sdo_chan_start(lcec_sdo_chan_t *chan);
+static void lcec_sdo_chan_finish(lcec_sdo_chan_t *chan, ec_request_state_t state);
+
+lcec_sdo_chan_t *lcec_init_sdo_chans(int comp_id, struct lcec_slave *slave, int count) {
+  lcec_master_t *master = slave->master;
+  lcec_sdo_chan_t *chans, *chan;
+  int i, j;
+
+  // alloc hal data
+  if ((chans = hal_malloc(sizeof(lcec_sdo_chan_t) * count)) == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "hal_malloc() for slave %s.%s sdo channels failed\n", master->name, slave->name);
+    return NULL;
+  }
+  memset(chans, 0, sizeof(lcec_sdo_chan_t) * count);
+
+  for (i = 0, chan = chans; i < count; i++, chan++) {
+    // create request pool, index and subindex are set on each transfer
+    for (j = 0; j < LCEC_SDO_CHAN_SIZES; j++) {
+      if (!(chan->req[j] = ecrt_slave_config_create_sdo_request(slave->config, 0, 0, chan_sizes[j]))) {
+        rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "slave %s.%s: Failed to create SDO request for channel %d\n", master->name, slave->name, i);
+        return NULL;
+      }
+      ecrt_sdo_request_timeout(chan->req[j], LCEC_SDO_REQ_TIMEOUT);
+    }
+
+    // export pins
+    if (hal_pin_u32_newf(HAL_IN, &(chan->index), comp_id, "%s.%s.%s.sdo-%d-index", LCEC_MODULE_NAME, master->name, slave->name, i) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.sdo-%d-index failed\n", LCEC_MODULE_NAME, master->name, slave->name, i);
+      return NULL;
+    }
+    if (hal_pin_u32_newf(HAL_IN, &(chan->subindex), comp_id, "%s.%s.%s.sdo-%d-subindex", LCEC_MODULE_NAME, master->name, slave->name, i) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.sdo-%d-subindex failed\n", LCEC_MODULE_NAME, master->name, slave->name, i);
+      return NULL;
+    }
+    if (hal_pin_u32_newf(HAL_IN, &(chan->size), comp_id, "%s.%s.%s.sdo-%d-size", LCEC_MODULE_NAME, master->name, slave->name, i) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.sdo-%d-size failed\n", LCEC_MODULE_NAME, master->name, slave->name, i);
+      return NULL;
+    }
+    if (hal_pin_bit_newf(HAL_IN, &(chan->write), comp_id, "%s.%s.%s.sdo-%d-write", LCEC_MODULE_NAME, master->name, slave->name, i) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.sdo-%d-write failed\n", LCEC_MODULE_NAME, master->name, slave->name, i);
+      return NULL;
+    }
+    if (hal_pin_bit_newf(HAL_IN, &(chan->sign), comp_id, "%s.%s.%s.sdo-%d-signed", LCEC_MODULE_NAME, master->name, slave->name, i) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.sdo-%d-signed failed\n", LCEC_MODULE_NAME, master->name, slave->name, i);
+      return NULL;
+    }
+    if (hal_pin_bit_newf(HAL_IN, &(chan->trigger), comp_id, "%s.%s.%s.sdo-%d-trigger", LCEC_MODULE_NAME, master->name, slave->name, i) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.sdo-%d-trigger failed\n", LCEC_MODULE_NAME, master->name, slave->name, i);
+      return NULL;
+    }
+    if (hal_pin_s32_newf(HAL_IN, &(chan->value_set), comp_id, "%s.%s.%s.sdo-%d-value-set", LCEC_MODULE_NAME, master->name, slave->name, i) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.sdo-%d-value-set failed\n", LCEC_MODULE_NAME, master->name, slave->name, i);
+      return NULL;
+    }
+    if (hal_pin_s32_newf(HAL_OUT, &(chan->value), comp_id, "%s.%s.%s.sdo-%d-value", LCEC_MODULE_NAME, master->name, slave->name, i) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.sdo-%d-value failed\n", LCEC_MODULE_NAME, master->name, slave->name, i);
+      return NULL;
+    }
+    if (hal_pin_bit_newf(HAL_OUT, &(chan->busy), comp_id, "%s.%s.%s.sdo-%d-busy", LCEC_MODULE_NAME, master->name, slave->name, i) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.sdo-%d-busy failed\n", LCEC_MODULE_NAME, master->name, slave->name, i);
+      return NULL;
+    }
+    if (hal_pin_bit_newf(HAL_OUT, &(chan->error), comp_id, "%s.%s.%s.sdo-%d-error", LCEC_MODULE_NAME, master->name, slave->name, i) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s.%s.sdo-%d-error failed\n", LCEC_MODULE_NAME, master->name, slave->name, i);
+      return NULL;
+    }
+
+    // initialize pins
+    *(chan->index) = 0;
+    *(chan->subindex) = 0;
+    *(chan->size) = 4;
+    *(chan->write) = 0;
+    *(chan->sign) = 0;
+    *(chan->trigger) = 0;
+    *(chan->value_set) = 0;
+    *(chan->value) = 0;
+    *(chan->busy) = 0;
+    *(chan->error) = 0;
+
+    chan->last_trigger = 0;
+    chan->active_write = 0;
+    chan->active = NULL;
+  }
+
+  return chans;
+}
+
+void lcec_update_sdo_chans(struct lcec_slave *slave) {
+  lcec_sdo_chan_t *chan;
+  ec_request_state_t state;
+  int i, trigger;
+
+  for (i = 0, chan = slave->sdo_chans; i < slave->sdo_chan_count; i++, chan++) {
+    trigger = *(chan->trigger);
+
+    if (chan->active != NULL) {
+      // poll running request, never wait for it
+      state = ecrt_sdo_request_state(chan->active);
+      if (state != EC_REQUEST_BUSY) {
+        lcec_sdo_chan_finish(chan, state);
+      }
+    } else if (trigger && !chan->last_trigger) {
+      // start new request on rising edge
+      lcec_sdo_chan_start(chan);
+    }
+
+    chan->last_trigger = trigger;
+  }
+}
+
+static void lcec_sdo_chan_start(lcec_sdo_chan_t *chan) {
+  ec_sdo_request_t *req;
+  uint8_t *data;
+  int j;
+
+  // reads always use the largest request, the slave tells the actual size
+  if (*(chan->write)) {
+    for (j = 0; j < LCEC_SDO_CHAN_SIZES && chan_sizes[j] != *(chan->size); j++);
+  } else {
+    j = LCEC_SDO_CHAN_SIZES - 1;
+  }
+  if (j >= LCEC_SDO_CHAN_SIZES || *(chan->index) > 0xffff || *(chan->subindex) > 0xff) {
+    *(chan->error) = 1;
+    return;
+  }
+  req = chan->req[j];
+
+  ecrt_sdo_request_index(req, *(chan->index), *(chan->subindex));
+  if (*(chan->write)) {
+    data = ecrt_sdo_request_data(req);
+    switch (chan_sizes[j]) {
+      case 1:
+        EC_WRITE_U8(data, *(chan->value_set));
+        break;
+      case 2:
+        EC_WRITE_U16(data, *(chan->value_set));
+        break;
+      default:
+        EC_WRITE_U32(data, *(chan->value_set));
+    }
+    ecrt_sdo_request_write(req);
+  } else {
+    ecrt_sdo_request_read(req);
+  }
+
+  chan->active = req;
+  chan->active_write = *(chan->write);
+  *(chan->busy) = 1;
+  *(chan->error) = 0;
+}
+
+static void lcec_sdo_chan_finish(lcec_sdo_chan_t *chan, ec_request_state_t state) {
+  ec_sdo_request_t *req = chan->active;
+  uint8_t *data;
+
+  chan->active = NULL;
+  *(chan->busy) = 0;
+
+  if (state != EC_REQUEST_SUCCESS) {
+    *(chan->error) = 1;
+    return;
+  }
+
+  // writes are done here
+  if (chan->active_write) {
+    return;
+  }
+
+  // get read value
+  data = ecrt_sdo_request_data(req);
+  switch (ecrt_sdo_request_data_size(req)) {
+    case 1:
+      *(chan->value) = *(chan->sign) ? EC_READ_S8(data) : EC_READ_U8(data);
+      break;
+    case 2:
+      *(chan->value) = *(chan->sign) ? EC_READ_S16(data) : EC_READ_U16(data);
+      break;
+    case 4:
+      *(chan->value) = EC_READ_S32(data);
+      break;
+    default:
+      *(chan->error) = 1;
+  }
+}
+
@@ -0,0 +1,48 @@
+//
+//    Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+#ifndef _LCEC_SDO_H_
+#define _LCEC_SDO_H_
+
+#include "lcec.h"
+
+// request sizes (bytes) pre-created per channel, the largest one is used for reads
+#define LCEC_SDO_CHAN_SIZES 3
+
+typedef struct lcec_sdo_chan {
+  hal_u32_t *index;
+  hal_u32_t *subindex;
+  hal_u32_t *size;
+  hal_bit_t *write;
+  hal_bit_t *sign;
+  hal_bit_t *trigger;
+  hal_s32_t *value_set;
+  hal_s32_t *value;
+  hal_bit_t *busy;
+  hal_bit_t *error;
+
+  int last_trigger;
+  int active_write;
+  ec_sdo_request_t *active;
+  ec_sdo_request_t *req[LCEC_SDO_CHAN_SIZES];
+} lcec_sdo_chan_t;
+
+lcec_sdo_chan_t *lcec_init_sdo_chans(int comp_id, struct lcec_slave *slave, int count);
+void lcec_update_sdo_chans(struct lcec_slave *slave);
+
+#endif
+
@@ -0,0 +1,741 @@
+//
+//    Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// Simulated EtherCAT master for simulator builds. The bus consists of
+// exactly the slaves lcec configures from its XML file, all of them
+// present and reaching OP on activation. Each domain is a plain memory
+// image laid out like the IgH master does it: whole sync manager images
+// in registration order. Frames take sim_latency ns for the round trip,
+// every sim_wc_errors-th frame misses one slave.
+
+#include "lcec.h"
+
+#define LCEC_SIM_MAX_MASTERS 32
+
+// sdo requests complete with the next received frame
+#define LCEC_SIM_REQ_IDLE 0
+#define LCEC_SIM_REQ_READ 1
+#define LCEC_SIM_REQ_WRITE 2
+
+static int sim_latency = 0;
+RTAPI_MP_INT(sim_latency, "simulated frame round trip time (ns)");
+static int sim_wc_errors = 0;
+RTAPI_MP_INT(sim_wc_errors, "drop one slave from every n-th frame (0 = never)");
+
+typedef struct lcec_sim_entry {
+  uint16_t index;
+  uint8_t subindex;
+  uint8_t bit_length;
+  unsigned int bit_pos;
+} lcec_sim_entry_t;
+
+typedef struct lcec_sim_sm {
+  ec_direction_t dir;
+  unsigned int bit_size;
+  int entry_count;
+  lcec_sim_entry_t *entries;
+  ec_domain_t *domain;
+  unsigned int offset;
+} lcec_sim_sm_t;
+
+// entries registered without a configured mapping (slave's default pdos)
+typedef struct lcec_sim_loose {
+  struct lcec_sim_loose *next;
+  ec_domain_t *domain;
+  uint16_t index;
+  uint8_t subindex;
+  ec_direction_t dir;
+  unsigned int offset;
+  unsigned int bit_pos;
+} lcec_sim_loose_t;
+
+typedef struct lcec_sim_sdo {
+  struct lcec_sim_sdo *next;
+  uint16_t index;
+  uint8_t subindex;
+  size_t size;
+  uint8_t data[];
+} lcec_sim_sdo_t;
+
+struct ec_sdo_request {
+  struct ec_sdo_request *next;
+  ec_slave_config_t *sc;
+  uint16_t index;
+  uint8_t subindex;
+  size_t size;
+  uint8_t *data;
+  int pending;
+  ec_request_state_t state;
+};
+
+struct ec_slave_config {
+  struct ec_slave_config *next;
+  ec_master_t *master;
+  uint16_t alias;
+  uint16_t position;
+  uint32_t vendor_id;
+  uint32_t product_code;
+  int sm_count;
+  lcec_sim_sm_t sms[EC_MAX_SYNC_MANAGERS];
+  lcec_sim_loose_t *first_loose;
+  ec_domain_t *loose_domain;
+  unsigned int loose_end;
+  lcec_sim_sdo_t *first_sdo;
+  ec_sdo_request_t *first_req;
+  int dc_used;
+};
+
+struct ec_domain {
+  struct ec_domain *next;
+  ec_master_t *master;
+  uint8_t *data;
+  size_t size;
+  unsigned int wc_expected;
+  unsigned int wc;
+  ec_wc_state_t wc_state;
+  int queued;
+  int in_flight;
+  int received;
+  long long send_time;
+};
+
+struct ec_master {
+  unsigned int index;
+  int active;
+  ec_domain_t *first_domain;
+  ec_slave_config_t *first_sc;
+  int sc_count;
+  unsigned int frames;
+  int dropped_sc;
+  uint64_t app_time;
+  uint32_t ref_time;
+  int dc_used;
+  int sync_monitor;
+};
+
+static ec_master_t *masters[LCEC_SIM_MAX_MASTERS];
+
+static int lcec_sim_map_sm(ec_domain_t *domain, ec_slave_config_t *sc, int sm_idx);
+static lcec_sim_sdo_t *lcec_sim_find_sdo(ec_slave_config_t *sc, uint16_t index, uint8_t subindex);
+static int lcec_sim_store_sdo(ec_slave_config_t *sc, uint16_t index, uint8_t subindex, const uint8_t *data, size_t size);
+static void lcec_sim_process_req(ec_sdo_request_t *req);
+static unsigned int lcec_sim_wc(ec_domain_t *domain, ec_slave_config_t *sc);
+
+ec_master_t *ecrt_request_master(unsigned int master_index) {
+  ec_master_t *master;
+
+  if (master_index >= LCEC_SIM_MAX_MASTERS || masters[master_index] != NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "simulated master %u not available\n", master_index);
+    return NULL;
+  }
+
+  if ((master = kzalloc(sizeof(ec_master_t), GFP_KERNEL)) == NULL) {
+    return NULL;
+  }
+  master->index = master_index;
+  master->dropped_sc = -1;
+  masters[master_index] = master;
+
+  rtapi_print_msg(RTAPI_MSG_INFO, LCEC_MSG_PFX "using simulated master %u (latency %d ns, wc errors every %d frames)\n",
+    master_index, sim_latency, sim_wc_errors);
+  return master;
+}
+
+void ecrt_release_master(ec_master_t *master) {
+  ec_domain_t *domain, *next_domain;
+  ec_slave_config_t *sc, *next_sc;
+  ec_sdo_request_t *req, *next_req;
+  lcec_sim_loose_t *loose, *next_loose;
+  lcec_sim_sdo_t *sdo, *next_sdo;
+  int i;
+
+  for (domain = master->first_domain; domain != NULL; domain = next_domain) {
+    next_domain = domain->next;
+    if (domain->data != NULL) {
+      kfree(domain->data);
+    }
+    kfree(domain);
+  }
+
+  for (sc = master->first_sc; sc != NULL; sc = next_sc) {
+    next_sc = sc->next;
+    for (i = 0; i < EC_MAX_SYNC_MANAGERS; i++) {
+      if (sc->sms[i].entries != NULL) {
+        kfree(sc->sms[i].entries);
+      }
+    }
+    for (loose = sc->first_loose; loose != NULL; loose = next_loose) {
+      next_loose = loose->next;
+      kfree(loose);
+    }
+    for (sdo = sc->first_sdo; sdo != NULL; sdo = next_sdo) {
+      next_sdo = sdo->next;
+      kfree(sdo);
+    }
+    for (req = sc->first_req; req != NULL; req = next_req) {
+      next_req = req->next;
+      kfree(req->data);
+      kfree(req);
+    }
+    kfree(sc);
+  }
+
+  masters[master->index] = NULL;
+  kfree(master);
+}
+
+void ecrt_master_callbacks(ec_master_t *master, void (*send_cb)(void *), void (*receive_cb)(void *), void *cb_data) {
+  // no concurrent users of the simulated bus
+}
+
+ec_domain_t *ecrt_master_create_domain(ec_master_t *master) {
+  ec_domain_t *domain, **tail;
+
+  if (master->active) {
+    return NULL;
+  }
+
+  if ((domain = kzalloc(sizeof(ec_domain_t), GFP_KERNEL)) == NULL) {
+    return NULL;
+  }
+  domain->master = master;
+
+  for (tail = &master->first_domain; *tail != NULL; tail = &(*tail)->next);
+  *tail = domain;
+
+  return domain;
+}
+
+ec_slave_config_t *ecrt_master_slave_config(ec_master_t *master, uint16_t alias, uint16_t position, uint32_t vendor_id, uint32_t product_code) {
+  ec_slave_config_t *sc, **tail;
+
+  // the same position must be requested with the same identity
+  for (tail = &master->first_sc; *tail != NULL; tail = &(*tail)->next) {
+    sc = *tail;
+    if (sc->alias == alias && sc->position == position) {
+      if (sc->vendor_id != vendor_id || sc->product_code != product_code) {
+        rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "simulated slave %u:%u configured with different identity\n", alias, position);
+        return NULL;
+      }
+      return sc;
+    }
+  }
+
+  if ((sc = kzalloc(sizeof(ec_slave_config_t), GFP_KERNEL)) == NULL) {
+    return NULL;
+  }
+  sc->master = master;
+  sc->alias = alias;
+  sc->position = position;
+  sc->vendor_id = vendor_id;
+  sc->product_code = product_code;
+
+  *tail = sc;
+  master->sc_count++;
+
+  return sc;
+}
+
+int ecrt_master_activate(ec_master_t *master) {
+  ec_domain_t *domain;
+  ec_slave_config_t *sc;
+
+  if (master->active) {
+    return 0;
+  }
+
+  for (domain = master->first_domain; domain != NULL; domain = domain->next) {
+    // process image, at least one byte like the real master
+    if ((domain->data = kzalloc(domain->size > 0 ? domain->size : 1, GFP_KERNEL)) == NULL) {
+      return -1;
+    }
+
+    // expected working counter: LRW counts 2 for outputs, 1 for inputs
+    domain->wc_expected = 0;
+    for (sc = master->first_sc; sc != NULL; sc = sc->next) {
+      domain->wc_expected += lcec_sim_wc(domain, sc);
+    }
+  }
+
+  master->active = 1;
+  return 0;
+}
+
+void ecrt_master_deactivate(ec_master_t *master) {
+  master->active = 0;
+}
+
+void ecrt_master_send(ec_master_t *master) {
+  ec_domain_t *domain;
+  long long now = rtapi_get_time();
+
+  for (domain = master->first_domain; domain != NULL; domain = domain->next) {
+    if (domain->queued) {
+      domain->queued = 0;
+      domain->in_flight = 1;
+      domain->send_time = now;
+    }
+  }
+}
+
+void ecrt_master_receive(ec_master_t *master) {
+  ec_domain_t *domain;
+  ec_slave_config_t *sc;
+  ec_sdo_request_t *req;
+  long long now = rtapi_get_time();
+  int i;
+
+  // pick the slave missing in this cycle's frames
+  master->dropped_sc = -1;
+  master->frames++;
+  if (sim_wc_errors > 0 && master->sc_count > 0 && (master->frames % sim_wc_errors) == 0) {
+    master->dropped_sc = (master->frames / sim_wc_errors) % master->sc_count;
+  }
+
+  for (domain = master->first_domain; domain != NULL; domain = domain->next) {
+    if (!domain->in_flight || (now - domain->send_time) < sim_latency) {
+      continue;
+    }
+    domain->in_flight = 0;
+    domain->received = 1;
+
+    domain->wc = domain->wc_expected;
+    for (sc = master->first_sc, i = 0; sc != NULL; sc = sc->next, i++) {
+      if (i == master->dropped_sc) {
+        domain->wc -= lcec_sim_wc(domain, sc);
+      }
+    }
+  }
+
+  // mailbox traffic
+  for (sc = master->first_sc; sc != NULL; sc = sc->next) {
+    for (req = sc->first_req; req != NULL; req = req->next) {
+      if (req->pending != LCEC_SIM_REQ_IDLE) {
+        lcec_sim_process_req(req);
+      }
+    }
+  }
+}
+
+void ecrt_master_state(const ec_master_t *master, ec_master_state_t *state) {
+  state->slaves_responding = master->sc_count;
+  state->al_states = master->active ? 0x08 : 0x02;
+  state->link_up = 1;
+}
+
+void ecrt_master_application_time(ec_master_t *master, uint64_t app_time) {
+  master->app_time = app_time;
+}
+
+void ecrt_master_sync_reference_clock(ec_master_t *master) {
+  // ideal reference clock: takes the application time
+  master->ref_time = (uint32_t) master->app_time;
+}
+
+void ecrt_master_sync_slave_clocks(ec_master_t *master) {
+}
+
+int ecrt_master_reference_clock_time(ec_master_t *master, uint32_t *time) {
+  if (!master->dc_used) {
+    return -1;
+  }
+  *time = master->ref_time;
+  return 0;
+}
+
+void ecrt_master_sync_monitor_queue(ec_master_t *master) {
+  master->sync_monitor = 1;
+}
+
+uint32_t ecrt_master_sync_monitor_process(ec_master_t *master) {
+  if (!master->sync_monitor) {
+    return 0xffffffff;
+  }
+  master->sync_monitor = 0;
+  return 0;
+}
+
+int ecrt_slave_config_pdos(ec_slave_config_t *sc, unsigned int n_syncs, const ec_sync_info_t syncs[]) {
+  const ec_sync_info_t *sync;
+  const ec_pdo_info_t *pdo;
+  lcec_sim_sm_t *sm;
+  lcec_sim_entry_t *entry;
+  unsigned int i, j, k;
+  int count;
+
+  for (i = 0, sync = syncs; i < n_syncs && sync->index != 0xff; i++, sync++) {
+    if (sync->index >= EC_MAX_SYNC_MANAGERS) {
+      return -1;
+    }
+    sm = &sc->sms[sync->index];
+    if (sm->domain != NULL) {
+      return -1;
+    }
+
+    // default direction by sync manager number
+    sm->dir = sync->dir;
+    if (sm->dir == EC_DIR_INVALID) {
+      sm->dir = (sync->index & 1) ? EC_DIR_INPUT : EC_DIR_OUTPUT;
+    }
+
+    // flatten pdo assignment
+    count = 0;
+    for (j = 0, pdo = sync->pdos; j < sync->n_pdos; j++, pdo++) {
+      if (pdo->entries != NULL) {
+        count += pdo->n_entries;
+      }
+    }
+    if (sm->entries != NULL) {
+      kfree(sm->entries);
+      sm->entries = NULL;
+    }
+    if (count > 0 && (sm->entries = kzalloc(sizeof(lcec_sim_entry_t) * count, GFP_KERNEL)) == NULL) {
+      return -1;
+    }
+
+    sm->entry_count = count;
+    sm->bit_size = 0;
+    entry = sm->entries;
+    for (j = 0, pdo = sync->pdos; j < sync->n_pdos; j++, pdo++) {
+      if (pdo->entries == NULL) {
+        continue;
+      }
+      for (k = 0; k < pdo->n_entries; k++, entry++) {
+        entry->index = pdo->entries[k].index;
+        entry->subindex = pdo->entries[k].subindex;
+        entry->bit_length = pdo->entries[k].bit_length;
+        entry->bit_pos = sm->bit_size;
+        sm->bit_size += entry->bit_length;
+      }
+    }
+
+    if (sync->index >= sc->sm_count) {
+      sc->sm_count = sync->index + 1;
+    }
+  }
+
+  return 0;
+}
+
+void ecrt_slave_config_watchdog(ec_slave_config_t *sc, uint16_t watchdog_divider, uint16_t watchdog_intervals) {
+}
+
+void ecrt_slave_config_dc(ec_slave_config_t *sc, uint16_t assign_activate, uint32_t sync0_cycle, int32_t sync0_shift, uint32_t sync1_cycle, int32_t sync1_shift) {
+  sc->dc_used = (assign_activate != 0);
+  if (sc->dc_used) {
+    sc->master->dc_used = 1;
+  }
+}
+
+int ecrt_slave_config_sdo(ec_slave_config_t *sc, uint16_t index, uint8_t subindex, const uint8_t *data, size_t size) {
+  return lcec_sim_store_sdo(sc, index, subindex, data, size);
+}
+
+int ecrt_slave_config_complete_sdo(ec_slave_config_t *sc, uint16_t index, const uint8_t *data, size_t size) {
+  return lcec_sim_store_sdo(sc, index, 0, data, size);
+}
+
+ec_sdo_request_t *ecrt_slave_config_create_sdo_request(ec_slave_config_t *sc, uint16_t index, uint8_t subindex, size_t size) {
+  ec_sdo_request_t *req;
+
+  if ((req = kzalloc(sizeof(ec_sdo_request_t), GFP_KERNEL)) == NULL) {
+    return NULL;
+  }
+  if ((req->data = kzalloc(size > 0 ? size : 1, GFP_KERNEL)) == NULL) {
+    kfree(req);
+    return NULL;
+  }
+  req->sc = sc;
+  req->index = index;
+  req->subindex = subindex;
+  req->size = size;
+  req->state = EC_REQUEST_UNUSED;
+
+  req->next = sc->first_req;
+  sc->first_req = req;
+
+  return req;
+}
+
+void ecrt_slave_config_state(const ec_slave_config_t *sc, ec_slave_config_state_t *state) {
+  state->online = 1;
+  state->operational = sc->master->active;
+  state->al_state = sc->master->active ? 0x08 : 0x02;
+}
+
+int ecrt_domain_reg_pdo_entry_list(ec_domain_t *domain, const ec_pdo_entry_reg_t *pdo_entry_regs) {
+  const ec_pdo_entry_reg_t *reg;
+  ec_slave_config_t *sc;
+  lcec_sim_sm_t *sm;
+  lcec_sim_entry_t *entry;
+  lcec_sim_loose_t *loose;
+  unsigned int bit;
+  int i, j, found;
+
+  if (domain->master->active) {
+    return -1;
+  }
+
+  for (reg = pdo_entry_regs; reg->index != 0; reg++) {
+    if ((sc = ecrt_master_slave_config(domain->master, reg->alias, reg->position, reg->vendor_id, reg->product_code)) == NULL) {
+      return -1;
+    }
+
+    // look up the entry in the configured mapping
+    found = 0;
+    for (i = 0, sm = sc->sms; i < sc->sm_count && !found; i++, sm++) {
+      for (j = 0, entry = sm->entries; j < sm->entry_count; j++, entry++) {
+        if (entry->index == reg->index && entry->subindex == reg->subindex) {
+          found = 1;
+          break;
+        }
+      }
+      if (!found) {
+        continue;
+      }
+
+      // the whole sync manager image goes to the first domain using it
+      if (sm->domain == NULL) {
+        if (lcec_sim_map_sm(domain, sc, i) != 0) {
+          return -1;
+        }
+      } else if (sm->domain != domain) {
+        rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "simulated slave %u sm %d already mapped to another domain\n", sc->position, i);
+        return -1;
+      }
+
+      bit = sm->offset * 8 + entry->bit_pos;
+      if (reg->bit_position != NULL) {
+        *(reg->bit_position) = bit % 8;
+      } else if ((bit % 8) != 0) {
+        rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "simulated slave %u entry %04x:%02x is not byte aligned\n", sc->position, reg->index, reg->subindex);
+        return -1;
+      }
+      *(reg->offset) = bit / 8;
+    }
+    if (found) {
+      continue;
+    }
+
+    // default mapping: entry size is unknown, so bits are packed and
+    // everything else gets a 32 bit slot. The direction follows the
+    // CoE profile areas (0x7000 outputs, anything else inputs).
+    for (loose = sc->first_loose; loose != NULL; loose = loose->next) {
+      if (loose->domain == domain && loose->index == reg->index && loose->subindex == reg->subindex) {
+        break;
+      }
+    }
+    if (loose == NULL) {
+      if ((loose = kzalloc(sizeof(lcec_sim_loose_t), GFP_KERNEL)) == NULL) {
+        return -1;
+      }
+      loose->domain = domain;
+      loose->index = reg->index;
+      loose->subindex = reg->subindex;
+      loose->dir = (reg->index >= 0x7000 && reg->index < 0x8000) ? EC_DIR_OUTPUT : EC_DIR_INPUT;
+
+      // continue the last bit area if nothing was mapped after it
+      bit = domain->size * 8;
+      if (reg->bit_position != NULL && sc->loose_domain == domain && (sc->loose_end + 7) / 8 == domain->size && (sc->loose_end % 8) != 0) {
+        bit = sc->loose_end;
+      }
+      loose->offset = bit / 8;
+      loose->bit_pos = bit % 8;
+      bit += (reg->bit_position != NULL) ? 1 : 32;
+      domain->size = (bit + 7) / 8;
+      sc->loose_domain = domain;
+      sc->loose_end = bit;
+
+      loose->next = sc->first_loose;
+      sc->first_loose = loose;
+    }
+
+    if (reg->bit_position != NULL) {
+      *(reg->bit_position) = loose->bit_pos;
+    }
+    *(reg->offset) = loose->offset;
+  }
+
+  return 0;
+}
+
+size_t ecrt_domain_size(const ec_domain_t *domain) {
+  return domain->size;
+}
+
+uint8_t *ecrt_domain_data(ec_domain_t *domain) {
+  return domain->data;
+}
+
+void ecrt_domain_process(ec_domain_t *domain) {
+  // a frame not yet back leaves the image untouched
+  if (!domain->received) {
+    domain->wc = 0;
+  }
+  domain->received = 0;
+
+  if (domain->wc == 0) {
+    domain->wc_state = EC_WC_ZERO;
+  } else if (domain->wc == domain->wc_expected) {
+    domain->wc_state = EC_WC_COMPLETE;
+  } else {
+    domain->wc_state = EC_WC_INCOMPLETE;
+  }
+}
+
+void ecrt_domain_queue(ec_domain_t *domain) {
+  // a frame still on the wire is lost by queuing the next one
+  domain->in_flight = 0;
+  domain->queued = 1;
+}
+
+void ecrt_domain_state(const ec_domain_t *domain, ec_domain_state_t *state) {
+  state->working_counter = domain->wc;
+  state->wc_state = domain->wc_state;
+  state->redundancy_active = 0;
+}
+
+void ecrt_sdo_request_index(ec_sdo_request_t *req, uint16_t index, uint8_t subindex) {
+  req->index = index;
+  req->subindex = subindex;
+}
+
+void ecrt_sdo_request_timeout(ec_sdo_request_t *req, uint32_t timeout) {
+}
+
+uint8_t *ecrt_sdo_request_data(ec_sdo_request_t *req) {
+  return req->data;
+}
+
+size_t ecrt_sdo_request_data_size(const ec_sdo_request_t *req) {
+  return req->size;
+}
+
+ec_request_state_t ecrt_sdo_request_state(ec_sdo_request_t *req) {
+  // before activation the master's idle thread serves mailboxes
+  if (req->pending != LCEC_SIM_REQ_IDLE && !req->sc->master->active) {
+    lcec_sim_process_req(req);
+  }
+  return req->state;
+}
+
+void ecrt_sdo_request_write(ec_sdo_request_t *req) {
+  req->pending = LCEC_SIM_REQ_WRITE;
+  req->state = EC_REQUEST_BUSY;
+}
+
+void ecrt_sdo_request_read(ec_sdo_request_t *req) {
+  req->pending = LCEC_SIM_REQ_READ;
+  req->state = EC_REQUEST_BUSY;
+}
+
+static int lcec_sim_map_sm(ec_domain_t *domain, ec_slave_config_t *sc, int sm_idx) {
+  lcec_sim_sm_t *sm = &sc->sms[sm_idx];
+
+  sm->domain = domain;
+  sm->offset = domain->size;
+  domain->size += (sm->bit_size + 7) / 8;
+
+  return 0;
+}
+
+static unsigned int lcec_sim_wc(ec_domain_t *domain, ec_slave_config_t *sc) {
+  lcec_sim_loose_t *loose;
+  int i, outputs = 0, inputs = 0;
+
+  for (i = 0; i < sc->sm_count; i++) {
+    if (sc->sms[i].domain == domain) {
+      if (sc->sms[i].dir == EC_DIR_OUTPUT) {
+        outputs = 1;
+      } else {
+        inputs = 1;
+      }
+    }
+  }
+
+  for (loose = sc->first_loose; loose != NULL; loose = loose->next) {
+    if (loose->domain == domain) {
+      if (loose->dir == EC_DIR_OUTPUT) {
+        outputs = 1;
+      } else {
+        inputs = 1;
+      }
+    }
+  }
+
+  return outputs * 2 + inputs;
+}
+
+static lcec_sim_sdo_t *lcec_sim_find_sdo(ec_slave_config_t *sc, uint16_t index, uint8_t subindex) {
+  lcec_sim_sdo_t *sdo;
+
+  for (sdo = sc->first_sdo; sdo != NULL; sdo = sdo->next) {
+    if (sdo->index == index && sdo->subindex == subindex) {
+      return sdo;
+    }
+  }
+
+  return NULL;
+}
+
+static int lcec_sim_store_sdo(ec_slave_config_t *sc, uint16_t index, uint8_t subindex, const uint8_t *data, size_t size) {
+  lcec_sim_sdo_t *sdo, **prev;
+
+  // replace existing object
+  for (prev = &sc->first_sdo; *prev != NULL; prev = &(*prev)->next) {
+    if ((*prev)->index == index && (*prev)->subindex == subindex) {
+      sdo = *prev;
+      *prev = sdo->next;
+      kfree(sdo);
+      break;
+    }
+  }
+
+  if ((sdo = kzalloc(sizeof(lcec_sim_sdo_t) + size, GFP_KERNEL)) == NULL) {
+    return -1;
+  }
+  sdo->index = index;
+  sdo->subindex = subindex;
+  sdo->size = size;
+  memcpy(sdo->data, data, size);
+
+  sdo->next = sc->first_sdo;
+  sc->first_sdo = sdo;
+
+  return 0;
+}
+
+static void lcec_sim_process_req(ec_sdo_request_t *req) {
+  lcec_sim_sdo_t *sdo;
+  size_t len;
+
+  if (req->pending == LCEC_SIM_REQ_WRITE) {
+    req->state = (lcec_sim_store_sdo(req->sc, req->index, req->subindex, req->data, req->size) == 0) ? EC_REQUEST_SUCCESS : EC_REQUEST_ERROR;
+  } else {
+    // objects never written read as zero
+    memset(req->data, 0, req->size);
+    if ((sdo = lcec_sim_find_sdo(req->sc, req->index, req->subindex)) != NULL) {
+      len = sdo->size < req->size ? sdo->size : req->size;
+      memcpy(req->data, sdo->data, len);
+    }
+    req->state = EC_REQUEST_SUCCESS;
+  }
+
+  req->pending = LCEC_SIM_REQ_IDLE;
+}
+
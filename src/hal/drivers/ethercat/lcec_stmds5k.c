@@ -353,9 +353,8 @@ void lcec_stmds5k_check_scales(lcec_stmds5k_data_t *hal_data) {
 }
 
 void lcec_stmds5k_read(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_stmds5k_data_t *hal_data = (lcec_stmds5k_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   int32_t index_tmp;
   int32_t pos_cnt, pos_cnt_diff;
   long long net_count;
@@ -442,9 +441,8 @@ void lcec_stmds5k_read(struct lcec_slave *slave, long period) {
 }
 
 void lcec_stmds5k_write(struct lcec_slave *slave, long period) {
-  lcec_master_t *master = slave->master;
   lcec_stmds5k_data_t *hal_data = (lcec_stmds5k_data_t *) slave->hal_data;
-  uint8_t *pd = master->process_data;
+  uint8_t *pd = slave->domain->process_data;
   uint8_t dev_ctrl;
   double speed_raw, torque_raw;
 
@@ -0,0 +1,217 @@
+//
+//    Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+#include "lcec.h"
+#include "lcec_timing.h"
+
+static const char *hist_names[lcecTimingHistCount] = {
+  "hist-recv",
+  "hist-send",
+  "hist-dc"
+};
+
+static void lcec_timing_hist_add(lcec_timing_t *timing, LCEC_TIMING_HIST_T hist, uint32_t value);
+static void lcec_timing_reset(lcec_timing_t *timing);
+
+lcec_timing_t *lcec_init_timing_hal(int comp_id, const char *pfx) {
+  lcec_timing_t *timing;
+  int i;
+
+  // alloc hal data (the histogram lives in HAL shared memory too)
+  if ((timing = hal_malloc(sizeof(lcec_timing_t))) == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "hal_malloc() for %s timing failed\n", pfx);
+    return NULL;
+  }
+  memset(timing, 0, sizeof(lcec_timing_t));
+
+  // export pins
+  if (hal_pin_u32_newf(HAL_OUT, &(timing->recv_time), comp_id, "%s.recv-time-ns", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.recv-time-ns failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_u32_newf(HAL_OUT, &(timing->recv_time_max), comp_id, "%s.recv-time-max-ns", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.recv-time-max-ns failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_u32_newf(HAL_OUT, &(timing->send_time), comp_id, "%s.send-time-ns", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.send-time-ns failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_u32_newf(HAL_OUT, &(timing->send_time_max), comp_id, "%s.send-time-max-ns", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.send-time-max-ns failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_u32_newf(HAL_OUT, &(timing->domain_wc), comp_id, "%s.domain-wc", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.domain-wc failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_u32_newf(HAL_OUT, &(timing->domain_wc_expected), comp_id, "%s.domain-wc-expected", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.domain-wc-expected failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_u32_newf(HAL_OUT, &(timing->domain_wc_state), comp_id, "%s.domain-wc-state", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.domain-wc-state failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_u32_newf(HAL_OUT, &(timing->domain_wc_errors), comp_id, "%s.domain-wc-errors", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.domain-wc-errors failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_s32_newf(HAL_OUT, &(timing->dc_ref_offset), comp_id, "%s.dc-ref-offset-ns", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.dc-ref-offset-ns failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_u32_newf(HAL_OUT, &(timing->dc_sync_error), comp_id, "%s.dc-sync-error-ns", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.dc-sync-error-ns failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_u32_newf(HAL_OUT, &(timing->dc_sync_error_max), comp_id, "%s.dc-sync-error-max-ns", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.dc-sync-error-max-ns failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_bit_newf(HAL_IN, &(timing->reset), comp_id, "%s.timing-reset", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.timing-reset failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_u32_newf(HAL_IN, &(timing->hist_binsize), comp_id, "%s.hist-binsize-ns", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.hist-binsize-ns failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_s32_newf(HAL_IN, &(timing->hist_index), comp_id, "%s.hist-index", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.hist-index failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_s32_newf(HAL_OUT, &(timing->hist_check), comp_id, "%s.hist-check", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.hist-check failed\n", pfx);
+    return NULL;
+  }
+  if (hal_pin_s32_newf(HAL_OUT, &(timing->hist_bins), comp_id, "%s.hist-bins", pfx) != 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.hist-bins failed\n", pfx);
+    return NULL;
+  }
+  for (i=0; i < lcecTimingHistCount; i++) {
+    if (hal_pin_u32_newf(HAL_OUT, &(timing->hist_value[i]), comp_id, "%s.%s", pfx, hist_names[i]) != 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, LCEC_MSG_PFX "exporting pin %s.%s failed\n", pfx, hist_names[i]);
+      return NULL;
+    }
+    *(timing->hist_value[i]) = 0;
+  }
+
+  // initialize pins
+  *(timing->recv_time) = 0;
+  *(timing->recv_time_max) = 0;
+  *(timing->send_time) = 0;
+  *(timing->send_time_max) = 0;
+  *(timing->domain_wc) = 0;
+  *(timing->domain_wc_expected) = 0;
+  *(timing->domain_wc_state) = 0;
+  *(timing->domain_wc_errors) = 0;
+  *(timing->dc_ref_offset) = 0;
+  *(timing->dc_sync_error) = 0;
+  *(timing->dc_sync_error_max) = 0;
+  *(timing->reset) = 0;
+  *(timing->hist_binsize) = LCEC_TIMING_HIST_BINSIZE;
+  *(timing->hist_index) = 0;
+  *(timing->hist_check) = 0;
+  *(timing->hist_bins) = LCEC_TIMING_HIST_BINS;
+
+  return timing;
+}
+
+void lcec_timing_update_read(lcec_timing_t *timing, uint32_t recv_time, ec_domain_state_t *ds, int dc_valid, int32_t dc_ref_offset, uint32_t dc_sync_error) {
+  int i, index;
+
+  // reset statistics
+  if (*(timing->reset)) {
+    lcec_timing_reset(timing);
+  }
+
+  // frame receive/process time
+  *(timing->recv_time) = recv_time;
+  if (recv_time > *(timing->recv_time_max)) {
+    *(timing->recv_time_max) = recv_time;
+  }
+  lcec_timing_hist_add(timing, lcecTimingHistRecv, recv_time);
+
+  // working counter, the expected value is the highest one seen
+  // while the domain was complete
+  *(timing->domain_wc) = ds->working_counter;
+  *(timing->domain_wc_state) = ds->wc_state;
+  if (ds->wc_state == EC_WC_COMPLETE) {
+    if (ds->working_counter > *(timing->domain_wc_expected)) {
+      *(timing->domain_wc_expected) = ds->working_counter;
+    }
+  } else {
+    (*(timing->domain_wc_errors))++;
+  }
+
+  // distributed clocks
+  if (dc_valid) {
+    *(timing->dc_ref_offset) = dc_ref_offset;
+    *(timing->dc_sync_error) = dc_sync_error;
+    if (dc_sync_error > *(timing->dc_sync_error_max)) {
+      *(timing->dc_sync_error_max) = dc_sync_error;
+    }
+    lcec_timing_hist_add(timing, lcecTimingHistDc, dc_sync_error);
+  }
+
+  // histogram read out
+  index = *(timing->hist_index);
+  *(timing->hist_check) = index;
+  for (i=0; i < lcecTimingHistCount; i++) {
+    if (index >= 0 && index < LCEC_TIMING_HIST_BINS) {
+      *(timing->hist_value[i]) = timing->bins[i][index];
+    } else {
+      *(timing->hist_value[i]) = 0;
+    }
+  }
+}
+
+void lcec_timing_update_write(lcec_timing_t *timing, uint32_t send_time) {
+  *(timing->send_time) = send_time;
+  if (send_time > *(timing->send_time_max)) {
+    *(timing->send_time_max) = send_time;
+  }
+  lcec_timing_hist_add(timing, lcecTimingHistSend, send_time);
+}
+
+static void lcec_timing_hist_add(lcec_timing_t *timing, LCEC_TIMING_HIST_T hist, uint32_t value) {
+  uint32_t binsize = *(timing->hist_binsize);
+  uint32_t bin;
+
+  // avoid divide by zero
+  if (binsize == 0) {
+    return;
+  }
+
+  bin = value / binsize;
+  if (bin >= LCEC_TIMING_HIST_BINS) {
+    bin = LCEC_TIMING_HIST_BINS - 1;
+  }
+  timing->bins[hist][bin]++;
+}
+
+static void lcec_timing_reset(lcec_timing_t *timing) {
+  *(timing->recv_time_max) = 0;
+  *(timing->send_time_max) = 0;
+  *(timing->domain_wc_expected) = 0;
+  *(timing->domain_wc_errors) = 0;
+  *(timing->dc_sync_error_max) = 0;
+  memset(timing->bins, 0, sizeof(timing->bins));
+}
+
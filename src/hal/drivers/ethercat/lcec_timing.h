@@ -0,0 +1,63 @@
+//
+//    Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+#ifndef _LCEC_TIMING_H_
+#define _LCEC_TIMING_H_
+
+#include "lcec.h"
+
+// histogram bins per value, the last bin counts all values above
+#define LCEC_TIMING_HIST_BINS 200
+
+// default histogram bin size (ns)
+#define LCEC_TIMING_HIST_BINSIZE 1000
+
+typedef enum {
+  lcecTimingHistRecv,
+  lcecTimingHistSend,
+  lcecTimingHistDc,
+  lcecTimingHistCount
+} LCEC_TIMING_HIST_T;
+
+typedef struct lcec_timing {
+  hal_u32_t *recv_time;
+  hal_u32_t *recv_time_max;
+  hal_u32_t *send_time;
+  hal_u32_t *send_time_max;
+  hal_u32_t *domain_wc;
+  hal_u32_t *domain_wc_expected;
+  hal_u32_t *domain_wc_state;
+  hal_u32_t *domain_wc_errors;
+  hal_s32_t *dc_ref_offset;
+  hal_u32_t *dc_sync_error;
+  hal_u32_t *dc_sync_error_max;
+  hal_bit_t *reset;
+  hal_u32_t *hist_binsize;
+  hal_s32_t *hist_index;
+  hal_s32_t *hist_check;
+  hal_s32_t *hist_bins;
+  hal_u32_t *hist_value[lcecTimingHistCount];
+
+  uint32_t bins[lcecTimingHistCount][LCEC_TIMING_HIST_BINS];
+} lcec_timing_t;
+
+lcec_timing_t *lcec_init_timing_hal(int comp_id, const char *pfx);
+void lcec_timing_update_read(lcec_timing_t *timing, uint32_t recv_time, ec_domain_state_t *ds, int dc_valid, int32_t dc_ref_offset, uint32_t dc_sync_error);
+void lcec_timing_update_write(lcec_timing_t *timing, uint32_t send_time);
+
+#endif
+
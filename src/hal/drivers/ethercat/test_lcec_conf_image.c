@@ -0,0 +1,179 @@
+//
+//    Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// Round trip and corruption checks for the precompiled config image
+// (lcec_conf --compile) and the record stream validation.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "lcec_conf_image.h"
+#include "tests/unittest.h"
+
+#define LAYOUT 0x12345678
+#define SLAVES 50
+#define ENTRIES 16
+
+char *modname = "test_lcec_conf_image";
+
+static void *buf;
+static size_t bufLen;
+static size_t bufPos;
+static void *add(LCEC_CONF_TYPE_T type, size_t len) {
+  LCEC_CONF_NULL_T *p;
+
+  if (bufPos + len > bufLen) {
+    bufLen = bufPos + len + 4096;
+    buf = realloc(buf, bufLen);
+  }
+  p = buf + bufPos;
+  memset(p, 0, len);
+  p->confType = type;
+  bufPos += len;
+  return p;
+}
+
+// 50 generic slaves with one sdo each, similar to a large real config
+static void build(void) {
+  LCEC_CONF_MASTER_T *master;
+  LCEC_CONF_DOMAIN_T *domain;
+  LCEC_CONF_SLAVE_T *slave;
+  LCEC_CONF_SYNCMANAGER_T *sm;
+  LCEC_CONF_PDO_T *pdo;
+  LCEC_CONF_PDOENTRY_T *pe;
+  LCEC_CONF_SDOCONF_T *sdo;
+  int i, j;
+
+  bufPos = 0;
+  master = add(lcecConfTypeMaster, sizeof(LCEC_CONF_MASTER_T));
+  strcpy(master->name, "0");
+  master->appTimePeriod = 1000000;
+  domain = add(lcecConfTypeDomain, sizeof(LCEC_CONF_DOMAIN_T));
+  strcpy(domain->name, "slow");
+  domain->divider = 10;
+
+  for (i = 0; i < SLAVES; i++) {
+    slave = add(lcecConfTypeSlave, sizeof(LCEC_CONF_SLAVE_T));
+    slave->index = i;
+    slave->type = lcecSlaveTypeGeneric;
+    snprintf(slave->name, LCEC_CONF_STR_MAXLEN, "drive%d", i);
+
+    add(lcecConfTypeDcConf, sizeof(LCEC_CONF_DC_T));
+    sdo = add(lcecConfTypeSdoConfig, sizeof(LCEC_CONF_SDOCONF_T) + 3);
+    sdo->index = 0x6060;
+    sdo->length = 3;
+    memcpy(sdo->data, "\x08\x00\x01", 3);
+
+    sm = add(lcecConfTypeSyncManager, sizeof(LCEC_CONF_SYNCMANAGER_T));
+    sm->index = 2;
+    sm->pdoCount = 1;
+    pdo = add(lcecConfTypePdo, sizeof(LCEC_CONF_PDO_T));
+    pdo->index = 0x1600;
+    pdo->pdoEntryCount = ENTRIES;
+    for (j = 0; j < ENTRIES; j++) {
+      pe = add(lcecConfTypePdoEntry, sizeof(LCEC_CONF_PDOENTRY_T));
+      pe->index = 0x6040 + j;
+      pe->bitLength = 16;
+      snprintf(pe->halPin, LCEC_CONF_STR_MAXLEN, "pin-%d", j);
+    }
+  }
+  add(lcecConfTypeNone, sizeof(LCEC_CONF_NULL_T));
+}
+
+static void corrupt(const char *filename, long pos) {
+  FILE *file = fopen(filename, "r+");
+  int c;
+
+  fseek(file, pos, SEEK_SET);
+  c = fgetc(file);
+  fseek(file, pos, SEEK_SET);
+  fputc(c ^ 0x01, file);
+  fclose(file);
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void) {
+  char filename[] = "/tmp/test_lcec_conf_imageXXXXXX";
+  LCEC_CONF_IMAGE_T image;
+  LCEC_CONF_SDOCONF_T *sdo;
+  double t0, t1;
+  int fd;
+
+  fd = mkstemp(filename);
+  if (fd < 0) {
+    printf("unable to create temp file\n");
+    return 1;
+  }
+  close(fd);
+
+  // record stream validation
+  build();
+  CHECK(lcecConfValidate(buf, bufPos) == 0);
+  CHECK(lcecConfValidate(buf, bufPos - sizeof(LCEC_CONF_NULL_T)) != 0);
+  CHECK(lcecConfValidate(buf, bufPos - 1) != 0);
+  add(lcecConfTypeMaster, 4);
+  CHECK(lcecConfValidate(buf, bufPos) != 0);
+  build();
+  ((LCEC_CONF_NULL_T *)buf)->confType = 0x7fff;
+  CHECK(lcecConfValidate(buf, bufPos) != 0);
+  build();
+  sdo = buf + sizeof(LCEC_CONF_MASTER_T) + sizeof(LCEC_CONF_DOMAIN_T) + sizeof(LCEC_CONF_SLAVE_T) + sizeof(LCEC_CONF_DC_T);
+  CHECK(sdo->confType == lcecConfTypeSdoConfig);
+  sdo->length = bufPos;
+  CHECK(lcecConfValidate(buf, bufPos) != 0);
+  CHECK(lcecConfWriteImage(filename, buf, bufPos, LAYOUT, 1, SLAVES) != 0);
+
+  // round trip
+  build();
+  CHECK(lcecConfWriteImage(filename, buf, bufPos, LAYOUT, 1, SLAVES) == 0);
+  CHECK(lcecConfIsImage(filename));
+  t0 = now();
+  CHECK(lcecConfMapImage(filename, LAYOUT, &image) == 0);
+  t1 = now();
+  if (image.map != NULL) {
+    CHECK(image.length == bufPos && memcmp(image.data, buf, bufPos) == 0);
+    CHECK(image.header->masterCount == 1 && image.header->slaveCount == SLAVES);
+    lcecConfUnmapImage(&image);
+  }
+
+  // rejected images
+  CHECK(lcecConfMapImage(filename, LAYOUT + 1, &image) != 0 && image.map == NULL);
+  corrupt(filename, sizeof(LCEC_CONF_IMAGE_HEADER_T) + bufPos / 2);
+  CHECK(lcecConfMapImage(filename, LAYOUT, &image) != 0);
+  CHECK(lcecConfWriteImage(filename, buf, bufPos, LAYOUT, 1, SLAVES) == 0);
+  CHECK(truncate(filename, sizeof(LCEC_CONF_IMAGE_HEADER_T) + bufPos - 1) == 0);
+  CHECK(lcecConfMapImage(filename, LAYOUT, &image) != 0);
+  CHECK(truncate(filename, 2) == 0);
+  CHECK(!lcecConfIsImage(filename));
+  CHECK(lcecConfMapImage(filename, LAYOUT, &image) != 0);
+
+  unlink(filename);
+  free(buf);
+
+  printf("%d slaves, %lu bytes, map+verify=%.1fus, %s\n", SLAVES, (unsigned long) bufPos, (t1-t0)*1e6, CHECK_RESULT);
+  return CHECK_EXIT;
+}
+
@@ -0,0 +1,264 @@
+//
+//    Copyright (C) 2012 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// Offline checks for the ESI importer: index build, lookup and PDO table
+// extraction on small sample ESI files, plus timing on a generated
+// multi-MB vendor library.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "lcec_esi.h"
+#include "tests/unittest.h"
+
+#define LIB_DEVICES 4000
+
+char *modname = "test_lcec_esi";
+
+// terminal in ISO-8859-1 with two revisions, one optional pdo
+static const char *sampleTerminal =
+  "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n"
+  "<EtherCATInfo xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">\n"
+  "  <Vendor><Id>#x00000002</Id><Name>Beckhoff Automation GmbH &amp; Co. KG</Name></Vendor>\n"
+  "  <Descriptions>\n"
+  "    <Groups><Group><Type>EL5xxx</Type><Name>Messkl\xe4mmen</Name></Group></Groups>\n"
+  "    <Devices>\n"
+  "      <Device Physics=\"YY\">\n"
+  "        <Type ProductCode=\"#x13ef3052\" RevisionNo=\"#x00100000\">EL5103</Type>\n"
+  "        <Name LcId=\"1031\">Z\xe4hler (alt)</Name>\n"
+  "        <Sm ControlByte=\"#x26\" Enable=\"1\">MBoxOut</Sm>\n"
+  "        <Sm ControlByte=\"#x22\" Enable=\"1\">MBoxIn</Sm>\n"
+  "        <Sm ControlByte=\"#x24\" Enable=\"1\">Outputs</Sm>\n"
+  "        <Sm ControlByte=\"#x20\" Enable=\"1\">Inputs</Sm>\n"
+  "        <TxPdo Fixed=\"1\" Sm=\"3\"><Index>#x1a00</Index><Name>ENC Status</Name>\n"
+  "          <Entry><Index>#x6000</Index><SubIndex>1</SubIndex><BitLen>16</BitLen><Name>Counter value</Name><DataType>UINT</DataType></Entry>\n"
+  "        </TxPdo>\n"
+  "      </Device>\n"
+  "      <Device Physics=\"YY\">\n"
+  "        <Type ProductCode=\"#x13ef3052\" RevisionNo=\"#x00110000\">EL5103</Type>\n"
+  "        <Name LcId=\"1031\">Z\xe4hler</Name>\n"
+  "        <Sm ControlByte=\"#x26\" Enable=\"1\">MBoxOut</Sm>\n"
+  "        <Sm ControlByte=\"#x22\" Enable=\"1\">MBoxIn</Sm>\n"
+  "        <Sm ControlByte=\"#x24\" Enable=\"1\">Outputs</Sm>\n"
+  "        <Sm ControlByte=\"#x20\" Enable=\"1\">Inputs</Sm>\n"
+  "        <RxPdo Fixed=\"1\" Sm=\"2\"><Index>#x1600</Index><Name>ENC Control</Name>\n"
+  "          <Entry><Index>#x7000</Index><SubIndex>1</SubIndex><BitLen>1</BitLen><Name>Control__Enable latch C</Name><DataType>BOOL</DataType></Entry>\n"
+  "          <Entry><Index>#x0</Index><BitLen>15</BitLen></Entry>\n"
+  "          <Entry><Index>#x7000</Index><SubIndex>#x11</SubIndex><BitLen>32</BitLen><Name>Set counter value</Name><DataType>UDINT</DataType></Entry>\n"
+  "        </RxPdo>\n"
+  "        <TxPdo Fixed=\"1\" Sm=\"3\"><Index>#x1a00</Index><Name>ENC Status</Name>\n"
+  "          <Entry><Index>#x6000</Index><SubIndex>1</SubIndex><BitLen>1</BitLen><Name>Status__Latch C valid</Name><DataType>BOOL</DataType></Entry>\n"
+  "          <Entry><Index>#x0</Index><BitLen>15</BitLen></Entry>\n"
+  "          <Entry><Index>#x6000</Index><SubIndex>#x11</SubIndex><BitLen>32</BitLen><Name>Counter value</Name><DataType>DINT</DataType></Entry>\n"
+  "        </TxPdo>\n"
+  "        <TxPdo Sm=\"3\"><Index>#x1a01</Index><Name>ENC Status ch 2</Name>\n"
+  "          <Entry><Index>#x6010</Index><SubIndex>#x11</SubIndex><BitLen>32</BitLen><Name>Counter value</Name><DataType>DINT</DataType></Entry>\n"
+  "        </TxPdo>\n"
+  "        <TxPdo><Index>#x1a02</Index><Name>ENC Period (optional)</Name>\n"
+  "          <Entry><Index>#x6000</Index><SubIndex>#x14</SubIndex><BitLen>32</BitLen><Name>Period value</Name><DataType>UDINT</DataType></Entry>\n"
+  "        </TxPdo>\n"
+  "      </Device>\n"
+  "    </Devices>\n"
+  "  </Descriptions>\n"
+  "</EtherCATInfo>\n";
+
+// CiA402 drive, UTF-8, decimal vendor id, 64, 24 and 4 bit entries
+static const char *sampleDrive =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+  "<EtherCATInfo>\n"
+  "  <Vendor><Id>36</Id><Name>Drive Vendor</Name></Vendor>\n"
+  "  <Descriptions><Devices>\n"
+  "    <Device>\n"
+  "      <Type ProductCode=\"#x00242804\" RevisionNo=\"#x2\">Servo \xc2\xb5" "Drive</Type>\n"
+  "      <Sm>MBoxOut</Sm><Sm>MBoxIn</Sm><Sm/><Sm/>\n"
+  "      <RxPdo Sm=\"2\"><Index>#x1600</Index><Name>Outputs</Name>\n"
+  "        <Entry><Index>#x6040</Index><SubIndex>0</SubIndex><BitLen>16</BitLen><Name>Controlword</Name><DataType>UINT</DataType></Entry>\n"
+  "        <Entry><Index>#x607a</Index><SubIndex>0</SubIndex><BitLen>32</BitLen><Name>Target position</Name><DataType>DINT</DataType></Entry>\n"
+  "      </RxPdo>\n"
+  "      <TxPdo Sm=\"3\"><Index>#x1a00</Index><Name>Inputs</Name>\n"
+  "        <Entry><Index>#x6041</Index><SubIndex>0</SubIndex><BitLen>16</BitLen><Name>Statusword</Name><DataType>UINT</DataType></Entry>\n"
+  "        <Entry><Index>#x6064</Index><SubIndex>0</SubIndex><BitLen>64</BitLen><Name>Position actual (64 bit)</Name><DataType>LINT</DataType></Entry>\n"
+  "        <Entry><Index>#x2010</Index><SubIndex>1</SubIndex><BitLen>24</BitLen><Name>Analog raw</Name><DataType>INT24</DataType></Entry>\n"
+  "        <Entry><Index>#x2010</Index><SubIndex>2</SubIndex><BitLen>4</BitLen><Name>Range</Name><DataType>BIT4</DataType></Entry>\n"
+  "      </TxPdo>\n"
+  "    </Device>\n"
+  "  </Devices></Descriptions>\n"
+  "</EtherCATInfo>\n";
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void writeFile(const char *name, const char *data) {
+  FILE *file = fopen(name, "w");
+  fputs(data, file);
+  fclose(file);
+}
+
+// vendor library with many devices of 32 entries each
+static long writeLibrary(const char *name) {
+  FILE *file = fopen(name, "w");
+  long size;
+  int i, j;
+
+  fprintf(file, "<?xml version=\"1.0\"?>\n<EtherCATInfo><Vendor><Id>#x00000099</Id></Vendor><Descriptions><Devices>\n");
+  for (i = 0; i < LIB_DEVICES; i++) {
+    fprintf(file, "<Device><Type ProductCode=\"#x%08x\" RevisionNo=\"#x1\">DEV%d</Type><Name>Device %d</Name>\n", i * 7, i, i);
+    fprintf(file, "<Sm>MBoxOut</Sm><Sm>MBoxIn</Sm><Sm>Outputs</Sm><Sm>Inputs</Sm>\n<TxPdo Sm=\"3\"><Index>#x1a00</Index><Name>Inputs</Name>\n");
+    for (j = 0; j < 32; j++) {
+      fprintf(file, "<Entry><Index>#x%04x</Index><SubIndex>%d</SubIndex><BitLen>16</BitLen><Name>Input value %d</Name><DataType>INT</DataType></Entry>\n", 0x6000 + j, j + 1, j);
+    }
+    fprintf(file, "</TxPdo></Device>\n");
+  }
+  fprintf(file, "</Devices></Descriptions></EtherCATInfo>\n");
+  size = ftell(file);
+  fclose(file);
+  return size;
+}
+
+int main(void) {
+  char dir[] = "/tmp/test_lcec_esiXXXXXX";
+  char terminal[64], drive[64], library[64], indexFile[64], output[64];
+  char *files[3];
+  LCEC_ESI_INDEX_T index;
+  const LCEC_ESI_INDEX_ENTRY_T *entry;
+  LCEC_ESI_DEVICE_T *device;
+  FILE *out;
+  char *xml;
+  long libSize, xmlLen;
+  double t0, t1, t2;
+  int i;
+
+  if (mkdtemp(dir) == NULL) {
+    printf("unable to create temp dir\n");
+    return 1;
+  }
+  snprintf(terminal, sizeof(terminal), "%s/terminal.xml", dir);
+  snprintf(drive, sizeof(drive), "%s/drive.xml", dir);
+  snprintf(library, sizeof(library), "%s/library.xml", dir);
+  snprintf(indexFile, sizeof(indexFile), "%s/esi.idx", dir);
+  snprintf(output, sizeof(output), "%s/slave.xml", dir);
+  writeFile(terminal, sampleTerminal);
+  writeFile(drive, sampleDrive);
+  device = malloc(sizeof(LCEC_ESI_DEVICE_T));
+
+  // index and lookup
+  files[0] = terminal;
+  files[1] = drive;
+  CHECK(lcecEsiBuildIndex(indexFile, 2, files) == 3);
+  CHECK(lcecEsiOpenIndex(indexFile, &index) == 0);
+  entry = lcecEsiLookup(&index, 0x2, 0x13ef3052, LCEC_ESI_ANY_REVISION);
+  CHECK(entry != NULL && entry->revision == 0x00110000 && strcmp(entry->type, "EL5103") == 0);
+  entry = lcecEsiLookup(&index, 0x2, 0x13ef3052, 0x00100000);
+  CHECK(entry != NULL && entry->revision == 0x00100000);
+  CHECK(lcecEsiLookup(&index, 0x2, 0x13ef3052, 0x00120000) == NULL);
+  CHECK(lcecEsiLookup(&index, 0x2, 0x13ef3053, LCEC_ESI_ANY_REVISION) == NULL);
+  CHECK(lcecEsiLookup(&index, 0x24, 0x00242804, LCEC_ESI_ANY_REVISION) != NULL);
+
+  // latin-1 terminal: default assigned pdos only, gaps kept
+  entry = lcecEsiLookup(&index, 0x2, 0x13ef3052, LCEC_ESI_ANY_REVISION);
+  CHECK(entry != NULL && lcecEsiReadDevice(&index, entry, device) == 0);
+  CHECK(device->smCount == 4 && device->smDir[2] == EC_DIR_OUTPUT && device->smDir[3] == EC_DIR_INPUT);
+  CHECK(device->pdoCount == 3);
+  CHECK(device->pdos[0].index == 0x1600 && device->pdos[0].sm == 2 && device->pdos[0].entryCount == 3);
+  CHECK(device->pdos[1].index == 0x1a00 && device->pdos[1].sm == 3 && device->pdos[1].entryCount == 3);
+  CHECK(device->entries[1].index == 0 && device->entries[1].bitLength == 15);
+  CHECK(device->entries[2].index == 0x7000 && device->entries[2].subindex == 0x11 && device->entries[2].bitLength == 32);
+
+  // drive: sync manager direction from pdos, odd widths without pin
+  entry = lcecEsiLookup(&index, 36, 0x00242804, LCEC_ESI_ANY_REVISION);
+  CHECK(entry != NULL && lcecEsiReadDevice(&index, entry, device) == 0);
+  CHECK(device->smDir[2] == EC_DIR_OUTPUT && device->smDir[3] == EC_DIR_INPUT);
+  CHECK(device->entryCount == 6 && device->entries[3].bitLength == 64);
+
+  // generated config
+  out = fopen(output, "w+");
+  lcecEsiWriteSlave(out, device, 5, "x");
+  xmlLen = ftell(out);
+  xml = calloc(1, xmlLen + 1);
+  rewind(out);
+  CHECK(fread(xml, 1, xmlLen, out) == xmlLen);
+  fclose(out);
+  CHECK(strstr(xml, "<slave idx=\"5\" type=\"generic\" vid=\"00000024\" pid=\"00242804\" configPdos=\"true\" name=\"x\">") != NULL);
+  CHECK(strstr(xml, "<syncManager idx=\"2\" dir=\"out\">") != NULL);
+  CHECK(strstr(xml, "<pdoEntry idx=\"607a\" subIdx=\"00\" bitLen=\"32\" halPin=\"target-position\" halType=\"s32\"/>") != NULL);
+  CHECK(strstr(xml, "<pdoEntry idx=\"6064\" subIdx=\"00\" bitLen=\"64\"/>") != NULL);
+  CHECK(strstr(xml, "<pdoEntry idx=\"2010\" subIdx=\"01\" bitLen=\"24\"/>") != NULL);
+  CHECK(strstr(xml, "<pdoEntry idx=\"2010\" subIdx=\"02\" bitLen=\"4\"/>") != NULL);
+  CHECK(strstr(xml, "<syncManager idx=\"0\"") == NULL && strstr(xml, "<syncManager idx=\"1\"") == NULL);
+  free(xml);
+
+  // duplicate names in channels get a suffix
+  entry = lcecEsiLookup(&index, 0x2, 0x13ef3052, LCEC_ESI_ANY_REVISION);
+  CHECK(entry != NULL && lcecEsiReadDevice(&index, entry, device) == 0);
+  out = fopen(output, "w+");
+  lcecEsiWriteSlave(out, device, 1, NULL);
+  xmlLen = ftell(out);
+  xml = calloc(1, xmlLen + 1);
+  rewind(out);
+  CHECK(fread(xml, 1, xmlLen, out) == xmlLen);
+  fclose(out);
+  CHECK(strstr(xml, "halPin=\"counter-value\" halType=\"s32\"") != NULL && strstr(xml, "halPin=\"counter-value-1\" halType=\"s32\"") != NULL);
+  CHECK(strstr(xml, "halPin=\"control-enable-latch\" halType=\"bit\"") != NULL);
+  free(xml);
+  lcecEsiCloseIndex(&index);
+
+  // stale index is detected
+  writeFile(terminal, sampleDrive);
+  CHECK(lcecEsiOpenIndex(indexFile, &index) == 0);
+  entry = lcecEsiLookup(&index, 0x2, 0x13ef3052, LCEC_ESI_ANY_REVISION);
+  CHECK(entry != NULL && lcecEsiReadDevice(&index, entry, device) != 0);
+  lcecEsiCloseIndex(&index);
+
+  // large library
+  libSize = writeLibrary(library);
+  files[0] = library;
+  t0 = now();
+  CHECK(lcecEsiBuildIndex(indexFile, 1, files) == LIB_DEVICES);
+  t1 = now();
+  CHECK(lcecEsiOpenIndex(indexFile, &index) == 0);
+  for (i = 0; i < 1000; i++) {
+    entry = lcecEsiLookup(&index, 0x99, ((i * 13) % LIB_DEVICES) * 7, LCEC_ESI_ANY_REVISION);
+    if (entry == NULL || entry->pid != ((i * 13) % LIB_DEVICES) * 7) {
+      CHECK(entry != NULL && entry->pid == ((i * 13) % LIB_DEVICES) * 7);
+      break;
+    }
+  }
+  entry = lcecEsiLookup(&index, 0x99, (LIB_DEVICES - 1) * 7, LCEC_ESI_ANY_REVISION);
+  CHECK(entry != NULL && lcecEsiReadDevice(&index, entry, device) == 0 && device->entryCount == 32);
+  t2 = now();
+  lcecEsiCloseIndex(&index);
+
+  unlink(terminal);
+  unlink(drive);
+  unlink(library);
+  unlink(indexFile);
+  unlink(output);
+  rmdir(dir);
+  free(device);
+
+  printf("library %.1fMB, %d devices: index=%.0fms, 1000 lookups+read=%.2fms, %s\n",
+    libSize / 1e6, LIB_DEVICES, (t1-t0)*1e3, (t2-t1)*1e3, CHECK_RESULT);
+  return CHECK_EXIT;
+}
+
@@ -0,0 +1,352 @@
+//
+//    Copyright (C) 2011 Sascha Ittner <sascha.ittner@modusoft.de>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// Checks the generic slave copy plan against the per-cycle type/length
+// dispatch it replaced and times both on a 64 entry CiA402 style slave.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lcec_generic.h"
+#include "tests/unittest.h"
+
+#define PD_SIZE 512
+#define ENTRY_COUNT 64
+#define N (1000000)
+
+typedef struct {
+  hal_type_t type;
+  hal_pin_dir_t dir;
+  int len;
+} entry_t;
+
+// one drive: 16 rx/tx entries each, repeated for 2 axes
+static const entry_t layout[ENTRY_COUNT / 2] = {
+  // rx pdos (HAL_IN)
+  { HAL_U32, HAL_IN, 16 },         // controlword
+  { HAL_S32, HAL_IN, 8 },          // modes of operation
+  { HAL_S32, HAL_IN, 32 },         // target position
+  { HAL_S32, HAL_IN, 32 },         // target velocity
+  { HAL_S32, HAL_IN, 16 },         // target torque
+  { HAL_U32, HAL_IN, 16 },         // max torque
+  { HAL_SPECIAL_U32, HAL_IN, 32 }, // position offset
+  { HAL_BIT, HAL_IN, 1 },          // digital outputs
+  { HAL_BIT, HAL_IN, 1 },
+  { HAL_BIT, HAL_IN, 1 },
+  { HAL_BIT, HAL_IN, 5 },
+  { HAL_U32, HAL_IN, 8 },
+  { HAL_U32, HAL_IN, 32 },
+  { HAL_S32, HAL_IN, 16 },
+  { HAL_BIT, HAL_IN, 16 },
+  { HAL_U32, HAL_IN, 16 },
+  // tx pdos (HAL_OUT)
+  { HAL_BIT, HAL_OUT, 16 },          // statusword bits
+  { HAL_S32, HAL_OUT, 8 },           // modes of operation display
+  { HAL_S32, HAL_OUT, 32 },          // position actual
+  { HAL_S32, HAL_OUT, 32 },          // velocity actual
+  { HAL_S32, HAL_OUT, 16 },          // torque actual
+  { HAL_SPECIAL_U32, HAL_OUT, 32 },  // position actual scaled
+  { HAL_SPECIAL_U32, HAL_OUT, 16 },  // current actual scaled
+  { HAL_U32, HAL_OUT, 16 },          // error code
+  { HAL_BIT, HAL_OUT, 1 },           // digital inputs
+  { HAL_BIT, HAL_OUT, 1 },
+  { HAL_BIT, HAL_OUT, 6 },
+  { HAL_U32, HAL_OUT, 32 },
+  { HAL_U32, HAL_OUT, 8 },
+  { HAL_S32, HAL_OUT, 32 },
+  { HAL_BIT, HAL_OUT, 32 },
+  { HAL_U32, HAL_OUT, 16 }
+};
+
+static lcec_generic_pin_t pins[ENTRY_COUNT];
+static uint8_t pd_ref[PD_SIZE];
+static uint8_t pd_plan[PD_SIZE];
+
+// per-cycle dispatch as done by lcec_generic_read before the copy plan
+static void legacy_read(lcec_generic_pin_t *hal_data, int count, uint8_t *pd) {
+  int i, j, offset;
+
+  for (i=0; i < count; i++, hal_data++) {
+    if (hal_data->dir != HAL_OUT || hal_data->pin[0] == NULL) {
+      continue;
+    }
+
+    switch (hal_data->type) {
+      case HAL_BIT:
+        offset = hal_data->pdo_os << 3 | (hal_data->pdo_bp & 0x07);
+        for (j=0; j < LCEC_GENERIC_MAX_SUBPINS && hal_data->pin[j] != NULL; j++, offset++) {
+          *((hal_bit_t *) hal_data->pin[j]) = EC_READ_BIT(&pd[offset >> 3], offset & 0x07);
+        }
+        break;
+      case HAL_S32:
+        switch (hal_data->pdo_len) {
+          case 8: *((hal_s32_t *) hal_data->pin[0]) = EC_READ_S8(&pd[hal_data->pdo_os]); break;
+          case 16: *((hal_s32_t *) hal_data->pin[0]) = EC_READ_S16(&pd[hal_data->pdo_os]); break;
+          case 32: *((hal_s32_t *) hal_data->pin[0]) = EC_READ_S32(&pd[hal_data->pdo_os]); break;
+        }
+        break;
+      case HAL_U32:
+        switch (hal_data->pdo_len) {
+          case 8: *((hal_u32_t *) hal_data->pin[0]) = EC_READ_U8(&pd[hal_data->pdo_os]); break;
+          case 16: *((hal_u32_t *) hal_data->pin[0]) = EC_READ_U16(&pd[hal_data->pdo_os]); break;
+          case 32: *((hal_u32_t *) hal_data->pin[0]) = EC_READ_U32(&pd[hal_data->pdo_os]); break;
+        }
+        break;
+      case HAL_SPECIAL_U32:
+        switch (hal_data->pdo_len) {
+          case 16: *((hal_float_t *) hal_data->pin[0]) = ((double) EC_READ_S16(&pd[hal_data->pdo_os])) / hal_data->scale; break;
+          case 32: *((hal_float_t *) hal_data->pin[0]) = ((double) EC_READ_S32(&pd[hal_data->pdo_os])) / hal_data->scale; break;
+        }
+        break;
+      default:
+        continue;
+    }
+  }
+}
+
+// per-cycle dispatch as done by lcec_generic_write before the copy plan
+static void legacy_write(lcec_generic_pin_t *hal_data, int count, uint8_t *pd) {
+  int i, j, offset;
+  hal_u32_t uval;
+  hal_s32_t sval;
+
+  for (i=0; i < count; i++, hal_data++) {
+    if (hal_data->dir != HAL_IN || hal_data->pin[0] == NULL) {
+      continue;
+    }
+
+    switch (hal_data->type) {
+      case HAL_BIT:
+        offset = hal_data->pdo_os << 3 | (hal_data->pdo_bp & 0x07);
+        for (j=0; j < LCEC_GENERIC_MAX_SUBPINS && hal_data->pin[j] != NULL; j++, offset++) {
+          EC_WRITE_BIT(&pd[offset >> 3], offset & 0x07, *((hal_bit_t *) hal_data->pin[j]));
+        }
+        break;
+      case HAL_S32:
+        sval = *((hal_s32_t *) hal_data->pin[0]);
+        switch (hal_data->pdo_len) {
+          case 8:
+            if (sval > 0x7f) sval = 0x7f;
+            if (sval < -0x80) sval = -0x80;
+            EC_WRITE_S8(&pd[hal_data->pdo_os], sval);
+            break;
+          case 16:
+            if (sval > 0x7fff) sval = 0x7fff;
+            if (sval < -0x8000) sval = -0x8000;
+            EC_WRITE_S16(&pd[hal_data->pdo_os], sval);
+            break;
+          case 32:
+            EC_WRITE_S32(&pd[hal_data->pdo_os], sval);
+            break;
+        }
+        break;
+      case HAL_U32:
+        uval = *((hal_u32_t *) hal_data->pin[0]);
+        switch (hal_data->pdo_len) {
+          case 8:
+            if (uval > 0xff) uval = 0xff;
+            EC_WRITE_U8(&pd[hal_data->pdo_os], uval);
+            break;
+          case 16:
+            if (uval > 0xffff) uval = 0xffff;
+            EC_WRITE_U16(&pd[hal_data->pdo_os], uval);
+            break;
+          case 32:
+            EC_WRITE_U32(&pd[hal_data->pdo_os], uval);
+            break;
+        }
+        break;
+      case HAL_SPECIAL_U32:
+        EC_WRITE_S32(&pd[hal_data->pdo_os], (hal_s32_t) (*((hal_float_t *) hal_data->pin[0]) * hal_data->scale));
+        break;
+      default:
+        continue;
+    }
+  }
+}
+
+static void *new_pin(hal_type_t type) {
+  switch (type) {
+    case HAL_BIT:
+      return calloc(1, sizeof(hal_bit_t));
+    case HAL_SPECIAL_U32:
+      return calloc(1, sizeof(real_t));
+    default:
+      return calloc(1, sizeof(hal_u32_t));
+  }
+}
+
+static void setup_pins(void) {
+  lcec_generic_pin_t *pin;
+  unsigned int bitpos = 0;
+  int i, j;
+
+  for (i=0, pin = pins; i < ENTRY_COUNT; i++, pin++) {
+    const entry_t *e = &layout[i % (ENTRY_COUNT / 2)];
+
+    snprintf(pin->name, LCEC_CONF_STR_MAXLEN, "pin-%d", i);
+    pin->type = e->type;
+    pin->dir = e->dir;
+    pin->pdo_len = e->len;
+    pin->scale = 1000.0;
+
+    // byte align non bit entries like the domain does for full bytes
+    if (e->type != HAL_BIT) {
+      bitpos = (bitpos + 7) & ~7;
+    }
+    pin->pdo_os = bitpos >> 3;
+    pin->pdo_bp = bitpos & 0x07;
+    bitpos += e->len;
+
+    for (j=0; j < (e->type == HAL_BIT ? e->len : 1); j++) {
+      pin->pin[j] = new_pin(e->type);
+    }
+  }
+}
+
+static void randomize_pd(void) {
+  int i;
+  for (i=0; i < PD_SIZE; i++) {
+    pd_ref[i] = rand();
+  }
+  memcpy(pd_plan, pd_ref, PD_SIZE);
+}
+
+static void randomize_inputs(void) {
+  lcec_generic_pin_t *pin;
+  int i, j;
+
+  for (i=0, pin = pins; i < ENTRY_COUNT; i++, pin++) {
+    if (pin->dir != HAL_IN) {
+      continue;
+    }
+    for (j=0; j < LCEC_GENERIC_MAX_SUBPINS && pin->pin[j] != NULL; j++) {
+      switch (pin->type) {
+        case HAL_BIT:
+          *((hal_bit_t *) pin->pin[j]) = rand() & 1;
+          break;
+        case HAL_S32:
+          *((hal_s32_t *) pin->pin[j]) = rand() - RAND_MAX / 2;
+          break;
+        case HAL_U32:
+          *((hal_u32_t *) pin->pin[j]) = rand();
+          break;
+        case HAL_SPECIAL_U32:
+          *((hal_float_t *) pin->pin[j]) = (rand() % 2000000) / 1000.0;
+          break;
+        default:
+          break;
+      }
+    }
+  }
+}
+
+// store output pin values of one pass, to compare it with another pass
+static int snapshot(double *buf) {
+  lcec_generic_pin_t *pin;
+  int i, j, n = 0;
+
+  for (i=0, pin = pins; i < ENTRY_COUNT; i++, pin++) {
+    if (pin->dir != HAL_OUT) {
+      continue;
+    }
+    for (j=0; j < LCEC_GENERIC_MAX_SUBPINS && pin->pin[j] != NULL; j++) {
+      switch (pin->type) {
+        case HAL_BIT: buf[n++] = *((hal_bit_t *) pin->pin[j]); break;
+        case HAL_S32: buf[n++] = *((hal_s32_t *) pin->pin[j]); break;
+        case HAL_U32: buf[n++] = *((hal_u32_t *) pin->pin[j]); break;
+        case HAL_SPECIAL_U32: buf[n++] = *((hal_float_t *) pin->pin[j]); break;
+        default: break;
+      }
+    }
+  }
+
+  return n;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void) {
+  lcec_generic_plan_t *plan;
+  double ref[ENTRY_COUNT * LCEC_GENERIC_MAX_SUBPINS];
+  double res[ENTRY_COUNT * LCEC_GENERIC_MAX_SUBPINS];
+  double t0, t1;
+  int i, n, val_count;
+
+  setup_pins();
+  val_count = lcec_generic_plan_count(pins, ENTRY_COUNT);
+  plan = lcec_generic_plan_build(malloc(lcec_generic_plan_size(val_count)), val_count, pins, ENTRY_COUNT);
+
+  // compare results
+  for (i=0; i < 100; i++) {
+    randomize_pd();
+    legacy_read(pins, ENTRY_COUNT, pd_ref);
+    n = snapshot(ref);
+    lcec_generic_plan_read(plan, pd_plan);
+    snapshot(res);
+    CHECK(memcmp(ref, res, n * sizeof(double)) == 0);
+    if (check_fails) {
+      break;
+    }
+
+    randomize_inputs();
+    legacy_write(pins, ENTRY_COUNT, pd_ref);
+    lcec_generic_plan_write(plan, pd_plan);
+    CHECK(memcmp(pd_ref, pd_plan, PD_SIZE) == 0);
+    if (check_fails) {
+      break;
+    }
+  }
+
+  // timing
+  t0 = now();
+  for (i=0; i < N; i++) {
+    legacy_read(pins, ENTRY_COUNT, pd_ref);
+  }
+  t1 = now();
+  printf("read  dispatch=%.1fns/cycle", (t1-t0)*1e9/N);
+  t0 = now();
+  for (i=0; i < N; i++) {
+    lcec_generic_plan_read(plan, pd_plan);
+  }
+  t1 = now();
+  printf(" plan=%.1fns/cycle\n", (t1-t0)*1e9/N);
+
+  t0 = now();
+  for (i=0; i < N; i++) {
+    legacy_write(pins, ENTRY_COUNT, pd_ref);
+  }
+  t1 = now();
+  printf("write dispatch=%.1fns/cycle", (t1-t0)*1e9/N);
+  t0 = now();
+  for (i=0; i < N; i++) {
+    lcec_generic_plan_write(plan, pd_plan);
+  }
+  t1 = now();
+  printf(" plan=%.1fns/cycle\n", (t1-t0)*1e9/N);
+
+  printf("%d entries, %d plan values, %s\n", ENTRY_COUNT, val_count, CHECK_RESULT);
+  return CHECK_EXIT;
+}
+
@@ -121,7 +121,7 @@ static void hm2_encoder_read_control_register(hostmot2_t *hm2) {
         hm2_encoder_instance_t *e = &hm2->encoder.instance[i];
         int state = (hm2->encoder.read_control_reg[i] & HM2_ENCODER_CONTROL_MASK) & HM2_ENCODER_QUADRATURE_ERROR;
         if ((*e->hal.pin.quadrature_error == 0) && state) {
-            HM2_ERR("Encoder %d: quadrature count error", i);
+            HM2_ERR_RT("Encoder %d: quadrature count error", i);
         }
         *e->hal.pin.quadrature_error = (hal_bit_t) state;
     }
@@ -735,7 +735,7 @@ static void hm2_encoder_instance_process_tram_read(hostmot2_t *hm2, int instance
 
     // sanity check
     if (e->hal.param.scale == 0.0) {
-        HM2_ERR("encoder.%02d.scale == 0.0, bogus, setting to 1.0\n", instance);
+        HM2_ERR_RT("encoder.%02d.scale == 0.0, bogus, setting to 1.0\n", instance);
         e->hal.param.scale = 1.0;
     }
 
@@ -829,10 +829,10 @@ static void hm2_encoder_instance_process_tram_read(hostmot2_t *hm2, int instance
                 //   sometimes makes encoder.velocity NaN.  Observed by
                 //   micges, but never reproduced.
                 if (dT_clocks < 1) {
-                    HM2_PRINT("(%s:%d) uh-oh, encoder vel is broken when slow\n", __FILE__, __LINE__);
-                    HM2_PRINT("    please email a bug report to the linuxcnc-devel list!\n");
-                    HM2_PRINT("    dS_counts=%d, dT_clocks=%d\n", dS_counts, dT_clocks);
-                    HM2_PRINT("    prev_update_dS_counts=%d, prev_update_dT_clocks=%d\n", prev_update_dS_counts, prev_update_dT_clocks);
+                    HM2_ERR_RT("(%s:%d) uh-oh, encoder vel is broken when slow\n", __FILE__, __LINE__);
+                    HM2_ERR_RT("    please email a bug report to the linuxcnc-devel list!\n");
+                    HM2_ERR_RT("    dS_counts=%d, dT_clocks=%d\n", dS_counts, dT_clocks);
+                    HM2_ERR_RT("    prev_update_dS_counts=%d, prev_update_dT_clocks=%d\n", prev_update_dS_counts, prev_update_dT_clocks);
                 } else {
                     // we know the encoder velocity is not faster than this
                     vel = dS_pos_units / dT_s;
@@ -890,10 +890,10 @@ static void hm2_encoder_instance_process_tram_read(hostmot2_t *hm2, int instance
                     //   sometimes makes encoder.velocity NaN.  Observed by
                     //   micges, but never reproduced.
                     if (dT_clocks < 1) {
-                        HM2_PRINT("(%s:%d) uh-oh, encoder vel is broken with an edge\n", __FILE__, __LINE__);
-                        HM2_PRINT("    please email a bug report to the linuxcnc-devel list!\n");
-                        HM2_PRINT("    dS_counts=%d, dT_clocks=%d\n", dS_counts, dT_clocks);
-                        HM2_PRINT("    prev_update_dS_counts=%d, prev_update_dT_clocks=%d\n", prev_update_dS_counts, prev_update_dT_clocks);
+                        HM2_ERR_RT("(%s:%d) uh-oh, encoder vel is broken with an edge\n", __FILE__, __LINE__);
+                        HM2_ERR_RT("    please email a bug report to the linuxcnc-devel list!\n");
+                        HM2_ERR_RT("    dS_counts=%d, dT_clocks=%d\n", dS_counts, dT_clocks);
+                        HM2_ERR_RT("    prev_update_dS_counts=%d, prev_update_dT_clocks=%d\n", prev_update_dS_counts, prev_update_dT_clocks);
                     } else {
                         // finally time to do Relative-Time Velocity Estimation
                         *e->hal.pin.velocity = dS_pos_units / dT_s;
@@ -67,6 +67,14 @@ char **argv_split(gfp_t gfp, const char *str, int *argcp);
 #define HM2_INFO(fmt, args...)   rtapi_print_msg(RTAPI_MSG_INFO, HM2_NAME "/%s: " fmt, hm2->llio->name, ## args)
 #define HM2_DBG(fmt, args...)    rtapi_print_msg(RTAPI_MSG_DBG,  HM2_NAME "/%s: " fmt, hm2->llio->name, ## args)
 
+//
+// HM2_ERR_RT() is for the realtime read and write functions: it uses
+// rtapi_log(), which is rate limited per call site and leaves the
+// formatting to 'halcmd log'
+//
+
+#define HM2_ERR_RT(fmt, args...) rtapi_log(RTAPI_MSG_ERR, HM2_NAME "/%s: " fmt, hm2->llio->name, ## args)
+
 
 
 
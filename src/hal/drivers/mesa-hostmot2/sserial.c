@@ -1112,14 +1112,14 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                 if (*inst->fault_count > inst->fault_lim) {
                     // If there have been a large percentage of misses, for quite
                     // a long time, it's time to take it seriously. 
-                    HM2_ERR("Smart Serial Comms Error: "
+                    HM2_ERR_RT("Smart Serial Comms Error: "
                             "There have been more than %i errors in %i "
                             "thread executions at least %i times. "
                             "See other error messages for details.\n",
                             inst->fault_dec, 
                             inst->fault_inc,
                             inst->fault_lim);
-                    HM2_ERR("***Smart Serial Port %i will be stopped***\n",i); 
+                    HM2_ERR_RT("***Smart Serial Port %i will be stopped***\n",i); 
                     *inst->state = 0x20;
                     *inst->command_reg_write = 0x800; // stop command
                     break;
@@ -1127,7 +1127,7 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                 if (*inst->command_reg_read) {
                     if (doit_err_count < 6){ doit_err_count++; }
                     if (doit_err_count == 4 ){ // ignore 4 errors at startup
-                        HM2_ERR("Smart Serial port %i: DoIt not cleared from previous "
+                        HM2_ERR_RT("Smart Serial port %i: DoIt not cleared from previous "
                                 "servo thread. Servo thread rate probably too fast. "
                                 "This message will not be repeated, but the " 
                                 "%s.sserial.%1d.fault-count pin will indicate "
@@ -1143,7 +1143,7 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                     f = (*inst->data_reg_read & (comm_err_flag ^ 0xFF));
                     if (f != 0 && f != 0xFF){
                         comm_err_flag |= (f & -f); //mask LSb
-                        HM2_ERR("Smart Serial Error: port %i channel %i. " 
+                        HM2_ERR_RT("Smart Serial Error: port %i channel %i. " 
                                 "You may see this error if the FPGA card "
                                 """read"" thread is not running. "
                                 "This error message will not repeat.\n",
@@ -1213,7 +1213,7 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                                     // Assume not for the time being
                                     break;
                                 default:
-                                    HM2_ERR("Unsupported output datatype %i (name ""%s"")\n",
+                                    HM2_ERR_RT("Unsupported output datatype %i (name ""%s"")\n",
                                             conf->DataType, conf->NameString);
                                     
                             }
@@ -1237,7 +1237,7 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                     if (inst->timer < 2100000000) {
                         break;
                     }
-                    HM2_ERR("sserial_write:"
+                    HM2_ERR_RT("sserial_write:"
                             "Timeout waiting for CMD to clear\n");
                     *inst->fault_count += inst->fault_inc;
                     // carry on, nothing much we can do about it
@@ -1250,7 +1250,7 @@ void hm2_sserial_prepare_tram_write(hostmot2_t *hm2, long period){
                 if ( ! *inst->run){*inst->state = 0x02;}
                 break;
             default: // Should never happen
-                HM2_ERR("Unhandled run/stop configuration in \n"
+                HM2_ERR_RT("Unhandled run/stop configuration in \n"
                         "hm2_sserial_write (%x)\n",
                         *inst->state);
                 *inst->state = 0;
@@ -1315,7 +1315,7 @@ void hm2_sserial_process_tram_read(hostmot2_t *hm2, long period){
                             pin->oldval = buff32;
                             break;
                         default:
-                            HM2_ERR("Unsupported input datatype %i (name ""%s"")\n",
+                            HM2_ERR_RT("Unsupported input datatype %i (name ""%s"")\n",
                                     conf->DataType, conf->NameString);
                     }
                     bitcount += conf->DataLength;
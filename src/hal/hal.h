@@ -457,6 +457,39 @@ extern int hal_link(const char *pin_name, const char *sig_name);
 */
 extern int hal_unlink(const char *pin_name);
 
+#ifdef ULAPI
+/** A signal group lets user space read several signals as they were
+    at the end of the same thread period, instead of one at a time
+    while the realtime threads write them, which could mix values of
+    different periods (X from one, Y from the next).  Each thread
+    keeps a sequence count that is odd while its functions run.  A
+    snapshot copies the group and retries if any thread started or
+    was running meanwhile.  The HAL mutex is only held for each try,
+    not while waiting for the next.  Signals written by user space
+    components are copied as they are.
+
+    'hal_group_new()' makes a group of the 'count' signals named in
+    'signals'.  'name' identifies the group in error messages.  It
+    returns NULL if a signal does not exist or on lack of memory.
+    'hal_group_delete()' frees a group.
+    'hal_group_snapshot()' copies the values of the group into the
+    group's own buffer.  Signals are looked up by name each time, so
+    groups stay valid if signals are deleted and made again, or moved
+    by hal_pack_signals().  It returns 0, -ENOENT if a signal is
+    gone, or -EAGAIN if the threads never left it a quiet moment.
+    'hal_group_type()' and 'hal_group_value()' give the type of signal
+    'n' of the group and a pointer to its value in the last snapshot.
+*/
+typedef struct hal_group hal_group_t;
+
+extern hal_group_t *hal_group_new(const char *name, const char **signals,
+    int count);
+extern void hal_group_delete(hal_group_t * group);
+extern int hal_group_snapshot(hal_group_t * group);
+extern hal_type_t hal_group_type(hal_group_t * group, int n);
+extern void *hal_group_value(hal_group_t * group, int n);
+#endif /* ULAPI */
+
 /***********************************************************************
 *                     "PARAMETER" FUNCTIONS                            *
 ************************************************************************/
@@ -693,6 +726,32 @@ extern int hal_add_funct_to_thread(const char *funct_name, const char *thread_na
 */
 extern int hal_del_funct_from_thread(const char *funct_name, const char *thread_name);
 
+/** hal_thread_parallel() turns parallel mode of thread 'name' on
+    ('on' non-zero) or off.  In parallel mode the functs of the thread
+    are spread over the thread's task and its worker tasks, one per
+    CPU in the 'worker_cpus' parameter of hal_lib, so that functs that
+    share no written signal and no component run at the same time.
+    Each funct still runs once per period, after the functs before it
+    that it depends on, and the thread's period ends when all are
+    done.  The lanes are planned again whenever the functs or links
+    of the thread change.
+    Returns 0, or a negative error code; -EINVAL if the thread has
+    no workers.  Call only from within user space, not from realtime
+    code.
+*/
+extern int hal_thread_parallel(const char *name, int on);
+
+/** hal_stats_histogram() keeps ('on' non-zero) or stops keeping a
+    histogram of the run times of the thread or function 'name', or
+    both if a thread and a function have that name.  The histogram
+    gives the percentiles of 'halcmd show funct-stats'; it takes about
+    half a kilobyte of HAL shared memory, which goes back to be reused
+    when it is turned off.  Turning it on clears the statistics.
+    Returns 0, or a negative error code.  Call only from within user
+    space, not from realtime code.
+*/
+extern int hal_stats_histogram(const char *name, int on);
+
 /** hal_start_threads() starts all threads that have been created.
     This is the point at which realtime functions start being called.
     On success it returns 0, on failure a negative
@@ -708,6 +767,19 @@ extern int hal_start_threads(void);
 */
 extern int hal_stop_threads(void);
 
+/** hal_pack_signals() moves the values of the signals used by the
+    realtime threads into one contiguous, cache line aligned block,
+    in the order the thread functions run, so each period touches
+    fewer cache lines.  Pins linked to the signals are updated.  Call
+    it with the threads stopped, after the last 'net' and 'addf'.
+    The old places of the values are not reused, except an earlier
+    packed block, so each call may use up some shared memory.
+    Returns the number of signals moved, or a negative error code.
+    Call only from within user space or init code, not from
+    realtime code.
+*/
+extern int hal_pack_signals(void);
+
 /** HAL 'constructor' typedef
     If it is not NULL, this points to a function which can construct a new
     instance of its component.  Return value is >=0 for success,
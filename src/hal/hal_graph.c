@@ -0,0 +1,319 @@
+/********************************************************************
+* Description:  hal_graph.c
+*               Derives the data flow between the functs of a thread
+*               from their pin -> signal -> pin links, for 'halcmd
+*               show graph' and for the lanes of parallel threads.
+*
+*               Part of the HAL library, user space only.  All
+*               functions assume the caller holds the hal_data mutex.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+/** This library is free software; you can redistribute it and/or
+    modify it under the terms of version 2.1 of the GNU Lesser General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+
+/* a linked pin of one of the thread's components */
+typedef struct {
+    int sig;			/* offset of its signal */
+    int comp;			/* component index */
+    int access;			/* 1 reads, 2 writes, 3 both */
+} graph_pin_t;
+
+static int compare_int(const void *a, const void *b)
+{
+    return *(const int *) a - *(const int *) b;
+}
+
+static int compare_pin(const void *a, const void *b)
+{
+    const graph_pin_t *pa = a, *pb = b;
+
+    if (pa->sig != pb->sig) {
+	return pa->sig - pb->sig;
+    }
+    return pa->comp - pb->comp;
+}
+
+/* component index of 'owner_ptr', from the sorted 'owners', or -1 */
+static int comp_index(int *owners, int *index, int ncomps, int owner_ptr)
+{
+    int *p;
+
+    p = bsearch(&owner_ptr, owners, ncomps, sizeof(int), compare_int);
+    return p ? index[p - owners] : -1;
+}
+
+/* one pass over the pins collects the accesses of the thread's
+   components, sorted by signal; components that share a signal with
+   a writer among them conflict */
+static int find_conflicts(hal_graph_t * graph, int *comp_owner)
+{
+    hal_pin_t *pin;
+    graph_pin_t *pins;
+    int *owners, *index;
+    int npins, n, next, first, a, b, c;
+
+    owners = malloc(graph->ncomps * sizeof(int) * 2);
+    if (owners == 0) {
+	return -ENOMEM;
+    }
+    index = owners + graph->ncomps;
+    memcpy(owners, comp_owner, graph->ncomps * sizeof(int));
+    qsort(owners, graph->ncomps, sizeof(int), compare_int);
+    for (n = 0; n < graph->ncomps; n++) {
+	for (c = 0; comp_owner[c] != owners[n]; c++) {
+	}
+	index[n] = c;
+    }
+    npins = 0;
+    for (next = hal_data->pin_list_ptr; next != 0; next = pin->next_ptr) {
+	pin = SHMPTR(next);
+	npins += (pin->signal != 0);
+    }
+    pins = malloc((npins + 1) * sizeof(graph_pin_t));
+    if (pins == 0) {
+	free(owners);
+	return -ENOMEM;
+    }
+    npins = 0;
+    for (next = hal_data->pin_list_ptr; next != 0; next = pin->next_ptr) {
+	pin = SHMPTR(next);
+	if (pin->signal == 0) {
+	    continue;
+	}
+	c = comp_index(owners, index, graph->ncomps, pin->owner_ptr);
+	if (c < 0) {
+	    continue;
+	}
+	pins[npins].sig = pin->signal;
+	pins[npins].comp = c;
+	pins[npins].access = (pin->dir == HAL_IN) ? 1 : (pin->dir == HAL_OUT) ? 2 : 3;
+	npins++;
+    }
+    qsort(pins, npins, sizeof(graph_pin_t), compare_pin);
+    /* merge the pins of a component on a signal */
+    for (a = 0, n = 0; a < npins; a++) {
+	if (n > 0 && pins[n - 1].sig == pins[a].sig &&
+	    pins[n - 1].comp == pins[a].comp) {
+	    pins[n - 1].access |= pins[a].access;
+	} else {
+	    pins[n++] = pins[a];
+	}
+    }
+    npins = n;
+    for (first = 0; first < npins; first = n) {
+	for (n = first; n < npins && pins[n].sig == pins[first].sig; n++) {
+	}
+	for (a = first; a < n; a++) {
+	    for (b = a + 1; b < n; b++) {
+		if ((pins[a].access | pins[b].access) & 2) {
+		    graph->conflict[pins[a].comp * graph->ncomps + pins[b].comp] = 1;
+		    graph->conflict[pins[b].comp * graph->ncomps + pins[a].comp] = 1;
+		}
+	    }
+	}
+    }
+    free(pins);
+    free(owners);
+    return 0;
+}
+
+int halpr_graph_depends(hal_graph_t * graph, int a, int b)
+{
+    return graph->comp[a] == graph->comp[b] ||
+	graph->conflict[graph->comp[a] * graph->ncomps + graph->comp[b]];
+}
+
+int halpr_graph_build(hal_thread_t * thread, hal_graph_t * graph)
+{
+    hal_list_t *list_root, *list_entry;
+    hal_stats_t copy;
+    int *comp_owner;
+    int n, a, b, c;
+
+    memset(graph, 0, sizeof(*graph));
+    list_root = &(thread->funct_list);
+    for (list_entry = list_next(list_root); list_entry != list_root;
+	list_entry = list_next(list_entry)) {
+	graph->nfuncts++;
+    }
+    n = graph->nfuncts + 1;
+    graph->entry = calloc(n, sizeof(*graph->entry));
+    graph->funct = calloc(n, sizeof(*graph->funct));
+    graph->comp = calloc(n, sizeof(*graph->comp));
+    graph->mean = calloc(n, sizeof(*graph->mean));
+    graph->level = calloc(n, sizeof(*graph->level));
+    graph->finish = calloc(n, sizeof(*graph->finish));
+    graph->crit_prev = calloc(n, sizeof(*graph->crit_prev));
+    graph->lane = calloc(n, sizeof(*graph->lane));
+    graph->conflict = calloc(n * n, 1);
+    comp_owner = calloc(n, sizeof(int));
+    if (!graph->entry || !graph->funct || !graph->comp || !graph->mean ||
+	!graph->level || !graph->finish || !graph->crit_prev ||
+	!graph->lane || !graph->conflict || !comp_owner) {
+	free(comp_owner);
+	halpr_graph_free(graph);
+	return -ENOMEM;
+    }
+    /* the functs in thread order, and the components they belong to */
+    n = 0;
+    for (list_entry = list_next(list_root); list_entry != list_root;
+	list_entry = list_next(list_entry)) {
+	graph->entry[n] = (hal_funct_entry_t *) list_entry;
+	graph->funct[n] = SHMPTR(graph->entry[n]->funct_ptr);
+	for (c = 0; c < graph->ncomps; c++) {
+	    if (comp_owner[c] == graph->funct[n]->owner_ptr) {
+		break;
+	    }
+	}
+	if (c == graph->ncomps) {
+	    comp_owner[graph->ncomps++] = graph->funct[n]->owner_ptr;
+	}
+	graph->comp[n] = c;
+	if (halpr_stats_snapshot(&(graph->funct[n]->stats), &copy, 0) == 0 &&
+	    copy.count > 0) {
+	    graph->mean[n] = (double) copy.sum / copy.count;
+	} else {
+	    graph->mean[n] = graph->funct[n]->runtime;
+	}
+	n++;
+    }
+    if (find_conflicts(graph, comp_owner) != 0) {
+	free(comp_owner);
+	halpr_graph_free(graph);
+	return -ENOMEM;
+    }
+    free(comp_owner);
+    /* levels and earliest finish times, in thread order */
+    for (b = 0; b < graph->nfuncts; b++) {
+	graph->crit_prev[b] = -1;
+	for (a = 0; a < b; a++) {
+	    if (!halpr_graph_depends(graph, a, b)) {
+		continue;
+	    }
+	    if (graph->level[a] + 1 > graph->level[b]) {
+		graph->level[b] = graph->level[a] + 1;
+	    }
+	    if (graph->crit_prev[b] < 0 ||
+		graph->finish[a] > graph->finish[graph->crit_prev[b]]) {
+		graph->crit_prev[b] = a;
+	    }
+	}
+	if (graph->crit_prev[b] >= 0) {
+	    graph->finish[b] = graph->finish[graph->crit_prev[b]];
+	}
+	graph->finish[b] += graph->mean[b];
+	graph->serial += graph->mean[b];
+	if (graph->level[b] + 1 > graph->levels) {
+	    graph->levels = graph->level[b] + 1;
+	}
+	if (graph->finish[b] > graph->finish[graph->last]) {
+	    graph->last = b;
+	}
+    }
+    graph->crit = graph->nfuncts ? graph->finish[graph->last] : 0.0;
+    graph->span = graph->serial;
+    return 0;
+}
+
+void halpr_graph_schedule(hal_graph_t * graph, int lanes)
+{
+    double lane_free[HAL_MAX_LANES];
+    double *done, ready, start, time;
+    int a, b, n;
+
+    if (lanes < 1) {
+	lanes = 1;
+    }
+    if (lanes > HAL_MAX_LANES) {
+	lanes = HAL_MAX_LANES;
+    }
+    memset(graph->lane, 0, graph->nfuncts * sizeof(int));
+    graph->span = graph->serial;
+    /* 'finish' is for unlimited lanes, this is for the real ones */
+    done = calloc(graph->nfuncts + 1, sizeof(double));
+    if (done == 0) {
+	/* all in one lane is always right */
+	return;
+    }
+    for (n = 0; n < lanes; n++) {
+	lane_free[n] = 0.0;
+    }
+    graph->span = 0.0;
+    for (b = 0; b < graph->nfuncts; b++) {
+	ready = 0.0;
+	for (a = 0; a < b; a++) {
+	    if (halpr_graph_depends(graph, a, b) && done[a] > ready) {
+		ready = done[a];
+	    }
+	}
+	/* the lane where it can start first, the thread's own on a tie */
+	for (n = 0; n < lanes; n++) {
+	    start = lane_free[n] > ready ? lane_free[n] : ready;
+	    if (n == 0 || start < done[b]) {
+		done[b] = start;
+		graph->lane[b] = n;
+	    }
+	}
+	/* functs that never ran count the same */
+	time = graph->mean[b] > 0.0 ? graph->mean[b] : 1.0;
+	done[b] += time;
+	lane_free[graph->lane[b]] = done[b];
+	if (done[b] > graph->span) {
+	    graph->span = done[b];
+	}
+    }
+    free(done);
+}
+
+void halpr_graph_apply(hal_graph_t * graph)
+{
+    hal_funct_entry_t *entry;
+    int a, b;
+
+    for (b = 0; b < graph->nfuncts; b++) {
+	entry = graph->entry[b];
+	entry->lane = graph->lane[b];
+	/* lanes run in order, the last dependency on each will do */
+	memset(entry->wait_ptr, 0, sizeof(entry->wait_ptr));
+	for (a = 0; a < b; a++) {
+	    if (graph->lane[a] != entry->lane &&
+		halpr_graph_depends(graph, a, b)) {
+		entry->wait_ptr[graph->lane[a]] = SHMOFF(graph->entry[a]);
+	    }
+	}
+    }
+}
+
+void halpr_graph_free(hal_graph_t * graph)
+{
+    free(graph->entry);
+    free(graph->funct);
+    free(graph->comp);
+    free(graph->mean);
+    free(graph->level);
+    free(graph->finish);
+    free(graph->crit_prev);
+    free(graph->lane);
+    free(graph->conflict);
+    memset(graph, 0, sizeof(*graph));
+}
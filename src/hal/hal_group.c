@@ -0,0 +1,210 @@
+/********************************************************************
+* Description:  hal_group.c
+*               Signal groups: consistent snapshots of several
+*               signals for user space readers, using the sequence
+*               count that each realtime thread bumps before and
+*               after running its functions.
+*
+*               Part of the HAL library, user space only.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+/** This library is free software; you can redistribute it and/or
+    modify it under the terms of version 2.1 of the GNU Lesser General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+/* snapshot attempts before giving up */
+#define GROUP_TRIES 1000
+
+typedef struct {
+    char name[HAL_NAME_LEN + 1];	/* signal name */
+    hal_type_t type;			/* its type */
+    hal_sig_t *sig;			/* looked up again per snapshot */
+    hal_data_u value;			/* value in the last snapshot */
+} hal_group_entry_t;
+
+struct hal_group {
+    char name[HAL_NAME_LEN + 1];	/* group name, for messages */
+    int count;				/* number of signals */
+    hal_group_entry_t entry[1];		/* 'count' of them */
+};
+
+/* sum of the thread sequence counts, or -1 if a thread is running.
+   The counts only go up, so the sum changes if any thread ran. */
+static long long threads_seq(void)
+{
+    long long sum = 0;
+    unsigned int seq;
+    int next;
+    hal_thread_t *thread;
+
+    next = hal_data->thread_list_ptr;
+    while (next != 0) {
+	thread = SHMPTR(next);
+	seq = thread->seq;
+	if (seq & 1) {
+	    return -1;
+	}
+	sum += seq;
+	next = thread->next_ptr;
+    }
+    return sum;
+}
+
+static void copy_value(hal_type_t type, hal_data_u * dest, void *src)
+{
+    switch (type) {
+    case HAL_BIT:
+	dest->b = *((hal_bit_t *) src);
+	break;
+    case HAL_S32:
+	dest->s = *((hal_s32_t *) src);
+	break;
+    case HAL_U32:
+	dest->u = *((hal_u32_t *) src);
+	break;
+    default:
+	dest->f = *((hal_float_t *) src);
+	break;
+    }
+}
+
+hal_group_t *hal_group_new(const char *name, const char **signals, int count)
+{
+    hal_group_t *group;
+    hal_sig_t *sig;
+    int n;
+
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: group_new called before init\n");
+	return NULL;
+    }
+    if (count < 1) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: group '%s' has no signals\n", name);
+	return NULL;
+    }
+    group = calloc(1, sizeof(hal_group_t) +
+	(count - 1) * sizeof(hal_group_entry_t));
+    if (group == NULL) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for group '%s'\n", name);
+	return NULL;
+    }
+    rtapi_snprintf(group->name, sizeof(group->name), "%s", name);
+    group->count = count;
+    rtapi_mutex_get(&(hal_data->mutex));
+    for (n = 0; n < count; n++) {
+	sig = halpr_find_sig_by_name(signals[n]);
+	if (sig == 0) {
+	    rtapi_mutex_give(&(hal_data->mutex));
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL: ERROR: signal '%s' of group '%s' not found\n",
+		signals[n], name);
+	    hal_group_delete(group);
+	    return NULL;
+	}
+	rtapi_snprintf(group->entry[n].name, sizeof(group->entry[n].name),
+	    "%s", signals[n]);
+	group->entry[n].type = sig->type;
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    return group;
+}
+
+void hal_group_delete(hal_group_t * group)
+{
+    free(group);
+}
+
+/* looks up the signals of 'group' and copies their values if no thread
+   ran meanwhile, the caller holds the mutex */
+static int group_copy(hal_group_t * group)
+{
+    hal_sig_t *sig;
+    long long before;
+    int n;
+
+    for (n = 0; n < group->count; n++) {
+	sig = halpr_find_sig_by_name(group->entry[n].name);
+	if (sig == 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL: ERROR: signal '%s' of group '%s' not found\n",
+		group->entry[n].name, group->name);
+	    return -ENOENT;
+	}
+	group->entry[n].sig = sig;
+	group->entry[n].type = sig->type;
+    }
+    before = threads_seq();
+    if (before < 0) {
+	return -EAGAIN;
+    }
+    hal_barrier();
+    for (n = 0; n < group->count; n++) {
+	sig = group->entry[n].sig;
+	copy_value(sig->type, &(group->entry[n].value),
+	    SHMPTR(sig->data_ptr));
+    }
+    hal_barrier();
+    if (threads_seq() != before) {
+	return -EAGAIN;
+    }
+    return 0;
+}
+
+int hal_group_snapshot(hal_group_t * group)
+{
+    int retval, tries;
+
+    for (tries = 0; tries < GROUP_TRIES; tries++) {
+	/* the mutex keeps the signals from going away under the copy */
+	rtapi_mutex_get(&(hal_data->mutex));
+	retval = group_copy(group);
+	rtapi_mutex_give(&(hal_data->mutex));
+	if (retval != -EAGAIN) {
+	    return retval;
+	}
+	/* let the thread finish, and others at the mutex meanwhile */
+	sched_yield();
+    }
+    rtapi_print_msg(RTAPI_MSG_ERR,
+	"HAL: ERROR: no consistent snapshot of group '%s'\n", group->name);
+    return -EAGAIN;
+}
+
+hal_type_t hal_group_type(hal_group_t * group, int n)
+{
+    if (n < 0 || n >= group->count) {
+	return HAL_TYPE_UNSPECIFIED;
+    }
+    return group->entry[n].type;
+}
+
+void *hal_group_value(hal_group_t * group, int n)
+{
+    if (n < 0 || n >= group->count) {
+	return NULL;
+    }
+    return &(group->entry[n].value);
+}
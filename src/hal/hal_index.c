@@ -0,0 +1,328 @@
+/********************************************************************
+* Description:  hal_index.c
+*               Name index for the HAL object lists.  The sorted
+*               lists get skip list express lanes for fast sorted
+*               insertion, and an open addressing hash table in
+*               shared memory answers the find-by-name lookups.
+*
+*               Part of the HAL library, used by both user space
+*               and realtime code.  All functions assume the caller
+*               holds the hal_data mutex.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+/** This library is free software; you can redistribute it and/or
+    modify it under the terms of version 2.1 of the GNU Lesser General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+
+#include "rtapi_string.h"
+
+/* smallest hash table, in slots */
+#define INDEX_MIN_SIZE 256
+
+/* slot marker of a deleted entry */
+#define INDEX_DELETED -1
+
+/* the list root and index of an object kind */
+static int *index_root(hal_index_kind_t kind)
+{
+    switch (kind) {
+    case HAL_INDEX_PIN:
+	return &(hal_data->pin_list_ptr);
+    case HAL_INDEX_SIG:
+	return &(hal_data->sig_list_ptr);
+    case HAL_INDEX_PARAM:
+	return &(hal_data->param_list_ptr);
+    default:
+	return &(hal_data->funct_list_ptr);
+    }
+}
+
+static hal_index_t *index_of(hal_index_kind_t kind)
+{
+    switch (kind) {
+    case HAL_INDEX_PIN:
+	return &(hal_data->pin_index);
+    case HAL_INDEX_SIG:
+	return &(hal_data->sig_index);
+    case HAL_INDEX_PARAM:
+	return &(hal_data->param_index);
+    default:
+	return &(hal_data->funct_index);
+    }
+}
+
+static char *obj_name(hal_index_kind_t kind, int ptr)
+{
+    switch (kind) {
+    case HAL_INDEX_PIN:
+	return ((hal_pin_t *) SHMPTR(ptr))->name;
+    case HAL_INDEX_SIG:
+	return ((hal_sig_t *) SHMPTR(ptr))->name;
+    case HAL_INDEX_PARAM:
+	return ((hal_param_t *) SHMPTR(ptr))->name;
+    default:
+	return ((hal_funct_t *) SHMPTR(ptr))->name;
+    }
+}
+
+/* name the object had before it was aliased, or NULL */
+static char *obj_oldname(hal_index_kind_t kind, int ptr)
+{
+    int oldname;
+
+    switch (kind) {
+    case HAL_INDEX_PIN:
+	oldname = ((hal_pin_t *) SHMPTR(ptr))->oldname;
+	break;
+    case HAL_INDEX_PARAM:
+	oldname = ((hal_param_t *) SHMPTR(ptr))->oldname;
+	break;
+    default:
+	oldname = 0;
+	break;
+    }
+    if (oldname == 0) {
+	return NULL;
+    }
+    return ((hal_oldname_t *) SHMPTR(oldname))->name;
+}
+
+/* FNV-1a */
+static unsigned int index_hash(const char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    while (*name != '\0') {
+	hash ^= (unsigned char) *name++;
+	hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* number of lanes an object is linked into.  The table uses the low
+   bits of the hash, the high ones give a 1/16 chance per extra lane. */
+static int index_levels(unsigned int hash)
+{
+    int levels = 1;
+
+    for (hash >>= 16; (hash & 15) == 0 && levels < HAL_INDEX_LEVELS;
+	hash >>= 4) {
+	levels++;
+    }
+    return levels;
+}
+
+/* link at 'level' of object 'ptr', or of the list root if 'ptr' is 0.
+   Level 0 is the plain 'next_ptr' list, the express lanes follow it. */
+static int *index_lane(hal_index_kind_t kind, int ptr, int level)
+{
+    if (ptr == 0) {
+	if (level == 0) {
+	    return index_root(kind);
+	}
+	return &(index_of(kind)->lanes[level - 1]);
+    }
+    return &(((int *) SHMPTR(ptr))[level]);
+}
+
+/* fills 'update' with the last link before 'name' on every lane */
+static void index_search(hal_index_kind_t kind, const char *name,
+    int **update)
+{
+    int level, ptr, next;
+
+    ptr = 0;
+    for (level = HAL_INDEX_LEVELS - 1; level >= 0; level--) {
+	while (1) {
+	    next = *index_lane(kind, ptr, level);
+	    if (next == 0 || strcmp(obj_name(kind, next), name) >= 0) {
+		break;
+	    }
+	    ptr = next;
+	}
+	update[level] = index_lane(kind, ptr, level);
+    }
+}
+
+static void slot_add(hal_index_t * index, unsigned int hash, int ptr)
+{
+    hal_index_slot_t *slots = SHMPTR(index->slots_ptr);
+    unsigned int mask = index->size - 1;
+    unsigned int n = hash & mask;
+
+    while (slots[n].ptr != 0 && slots[n].ptr != INDEX_DELETED) {
+	n = (n + 1) & mask;
+    }
+    if (slots[n].ptr == 0) {
+	index->used++;
+    }
+    slots[n].hash = hash;
+    slots[n].ptr = ptr;
+    index->count++;
+}
+
+static void slot_del(hal_index_t * index, unsigned int hash, int ptr)
+{
+    hal_index_slot_t *slots = SHMPTR(index->slots_ptr);
+    unsigned int mask = index->size - 1;
+    unsigned int n = hash & mask;
+
+    while (slots[n].ptr != 0) {
+	if (slots[n].ptr == ptr && slots[n].hash == hash) {
+	    slots[n].ptr = INDEX_DELETED;
+	    index->count--;
+	    return;
+	}
+	n = (n + 1) & mask;
+    }
+}
+
+int halpr_index_reserve(hal_index_kind_t kind, int count,
+    void *(*alloc) (long int size))
+{
+    hal_index_t *index = index_of(kind);
+    hal_index_slot_t *old_slots, *slots;
+    int old_size, size, n;
+
+    /* keep the load (deleted slots included) below 3/4 */
+    if (index->slots_ptr != 0 && (index->used + count) * 4 <= index->size * 3) {
+	return 0;
+    }
+    /* size for the live entries at half load */
+    size = INDEX_MIN_SIZE;
+    while ((index->count + count) * 2 > size) {
+	size *= 2;
+    }
+    if (size < index->size) {
+	size = index->size;
+    }
+    slots = halpr_pool_alloc(size * sizeof(hal_index_slot_t), 0, alloc);
+    if (slots == 0) {
+	return -ENOMEM;
+    }
+    memset(slots, 0, size * sizeof(hal_index_slot_t));
+    /* move the live entries over */
+    old_slots = SHMPTR(index->slots_ptr);
+    old_size = index->slots_ptr != 0 ? index->size : 0;
+    index->slots_ptr = SHMOFF(slots);
+    index->size = size;
+    index->used = 0;
+    index->count = 0;
+    for (n = 0; n < old_size; n++) {
+	if (old_slots[n].ptr != 0 && old_slots[n].ptr != INDEX_DELETED) {
+	    slot_add(index, old_slots[n].hash, old_slots[n].ptr);
+	}
+    }
+    /* the old table goes back to the pool, for the next one of its
+       size, a table of another kind, or hal_malloc() */
+    if (old_size != 0) {
+	halpr_pool_free(old_slots);
+    }
+    return 0;
+}
+
+int halpr_index_insert(hal_index_kind_t kind, void *obj)
+{
+    hal_index_t *index = index_of(kind);
+    int *update[HAL_INDEX_LEVELS];
+    int ptr, next, level, levels;
+    char *name, *oldname;
+    unsigned int hash;
+
+    ptr = SHMOFF(obj);
+    name = obj_name(kind, ptr);
+    /* find the place in the sorted list */
+    index_search(kind, name, update);
+    next = *update[0];
+    if (next != 0 && strcmp(obj_name(kind, next), name) == 0) {
+	/* name already in list, can't insert */
+	return -EEXIST;
+    }
+    /* link into the list and the express lanes */
+    hash = index_hash(name);
+    levels = index_levels(hash);
+    for (level = 0; level < levels; level++) {
+	*index_lane(kind, ptr, level) = *update[level];
+	*update[level] = ptr;
+    }
+    /* and into the hash table, under both names if aliased */
+    slot_add(index, hash, ptr);
+    oldname = obj_oldname(kind, ptr);
+    if (oldname != NULL) {
+	slot_add(index, index_hash(oldname), ptr);
+    }
+    return 0;
+}
+
+void halpr_index_remove(hal_index_kind_t kind, void *obj)
+{
+    hal_index_t *index = index_of(kind);
+    int *update[HAL_INDEX_LEVELS];
+    int ptr, level;
+    char *name, *oldname;
+
+    ptr = SHMOFF(obj);
+    name = obj_name(kind, ptr);
+    /* unlink from every lane that leads to it */
+    index_search(kind, name, update);
+    for (level = 0; level < HAL_INDEX_LEVELS; level++) {
+	if (*update[level] == ptr) {
+	    *update[level] = *index_lane(kind, ptr, level);
+	}
+    }
+    *index_lane(kind, ptr, 0) = 0;
+    /* drop the hash table entries */
+    if (index->slots_ptr == 0) {
+	return;
+    }
+    slot_del(index, index_hash(name), ptr);
+    oldname = obj_oldname(kind, ptr);
+    if (oldname != NULL) {
+	slot_del(index, index_hash(oldname), ptr);
+    }
+}
+
+void *halpr_index_find(hal_index_kind_t kind, const char *name)
+{
+    hal_index_t *index = index_of(kind);
+    hal_index_slot_t *slots;
+    unsigned int hash, mask, n;
+    char *oldname;
+    int ptr;
+
+    if (index->slots_ptr == 0) {
+	return 0;
+    }
+    slots = SHMPTR(index->slots_ptr);
+    hash = index_hash(name);
+    mask = index->size - 1;
+    for (n = hash & mask; (ptr = slots[n].ptr) != 0; n = (n + 1) & mask) {
+	if (ptr == INDEX_DELETED || slots[n].hash != hash) {
+	    continue;
+	}
+	if (strcmp(obj_name(kind, ptr), name) == 0) {
+	    return SHMPTR(ptr);
+	}
+	oldname = obj_oldname(kind, ptr);
+	if (oldname != NULL && strcmp(oldname, name) == 0) {
+	    return SHMPTR(ptr);
+	}
+    }
+    return 0;
+}
@@ -65,11 +65,22 @@
 MODULE_AUTHOR("John Kasunich");
 MODULE_DESCRIPTION("Hardware Abstraction Layer for EMC");
 MODULE_LICENSE("GPL");
+
+static int hal_size = HAL_SIZE;
+RTAPI_MP_INT(hal_size, "size of the HAL shared memory block");
+
+/* every thread gets a worker task on each of these, see
+   hal_thread_parallel() */
+static int worker_cpus[HAL_MAX_WORKERS] = { -1, -1, -1, -1, -1, -1, -1 };
+RTAPI_MP_ARRAY_INT(worker_cpus, HAL_MAX_WORKERS,
+    "CPUs for the workers of parallel threads");
 #endif /* RTAPI */
 
 #if defined(ULAPI)
 #include <sys/types.h>		/* pid_t */
 #include <unistd.h>		/* getpid() */
+#include <stdlib.h>		/* getenv(), strtol() */
+#include <sched.h>		/* sched_yield() */
 #endif
 
 char *hal_shmem_base = 0;
@@ -84,11 +95,19 @@ static int lib_mem_id = 0;	/* RTAPI shmem ID for library module */
 /* These functions are used internally by this file.  The code is at
    the end of the file.  */
 
+/** shmem_open() attaches the HAL shmem block.  It maps only the
+    header first: if the block is already set up that tells its real
+    size, otherwise the block gets created with '*size' bytes (raised
+    to HAL_SIZE if less).  Returns the RTAPI shmem ID and sets 'mem'
+    and '*size', or returns a negative error code.
+*/
+static int shmem_open(int module_id, long int *size, void **mem);
+
 /** init_hal_data() initializes the entire HAL data structure, only
     if the structure has not already been initialized.  (The init
     is done by the first HAL component to be loaded.
 */
-static int init_hal_data(void);
+static int init_hal_data(int size);
 
 /** The 'shmalloc_xx()' functions allocate blocks of shared memory.
     Each function allocates a block that is 'size' bytes long.
@@ -98,7 +117,7 @@ static int init_hal_data(void);
     These functions do not test a mutex - they are called from
     within the hal library by code that already has the mutex.
     (The public function 'hal_malloc()' is a wrapper that gets the
-    mutex and then calls 'shmalloc_up()'.)
+    mutex and then calls 'halpr_pool_alloc()' with 'shmalloc_up()'.)
     The only difference between the two functions is the location
     of the allocated memory.  'shmalloc_up()' allocates from the
     base of shared memory and works upward, while 'shmalloc_dn()'
@@ -113,6 +132,19 @@ static int init_hal_data(void);
 static void *shmalloc_up(long int size);
 static void *shmalloc_dn(long int size);
 
+/** 'alloc_owner()' picks the component that hal_malloc() memory is
+    charged to: the one whose constructor is running, else the newest
+    component of the caller that is not ready yet.  Memory allocated
+    outside of those windows has no owner and is never released.
+*/
+static hal_comp_t *alloc_owner(void);
+
+/** 'index_reserve()' makes room for 'count' names in the name index
+    of the given kind, allocating with 'shmalloc_dn()'.  See
+    'halpr_index_reserve()' in hal_priv.h.
+*/
+static int index_reserve(hal_index_kind_t kind, int count);
+
 /** The alloc_xxx_struct() functions allocate a structure of the
     appropriate type and return a pointer to it, or 0 if they fail.
     They attempt to re-use freed structs first, if none are
@@ -149,12 +181,31 @@ static void free_funct_entry_struct(hal_funct_entry_t * funct_entry);
 static void free_thread_struct(hal_thread_t * thread);
 #endif /* RTAPI */
 
+/** 'thread_serial()' makes 'thread' run its functs one after the other
+    and waits until its workers let go of the funct list, so that the
+    list or the lanes may change, waiting out a period that is under
+    way.  'thread_plan()' spreads the functs of a thread in parallel
+    mode over its lanes again, and 'halpr_threads_replan()' does it for
+    every such thread.  Planning needs malloc(), so from realtime
+    module init or cleanup code the thread stays serial, with parallel
+    mode still on, until halcmd plans it after loadrt or unloadrt.
+    The caller must hold the mutex.
+*/
+static void thread_serial(hal_thread_t * thread);
+static void thread_plan(hal_thread_t * thread);
+
 #ifdef RTAPI
 /** 'thread_task()' is a function that is invoked as a realtime task.
     It implements a thread, by running down the thread's function list
     and calling each function in turn.
 */
 static void thread_task(void *arg);
+
+/** 'worker_task()' runs one lane of a thread in parallel mode, on its
+    own CPU, with the same priority as the thread.  It sleeps on its
+    semaphore until thread_task() starts a parallel period.
+*/
+static void worker_task(void *arg);
 #endif /* RTAPI */
 
 /***********************************************************************
@@ -169,6 +220,8 @@ int hal_init(const char *name)
 #ifdef ULAPI
     int retval;
     void *mem;
+    long int size;
+    char *env, *end;
 #endif
     char rtapi_name[RTAPI_NAME_LEN + 1];
     char hal_name[HAL_NAME_LEN + 1];
@@ -190,27 +243,31 @@ int hal_init(const char *name)
 	rtapi_snprintf(rtapi_name, RTAPI_NAME_LEN, "HAL_LIB_%d", (int)getpid());
 	lib_module_id = rtapi_init(rtapi_name);
 
+	/* size to use if we are the first, see HAL_SIZE_ENV */
+	size = HAL_SIZE;
+	env = getenv(HAL_SIZE_ENV);
+	if (env != NULL && *env != '\0') {
+	    size = strtol(env, &end, 0);
+	    if (*end != '\0' || size <= 0) {
+		rtapi_print_msg(RTAPI_MSG_ERR,
+		    "HAL: ERROR: bad %s '%s'\n", HAL_SIZE_ENV, env);
+		rtapi_exit(lib_module_id);
+		return -EINVAL;
+	    }
+	}
 	/* get HAL shared memory block from RTAPI */
-	lib_mem_id = rtapi_shmem_new(HAL_KEY, lib_module_id, HAL_SIZE);
+	lib_mem_id = shmem_open(lib_module_id, &size, &mem);
 	if (lib_mem_id < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: could not open shared memory\n");
 	    rtapi_exit(lib_module_id);
 	    return -EINVAL;
 	}
-	/* get address of shared memory area */
-	retval = rtapi_shmem_getptr(lib_mem_id, &mem);
-	if (retval < 0) {
-	    rtapi_print_msg(RTAPI_MSG_ERR,
-		"HAL: ERROR: could not access shared memory\n");
-	    rtapi_exit(lib_module_id);
-	    return -EINVAL;
-	}
 	/* set up internal pointers to shared mem and data structure */
         hal_shmem_base = (char *) mem;
         hal_data = (hal_data_t *) mem;
 	/* perform a global init if needed */
-	retval = init_hal_data();
+	retval = init_hal_data(size);
 	if ( retval ) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"HAL: ERROR: could not init shared memory\n");
@@ -320,6 +377,8 @@ int hal_exit(int comp_id)
     rtapi_snprintf(name, sizeof(name), "%s", comp->name);
     /* get rid of the component */
     free_comp_struct(comp);
+    /* its functs left the threads, its pins the signals */
+    halpr_threads_replan();
 /*! \todo Another #if 0 */
 #if 0
     /*! \todo FIXME - this is the beginning of a two pronged approach to managing
@@ -372,7 +431,7 @@ void *hal_malloc(long int size)
     /* get the mutex */
     rtapi_mutex_get(&(hal_data->mutex));
     /* allocate memory */
-    retval = shmalloc_up(size);
+    retval = halpr_pool_alloc(size, alloc_owner(), shmalloc_up);
     /* release the mutex */
     rtapi_mutex_give(&(hal_data->mutex));
     /* check return value */
@@ -598,8 +657,7 @@ int hal_pin_s32_newf(hal_pin_dir_t dir,
 int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
     void **data_ptr_addr, int comp_id)
 {
-    int *prev, next, cmp;
-    hal_pin_t *new, *ptr;
+    hal_pin_t *new;
     hal_comp_t *comp;
 
     if (hal_data == 0) {
@@ -681,44 +739,30 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
     /* make 'data_ptr' point to dummy signal */
     *data_ptr_addr = comp->shmem_base + SHMOFF(&(new->dummysig));
-    /* search list for 'name' and insert new structure */
-    prev = &(hal_data->pin_list_ptr);
-    next = *prev;
-    while (1) {
-	if (next == 0) {
-	    /* reached end of list, insert here */
-	    new->next_ptr = next;
-	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    return 0;
-	}
-	ptr = SHMPTR(next);
-	cmp = strcmp(ptr->name, new->name);
-	if (cmp > 0) {
-	    /* found the right place for it, insert here */
-	    new->next_ptr = next;
-	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    return 0;
-	}
-	if (cmp == 0) {
-	    /* name already in list, can't insert */
-	    free_pin_struct(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    rtapi_print_msg(RTAPI_MSG_ERR,
-		"HAL: ERROR: duplicate variable '%s'\n", name);
-	    return -EINVAL;
-	}
-	/* didn't find it yet, look at next one */
-	prev = &(ptr->next_ptr);
-	next = *prev;
+    /* insert new structure into the sorted list and name index */
+    if (index_reserve(HAL_INDEX_PIN, 1) != 0) {
+	free_pin_struct(new);
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for pin '%s'\n", name);
+	return -ENOMEM;
+    }
+    if (halpr_find_pin_by_name(name) != 0
+	|| halpr_index_insert(HAL_INDEX_PIN, new) != 0) {
+	/* name (or alias) already in use, can't insert */
+	free_pin_struct(new);
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: duplicate variable '%s'\n", name);
+	return -EINVAL;
     }
+    rtapi_mutex_give(&(hal_data->mutex));
+    return 0;
 }
 
 int hal_pin_alias(const char *pin_name, const char *alias)
 {
-    int *prev, next, cmp;
-    hal_pin_t *pin, *ptr;
+    hal_pin_t *pin;
     hal_oldname_t *oldname;
 
     if (hal_data == 0) {
@@ -763,35 +807,22 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	return -EINVAL;
     }
     free_oldname_struct(oldname);
+    /* same for the name index, the pin comes back with two names */
+    if (index_reserve(HAL_INDEX_PIN, 2) != 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for pin_alias\n");
+	return -EINVAL;
+    }
     /* find the pin and unlink it from pin list */
-    prev = &(hal_data->pin_list_ptr);
-    next = *prev;
-    while (1) {
-	if (next == 0) {
-	    /* reached end of list, not found */
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    rtapi_print_msg(RTAPI_MSG_ERR,
-		"HAL: ERROR: pin '%s' not found\n", pin_name);
-	    return -EINVAL;
-	}
-	pin = SHMPTR(next);
-	if ( strcmp(pin->name, pin_name) == 0 ) {
-	    /* found it, unlink from list */
-	    *prev = pin->next_ptr;
-	    break;
-	}
-	if (pin->oldname != 0 ) {
-	    oldname = SHMPTR(pin->oldname);
-	    if (strcmp(oldname->name, pin_name) == 0) {
-		/* found it, unlink from list */
-		*prev = pin->next_ptr;
-		break;
-	    }
-	}
-	/* didn't find it yet, look at next one */
-	prev = &(pin->next_ptr);
-	next = *prev;
+    pin = halpr_find_pin_by_name(pin_name);
+    if (pin == 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: pin '%s' not found\n", pin_name);
+	return -EINVAL;
     }
+    halpr_index_remove(HAL_INDEX_PIN, pin);
     if ( alias != NULL ) {
 	/* adding a new alias */
 	if ( pin->oldname == 0 ) {
@@ -813,29 +844,9 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	}
     }
     /* insert pin back into list in proper place */
-    prev = &(hal_data->pin_list_ptr);
-    next = *prev;
-    while (1) {
-	if (next == 0) {
-	    /* reached end of list, insert here */
-	    pin->next_ptr = next;
-	    *prev = SHMOFF(pin);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    return 0;
-	}
-	ptr = SHMPTR(next);
-	cmp = strcmp(ptr->name, pin->name);
-	if (cmp > 0) {
-	    /* found the right place for it, insert here */
-	    pin->next_ptr = next;
-	    *prev = SHMOFF(pin);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    return 0;
-	}
-	/* didn't find it yet, look at next one */
-	prev = &(ptr->next_ptr);
-	next = *prev;
-    }
+    halpr_index_insert(HAL_INDEX_PIN, pin);
+    rtapi_mutex_give(&(hal_data->mutex));
+    return 0;
 }
 
 /***********************************************************************
@@ -844,10 +855,7 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 
 int hal_signal_new(const char *name, hal_type_t type)
 {
-
-    int *prev, next, cmp;
-    hal_sig_t *new, *ptr;
-    void *data_addr;
+    int retval;
 
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -869,13 +877,33 @@ int hal_signal_new(const char *name, hal_type_t type)
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: creating signal '%s'\n", name);
     /* get mutex before accessing shared data */
     rtapi_mutex_get(&(hal_data->mutex));
+    retval = halpr_signal_new(name, type);
+    rtapi_mutex_give(&(hal_data->mutex));
+    return retval;
+}
+
+int halpr_signal_new(const char *name, hal_type_t type)
+{
+    hal_sig_t *new;
+    void *data_addr;
+
+    if (strlen(name) > HAL_NAME_LEN) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: signal name '%s' is too long\n", name);
+	return -EINVAL;
+    }
     /* check for an existing signal with the same name */
     if (halpr_find_sig_by_name(name) != 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: duplicate signal '%s'\n", name);
 	return -EINVAL;
     }
+    /* make room in the name index */
+    if (index_reserve(HAL_INDEX_SIG, 1) != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for signal '%s'\n", name);
+	return -ENOMEM;
+    }
     /* allocate memory for the signal value */
     switch (type) {
     case HAL_BIT:
@@ -891,7 +919,6 @@ int hal_signal_new(const char *name, hal_type_t type)
 	data_addr = shmalloc_up(sizeof(hal_float_t));
 	break;
     default:
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: illegal signal type %d'\n", type);
 	return -EINVAL;
@@ -901,7 +928,6 @@ int hal_signal_new(const char *name, hal_type_t type)
     new = alloc_sig_struct();
     if ((new == 0) || (data_addr == 0)) {
 	/* alloc failed */
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for signal '%s'\n", name);
 	return -ENOMEM;
@@ -930,36 +956,14 @@ int hal_signal_new(const char *name, hal_type_t type)
     new->writers = 0;
     new->bidirs = 0;
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
-    /* search list for 'name' and insert new structure */
-    prev = &(hal_data->sig_list_ptr);
-    next = *prev;
-    while (1) {
-	if (next == 0) {
-	    /* reached end of list, insert here */
-	    new->next_ptr = next;
-	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    return 0;
-	}
-	ptr = SHMPTR(next);
-	cmp = strcmp(ptr->name, new->name);
-	if (cmp > 0) {
-	    /* found the right place for it, insert here */
-	    new->next_ptr = next;
-	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    return 0;
-	}
-	/* didn't find it yet, look at next one */
-	prev = &(ptr->next_ptr);
-	next = *prev;
-    }
+    /* insert new structure into the sorted list and name index */
+    halpr_index_insert(HAL_INDEX_SIG, new);
+    return 0;
 }
 
 int hal_signal_delete(const char *name)
 {
     hal_sig_t *sig;
-    int *prev, next;
 
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -977,22 +981,16 @@ int hal_signal_delete(const char *name)
     /* get mutex before accessing shared data */
     rtapi_mutex_get(&(hal_data->mutex));
     /* search for the signal */
-    prev = &(hal_data->sig_list_ptr);
-    next = *prev;
-    while (next != 0) {
-	sig = SHMPTR(next);
-	if (strcmp(sig->name, name) == 0) {
-	    /* this is the right signal, unlink from list */
-	    *prev = sig->next_ptr;
-	    /* and delete it */
-	    free_sig_struct(sig);
-	    /* done */
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    return 0;
-	}
-	/* no match, try the next one */
-	prev = &(sig->next_ptr);
-	next = *prev;
+    sig = halpr_find_sig_by_name(name);
+    if (sig != 0) {
+	/* this is the right signal, unlink from list */
+	halpr_index_remove(HAL_INDEX_SIG, sig);
+	/* and delete it */
+	free_sig_struct(sig);
+	halpr_threads_replan();
+	/* done */
+	rtapi_mutex_give(&(hal_data->mutex));
+	return 0;
     }
     /* if we get here, we didn't find a match */
     rtapi_mutex_give(&(hal_data->mutex));
@@ -1005,8 +1003,7 @@ int hal_link(const char *pin_name, const char *sig_name)
 {
     hal_pin_t *pin;
     hal_sig_t *sig;
-    hal_comp_t *comp;
-    void **data_ptr_addr, *data_addr;
+    int retval;
 
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -1051,43 +1048,55 @@ int hal_link(const char *pin_name, const char *sig_name)
 	    "HAL: ERROR: signal '%s' not found\n", sig_name);
 	return -EINVAL;
     }
-    /* found both pin and signal, are they already connected? */
+    retval = halpr_link(pin, sig);
+    if (retval == 0) {
+	/* its component may depend on others now */
+	halpr_threads_replan();
+    }
+    /* done, release the mutex and return */
+    rtapi_mutex_give(&(hal_data->mutex));
+    return retval;
+}
+
+int halpr_link(hal_pin_t * pin, hal_sig_t * sig)
+{
+    hal_sig_t *other;
+    hal_comp_t *comp;
+    void **data_ptr_addr, *data_addr;
+
+    /* are they already connected? */
     if (SHMPTR(pin->signal) == sig) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_WARN,
-	    "HAL: Warning: pin '%s' already linked to '%s'\n", pin_name, sig_name);
+	    "HAL: Warning: pin '%s' already linked to '%s'\n", pin->name,
+	    sig->name);
 	return 0;
     }
     /* is the pin connected to something else? */
     if(pin->signal) {
-	rtapi_mutex_give(&(hal_data->mutex));
-	sig = SHMPTR(pin->signal);
+	other = SHMPTR(pin->signal);
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: pin '%s' is linked to '%s', cannot link to '%s'\n",
-	    pin_name, sig->name, sig_name);
+	    pin->name, other->name, sig->name);
 	return -EINVAL;
     }
     /* check types */
     if (pin->type != sig->type) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: type mismatch '%s' <- '%s'\n", pin_name, sig_name);
+	    "HAL: ERROR: type mismatch '%s' <- '%s'\n", pin->name, sig->name);
 	return -EINVAL;
     }
     /* linking output pin to sig that already has output or I/O pins? */
     if ((pin->dir == HAL_OUT) && ((sig->writers > 0) || (sig->bidirs > 0 ))) {
 	/* yes, can't do that */
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: signal '%s' already has output or I/O pin(s)\n", sig_name);
+	    "HAL: ERROR: signal '%s' already has output or I/O pin(s)\n", sig->name);
 	return -EINVAL;
     }
     /* linking bidir pin to sig that already has output pin? */
     if ((pin->dir == HAL_IO) && (sig->writers > 0)) {
 	/* yes, can't do that */
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: signal '%s' already has output pin\n", sig_name);
+	    "HAL: ERROR: signal '%s' already has output pin\n", sig->name);
 	return -EINVAL;
     }
     /* everything is OK, make the new link */
@@ -1107,8 +1116,6 @@ int hal_link(const char *pin_name, const char *sig_name)
     }
     /* and update the pin */
     pin->signal = SHMOFF(sig);
-    /* done, release the mutex and return */
-    rtapi_mutex_give(&(hal_data->mutex));
     return 0;
 }
 
@@ -1147,6 +1154,7 @@ int hal_unlink(const char *pin_name)
     }
     /* found pin, unlink it */
     unlink_pin(pin);
+    halpr_threads_replan();
     /* done, release the mutex and return */
     rtapi_mutex_give(&(hal_data->mutex));
     return 0;
@@ -1246,8 +1254,7 @@ int hal_param_s32_newf(hal_param_dir_t dir, hal_s32_t * data_addr,
 int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *data_addr,
     int comp_id)
 {
-    int *prev, next, cmp;
-    hal_param_t *new, *ptr;
+    hal_param_t *new;
     hal_comp_t *comp;
 
     if (hal_data == 0) {
@@ -1320,38 +1327,25 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
     new->type = type;
     new->dir = dir;
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
-    /* search list for 'name' and insert new structure */
-    prev = &(hal_data->param_list_ptr);
-    next = *prev;
-    while (1) {
-	if (next == 0) {
-	    /* reached end of list, insert here */
-	    new->next_ptr = next;
-	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    return 0;
-	}
-	ptr = SHMPTR(next);
-	cmp = strcmp(ptr->name, new->name);
-	if (cmp > 0) {
-	    /* found the right place for it, insert here */
-	    new->next_ptr = next;
-	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    return 0;
-	}
-	if (cmp == 0) {
-	    /* name already in list, can't insert */
-	    free_param_struct(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    rtapi_print_msg(RTAPI_MSG_ERR,
-		"HAL: ERROR: duplicate parameter '%s'\n", name);
-	    return -EINVAL;
-	}
-	/* didn't find it yet, look at next one */
-	prev = &(ptr->next_ptr);
-	next = *prev;
+    /* insert new structure into the sorted list and name index */
+    if (index_reserve(HAL_INDEX_PARAM, 1) != 0) {
+	free_param_struct(new);
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for parameter '%s'\n", name);
+	return -ENOMEM;
+    }
+    if (halpr_find_param_by_name(name) != 0
+	|| halpr_index_insert(HAL_INDEX_PARAM, new) != 0) {
+	/* name (or alias) already in use, can't insert */
+	free_param_struct(new);
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: duplicate parameter '%s'\n", name);
+	return -EINVAL;
     }
+    rtapi_mutex_give(&(hal_data->mutex));
+    return 0;
 }
 
 /* wrapper functs for typed params - these call the generic funct below */
@@ -1454,8 +1448,7 @@ int hal_param_set(const char *name, hal_type_t type, void *value_addr)
 
 int hal_param_alias(const char *param_name, const char *alias)
 {
-    int *prev, next, cmp;
-    hal_param_t *param, *ptr;
+    hal_param_t *param;
     hal_oldname_t *oldname;
 
     if (hal_data == 0) {
@@ -1500,35 +1493,22 @@ int hal_param_alias(const char *param_name, const char *alias)
 	return -EINVAL;
     }
     free_oldname_struct(oldname);
-    /* find the param and unlink it from pin list */
-    prev = &(hal_data->param_list_ptr);
-    next = *prev;
-    while (1) {
-	if (next == 0) {
-	    /* reached end of list, not found */
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    rtapi_print_msg(RTAPI_MSG_ERR,
-		"HAL: ERROR: param '%s' not found\n", param_name);
-	    return -EINVAL;
-	}
-	param = SHMPTR(next);
-	if ( strcmp(param->name, param_name) == 0 ) {
-	    /* found it, unlink from list */
-	    *prev = param->next_ptr;
-	    break;
-	}
-	if (param->oldname != 0 ) {
-	    oldname = SHMPTR(param->oldname);
-	    if (strcmp(oldname->name, param_name) == 0) {
-		/* found it, unlink from list */
-		*prev = param->next_ptr;
-		break;
-	    }
-	}
-	/* didn't find it yet, look at next one */
-	prev = &(param->next_ptr);
-	next = *prev;
+    /* same for the name index, the param comes back with two names */
+    if (index_reserve(HAL_INDEX_PARAM, 2) != 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for param_alias\n");
+	return -EINVAL;
+    }
+    /* find the param and unlink it from param list */
+    param = halpr_find_param_by_name(param_name);
+    if (param == 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: param '%s' not found\n", param_name);
+	return -EINVAL;
     }
+    halpr_index_remove(HAL_INDEX_PARAM, param);
     if ( alias != NULL ) {
 	/* adding a new alias */
 	if ( param->oldname == 0 ) {
@@ -1550,29 +1530,9 @@ int hal_param_alias(const char *param_name, const char *alias)
 	}
     }
     /* insert param back into list in proper place */
-    prev = &(hal_data->param_list_ptr);
-    next = *prev;
-    while (1) {
-	if (next == 0) {
-	    /* reached end of list, insert here */
-	    param->next_ptr = next;
-	    *prev = SHMOFF(param);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    return 0;
-	}
-	ptr = SHMPTR(next);
-	cmp = strcmp(ptr->name, param->name);
-	if (cmp > 0) {
-	    /* found the right place for it, insert here */
-	    param->next_ptr = next;
-	    *prev = SHMOFF(param);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    return 0;
-	}
-	/* didn't find it yet, look at next one */
-	prev = &(ptr->next_ptr);
-	next = *prev;
-    }
+    halpr_index_insert(HAL_INDEX_PARAM, param);
+    rtapi_mutex_give(&(hal_data->mutex));
+    return 0;
 }
 
 /***********************************************************************
@@ -1584,8 +1544,7 @@ int hal_param_alias(const char *param_name, const char *alias)
 int hal_export_funct(const char *name, void (*funct) (void *, long),
     void *arg, int uses_fp, int reentrant, int comp_id)
 {
-    int *prev, next, cmp;
-    hal_funct_t *new, *fptr;
+    hal_funct_t *new;
     hal_comp_t *comp;
     char buf[HAL_NAME_LEN + 1];
 
@@ -1648,43 +1607,29 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
     new->arg = arg;
     new->funct = funct;
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
-    /* search list for 'name' and insert new structure */
-    prev = &(hal_data->funct_list_ptr);
-    next = *prev;
-    while (1) {
-	if (next == 0) {
-	    /* reached end of list, insert here */
-	    new->next_ptr = next;
-	    *prev = SHMOFF(new);
-	    /* break out of loop and init the new function */
-	    break;
-	}
-	fptr = SHMPTR(next);
-	cmp = strcmp(fptr->name, new->name);
-	if (cmp > 0) {
-	    /* found the right place for it, insert here */
-	    new->next_ptr = next;
-	    *prev = SHMOFF(new);
-	    /* break out of loop and init the new function */
-	    break;
-	}
-	if (cmp == 0) {
-	    /* name already in list, can't insert */
-	    free_funct_struct(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
-	    rtapi_print_msg(RTAPI_MSG_ERR,
-		"HAL: ERROR: duplicate function '%s'\n", name);
-	    return -EINVAL;
-	}
-	/* didn't find it yet, look at next one */
-	prev = &(fptr->next_ptr);
-	next = *prev;
+    /* insert new structure into the sorted list and name index */
+    if (index_reserve(HAL_INDEX_FUNCT, 1) != 0) {
+	free_funct_struct(new);
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for function '%s'\n", name);
+	return -ENOMEM;
+    }
+    if (halpr_index_insert(HAL_INDEX_FUNCT, new) != 0) {
+	/* name already in list, can't insert */
+	free_funct_struct(new);
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: duplicate function '%s'\n", name);
+	return -EINVAL;
     }
     /* at this point we have a new function and can yield the mutex */
     rtapi_mutex_give(&(hal_data->mutex));
     /* init time logging variables */
     new->runtime = 0;
     new->maxtime = 0;
+    new->stats.hist_ptr = 0;
+    halpr_stats_reset(&(new->stats));
     /* note that failure to successfully create the following params
        does not cause the "export_funct()" call to fail - they are
        for debugging and testing use only */
@@ -1837,14 +1782,54 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
 	    "HAL_LIB: could not start task for thread %s: %d\n", name, retval);
 	return -EINVAL;
     }
-    /* insert new structure at head of list */
-    new->next_ptr = hal_data->thread_list_ptr;
-    hal_data->thread_list_ptr = SHMOFF(new);
-    /* done, release mutex */
+    /* workers for parallel mode, they sleep on their semaphore until
+       the thread wakes them */
+    for (n = 0; n < HAL_MAX_WORKERS && worker_cpus[n] >= 0; n++) {
+	new->worker[n].thread_ptr = SHMOFF(new);
+	new->worker[n].lane = n + 1;
+	new->worker[n].cpu = worker_cpus[n];
+	new->worker[n].busy = 0;
+	retval = rtapi_sem_new(HAL_KEY + SHMOFF(&(new->worker[n])),
+	    lib_module_id);
+	if (retval < 0) {
+	    rtapi_print_msg(RTAPI_MSG_WARN,
+		"HAL_LIB: WARNING: no semaphore for worker on cpu %d for thread %s: %d\n",
+		worker_cpus[n], name, retval);
+	    break;
+	}
+	new->worker[n].sem_id = retval;
+	retval = rtapi_task_new_cpu(worker_task, &(new->worker[n]),
+	    new->priority, lib_module_id, HAL_STACKSIZE, uses_fp,
+	    worker_cpus[n]);
+	if (retval < 0) {
+	    rtapi_sem_delete(new->worker[n].sem_id, lib_module_id);
+	    rtapi_print_msg(RTAPI_MSG_WARN,
+		"HAL_LIB: WARNING: no worker on cpu %d for thread %s: %d\n",
+		worker_cpus[n], name, retval);
+	    break;
+	}
+	new->worker[n].task_id = retval;
+	retval = rtapi_task_resume(new->worker[n].task_id);
+	if (retval < 0) {
+	    rtapi_task_delete(new->worker[n].task_id);
+	    rtapi_sem_delete(new->worker[n].sem_id, lib_module_id);
+	    rtapi_print_msg(RTAPI_MSG_WARN,
+		"HAL_LIB: WARNING: could not start worker on cpu %d for thread %s: %d\n",
+		worker_cpus[n], name, retval);
+	    break;
+	}
+    }
+    new->workers = n;
+    /* insert new structure at head of list */
+    new->next_ptr = hal_data->thread_list_ptr;
+    hal_data->thread_list_ptr = SHMOFF(new);
+    /* done, release mutex */
     rtapi_mutex_give(&(hal_data->mutex));
     /* init time logging variables */
     new->runtime = 0;
     new->maxtime = 0;
+    new->stats.hist_ptr = 0;
+    halpr_stats_reset(&(new->stats));
 /*! \todo Another #if 0 */
 #if 0
 /* These params need to be re-visited when I refactor HAL.  Right
@@ -1914,9 +1899,7 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 {
     hal_thread_t *thread;
     hal_funct_t *funct;
-    hal_list_t *list_root, *list_entry;
-    int n;
-    hal_funct_entry_t *funct_entry;
+    int retval;
 
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -1935,13 +1918,6 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	funct_name, thread_name);
     /* get mutex before accessing data structures */
     rtapi_mutex_get(&(hal_data->mutex));
-    /* make sure position is valid */
-    if (position == 0) {
-	/* zero is not allowed */
-	rtapi_mutex_give(&(hal_data->mutex));
-	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: bad position: 0\n");
-	return -EINVAL;
-    }
     /* make sure we were given a function name */
     if (funct_name == 0) {
 	/* no name supplied */
@@ -1965,13 +1941,6 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	    "HAL: ERROR: function '%s' not found\n", funct_name);
 	return -EINVAL;
     }
-    /* found the function, is it available? */
-    if ((funct->users > 0) && (funct->reentrant == 0)) {
-	rtapi_mutex_give(&(hal_data->mutex));
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: function '%s' may only be added to one thread\n", funct_name);
-	return -EINVAL;
-    }
     /* search thread list for thread_name */
     thread = halpr_find_thread_by_name(thread_name);
     if (thread == 0) {
@@ -1981,11 +1950,35 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	    "HAL: ERROR: thread '%s' not found\n", thread_name);
 	return -EINVAL;
     }
-    /* ok, we have thread and function, are they compatible? */
+    retval = halpr_add_funct_to_thread(funct, thread, position);
+    rtapi_mutex_give(&(hal_data->mutex));
+    return retval;
+}
+
+int halpr_add_funct_to_thread(hal_funct_t * funct, hal_thread_t * thread,
+    int position)
+{
+    hal_list_t *list_root, *list_entry;
+    int n;
+    hal_funct_entry_t *funct_entry;
+
+    /* make sure position is valid */
+    if (position == 0) {
+	/* zero is not allowed */
+	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: bad position: 0\n");
+	return -EINVAL;
+    }
+    /* is the function available? */
+    if ((funct->users > 0) && (funct->reentrant == 0)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: function '%s' may only be added to one thread\n",
+	    funct->name);
+	return -EINVAL;
+    }
+    /* are thread and function compatible? */
     if ((funct->uses_fp) && (!thread->uses_fp)) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: function '%s' needs FP\n", funct_name);
+	    "HAL: ERROR: function '%s' needs FP\n", funct->name);
 	return -EINVAL;
     }
     /* find insertion point */
@@ -1999,7 +1992,6 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	    list_entry = list_next(list_entry);
 	    if (list_entry == list_root) {
 		/* reached end of list */
-		rtapi_mutex_give(&(hal_data->mutex));
 		rtapi_print_msg(RTAPI_MSG_ERR,
 		    "HAL: ERROR: position '%d' is too high\n", position);
 		return -EINVAL;
@@ -2012,7 +2004,6 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	    list_entry = list_prev(list_entry);
 	    if (list_entry == list_root) {
 		/* reached end of list */
-		rtapi_mutex_give(&(hal_data->mutex));
 		rtapi_print_msg(RTAPI_MSG_ERR,
 		    "HAL: ERROR: position '%d' is too low\n", position);
 		return -EINVAL;
@@ -2025,7 +2016,6 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
     funct_entry = alloc_funct_entry_struct();
     if (funct_entry == 0) {
 	/* alloc failed */
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for thread->function link\n");
 	return -ENOMEM;
@@ -2034,11 +2024,15 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
     funct_entry->funct_ptr = SHMOFF(funct);
     funct_entry->arg = funct->arg;
     funct_entry->funct = funct->funct;
+    /* not taken in any parallel period yet */
+    funct_entry->claim = thread->run;
+    funct_entry->done = thread->run;
     /* add the entry to the list */
+    thread_serial(thread);
     list_add_after((hal_list_t *) funct_entry, list_entry);
     /* update the function usage count */
     funct->users++;
-    rtapi_mutex_give(&(hal_data->mutex));
+    thread_plan(thread);
     return 0;
 }
 
@@ -2120,9 +2114,11 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
 	funct_entry = (hal_funct_entry_t *) list_entry;
 	if (SHMPTR(funct_entry->funct_ptr) == funct) {
 	    /* this funct entry points to our funct, unlink */
+	    thread_serial(thread);
 	    list_remove_entry(list_entry);
 	    /* and delete it */
 	    free_funct_entry_struct(funct_entry);
+	    thread_plan(thread);
 	    /* done */
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
@@ -2132,6 +2128,83 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
     }
 }
 
+#ifdef ULAPI
+int hal_thread_parallel(const char *name, int on)
+{
+    hal_thread_t *thread;
+
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread_parallel called before init\n");
+	return -EINVAL;
+    }
+
+    if (hal_data->lock & HAL_LOCK_CONFIG) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread_parallel called while HAL is locked\n");
+	return -EPERM;
+    }
+
+    /* get mutex before accessing data structures */
+    rtapi_mutex_get(&(hal_data->mutex));
+    thread = halpr_find_thread_by_name(name);
+    if (thread == 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread '%s' not found\n", name);
+	return -EINVAL;
+    }
+    if (on && thread->workers == 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread '%s' has no workers, see worker_cpus of hal_lib\n",
+	    name);
+	return -EINVAL;
+    }
+    thread->parallel = (on != 0);
+    thread_plan(thread);
+    rtapi_mutex_give(&(hal_data->mutex));
+    return 0;
+}
+
+int hal_stats_histogram(const char *name, int on)
+{
+    hal_thread_t *thread;
+    hal_funct_t *funct;
+    int retval;
+
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: stats_histogram called before init\n");
+	return -EINVAL;
+    }
+
+    /* get mutex before accessing data structures */
+    rtapi_mutex_get(&(hal_data->mutex));
+    thread = halpr_find_thread_by_name(name);
+    funct = halpr_find_funct_by_name(name);
+    if (thread == 0 && funct == 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: no thread or function '%s'\n", name);
+	return -EINVAL;
+    }
+    retval = 0;
+    if (thread != 0) {
+	retval = halpr_stats_histogram(&(thread->stats), on, shmalloc_up);
+    }
+    if (funct != 0 && retval == 0) {
+	retval = halpr_stats_histogram(&(funct->stats), on, shmalloc_up);
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for histogram of '%s'\n", name);
+    }
+    return retval;
+}
+#endif /* ULAPI */
+
 int hal_start_threads(void)
 {
     /* a trivial function for a change! */
@@ -2173,6 +2246,39 @@ int hal_stop_threads(void)
     return 0;
 }
 
+int hal_pack_signals(void)
+{
+    int retval;
+
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: pack_signals called before init\n");
+	return -EINVAL;
+    }
+    if (hal_data->lock & HAL_LOCK_CONFIG) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: pack_signals called while HAL locked\n");
+	return -EPERM;
+    }
+    rtapi_mutex_get(&(hal_data->mutex));
+    /* pins may not move under a running funct */
+    if (hal_data->threads_running) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: pack_signals called while threads are running\n");
+	return -EBUSY;
+    }
+    retval = halpr_pack_signals();
+    rtapi_mutex_give(&(hal_data->mutex));
+    if (retval < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory to pack signals\n");
+	return retval;
+    }
+    rtapi_print_msg(RTAPI_MSG_DBG, "HAL: %d signals packed\n", retval);
+    return retval;
+}
+
 /***********************************************************************
 *                    PRIVATE FUNCTION CODE                             *
 ************************************************************************/
@@ -2271,78 +2377,20 @@ hal_comp_t *halpr_find_comp_by_name(const char *name)
 
 hal_pin_t *halpr_find_pin_by_name(const char *name)
 {
-    int next;
-    hal_pin_t *pin;
-    hal_oldname_t *oldname;
-
-    /* search pin list for 'name' */
-    next = hal_data->pin_list_ptr;
-    while (next != 0) {
-	pin = SHMPTR(next);
-	if (strcmp(pin->name, name) == 0) {
-	    /* found a match */
-	    return pin;
-	}
-	if (pin->oldname != 0 ) {
-	    oldname = SHMPTR(pin->oldname);
-	    if (strcmp(oldname->name, name) == 0) {
-		/* found a match */
-		return pin;
-	    }
-	}
-	/* didn't find it yet, look at next one */
-	next = pin->next_ptr;
-    }
-    /* if loop terminates, we reached end of list with no match */
-    return 0;
+    /* look up 'name' (or old name of an aliased pin) in the index */
+    return halpr_index_find(HAL_INDEX_PIN, name);
 }
 
 hal_sig_t *halpr_find_sig_by_name(const char *name)
 {
-    int next;
-    hal_sig_t *sig;
-
-    /* search signal list for 'name' */
-    next = hal_data->sig_list_ptr;
-    while (next != 0) {
-	sig = SHMPTR(next);
-	if (strcmp(sig->name, name) == 0) {
-	    /* found a match */
-	    return sig;
-	}
-	/* didn't find it yet, look at next one */
-	next = sig->next_ptr;
-    }
-    /* if loop terminates, we reached end of list with no match */
-    return 0;
+    /* look up 'name' in the index */
+    return halpr_index_find(HAL_INDEX_SIG, name);
 }
 
 hal_param_t *halpr_find_param_by_name(const char *name)
 {
-    int next;
-    hal_param_t *param;
-    hal_oldname_t *oldname;
-
-    /* search parameter list for 'name' */
-    next = hal_data->param_list_ptr;
-    while (next != 0) {
-	param = SHMPTR(next);
-	if (strcmp(param->name, name) == 0) {
-	    /* found a match */
-	    return param;
-	}
-	if (param->oldname != 0 ) {
-	    oldname = SHMPTR(param->oldname);
-	    if (strcmp(oldname->name, name) == 0) {
-		/* found a match */
-		return param;
-	    }
-	}
-	/* didn't find it yet, look at next one */
-	next = param->next_ptr;
-    }
-    /* if loop terminates, we reached end of list with no match */
-    return 0;
+    /* look up 'name' (or old name of an aliased param) in the index */
+    return halpr_index_find(HAL_INDEX_PARAM, name);
 }
 
 hal_thread_t *halpr_find_thread_by_name(const char *name)
@@ -2367,22 +2415,8 @@ hal_thread_t *halpr_find_thread_by_name(const char *name)
 
 hal_funct_t *halpr_find_funct_by_name(const char *name)
 {
-    int next;
-    hal_funct_t *funct;
-
-    /* search function list for 'name' */
-    next = hal_data->funct_list_ptr;
-    while (next != 0) {
-	funct = SHMPTR(next);
-	if (strcmp(funct->name, name) == 0) {
-	    /* found a match */
-	    return funct;
-	}
-	/* didn't find it yet, look at next one */
-	next = funct->next_ptr;
-    }
-    /* if loop terminates, we reached end of list with no match */
-    return 0;
+    /* look up 'name' in the index */
+    return halpr_index_find(HAL_INDEX_FUNCT, name);
 }
 
 hal_comp_t *halpr_find_comp_by_id(int id)
@@ -2580,6 +2614,7 @@ int rtapi_app_main(void)
 {
     int retval;
     void *mem;
+    long int size;
 
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL_LIB: loading kernel lib\n");
     /* do RTAPI init */
@@ -2589,26 +2624,19 @@ int rtapi_app_main(void)
 	return -EINVAL;
     }
     /* get HAL shared memory block from RTAPI */
-    lib_mem_id = rtapi_shmem_new(HAL_KEY, lib_module_id, HAL_SIZE);
+    size = hal_size;
+    lib_mem_id = shmem_open(lib_module_id, &size, &mem);
     if (lib_mem_id < 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL_LIB: ERROR: could not open shared memory\n");
 	rtapi_exit(lib_module_id);
 	return -EINVAL;
     }
-    /* get address of shared memory area */
-    retval = rtapi_shmem_getptr(lib_mem_id, &mem);
-    if (retval < 0) {
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL_LIB: ERROR: could not access shared memory\n");
-	rtapi_exit(lib_module_id);
-	return -EINVAL;
-    }
     /* set up internal pointers to shared mem and data structure */
     hal_shmem_base = (char *) mem;
     hal_data = (hal_data_t *) mem;
     /* perform a global init if needed */
-    retval = init_hal_data();
+    retval = init_hal_data(size);
     if ( retval ) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL_LIB: ERROR: could not init shared memory\n");
@@ -2664,6 +2692,8 @@ static void thread_task(void *arg)
     hal_funct_entry_t *funct_root, *funct_entry;
     long long int start_time, end_time;
     long long int thread_start_time;
+    unsigned int run;
+    int n;
 
     thread = arg;
     while (1) {
@@ -2675,41 +2705,130 @@ static void thread_task(void *arg)
 	    start_time = rtapi_get_clocks();
 	    end_time = start_time;
 	    thread_start_time = start_time;
-	    /* run thru function list */
-	    while (funct_entry != funct_root) {
-		/* call the function */
-		funct_entry->funct(funct_entry->arg, thread->period);
-		/* capture execution time */
+	    /* odd until all functs ran, see hal_group_snapshot() */
+	    thread->seq++;
+	    hal_barrier();
+	    if (thread->lanes > 1) {
+		/* the workers are waiting for this */
+		run = thread->run + 1;
+		thread->run = run;
+		for (n = 0; n < thread->lanes - 1; n++) {
+		    rtapi_sem_give(thread->worker[n].sem_id);
+		}
+		halpr_parallel_run(thread, 0, run);
+		halpr_parallel_finish(thread, run);
 		end_time = rtapi_get_clocks();
-		/* point to function structure */
-		funct = SHMPTR(funct_entry->funct_ptr);
-		/* update execution time data */
-		funct->runtime = (hal_s32_t)(end_time - start_time);
-		if (funct->runtime > funct->maxtime) {
-		    funct->maxtime = funct->runtime;
+	    } else {
+		/* run thru function list */
+		while (funct_entry != funct_root) {
+		    /* call the function */
+		    funct_entry->funct(funct_entry->arg, thread->period);
+		    /* capture execution time */
+		    end_time = rtapi_get_clocks();
+		    /* point to function structure */
+		    funct = SHMPTR(funct_entry->funct_ptr);
+		    /* update execution time data */
+		    halpr_funct_ran(funct, (hal_s32_t)(end_time - start_time));
+		    /* point to next next entry in list */
+		    funct_entry = SHMPTR(funct_entry->links.next);
+		    /* prepare to measure time for next funct */
+		    start_time = end_time;
 		}
-		/* point to next next entry in list */
-		funct_entry = SHMPTR(funct_entry->links.next);
-		/* prepare to measure time for next funct */
-		start_time = end_time;
 	    }
+	    hal_barrier();
+	    thread->seq++;
 	    /* update thread execution time */
 	    thread->runtime = (hal_s32_t)(end_time - thread_start_time);
 	    if (thread->runtime > thread->maxtime) {
 		thread->maxtime = thread->runtime;
 	    }
+	    halpr_stats_update(&(thread->stats), thread->runtime);
 	}
 	/* wait until next period */
 	rtapi_wait();
     }
 }
+
+static void worker_task(void *arg)
+{
+    hal_worker_t *worker;
+    hal_thread_t *thread;
+    unsigned int last;
+
+    worker = arg;
+    thread = SHMPTR(worker->thread_ptr);
+    last = thread->run;
+    while (1) {
+	/* sleep until thread_task() starts a parallel period; wakeups
+	   for periods that are over by now are of no use */
+	rtapi_sem_take(worker->sem_id);
+	while (rtapi_sem_try(worker->sem_id) == 0) {
+	}
+	/* thread_serial() sees this before the lanes, or this sees
+	   the lanes it set */
+	worker->busy = 1;
+	hal_barrier();
+	if (thread->lanes > worker->lane && thread->run != last) {
+	    last = thread->run;
+	    halpr_parallel_run(thread, worker->lane, last);
+	}
+	hal_barrier();
+	worker->busy = 0;
+    }
+}
 #endif /* RTAPI */
 
 /* see the declarations of these functions (near top of file) for
    a description of what they do.
 */
 
-static int init_hal_data(void)
+static int shmem_open(int module_id, long int *size, void **mem)
+{
+    int mem_id, retval;
+    hal_data_t *header;
+
+    /* map just the header to see if the block exists */
+    mem_id = rtapi_shmem_new(HAL_KEY, module_id, sizeof(hal_data_t));
+    if (mem_id < 0) {
+	return mem_id;
+    }
+    retval = rtapi_shmem_getptr(mem_id, mem);
+    if (retval < 0) {
+	rtapi_shmem_delete(mem_id, module_id);
+	return retval;
+    }
+    header = *mem;
+    if (header->version == HAL_VER) {
+	/* already set up, take it as it is */
+	*size = header->shmem_size;
+    } else if (header->version != 0) {
+	/* somebody else's layout, init_hal_data() will complain */
+	*size = sizeof(hal_data_t);
+    } else {
+	/* new block, offsets have to fit in an int */
+	if (*size < HAL_SIZE) {
+	    *size = HAL_SIZE;
+	}
+	if (*size > 0x7FFFFFF8L) {
+	    *size = 0x7FFFFFF8L;
+	}
+	*size = (*size + 7) & (~7);
+    }
+    rtapi_shmem_delete(mem_id, module_id);
+    /* now map all of it */
+    mem_id = rtapi_shmem_new(HAL_KEY, module_id, *size);
+    if (mem_id < 0) {
+	return mem_id;
+    }
+    retval = rtapi_shmem_getptr(mem_id, mem);
+    if (retval < 0) {
+	rtapi_shmem_delete(mem_id, module_id);
+	return retval;
+    }
+    return mem_id;
+}
+
+static int init_hal_data(int size)
 {
     /* has the block already been initialized? */
     if (hal_data->version != 0) {
@@ -2746,9 +2865,20 @@ static int init_hal_data(void)
     list_init_entry(&(hal_data->funct_entry_free));
     hal_data->thread_free_ptr = 0;
     hal_data->exact_base_period = 0;
+    memset(&(hal_data->pin_index), 0, sizeof(hal_index_t));
+    memset(&(hal_data->sig_index), 0, sizeof(hal_index_t));
+    memset(&(hal_data->param_index), 0, sizeof(hal_index_t));
+    memset(&(hal_data->funct_index), 0, sizeof(hal_index_t));
+    memset(hal_data->pool_free_ptr, 0, sizeof(hal_data->pool_free_ptr));
+    hal_data->pool_large_ptr = 0;
+    hal_data->pool_free = 0;
+    hal_data->sig_pack_ptr = 0;
+    hal_data->sig_pack_size = 0;
     /* set up for shmalloc_xx() */
+    hal_data->shmem_size = size;
     hal_data->shmem_bot = sizeof(hal_data_t);
-    hal_data->shmem_top = HAL_SIZE;
+    hal_data->shmem_top = size;
+    hal_data->shmem_avail = hal_data->shmem_top - hal_data->shmem_bot;
     hal_data->lock = HAL_LOCK_NONE;
     /* done, release mutex */
     rtapi_mutex_give(&(hal_data->mutex));
@@ -2814,6 +2944,41 @@ static void *shmalloc_dn(long int size)
     return retval;
 }
 
+static int index_reserve(hal_index_kind_t kind, int count)
+{
+    return halpr_index_reserve(kind, count, shmalloc_dn);
+}
+
+static hal_comp_t *alloc_owner(void)
+{
+    hal_comp_t *comp;
+    int next;
+
+    /* newest components are at the head of the list */
+    next = hal_data->comp_list_ptr;
+    while (next != 0) {
+	comp = SHMPTR(next);
+	next = comp->next_ptr;
+#ifdef RTAPI
+	if (hal_data->pending_constructor != 0) {
+	    /* an instance being made belongs to its module */
+	    if (comp->make == hal_data->pending_constructor) {
+		return comp;
+	    }
+	    continue;
+	}
+	if (comp->type == 1) {
+	    return comp->ready ? 0 : comp;
+	}
+#else /* ULAPI */
+	if (comp->type == 0 && comp->pid == getpid()) {
+	    return comp->ready ? 0 : comp;
+	}
+#endif
+    }
+    return 0;
+}
+
 hal_comp_t *halpr_alloc_comp_struct(void)
 {
     hal_comp_t *p;
@@ -2837,6 +3002,8 @@ hal_comp_t *halpr_alloc_comp_struct(void)
 	p->type = 0;
 	p->shmem_base = 0;
 	p->name[0] = '\0';
+	p->mem_ptr = 0;
+	p->mem_bytes = 0;
     }
     return p;
 }
@@ -3001,6 +3168,8 @@ static hal_funct_entry_t *alloc_funct_entry_struct(void)
 	p->funct_ptr = 0;
 	p->arg = 0;
 	p->funct = 0;
+	p->lane = 0;
+	memset(p->wait_ptr, 0, sizeof(p->wait_ptr));
     }
     return p;
 }
@@ -3028,6 +3197,10 @@ static hal_thread_t *alloc_thread_struct(void)
 	p->period = 0;
 	p->priority = 0;
 	p->task_id = 0;
+	p->seq = 0;
+	p->workers = 0;
+	p->lanes = 1;
+	p->run = 0;
 	list_init_entry(&(p->funct_list));
 	p->name[0] = '\0';
     }
@@ -3037,7 +3210,7 @@ static hal_thread_t *alloc_thread_struct(void)
 
 static void free_comp_struct(hal_comp_t * comp)
 {
-    int *prev, next;
+    int next;
 #ifdef RTAPI
     hal_funct_t *funct;
 #endif /* RTAPI */
@@ -3048,54 +3221,44 @@ static void free_comp_struct(hal_comp_t * comp)
     /* need to check for functs only if a realtime component */
 #ifdef RTAPI
     /* search the function list for this component's functs */
-    prev = &(hal_data->funct_list_ptr);
-    next = *prev;
+    next = hal_data->funct_list_ptr;
     while (next != 0) {
 	funct = SHMPTR(next);
+	next = funct->next_ptr;
 	if (SHMPTR(funct->owner_ptr) == comp) {
 	    /* this function belongs to our component, unlink from list */
-	    *prev = funct->next_ptr;
+	    halpr_index_remove(HAL_INDEX_FUNCT, funct);
 	    /* and delete it */
 	    free_funct_struct(funct);
-	} else {
-	    /* no match, try the next one */
-	    prev = &(funct->next_ptr);
 	}
-	next = *prev;
     }
 #endif /* RTAPI */
     /* search the pin list for this component's pins */
-    prev = &(hal_data->pin_list_ptr);
-    next = *prev;
+    next = hal_data->pin_list_ptr;
     while (next != 0) {
 	pin = SHMPTR(next);
+	next = pin->next_ptr;
 	if (SHMPTR(pin->owner_ptr) == comp) {
 	    /* this pin belongs to our component, unlink from list */
-	    *prev = pin->next_ptr;
+	    halpr_index_remove(HAL_INDEX_PIN, pin);
 	    /* and delete it */
 	    free_pin_struct(pin);
-	} else {
-	    /* no match, try the next one */
-	    prev = &(pin->next_ptr);
 	}
-	next = *prev;
     }
     /* search the parameter list for this component's parameters */
-    prev = &(hal_data->param_list_ptr);
-    next = *prev;
+    next = hal_data->param_list_ptr;
     while (next != 0) {
 	param = SHMPTR(next);
+	next = param->next_ptr;
 	if (SHMPTR(param->owner_ptr) == comp) {
 	    /* this param belongs to our component, unlink from list */
-	    *prev = param->next_ptr;
+	    halpr_index_remove(HAL_INDEX_PARAM, param);
 	    /* and delete it */
 	    free_param_struct(param);
-	} else {
-	    /* no match, try the next one */
-	    prev = &(param->next_ptr);
 	}
-	next = *prev;
     }
+    /* give back what it got from hal_malloc() */
+    halpr_pool_release(comp);
     /* now we can delete the component itself */
     /* clear contents of struct */
     comp->comp_id = 0;
@@ -3222,6 +3385,8 @@ static void free_funct_struct(hal_funct_t * funct)
 	while (next_thread != 0) {
 	    /* point to thread */
 	    thread = SHMPTR(next_thread);
+	    /* the workers must not see the entries go */
+	    thread_serial(thread);
 	    /* start at root of funct_entry list */
 	    list_root = &(thread->funct_list);
 	    list_entry = list_next(list_root);
@@ -3252,6 +3417,8 @@ static void free_funct_struct(hal_funct_t * funct)
     funct->arg = 0;
     funct->funct = 0;
     funct->name[0] = '\0';
+    /* the histogram goes back to the pool */
+    halpr_stats_histogram(&(funct->stats), 0, 0);
     /* add it to free list */
     funct->next_ptr = hal_data->funct_free_ptr;
     hal_data->funct_free_ptr = SHMOFF(funct);
@@ -3280,6 +3447,7 @@ static void free_thread_struct(hal_thread_t * thread)
 {
     hal_funct_entry_t *funct_entry;
     hal_list_t *list_root, *list_entry;
+    int n;
 /*! \todo Another #if 0 */
 #if 0
     int *prev, next;
@@ -3292,6 +3460,18 @@ static void free_thread_struct(hal_thread_t * thread)
     /* and stop the task associated with this thread */
     rtapi_task_pause(thread->task_id);
     rtapi_task_delete(thread->task_id);
+    /* and its workers */
+    thread->lanes = 1;
+    for (n = 0; n < thread->workers; n++) {
+	rtapi_task_pause(thread->worker[n].task_id);
+	rtapi_task_delete(thread->worker[n].task_id);
+	rtapi_sem_delete(thread->worker[n].sem_id, lib_module_id);
+	thread->worker[n].task_id = 0;
+	thread->worker[n].sem_id = 0;
+    }
+    thread->workers = 0;
+    /* the histogram goes back to the pool */
+    halpr_stats_histogram(&(thread->stats), 0, 0);
     /* clear contents of struct */
     thread->uses_fp = 0;
     thread->period = 0;
@@ -3344,6 +3524,83 @@ static void free_thread_struct(hal_thread_t * thread)
 }
 #endif /* RTAPI */
 
+static void thread_serial(hal_thread_t * thread)
+{
+    unsigned int seq;
+    int n;
+
+    if (thread->lanes <= 1) {
+	return;
+    }
+    thread->lanes = 1;
+    hal_barrier();
+    /* the period under way, if any, runs to its end in parallel;
+       the ones after it see the single lane */
+    seq = thread->seq;
+    while ((seq & 1) && thread->seq == seq) {
+#ifdef ULAPI
+	sched_yield();
+#endif
+	hal_barrier();
+    }
+    /* and a worker woken late may still walk the list */
+    for (n = 0; n < thread->workers; n++) {
+	while (thread->worker[n].busy) {
+#ifdef ULAPI
+	    sched_yield();
+#endif
+	    hal_barrier();
+	}
+    }
+}
+
+static void thread_plan(hal_thread_t * thread)
+{
+#ifdef ULAPI
+    hal_graph_t graph;
+#endif
+
+    thread_serial(thread);
+    if (!thread->parallel) {
+	return;
+    }
+#ifdef ULAPI
+    if (halpr_graph_build(thread, &graph) != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: no memory to plan thread '%s', it runs serial\n",
+	    thread->name);
+	return;
+    }
+    halpr_graph_schedule(&graph, thread->workers + 1);
+    halpr_graph_apply(&graph);
+    halpr_graph_free(&graph);
+    /* lanes and waits are out before anybody runs them */
+    hal_barrier();
+    thread->lanes = thread->workers + 1;
+#else
+    /* planning takes malloc(), it stays serial until halcmd plans
+       it again after the module that changed it is in or out */
+    rtapi_print_msg(RTAPI_MSG_INFO,
+	"HAL: thread '%s' runs serial until it is planned again\n",
+	thread->name);
+#endif
+}
+
+void halpr_threads_replan(void)
+{
+    int next;
+    hal_thread_t *thread;
+
+    next = hal_data->thread_list_ptr;
+    while (next != 0) {
+	thread = SHMPTR(next);
+	if (thread->parallel) {
+	    thread_plan(thread);
+	}
+	next = thread->next_ptr;
+    }
+}
+
 
 #ifdef RTAPI
 /* only export symbols when we're building a kernel module */
@@ -3399,6 +3656,7 @@ EXPORT_SYMBOL(hal_del_funct_from_thread);
 
 EXPORT_SYMBOL(hal_start_threads);
 EXPORT_SYMBOL(hal_stop_threads);
+EXPORT_SYMBOL(hal_pack_signals);
 
 EXPORT_SYMBOL(hal_shmem_base);
 EXPORT_SYMBOL(halpr_find_comp_by_name);
@@ -3415,4 +3673,9 @@ EXPORT_SYMBOL(halpr_find_funct_by_owner);
 
 EXPORT_SYMBOL(halpr_find_pin_by_sig);
 
+EXPORT_SYMBOL(halpr_signal_new);
+EXPORT_SYMBOL(halpr_link);
+EXPORT_SYMBOL(halpr_add_funct_to_thread);
+EXPORT_SYMBOL(halpr_threads_replan);
+
 #endif /* rtapi */
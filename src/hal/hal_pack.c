@@ -0,0 +1,182 @@
+/********************************************************************
+* Description:  hal_pack.c
+*               Moves the values of the signals that the realtime
+*               threads use into one cache line aligned block, in the
+*               order the thread functions touch them, so a servo
+*               period reads a few contiguous lines instead of values
+*               scattered over the whole shared memory.
+*
+*               Part of the HAL library, used by both user space
+*               and realtime code.  The caller holds the hal_data
+*               mutex and the threads are stopped.
+*
+*               The first place of each value, from hal_signal_new(),
+*               is left behind unused, and so is an old block that the
+*               new layout outgrew: HAL shared memory is never freed.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+/** This library is free software; you can redistribute it and/or
+    modify it under the terms of version 2.1 of the GNU Lesser General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+
+#include "rtapi_string.h"
+
+/* where the new layout is built before it is copied into place */
+typedef struct {
+    long image;			/* offset of the image, in free shmem */
+    long used;			/* bytes of it used so far */
+    int count;			/* signals placed */
+} pack_state_t;
+
+static int sig_size(hal_type_t type)
+{
+    switch (type) {
+    case HAL_BIT:
+	return sizeof(hal_bit_t);
+    case HAL_S32:
+	return sizeof(hal_s32_t);
+    case HAL_U32:
+	return sizeof(hal_u32_t);
+    default:
+	return sizeof(hal_float_t);
+    }
+}
+
+/* copies the value of 'sig' to the end of the image, naturally
+   aligned, unless an earlier funct already put it there */
+static void pack_sig(pack_state_t * state, hal_sig_t * sig)
+{
+    long size, pos;
+
+    if (sig->data_ptr >= state->image &&
+	sig->data_ptr < state->image + state->used) {
+	return;
+    }
+    size = sig_size(sig->type);
+    pos = (state->used + size - 1) & ~(size - 1);
+    memcpy(SHMPTR(state->image + pos), SHMPTR(sig->data_ptr), size);
+    sig->data_ptr = state->image + pos;
+    state->used = pos + size;
+    state->count++;
+}
+
+/* the linked signals of all pins of the component that owns 'funct' */
+static void pack_funct(pack_state_t * state, hal_funct_t * funct)
+{
+    int next;
+    hal_pin_t *pin;
+
+    next = hal_data->pin_list_ptr;
+    while (next != 0) {
+	pin = SHMPTR(next);
+	if (pin->owner_ptr == funct->owner_ptr && pin->signal != 0) {
+	    pack_sig(state, SHMPTR(pin->signal));
+	}
+	next = pin->next_ptr;
+    }
+}
+
+int halpr_pack_signals(void)
+{
+    pack_state_t state;
+    hal_thread_t *thread;
+    hal_list_t *list_root, *list_entry;
+    hal_funct_entry_t *fentry;
+    hal_sig_t *sig;
+    hal_pin_t *pin;
+    hal_comp_t *comp;
+    long block, old_end, bound;
+    int next;
+
+    /* the image goes in free memory, make sure the worst case fits
+       before anything is moved */
+    state.image = (hal_data->shmem_bot + HAL_CACHE_LINE - 1) &
+	~(HAL_CACHE_LINE - 1);
+    state.used = 0;
+    state.count = 0;
+    bound = 0;
+    next = hal_data->sig_list_ptr;
+    while (next != 0) {
+	sig = SHMPTR(next);
+	bound += sizeof(hal_data_u);
+	next = sig->next_ptr;
+    }
+    if (state.image + bound + HAL_CACHE_LINE > hal_data->shmem_top) {
+	return -ENOMEM;
+    }
+    /* threads in list order, functs in execution order */
+    next = hal_data->thread_list_ptr;
+    while (next != 0) {
+	thread = SHMPTR(next);
+	list_root = &(thread->funct_list);
+	list_entry = list_next(list_root);
+	while (list_entry != list_root) {
+	    fentry = (hal_funct_entry_t *) list_entry;
+	    pack_funct(&state, SHMPTR(fentry->funct_ptr));
+	    list_entry = list_next(list_entry);
+	}
+	next = thread->next_ptr;
+    }
+    /* signals left in the old block must move out before it is reused */
+    old_end = hal_data->sig_pack_ptr + hal_data->sig_pack_size;
+    next = hal_data->sig_list_ptr;
+    while (next != 0) {
+	sig = SHMPTR(next);
+	if (sig->data_ptr >= hal_data->sig_pack_ptr && sig->data_ptr < old_end) {
+	    pack_sig(&state, sig);
+	}
+	next = sig->next_ptr;
+    }
+    /* reuse the old block if the new layout fits, else keep the image */
+    if (hal_data->sig_pack_ptr != 0 && state.used <= hal_data->sig_pack_size) {
+	block = hal_data->sig_pack_ptr;
+	memcpy(SHMPTR(block), SHMPTR(state.image), state.used);
+    } else {
+	block = state.image;
+	hal_data->sig_pack_ptr = block;
+	hal_data->sig_pack_size = (state.used + HAL_CACHE_LINE - 1) &
+	    ~(HAL_CACHE_LINE - 1);
+	hal_data->shmem_bot = block + hal_data->sig_pack_size;
+	hal_data->shmem_avail = hal_data->shmem_top - hal_data->shmem_bot;
+    }
+    next = hal_data->sig_list_ptr;
+    while (next != 0) {
+	sig = SHMPTR(next);
+	if (sig->data_ptr >= state.image &&
+	    sig->data_ptr < state.image + state.used) {
+	    sig->data_ptr += block - state.image;
+	}
+	next = sig->next_ptr;
+    }
+    /* point the linked pins at the new places */
+    next = hal_data->pin_list_ptr;
+    while (next != 0) {
+	pin = SHMPTR(next);
+	if (pin->signal != 0) {
+	    sig = SHMPTR(pin->signal);
+	    comp = SHMPTR(pin->owner_ptr);
+	    *((void **) SHMPTR(pin->data_ptr_addr)) =
+		comp->shmem_base + sig->data_ptr;
+	}
+	next = pin->next_ptr;
+    }
+    /* cached data_ptrs are stale now, see scope_rt */
+    hal_data->pack_seq++;
+    return state.count;
+}
@@ -0,0 +1,150 @@
+/********************************************************************
+* Description:  hal_parallel.c
+*               Runs the functs of a thread in parallel mode.  The
+*               thread's task and its worker tasks each run one lane
+*               of the schedule hal_thread_parallel() made, and wait
+*               for the entries of other lanes a funct depends on.
+*
+*               Every entry is taken with a compare and swap before
+*               it runs, so it runs once per period no matter who
+*               gets to it.  Whoever waits for an entry runs what
+*               nobody took yet, in thread order, so a late or dead
+*               worker only costs time, and a stale schedule can't
+*               deadlock.
+*
+*               Part of the HAL library, the functions are called
+*               from realtime tasks without the mutex.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+/** This library is free software; you can redistribute it and/or
+    modify it under the terms of version 2.1 of the GNU Lesser General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+
+/* periods are counted with wrap around, an entry is done (or taken)
+   for 'run' if its stamp is 'run' or later */
+static int stamped(volatile unsigned int *stamp, unsigned int run)
+{
+    return (int) (*stamp - run) >= 0;
+}
+
+/* takes 'entry' for period 'run', 0 if somebody else has it */
+static int claim(hal_funct_entry_t * entry, unsigned int run)
+{
+    unsigned int old;
+
+    old = entry->claim;
+    if ((int) (old - run) >= 0) {
+	return 0;
+    }
+    return __sync_bool_compare_and_swap(&(entry->claim), old, run);
+}
+
+static void run_entry(hal_thread_t * thread, hal_funct_entry_t * entry,
+    unsigned int run)
+{
+    long long int start_time;
+
+    start_time = rtapi_get_clocks();
+    entry->funct(entry->arg, thread->period);
+    halpr_funct_ran(SHMPTR(entry->funct_ptr),
+	(hal_s32_t) (rtapi_get_clocks() - start_time));
+    /* what the funct wrote is out before anybody sees it done */
+    hal_barrier();
+    entry->done = run;
+}
+
+/* returns when 'target' (0 for all entries) is done, running entries
+   up to it that nobody took yet.  In thread order everything an entry
+   depends on comes before it, so when an entry is taken here all it
+   needs is done already. */
+static void wait_for(hal_thread_t * thread, hal_funct_entry_t * target,
+    unsigned int run)
+{
+    hal_list_t *root, *list_entry;
+    hal_funct_entry_t *entry;
+
+    root = &(thread->funct_list);
+    list_entry = SHMPTR(root->next);
+    while (list_entry != root) {
+	if (target != 0 && stamped(&(target->done), run)) {
+	    break;
+	}
+	entry = (hal_funct_entry_t *) list_entry;
+	if (claim(entry, run)) {
+	    run_entry(thread, entry, run);
+	} else {
+	    while (!stamped(&(entry->done), run)) {
+	    }
+	}
+	if (entry == target) {
+	    break;
+	}
+	list_entry = SHMPTR(list_entry->next);
+    }
+    hal_barrier();
+}
+
+void halpr_parallel_run(hal_thread_t * thread, int lane, unsigned int run)
+{
+    hal_list_t *root, *list_entry;
+    hal_funct_entry_t *entry, *need;
+    int n;
+
+    root = &(thread->funct_list);
+    list_entry = SHMPTR(root->next);
+    while (list_entry != root) {
+	entry = (hal_funct_entry_t *) list_entry;
+	list_entry = SHMPTR(list_entry->next);
+	if (entry->lane != lane) {
+	    continue;
+	}
+	/* lanes run in order, so the last entry needed from a lane
+	   being done means all before it are */
+	for (n = 0; n < HAL_MAX_LANES; n++) {
+	    if (entry->wait_ptr[n] != 0) {
+		need = SHMPTR(entry->wait_ptr[n]);
+		if (!stamped(&(need->done), run)) {
+		    wait_for(thread, need, run);
+		}
+	    }
+	}
+	if (claim(entry, run)) {
+	    run_entry(thread, entry, run);
+	} else {
+	    /* somebody helped out, the next one may need it */
+	    while (!stamped(&(entry->done), run)) {
+	    }
+	    hal_barrier();
+	}
+    }
+}
+
+void halpr_parallel_finish(hal_thread_t * thread, unsigned int run)
+{
+    wait_for(thread, 0, run);
+}
+
+void halpr_funct_ran(hal_funct_t * funct, hal_s32_t time)
+{
+    funct->runtime = time;
+    if (funct->runtime > funct->maxtime) {
+	funct->maxtime = funct->runtime;
+    }
+    halpr_stats_update(&(funct->stats), funct->runtime);
+}
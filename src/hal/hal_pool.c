@@ -0,0 +1,149 @@
+/********************************************************************
+* Description:  hal_pool.c
+*               Size class free lists for hal_malloc() memory, so
+*               that what a component allocated can be reused after
+*               it exits.
+*
+*               Part of the HAL library, used by both user space
+*               and realtime code.  All functions assume the caller
+*               holds the hal_data mutex.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+/** This library is free software; you can redistribute it and/or
+    modify it under the terms of version 2.1 of the GNU Lesser General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+
+#include "rtapi_string.h"
+
+/* size class of a hal_malloc() request, -1 for the big block list.
+   Sets 'class_size' to the size the block gets rounded up to. */
+static int pool_class(long int size, long int *class_size)
+{
+    int shift, step;
+    long int n;
+
+    if (size <= 256) {
+	/* 8 byte steps */
+	n = (size + 7) >> 3;
+	if (n == 0) {
+	    n = 1;
+	}
+	*class_size = n << 3;
+	return n - 1;
+    }
+    /* four classes between 2^shift and 2^(shift+1) */
+    shift = 8;
+    while (size > (2L << shift)) {
+	shift++;
+    }
+    if (shift > 15) {
+	*class_size = (size + 7) & (~7);
+	return -1;
+    }
+    step = 1 << (shift - 2);
+    n = (size - (1L << shift) + step - 1) / step;
+    *class_size = (1L << shift) + n * step;
+    return 32 + (shift - 8) * 4 + n - 1;
+}
+
+void *halpr_pool_alloc(long int size, hal_comp_t * owner,
+    void *(*alloc) (long int size))
+{
+    hal_pool_block_t *block, *p;
+    long int block_size;
+    int *prev, class;
+
+    class = pool_class(size, &block_size);
+    block = 0;
+    if (class >= 0) {
+	/* any free block of the class will do */
+	if (hal_data->pool_free_ptr[class] != 0) {
+	    block = SHMPTR(hal_data->pool_free_ptr[class]);
+	    hal_data->pool_free_ptr[class] = block->next_ptr;
+	}
+    } else {
+	/* first big block that is large enough */
+	prev = &(hal_data->pool_large_ptr);
+	while (*prev != 0) {
+	    p = SHMPTR(*prev);
+	    if (p->size >= block_size) {
+		*prev = p->next_ptr;
+		block = p;
+		break;
+	    }
+	    prev = &(p->next_ptr);
+	}
+    }
+    if (block != 0) {
+	/* re-used, hand it out cleared like fresh shmem */
+	hal_data->pool_free -= sizeof(hal_pool_block_t) + block->size;
+	memset(block + 1, 0, block->size);
+    } else {
+	/* nothing to re-use, carve a new block */
+	block = alloc(sizeof(hal_pool_block_t) + block_size);
+	if (block == 0) {
+	    return 0;
+	}
+	block->size = block_size;
+    }
+    block->next_ptr = 0;
+    if (owner != 0) {
+	block->next_ptr = owner->mem_ptr;
+	owner->mem_ptr = SHMOFF(block);
+	owner->mem_bytes += sizeof(hal_pool_block_t) + block->size;
+    }
+    return block + 1;
+}
+
+/* puts 'block' on the free list of its class */
+static void pool_put(hal_pool_block_t * block)
+{
+    long int block_size;
+    int class;
+
+    class = pool_class(block->size, &block_size);
+    if (class >= 0) {
+	block->next_ptr = hal_data->pool_free_ptr[class];
+	hal_data->pool_free_ptr[class] = SHMOFF(block);
+    } else {
+	block->next_ptr = hal_data->pool_large_ptr;
+	hal_data->pool_large_ptr = SHMOFF(block);
+    }
+    hal_data->pool_free += sizeof(hal_pool_block_t) + block->size;
+}
+
+void halpr_pool_release(hal_comp_t * comp)
+{
+    hal_pool_block_t *block;
+    int next;
+
+    next = comp->mem_ptr;
+    while (next != 0) {
+	block = SHMPTR(next);
+	next = block->next_ptr;
+	pool_put(block);
+    }
+    comp->mem_ptr = 0;
+    comp->mem_bytes = 0;
+}
+
+void halpr_pool_free(void *mem)
+{
+    pool_put((hal_pool_block_t *) mem - 1);
+}
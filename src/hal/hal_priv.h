@@ -105,7 +105,7 @@ RTAPI_BEGIN_DECLS
    location that is part of the HAL shared memory block. */
 
 #define SHMCHK(ptr)  ( ((char *)(ptr)) > (hal_shmem_base) && \
-                       ((char *)(ptr)) < (hal_shmem_base + HAL_SIZE) )
+                       ((char *)(ptr)) < (hal_shmem_base + hal_data->shmem_size) )
 
 /** The good news is that none of this linked list complexity is
     visible to the components that use this API.  Complexity here
@@ -151,6 +151,65 @@ typedef struct {
     char name[HAL_NAME_LEN + 1];	/* the original name */
 } hal_oldname_t;
 
+/** HAL name index.
+    Pins, signals, parameters and functions are kept in linked lists
+    sorted by name, which is what 'halcmd show' and friends walk.  On
+    top of that each list carries a skip list (the 'skip_ptr' express
+    lanes right after 'next_ptr' in the object structs) that keeps
+    sorted insertion fast, and an open addressing hash table that maps
+    names (and old names of aliased objects) to objects.  Every lane
+    skips about 16 objects of the one below, so two lanes cost each
+    object 8 bytes and keep an insert into 20000 pins at a few dozen
+    steps.  The hash table comes from the hal_malloc() pool and goes
+    back to it when it is replaced by a bigger one.  Everything is
+    stored as shmem offsets.
+*/
+#define HAL_INDEX_LEVELS 3
+
+typedef struct {
+    int lanes[HAL_INDEX_LEVELS - 1];	/* roots of the express lanes */
+    int slots_ptr;		/* hash slot array, 0 if none yet */
+    int size;			/* number of hash slots (power of 2) */
+    int used;			/* live plus deleted slots */
+    int count;			/* live slots */
+} hal_index_t;
+
+typedef struct {
+    unsigned int hash;		/* hash of the name */
+    int ptr;			/* object, 0 = empty, -1 = deleted */
+} hal_index_slot_t;
+
+typedef enum {
+    HAL_INDEX_PIN,
+    HAL_INDEX_SIG,
+    HAL_INDEX_PARAM,
+    HAL_INDEX_FUNCT
+} hal_index_kind_t;
+
+/** A full memory barrier, for the sequence counts of the stats,
+    signal groups and threads: neither the compiler nor the CPU moves
+    loads or stores across it, so readers on other CPUs see the data
+    and the count change in the order they were written.
+*/
+#define hal_barrier() __sync_synchronize()
+
+/** 'halpr_pack_signals()' aligns the packed signal block to this. */
+#define HAL_CACHE_LINE 64
+
+/** Memory handed out by hal_malloc() comes from a pool.  Each block
+    has a small header and is rounded up to a size class: 8 bytes
+    apart up to 256 bytes, then four classes per power of two up to
+    64k.  Bigger blocks share a single first fit list.  While in use
+    a block is chained to the component that allocated it, when that
+    component exits the block goes to the free list of its class.
+*/
+#define HAL_POOL_CLASSES 64
+
+typedef struct {
+    int next_ptr;		/* next block of owner, or next free block */
+    int size;			/* usable size, always a class size */
+} hal_pool_block_t;
+
 /* Master HAL data structure
    There is a single instance of this structure in the machine.
    It resides at the base of the HAL shared memory block, where it
@@ -161,6 +220,7 @@ typedef struct {
 */
 typedef struct {
     int version;		/* version code for structs, etc */
+    int shmem_size;		/* size of the whole shmem block */
     unsigned long mutex;	/* protection for linked lists, etc. */
     hal_s32_t shmem_avail;	/* amount of shmem left free */
     constructor pending_constructor;
@@ -190,8 +250,43 @@ typedef struct {
     int exact_base_period;      /* if set, pretend that rtapi satisfied our
 				   period request exactly */
     unsigned char lock;         /* hal locking, can be one of the HAL_LOCK_* types */
+    hal_index_t pin_index;	/* name index of the pin list */
+    hal_index_t sig_index;	/* name index of the signal list */
+    hal_index_t param_index;	/* name index of the parameter list */
+    hal_index_t funct_index;	/* name index of the function list */
+    int pool_free_ptr[HAL_POOL_CLASSES];
+				/* free hal_malloc() blocks by class */
+    int pool_large_ptr;		/* free blocks too big for a class */
+    hal_s32_t pool_free;	/* bytes in free blocks, headers included */
+    int sig_pack_ptr;		/* block of packed signal values, or 0 */
+    int sig_pack_size;		/* its size, whole cache lines */
+    volatile unsigned int pack_seq;	/* bumped when signal values move */
 } hal_data_t;
 
+/** Run time statistics of a funct or thread.  Only the thread that
+    runs it writes them.  Readers copy them with halpr_stats_snapshot(),
+    which retries while 'seq' is odd or changes under it, and ask for a
+    reset by setting 'reset', which the writer acts on at its next run.
+    The histogram for percentiles is only there while it is turned on
+    ('halcmd histogram'), as a block from the hal_malloc() pool, so the
+    functs and threads themselves carry just the sums.  It is log scale
+    with four buckets per power of two: 0, 1, 2, 3, 4, ... 7, 8-9,
+    10-11, ... 14-15, 16-19, ...  Before the sums can overflow all
+    counts are halved, so a very long run becomes a decaying average.
+*/
+#define HAL_STATS_BUCKETS 128
+
+typedef struct {
+    volatile unsigned int seq;	/* odd while being updated */
+    volatile int reset;		/* set by readers to clear the stats */
+    hal_s32_t min;		/* shortest run */
+    hal_s32_t max;		/* longest run */
+    unsigned int count;		/* number of runs */
+    volatile int hist_ptr;	/* runs per bucket, 0 if not kept */
+    unsigned long long sum;	/* sum of run times */
+    unsigned long long sumsq;	/* sum of squared run times */
+} hal_stats_t;
+
 /** HAL 'component' data structure.
     This structure contains information that is unique to a HAL component.
     An instance of this structure is added to a linked list when the
@@ -208,6 +303,8 @@ typedef struct {
     char name[HAL_NAME_LEN + 1];	/* component name */
     constructor make;
     int insmod_args;		/* args passed to insmod when loaded */
+    int mem_ptr;		/* hal_malloc() blocks owned by this comp */
+    hal_s32_t mem_bytes;	/* their size, headers included */
 } hal_comp_t;
 
 /** HAL 'pin' data structure.
@@ -215,6 +312,7 @@ typedef struct {
 */
 typedef struct {
     int next_ptr;		/* next pin in linked list */
+    int skip_ptr[HAL_INDEX_LEVELS - 1];	/* name index lanes, must follow next_ptr */
     int data_ptr_addr;		/* address of pin data pointer */
     int owner_ptr;		/* component that owns this pin */
     int signal;			/* signal to which pin is linked */
@@ -230,6 +328,7 @@ typedef struct {
 */
 typedef struct {
     int next_ptr;		/* next signal in linked list */
+    int skip_ptr[HAL_INDEX_LEVELS - 1];	/* name index lanes, must follow next_ptr */
     int data_ptr;		/* offset of signal value */
     hal_type_t type;		/* data type */
     int readers;		/* number of input pins linked */
@@ -243,6 +342,7 @@ typedef struct {
 */
 typedef struct {
     int next_ptr;		/* next parameter in linked list */
+    int skip_ptr[HAL_INDEX_LEVELS - 1];	/* name index lanes, must follow next_ptr */
     int data_ptr;		/* offset of parameter value */
     int owner_ptr;		/* component that owns this signal */
     int oldname;		/* old name if aliased, else zero */
@@ -269,6 +369,7 @@ typedef struct {
 
 typedef struct {
     int next_ptr;		/* next function in linked list */
+    int skip_ptr[HAL_INDEX_LEVELS - 1];	/* name index lanes, must follow next_ptr */
     int uses_fp;		/* floating point flag */
     int owner_ptr;		/* component that added this funct */
     int reentrant;		/* non-zero if function is re-entrant */
@@ -277,18 +378,38 @@ typedef struct {
     void (*funct) (void *, long);	/* ptr to function code */
     hal_s32_t runtime;		/* duration of last run, in nsec */
     hal_s32_t maxtime;		/* duration of longest run, in nsec */
+    hal_stats_t stats;		/* run time statistics */
     char name[HAL_NAME_LEN + 1];	/* function name */
 } hal_funct_t;
 
+/* A thread in parallel mode spreads its functs over lanes: its own
+   task runs lane 0, and worker tasks pinned to the CPUs hal_lib got as
+   'worker_cpus' run the others.  See hal_thread_parallel(). */
+#define HAL_MAX_WORKERS 7
+#define HAL_MAX_LANES (HAL_MAX_WORKERS + 1)
+
 typedef struct {
     hal_list_t links;		/* linked list data */
     void *arg;			/* argument for function */
     void (*funct) (void *, long);	/* ptr to function code */
     int funct_ptr;		/* pointer to function */
+    int lane;			/* lane that runs it in parallel mode */
+    int wait_ptr[HAL_MAX_LANES];	/* last entry of each other lane it needs */
+    volatile unsigned int claim;	/* parallel period it was taken in */
+    volatile unsigned int done;	/* parallel period it last finished */
 } hal_funct_entry_t;
 
 #define HAL_STACKSIZE 16384	/* realtime task stacksize */
 
+typedef struct {
+    int thread_ptr;		/* thread it works for */
+    int lane;			/* lane it runs, 1 and up */
+    int cpu;			/* CPU its task is pinned to */
+    int task_id;		/* ID of that task */
+    int sem_id;			/* semaphore thread_task() wakes it with */
+    volatile int busy;		/* set while it looks at the funct list */
+} hal_worker_t;
+
 typedef struct {
     int next_ptr;		/* next thread in linked list */
     int uses_fp;		/* floating point flag */
@@ -297,6 +418,13 @@ typedef struct {
     int task_id;		/* ID of the task that runs this thread */
     hal_s32_t runtime;		/* duration of last run, in nsec */
     hal_s32_t maxtime;		/* duration of longest run, in nsec */
+    hal_stats_t stats;		/* run time statistics */
+    volatile unsigned int seq;	/* odd while the functs run */
+    int parallel;		/* parallel mode was turned on */
+    int workers;		/* worker tasks made for it */
+    hal_worker_t worker[HAL_MAX_WORKERS];
+    volatile int lanes;		/* lanes in use, 1 when serial */
+    volatile unsigned int run;	/* count of parallel periods */
     hal_list_t funct_list;	/* list of functions to run */
     char name[HAL_NAME_LEN + 1];	/* thread name */
 } hal_thread_t;
@@ -324,8 +452,21 @@ typedef struct {
 */
 
 #define HAL_KEY   0x48414C32	/* key used to open HAL shared memory */
-#define HAL_VER   0x0000000C	/* version code */
-#define HAL_SIZE  262000
+#define HAL_VER   0x00000016	/* version code */
+#define HAL_SIZE  393216	/* default and minimum shmem size */
+
+/* The size of the shmem block is fixed when it is created.  The
+   default used to be 262000 bytes; the name index, the per funct run
+   time statistics and the parallel lanes add roughly a third to what
+   each pin, signal, function and thread takes, so it grew by half to
+   keep configurations that used to fit fitting.  A larger
+   block can be asked for with the 'hal_size' parameter of the hal_lib
+   module, or with the HAL_SHMEM_SIZE environment variable when a user
+   space process creates the block (simulator builds).  The linuxcnc
+   script sets both from [HAL]SHMEM_SIZE in the ini file.  Anybody who
+   attaches later reads the actual size from hal_data->shmem_size.
+*/
+#define HAL_SIZE_ENV "HAL_SHMEM_SIZE"
 
 /* These pointers are set by hal_init() to point to the shmem block
    and to the master data structure. All access should use these
@@ -390,6 +531,162 @@ extern hal_param_t *halpr_find_param_by_name(const char *name);
 extern hal_thread_t *halpr_find_thread_by_name(const char *name);
 extern hal_funct_t *halpr_find_funct_by_name(const char *name);
 
+/** The 'index_xxx()' functions maintain the name index of the pin,
+    signal, parameter and function lists (see hal_index_t).
+    'halpr_index_reserve()' makes sure the hash table has room for
+    'count' more names, growing it with pool memory, or memory from
+    'alloc' when the pool has none, and giving the old table back.
+    It returns 0 or -ENOMEM and must be called before inserting, so
+    that an insert can never fail half way.  An aliased object needs
+    two names.
+    'halpr_index_insert()' links 'obj' into the sorted list and the
+    hash table under its name (and old name), it returns -EEXIST if
+    the list already holds that name.
+    'halpr_index_remove()' unlinks 'obj', it must be called before the
+    object is renamed.
+    'halpr_index_find()' returns the object with 'name' (or old name),
+    or NULL.
+*/
+extern int halpr_index_reserve(hal_index_kind_t kind, int count,
+    void *(*alloc) (long int size));
+extern int halpr_index_insert(hal_index_kind_t kind, void *obj);
+extern void halpr_index_remove(hal_index_kind_t kind, void *obj);
+extern void *halpr_index_find(hal_index_kind_t kind, const char *name);
+
+/** The 'stats_xxx()' functions maintain hal_stats_t.
+    'halpr_stats_update()' adds a run of 'time', it is called from the
+    thread that owns the stats, and only from there.
+    'halpr_stats_reset()' clears them, either at init or from the owning
+    thread.  Everybody else sets 'reset' instead.
+    'halpr_stats_histogram()' gives the stats a histogram, from the
+    pool or from 'alloc', and asks for a reset so that it starts with
+    the other figures; or ('on' zero) takes it away and gives it back
+    to the pool.  It returns 0 or -ENOMEM, and the caller must hold
+    the mutex.
+    'halpr_stats_snapshot()' makes a consistent copy, and of the
+    histogram into 'hist' (HAL_STATS_BUCKETS entries, all zero if
+    there is none) unless that is NULL.  It returns 0 or -EAGAIN if
+    the writer kept it busy.
+    'halpr_stats_percentile()' estimates the run time below which
+    'percent' of the runs in a snapshot histogram were (user space
+    only).
+*/
+extern void halpr_stats_update(hal_stats_t * stats, hal_s32_t time);
+extern void halpr_stats_reset(hal_stats_t * stats);
+extern int halpr_stats_histogram(hal_stats_t * stats, int on,
+    void *(*alloc) (long int size));
+extern int halpr_stats_snapshot(hal_stats_t * stats, hal_stats_t * copy,
+    unsigned int *hist);
+#ifdef ULAPI
+extern double halpr_stats_percentile(hal_stats_t * copy,
+    unsigned int *hist, double percent);
+#endif
+
+/** 'halpr_pack_signals()' moves the values of the signals linked to
+    pins of the thread functs' components into one cache line aligned
+    block, in thread and execution order, and points the pins at the
+    new places.  The block is reused by later calls if the new layout
+    fits in it; the places the values had before are not freed, HAL
+    shared memory never is.  Anything that keeps a signal's data_ptr
+    instead of its pin or name, such as scope_rt's channels, must look
+    it up again when 'pack_seq' changes, and not read through the old
+    offset meanwhile: a reused block may hold another signal there.
+    The caller must hold the mutex, and the threads must be stopped.
+    Returns the number of signals moved, or -ENOMEM.
+*/
+extern int halpr_pack_signals(void);
+
+/** 'halpr_pool_alloc()' hands out hal_malloc() memory, re-using a
+    free block of the right size class if there is one, else carving
+    a new one with 'alloc'.  The block is chained to 'owner' (may be
+    0).  Returns 0 if 'alloc' fails.
+    'halpr_pool_release()' puts all blocks of 'comp' back on the free
+    lists.
+    'halpr_pool_free()' puts back a single block that was allocated
+    with no owner.  All three assume the caller has the mutex.
+*/
+extern void *halpr_pool_alloc(long int size, hal_comp_t * owner,
+    void *(*alloc) (long int size));
+extern void halpr_pool_release(hal_comp_t * comp);
+extern void halpr_pool_free(void *mem);
+
+/** 'halpr_funct_ran()' updates the run time data of 'funct' after a
+    run that took 'time' clocks, from the thread that ran it.
+*/
+extern void halpr_funct_ran(hal_funct_t * funct, hal_s32_t time);
+
+/** 'halpr_parallel_run()' runs the functs of 'lane' for parallel
+    period 'run' of 'thread', in list order.  Before a funct it waits
+    for the entries of other lanes it depends on, and runs any of them
+    that nobody took yet, so it returns even if the tasks of other
+    lanes are late or gone.  Each entry runs once per period, whoever
+    takes it first.
+    'halpr_parallel_finish()' returns when every entry of the thread
+    is done for 'run', running those nobody took.
+    Both are called from realtime tasks, without the mutex.
+*/
+extern void halpr_parallel_run(hal_thread_t * thread, int lane,
+    unsigned int run);
+extern void halpr_parallel_finish(hal_thread_t * thread, unsigned int run);
+
+#ifdef ULAPI
+/** The funct data flow of a thread.  Funct 'b' depends on an earlier
+    funct 'a' if both belong to the same component, or if their
+    components share a signal that at least one of them writes (pins
+    are owned by components, not functs).
+    'halpr_graph_build()' fills 'graph' for 'thread', with levels,
+    earliest finish times and the critical path from the mean run
+    times.  The caller must hold the mutex.  Returns 0 or -ENOMEM.
+    'halpr_graph_depends()' tells if funct 'b' depends on 'a' directly.
+    'halpr_graph_schedule()' assigns the functs to 'lanes' lanes, each
+    to the one where it can start first, and sets 'span' to the
+    resulting period.
+    'halpr_graph_apply()' stores the lanes in the thread entries, each
+    with the last entry of every other lane it depends on, for
+    halpr_parallel_run().
+    'halpr_graph_free()' frees what halpr_graph_build() allocated.
+*/
+typedef struct {
+    int nfuncts;		/* functs in the thread */
+    int ncomps;			/* components they belong to */
+    hal_funct_entry_t **entry;	/* thread entries, in thread order */
+    hal_funct_t **funct;	/* their functs */
+    int *comp;			/* component index of each funct */
+    char *conflict;		/* ncomps x ncomps, share a written signal */
+    double *mean;		/* mean run time */
+    int *level;			/* longest chain of functs before it */
+    double *finish;		/* earliest finish, any number of CPUs */
+    int *crit_prev;		/* dependency that finishes last, or -1 */
+    int *lane;			/* lane after halpr_graph_schedule() */
+    int levels;			/* highest level plus one */
+    int last;			/* funct that finishes last */
+    double serial;		/* sum of the mean run times */
+    double crit;		/* length of the critical path */
+    double span;		/* period with the scheduled lanes */
+} hal_graph_t;
+
+extern int halpr_graph_build(hal_thread_t * thread, hal_graph_t * graph);
+extern int halpr_graph_depends(hal_graph_t * graph, int a, int b);
+extern void halpr_graph_schedule(hal_graph_t * graph, int lanes);
+extern void halpr_graph_apply(hal_graph_t * graph);
+extern void halpr_graph_free(hal_graph_t * graph);
+#endif
+
+/** Unlocked versions of hal_signal_new(), hal_link() and
+    hal_add_funct_to_thread(), for callers that already hold the mutex
+    and looked up the objects, like the batch mode of halcmd.  They
+    check what the public functions check except the HAL lock, and
+    return the same codes.  'halpr_link()' leaves the lanes of parallel
+    threads alone, call 'halpr_threads_replan()' after the last link.
+    halcmd also calls it after loadrt and unloadrt, since realtime code
+    can't plan threads and leaves them serial.
+*/
+extern int halpr_signal_new(const char *name, hal_type_t type);
+extern int halpr_link(hal_pin_t * pin, hal_sig_t * sig);
+extern int halpr_add_funct_to_thread(hal_funct_t * funct,
+    hal_thread_t * thread, int position);
+extern void halpr_threads_replan(void);
+
 /** Allocates a HAL component structure */
 extern hal_comp_t *halpr_alloc_comp_struct(void);
 
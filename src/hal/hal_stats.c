@@ -0,0 +1,241 @@
+/********************************************************************
+* Description:  hal_stats.c
+*               Run time statistics for HAL functions and threads:
+*               min, max, sums for mean and variance, and when turned
+*               on a log scale histogram for percentiles.
+*
+*               Part of the HAL library, used by both user space
+*               and realtime code.  The stats have a single writer,
+*               the thread that runs the funct, so updates need no
+*               lock.  Readers use the sequence count.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+/** This library is free software; you can redistribute it and/or
+    modify it under the terms of version 2.1 of the GNU Lesser General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+*/
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+
+#include "rtapi_string.h"
+
+/* halve everything before 'count' or 'sumsq' can overflow */
+#define STATS_COUNT_LIMIT 0x7FFFFFFFu
+#define STATS_SUMSQ_LIMIT (1ULL << 62)
+
+/* bucket of a run time, four per power of two */
+static int stats_bucket(unsigned int time)
+{
+    int msb;
+
+    if (time < 4) {
+	return time;
+    }
+    msb = 31 - __builtin_clz(time);
+    return 4 * msb + ((time >> (msb - 2)) & 3);
+}
+
+static unsigned int *stats_hist(hal_stats_t * stats)
+{
+    int hist_ptr = stats->hist_ptr;
+
+    return hist_ptr != 0 ? SHMPTR(hist_ptr) : 0;
+}
+
+static void stats_halve(hal_stats_t * stats, unsigned int *hist)
+{
+    int n;
+
+    if (hist != 0) {
+	stats->count = 0;
+	for (n = 0; n < HAL_STATS_BUCKETS; n++) {
+	    hist[n] >>= 1;
+	    stats->count += hist[n];
+	}
+    } else {
+	stats->count >>= 1;
+    }
+    stats->sum >>= 1;
+    stats->sumsq >>= 1;
+}
+
+void halpr_stats_reset(hal_stats_t * stats)
+{
+    unsigned int *hist;
+
+    stats->seq++;
+    hal_barrier();
+    hist = stats_hist(stats);
+    stats->min = 0x7FFFFFFF;
+    stats->max = 0;
+    stats->count = 0;
+    stats->sum = 0;
+    stats->sumsq = 0;
+    if (hist != 0) {
+	memset(hist, 0, HAL_STATS_BUCKETS * sizeof(unsigned int));
+    }
+    stats->reset = 0;
+    hal_barrier();
+    stats->seq++;
+}
+
+void halpr_stats_update(hal_stats_t * stats, hal_s32_t time)
+{
+    unsigned int *hist;
+    unsigned int t;
+
+    if (stats->reset) {
+	halpr_stats_reset(stats);
+    }
+    /* a clock going backwards counts as zero */
+    t = time > 0 ? time : 0;
+    stats->seq++;
+    hal_barrier();
+    hist = stats_hist(stats);
+    if (stats->count >= STATS_COUNT_LIMIT || stats->sumsq >= STATS_SUMSQ_LIMIT) {
+	stats_halve(stats, hist);
+    }
+    if ((hal_s32_t) t < stats->min) {
+	stats->min = t;
+    }
+    if ((hal_s32_t) t > stats->max) {
+	stats->max = t;
+    }
+    stats->count++;
+    stats->sum += t;
+    stats->sumsq += (unsigned long long) t * t;
+    if (hist != 0) {
+	hist[stats_bucket(t)]++;
+    }
+    hal_barrier();
+    stats->seq++;
+}
+
+int halpr_stats_histogram(hal_stats_t * stats, int on,
+    void *(*alloc) (long int size))
+{
+    unsigned int *hist, seq;
+
+    hist = stats_hist(stats);
+    if (on) {
+	if (hist != 0) {
+	    return 0;
+	}
+	hist = halpr_pool_alloc(HAL_STATS_BUCKETS * sizeof(unsigned int), 0,
+	    alloc);
+	if (hist == 0) {
+	    return -ENOMEM;
+	}
+	memset(hist, 0, HAL_STATS_BUCKETS * sizeof(unsigned int));
+	hal_barrier();
+	stats->hist_ptr = SHMOFF(hist);
+	stats->reset = 1;
+	return 0;
+    }
+    if (hist == 0) {
+	return 0;
+    }
+    stats->hist_ptr = 0;
+    hal_barrier();
+    /* an update that is under way may still have the old pointer,
+       it is over when the count moves on */
+    seq = stats->seq;
+    while ((seq & 1) && stats->seq == seq) {
+	hal_barrier();
+    }
+    halpr_pool_free(hist);
+    return 0;
+}
+
+int halpr_stats_snapshot(hal_stats_t * stats, hal_stats_t * copy,
+    unsigned int *hist)
+{
+    unsigned int *src, seq;
+    int tries;
+
+    for (tries = 0; tries < 1000; tries++) {
+	seq = stats->seq;
+	hal_barrier();
+	if (seq & 1) {
+	    continue;
+	}
+	memcpy(copy, stats, sizeof(hal_stats_t));
+	if (hist != 0) {
+	    src = copy->hist_ptr != 0 ? SHMPTR(copy->hist_ptr) : 0;
+	    if (src != 0) {
+		memcpy(hist, src, HAL_STATS_BUCKETS * sizeof(unsigned int));
+	    } else {
+		memset(hist, 0, HAL_STATS_BUCKETS * sizeof(unsigned int));
+	    }
+	}
+	hal_barrier();
+	if (stats->seq == seq) {
+	    return 0;
+	}
+    }
+    return -EAGAIN;
+}
+
+#ifdef ULAPI
+double halpr_stats_percentile(hal_stats_t * copy, unsigned int *hist,
+    double percent)
+{
+    double rank, low, width, seen, total;
+    int n, msb;
+
+    /* the histogram may have started later than the sums */
+    total = 0.0;
+    for (n = 0; n < HAL_STATS_BUCKETS; n++) {
+	total += hist[n];
+    }
+    if (total == 0.0) {
+	return 0.0;
+    }
+    /* walk the buckets up to the one holding the wanted rank */
+    rank = total * percent / 100.0;
+    seen = 0.0;
+    for (n = 0; n < HAL_STATS_BUCKETS; n++) {
+	if (hist[n] == 0) {
+	    continue;
+	}
+	if (seen + hist[n] >= rank) {
+	    break;
+	}
+	seen += hist[n];
+    }
+    if (n == HAL_STATS_BUCKETS) {
+	return copy->max;
+    }
+    /* and interpolate inside it */
+    if (n < 4) {
+	low = n;
+	width = 1.0;
+    } else {
+	msb = n / 4;
+	low = (double) ((4u | (n & 3)) << (msb - 2));
+	width = (double) (1u << (msb - 2));
+    }
+    low += width * (rank - seen) / hist[n];
+    /* the exact ends are known */
+    if (low < copy->min) {
+	low = copy->min;
+    }
+    if (low > copy->max) {
+	low = copy->max;
+    }
+    return low;
+}
+#endif
@@ -0,0 +1,73 @@
+/********************************************************************
+* Description:  hal_test.h
+*               A block of ordinary memory standing in for the HAL
+*               shared memory, for the unit tests that run parts of
+*               the HAL library in userspace.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+
+#ifndef HAL_TEST_H
+#define HAL_TEST_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "hal_priv.h"
+
+char *hal_shmem_base;
+hal_data_t *hal_data;
+
+static long hal_test_size;
+
+/* allocates the block on the first call, and zeroes it on every call,
+   with shmem_bot and shmem_top as init_hal_data() leaves them */
+static inline int hal_test_arena(long size)
+{
+    if (hal_shmem_base == 0) {
+	hal_shmem_base = malloc(size);
+	if (hal_shmem_base == 0) {
+	    return -1;
+	}
+	hal_test_size = size;
+    }
+    memset(hal_shmem_base, 0, hal_test_size);
+    hal_data = (hal_data_t *) hal_shmem_base;
+    hal_data->shmem_bot = sizeof(hal_data_t);
+    hal_data->shmem_top = hal_test_size;
+    return 0;
+}
+
+static inline void hal_test_arena_free(void)
+{
+    free(hal_shmem_base);
+    hal_shmem_base = 0;
+    hal_data = 0;
+}
+
+/* shmalloc_up() and shmalloc_dn(), returning 0 when the block is full */
+static inline void *hal_test_alloc_up(long int size)
+{
+    long bot = (hal_data->shmem_bot + 7) & ~7;
+
+    if (bot + size > hal_data->shmem_top) {
+	return 0;
+    }
+    hal_data->shmem_bot = bot + size;
+    return SHMPTR(bot);
+}
+
+static inline void *hal_test_alloc_dn(long int size)
+{
+    long top = (hal_data->shmem_top - size) & ~7;
+
+    if (top < hal_data->shmem_bot) {
+	return 0;
+    }
+    hal_data->shmem_top = top;
+    return memset(SHMPTR(top), 0, size);
+}
+
+#endif /* HAL_TEST_H */
@@ -1066,6 +1066,150 @@ PyTypeObject shm_type = {
 };
 
 
+struct groupobject {
+    PyObject_HEAD
+    hal_group_t *group;
+    int count;
+    char *name;
+};
+
+static int pygroup_init(PyObject *_self, PyObject *args, PyObject *kw) {
+    groupobject *self = (groupobject *)_self;
+    char *name;
+    PyObject *signals, *seq;
+
+    self->group = 0;
+    self->count = 0;
+    self->name = 0;
+    if(!PyArg_ParseTuple(args, "sO:hal.group", &name, &signals)) return -1;
+    if(!SHMPTR(0)) {
+	PyErr_Format(PyExc_RuntimeError,
+		"Cannot call before creating component");
+	return -1;
+    }
+
+    seq = PySequence_Fast(signals, "signal names must be a sequence");
+    if(!seq) return -1;
+    int count = PySequence_Fast_GET_SIZE(seq);
+    const char **names = new const char *[count ? count : 1];
+    for(int i = 0; i < count; i++) {
+        names[i] = PyString_AsString(PySequence_Fast_GET_ITEM(seq, i));
+        if(!names[i]) {
+            delete [] names;
+            Py_DECREF(seq);
+            return -1;
+        }
+    }
+    self->group = hal_group_new(name, names, count);
+    delete [] names;
+    Py_DECREF(seq);
+    if(!self->group) {
+        PyErr_Format(pyhal_error_type, "Cannot create group '%s'", name);
+        return -1;
+    }
+    self->count = count;
+    self->name = strdup(name);
+    if(!self->name) {
+        PyErr_SetString(PyExc_MemoryError, "strdup(name) failed");
+        return -1;
+    }
+    return 0;
+}
+
+static void pygroup_delete(PyObject *_self) {
+    groupobject *self = (groupobject *)_self;
+    hal_group_delete(self->group);
+    free(self->name);
+    self->ob_type->tp_free(self);
+}
+
+static PyObject *pygroup_repr(PyObject *_self) {
+    groupobject *self = (groupobject *)_self;
+    return PyString_FromFormat("<hal group \"%s\" with %d signals>",
+            self->name ? self->name : "", self->count);
+}
+
+static PyObject *pygroup_snapshot(PyObject *_self, PyObject *o) {
+    groupobject *self = (groupobject *)_self;
+    if(!self->group) {
+        PyErr_SetString(PyExc_RuntimeError, "Invalid operation on empty group");
+        return NULL;
+    }
+    int res = hal_group_snapshot(self->group);
+    if(res) return pyhal_error(res);
+
+    PyObject *result = PyTuple_New(self->count);
+    if(!result) return NULL;
+    for(int i = 0; i < self->count; i++) {
+        void *v = hal_group_value(self->group, i);
+        PyObject *item;
+        switch(hal_group_type(self->group, i)) {
+            case HAL_BIT: item = PyBool_FromLong(*(hal_bit_t *)v); break;
+            case HAL_U32: item = PyLong_FromUnsignedLong(*(hal_u32_t *)v); break;
+            case HAL_S32: item = PyInt_FromLong(*(hal_s32_t *)v); break;
+            default: item = PyFloat_FromDouble(*(hal_float_t *)v); break;
+        }
+        if(!item) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(result, i, item);
+    }
+    return result;
+}
+
+static PyMethodDef group_methods[] = {
+    {"snapshot", pygroup_snapshot, METH_NOARGS,
+	"Read all signals of the group as of the end of the same thread\n"
+	"period, returned as a tuple in the order they were given"},
+    {NULL},
+};
+
+static 
+PyTypeObject group_type = {
+    PyObject_HEAD_INIT(NULL)
+    0,                         /*ob_size*/
+    "hal.group",               /*tp_name*/
+    sizeof(groupobject),       /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    pygroup_delete,            /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    pygroup_repr,              /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,        /*tp_flags*/
+    "HAL signal group: hal.group(name, [signal, ...])",  /*tp_doc*/
+    0,                         /*tp_traverse*/
+    0,                         /*tp_clear*/
+    0,                         /*tp_richcompare*/
+    0,                         /*tp_weaklistoffset*/
+    0,                         /*tp_iter*/
+    0,                         /*tp_iternext*/
+    group_methods,             /*tp_methods*/
+    0,                         /*tp_members*/
+    0,                         /*tp_getset*/
+    0,                         /*tp_base*/
+    0,                         /*tp_dict*/
+    0,                         /*tp_descr_get*/
+    0,                         /*tp_descr_set*/
+    0,                         /*tp_dictoffset*/
+    pygroup_init,              /*tp_init*/
+    0,                         /*tp_alloc*/
+    PyType_GenericNew,         /*tp_new*/
+    0,                         /*tp_free*/
+    0,                         /*tp_is_gc*/
+};
+
 PyMethodDef module_methods[] = {
     {"pin_has_writer", pin_has_writer, METH_VARARGS,
 	"Return a FALSE value if a pin has no writers and TRUE if it does"},
@@ -1109,7 +1253,13 @@ const char *module_doc = "Interface to emc2's hal\n"
 "\n"
 "\n"
 "When the component is requested to exit with 'halcmd unload', a\n"
-"KeyboardInterrupt exception will be raised."
+"KeyboardInterrupt exception will be raised.\n"
+"\n"
+"To read several signals from the same realtime thread period, for\n"
+"example the position of all axes, use a signal group:\n"
+"\n"
+"g = hal.group(\"axes\", [\"x-pos-fb\", \"y-pos-fb\", \"z-pos-fb\"])\n"
+"x, y, z = g.snapshot()"
 ;
 
 extern "C"
@@ -1123,9 +1273,11 @@ void init_hal(void) {
     PyType_Ready(&halobject_type);
     PyType_Ready(&shm_type);
     PyType_Ready(&halpin_type);
+    PyType_Ready(&group_type);
     PyModule_AddObject(m, "component", (PyObject*)&halobject_type);
     PyModule_AddObject(m, "shm", (PyObject*)&shm_type);
     PyModule_AddObject(m, "item", (PyObject*)&halpin_type);
+    PyModule_AddObject(m, "group", (PyObject*)&group_type);
 
     PyModule_AddIntConstant(m, "MSG_NONE", RTAPI_MSG_NONE);
     PyModule_AddIntConstant(m, "MSG_ERR", RTAPI_MSG_ERR);
@@ -0,0 +1,173 @@
+/********************************************************************
+* Description:  test_hal_group.c
+*               Checks that signal group snapshots never mix values
+*               of different thread periods, against a writer thread
+*               that behaves like thread_task() and now and then is
+*               preempted in the middle of a period.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "rtapi.h"
+#include "hal_test.h"
+#include "tests/unittest.h"
+
+#define ARENA_SIZE (64 * 1024)
+#define SIGNALS 3
+#define SNAPSHOTS 20000
+
+static volatile int done;
+
+/* what hal_group.c needs from the rest of the library */
+int rtapi_snprintf(char *buf, unsigned long int size, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+void rtapi_print_msg(int level, const char *fmt, ...)
+{
+}
+
+hal_sig_t *halpr_find_sig_by_name(const char *name)
+{
+    int next;
+    hal_sig_t *sig;
+
+    for (next = hal_data->sig_list_ptr; next != 0; next = sig->next_ptr) {
+	sig = SHMPTR(next);
+	if (strcmp(sig->name, name) == 0) {
+	    return sig;
+	}
+    }
+    return 0;
+}
+
+static hal_thread_t *thread;
+static hal_float_t *value[SIGNALS];
+
+/* thread_task(): one funct per axis, all written in the same period */
+static void *writer(void *arg)
+{
+    double pos = 0.0;
+    volatile int spin;
+    int n, period;
+
+    for (period = 0; !done; period++) {
+	thread->seq++;
+	hal_barrier();
+	pos += 1.0;
+	for (n = 0; n < SIGNALS; n++) {
+	    *value[n] = pos;
+	    for (spin = 0; spin < 50; spin++) {
+	    }
+	    /* every few periods the readers get in between the functs */
+	    if (n == 0 && period % 4 == 0) {
+		sched_yield();
+	    }
+	}
+	hal_barrier();
+	thread->seq++;
+	/* rest of the period */
+	for (spin = 0; spin < 1000; spin++) {
+	}
+	sched_yield();
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    static const char *names[SIGNALS] = {
+	"x-pos-fb", "y-pos-fb", "z-pos-fb"
+    };
+    const char *missing[2] = { "x-pos-fb", "a-pos-fb" };
+    hal_group_t *group;
+    hal_sig_t *sig;
+    pthread_t tid;
+    double x, y, z, last;
+    int n, torn, mixed, busy;
+
+    if (hal_test_arena(ARENA_SIZE) != 0) {
+	return 1;
+    }
+    thread = hal_test_alloc_dn(sizeof(hal_thread_t));
+    hal_data->thread_list_ptr = SHMOFF(thread);
+    for (n = 0; n < SIGNALS; n++) {
+	sig = hal_test_alloc_dn(sizeof(hal_sig_t));
+	strcpy(sig->name, names[n]);
+	sig->type = HAL_FLOAT;
+	sig->data_ptr = SHMOFF(hal_test_alloc_up(sizeof(hal_float_t)));
+	sig->next_ptr = hal_data->sig_list_ptr;
+	hal_data->sig_list_ptr = SHMOFF(sig);
+	value[n] = SHMPTR(sig->data_ptr);
+    }
+
+    CHECK(hal_group_new("bad", missing, 2) == NULL);
+    group = hal_group_new("axes", names, SIGNALS);
+    CHECK(group != NULL);
+    CHECK(hal_group_type(group, 1) == HAL_FLOAT);
+    CHECK(hal_group_value(group, SIGNALS) == NULL);
+
+    pthread_create(&tid, NULL, writer, NULL);
+    /* reading one signal at a time mixes periods */
+    torn = 0;
+    for (n = 0; n < SNAPSHOTS; n++) {
+	sched_yield();
+	x = *value[0];
+	y = *value[1];
+	z = *value[2];
+	torn += x != y || y != z;
+    }
+    /* a snapshot does not */
+    mixed = 0;
+    busy = 0;
+    last = 0.0;
+    for (n = 0; n < SNAPSHOTS; n++) {
+	sched_yield();
+	if (hal_group_snapshot(group) != 0) {
+	    busy++;
+	    continue;
+	}
+	x = *((hal_float_t *) hal_group_value(group, 0));
+	y = *((hal_float_t *) hal_group_value(group, 1));
+	z = *((hal_float_t *) hal_group_value(group, 2));
+	mixed += x != y || y != z || x < last;
+	last = x;
+    }
+    done = 1;
+    pthread_join(tid, NULL);
+    /* without the group the same reads do tear, or the test shows nothing */
+    CHECK(torn > 0);
+    CHECK(mixed == 0);
+    CHECK(busy < SNAPSHOTS / 100);
+
+    /* signals are looked up by name each time */
+    sig = halpr_find_sig_by_name("y-pos-fb");
+    strcpy(sig->name, "y-gone");
+    CHECK(hal_group_snapshot(group) == -ENOENT);
+    strcpy(sig->name, "y-pos-fb");
+    sig->data_ptr = SHMOFF(hal_test_alloc_up(sizeof(hal_float_t)));
+    *((hal_float_t *) SHMPTR(sig->data_ptr)) = 42.0;
+    CHECK(hal_group_snapshot(group) == 0);
+    CHECK(*((hal_float_t *) hal_group_value(group, 1)) == 42.0);
+    hal_group_delete(group);
+
+    printf("group of %d: %d of %d single reads torn, %d snapshots mixed, %s\n",
+	SIGNALS, torn, SNAPSHOTS, mixed, CHECK_RESULT);
+    hal_test_arena_free();
+    return CHECK_EXIT;
+}
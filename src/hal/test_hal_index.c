@@ -0,0 +1,278 @@
+/********************************************************************
+* Description:  test_hal_index.c
+*               Checks the HAL name index and times loading 10000
+*               pins against the linear sorted list it replaced, and
+*               that unloading and reloading doesn't use up memory.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rtapi.h"
+#include "hal_test.h"
+#include "tests/unittest.h"
+
+#define ARENA_SIZE (8 * 1024 * 1024)
+#define SLAVES 250
+#define PINS_PER_SLAVE 40
+#define PIN_COUNT (SLAVES * PINS_PER_SLAVE)
+#define RELOADS 100
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+/* lcec style names: slaves in configuration order, pins in export order */
+static char names[PIN_COUNT][HAL_NAME_LEN + 1];
+
+static hal_pin_t *unloaded[PIN_COUNT];
+
+static void make_names(void)
+{
+    static const char *pins[8] = {
+	"srv-vel-cmd", "srv-pos-fb", "srv-enable", "din-%d",
+	"dout-%d", "srv-fault", "ain-%d-val", "enc-count"
+    };
+    char pin[16];
+    int s, p, n = 0;
+
+    for (s = 0; s < SLAVES; s++) {
+	for (p = 0; p < PINS_PER_SLAVE; p++) {
+	    snprintf(pin, sizeof(pin), pins[p % 8], p);
+	    snprintf(names[n++], HAL_NAME_LEN + 1, "lcec.0.s%03d.%.15s-%d",
+		(s * 97) % SLAVES, pin, p);
+	}
+    }
+}
+
+static hal_pin_t *new_pin(const char *name, int owner)
+{
+    hal_pin_t *pin = hal_test_alloc_dn(sizeof(hal_pin_t));
+
+    memset(pin, 0, sizeof(hal_pin_t));
+    pin->owner_ptr = owner;
+    strcpy(pin->name, name);
+    return pin;
+}
+
+/* the former hal_pin_new() list walk and halpr_find_pin_by_name() */
+static int linear_insert(hal_pin_t * new)
+{
+    int *prev, next, cmp;
+    hal_pin_t *ptr;
+
+    prev = &(hal_data->pin_list_ptr);
+    next = *prev;
+    while (1) {
+	if (next == 0) {
+	    new->next_ptr = next;
+	    *prev = SHMOFF(new);
+	    return 0;
+	}
+	ptr = SHMPTR(next);
+	cmp = strcmp(ptr->name, new->name);
+	if (cmp > 0) {
+	    new->next_ptr = next;
+	    *prev = SHMOFF(new);
+	    return 0;
+	}
+	if (cmp == 0) {
+	    return -1;
+	}
+	prev = &(ptr->next_ptr);
+	next = *prev;
+    }
+}
+
+static hal_pin_t *linear_find(const char *name)
+{
+    int next;
+    hal_pin_t *pin;
+
+    next = hal_data->pin_list_ptr;
+    while (next != 0) {
+	pin = SHMPTR(next);
+	if (strcmp(pin->name, name) == 0) {
+	    return pin;
+	}
+	next = pin->next_ptr;
+    }
+    return 0;
+}
+
+/* removes the pins of component 1 and inserts them again, under
+   names of their own for each 'round' like a different component */
+static void reload(int round)
+{
+    hal_pin_t *pin;
+    char *mark;
+    int n, next;
+
+    n = 0;
+    next = hal_data->pin_list_ptr;
+    while (next != 0) {
+	pin = SHMPTR(next);
+	next = pin->next_ptr;
+	if (pin->owner_ptr == 1) {
+	    halpr_index_remove(HAL_INDEX_PIN, pin);
+	    unloaded[n++] = pin;
+	}
+    }
+    while (n > 0) {
+	pin = unloaded[n - 1];
+	mark = strchr(pin->name, '#');
+	if (mark != NULL) {
+	    *mark = '\0';
+	}
+	snprintf(pin->name + strlen(pin->name), 8, "#%d", round);
+	CHECK(halpr_index_reserve(HAL_INDEX_PIN, 1, hal_test_alloc_dn) == 0);
+	CHECK(halpr_index_insert(HAL_INDEX_PIN, unloaded[--n]) == 0);
+    }
+}
+
+/* every lane must be sorted and only skip over level 0 entries */
+static int check_lanes(int expected)
+{
+    int level, next, count;
+    int *lane;
+    const char *last;
+    hal_pin_t *pin;
+
+    for (level = 0; level < HAL_INDEX_LEVELS; level++) {
+	lane = level == 0 ? &(hal_data->pin_list_ptr) :
+	    &(hal_data->pin_index.lanes[level - 1]);
+	last = "";
+	count = 0;
+	for (next = *lane; next != 0; next = ((int *) SHMPTR(next))[level]) {
+	    pin = SHMPTR(next);
+	    if (strcmp(last, pin->name) >= 0) {
+		return -1;
+	    }
+	    last = pin->name;
+	    count++;
+	}
+	if (level == 0 && count != expected) {
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+int main(void)
+{
+    double t0, t_linear, t_index;
+    hal_pin_t *pin;
+    hal_oldname_t *oldname;
+    int n, next, count, top;
+
+    if (hal_test_arena(ARENA_SIZE) != 0) {
+	return 1;
+    }
+    make_names();
+
+    /* baseline: sorted list insert, then lookups like 'net' does */
+    hal_test_arena(ARENA_SIZE);
+    t0 = now_ms();
+    for (n = 0; n < PIN_COUNT; n++) {
+	if (linear_find(names[n]) == 0) {
+	    linear_insert(new_pin(names[n], 1));
+	}
+    }
+    for (n = 0; n < PIN_COUNT; n++) {
+	CHECK(linear_find(names[n]) != 0);
+    }
+    t_linear = now_ms() - t0;
+
+    /* same with the index */
+    hal_test_arena(ARENA_SIZE);
+    t0 = now_ms();
+    for (n = 0; n < PIN_COUNT; n++) {
+	CHECK(halpr_index_reserve(HAL_INDEX_PIN, 1, hal_test_alloc_dn) == 0);
+	if (halpr_index_find(HAL_INDEX_PIN, names[n]) == 0) {
+	    CHECK(halpr_index_insert(HAL_INDEX_PIN, new_pin(names[n], n & 1)) == 0);
+	}
+    }
+    for (n = 0; n < PIN_COUNT; n++) {
+	CHECK(halpr_index_find(HAL_INDEX_PIN, names[n]) != 0);
+    }
+    t_index = now_ms() - t0;
+
+    /* list order is the same as before */
+    CHECK(check_lanes(PIN_COUNT) == 0);
+    CHECK(halpr_index_find(HAL_INDEX_PIN, "lcec.0.s000.nothing") == 0);
+    CHECK(halpr_index_insert(HAL_INDEX_PIN, new_pin(names[7], 0)) == -EEXIST);
+
+    /* alias: found under both names, sorted under the new one */
+    pin = halpr_index_find(HAL_INDEX_PIN, names[5]);
+    CHECK(halpr_index_reserve(HAL_INDEX_PIN, 2, hal_test_alloc_dn) == 0);
+    halpr_index_remove(HAL_INDEX_PIN, pin);
+    CHECK(halpr_index_find(HAL_INDEX_PIN, names[5]) == 0);
+    oldname = hal_test_alloc_dn(sizeof(hal_oldname_t));
+    snprintf(oldname->name, sizeof(oldname->name), "%s", pin->name);
+    pin->oldname = SHMOFF(oldname);
+    snprintf(pin->name, sizeof(pin->name), "a-spindle-enable");
+    CHECK(halpr_index_insert(HAL_INDEX_PIN, pin) == 0);
+    CHECK(halpr_index_find(HAL_INDEX_PIN, "a-spindle-enable") == pin);
+    CHECK(halpr_index_find(HAL_INDEX_PIN, names[5]) == pin);
+    CHECK(SHMPTR(hal_data->pin_list_ptr) == pin);
+    CHECK(check_lanes(PIN_COUNT) == 0);
+    halpr_index_remove(HAL_INDEX_PIN, pin);
+    snprintf(pin->name, sizeof(pin->name), "%s", oldname->name);
+    pin->oldname = 0;
+    CHECK(halpr_index_insert(HAL_INDEX_PIN, pin) == 0);
+    CHECK(halpr_index_find(HAL_INDEX_PIN, "a-spindle-enable") == 0);
+    CHECK(halpr_index_find(HAL_INDEX_PIN, names[5]) == pin);
+
+    /* unload a component: walk the list, remove what it owns */
+    next = hal_data->pin_list_ptr;
+    while (next != 0) {
+	pin = SHMPTR(next);
+	next = pin->next_ptr;
+	if (pin->owner_ptr == 1) {
+	    halpr_index_remove(HAL_INDEX_PIN, pin);
+	}
+    }
+    CHECK(check_lanes(PIN_COUNT / 2) == 0);
+    count = 0;
+    for (n = 0; n < PIN_COUNT; n++) {
+	pin = halpr_index_find(HAL_INDEX_PIN, names[n]);
+	CHECK((pin != 0) == !(n & 1));
+	count += pin != 0;
+    }
+    CHECK(count == PIN_COUNT / 2);
+
+    /* reload it, deleted slots get reused or dropped on growth */
+    for (n = 1; n < PIN_COUNT; n += 2) {
+	CHECK(halpr_index_reserve(HAL_INDEX_PIN, 1, hal_test_alloc_dn) == 0);
+	CHECK(halpr_index_insert(HAL_INDEX_PIN, new_pin(names[n], 1)) == 0);
+    }
+    CHECK(check_lanes(PIN_COUNT) == 0);
+    CHECK(hal_data->pin_index.count == PIN_COUNT);
+    CHECK(hal_data->pin_index.used * 4 <= hal_data->pin_index.size * 3);
+
+    /* replaced tables go back to the pool, so the table and the one
+       before it take turns, instead of each reload leaving one behind */
+    reload(0);
+    top = hal_data->shmem_top;
+    for (n = 1; n <= RELOADS; n++) {
+	reload(n);
+    }
+    CHECK(top - hal_data->shmem_top <= (long) sizeof(hal_pool_block_t) +
+	hal_data->pin_index.size * (long) sizeof(hal_index_slot_t));
+    CHECK(check_lanes(PIN_COUNT) == 0);
+    CHECK(hal_data->pin_index.count == PIN_COUNT);
+
+    printf("pins %d: linear %.1fms, index %.1fms, %s\n", PIN_COUNT,
+	t_linear, t_index, CHECK_RESULT);
+    hal_test_arena_free();
+    return CHECK_EXIT;
+}
@@ -0,0 +1,345 @@
+/********************************************************************
+* Description:  test_hal_pack.c
+*               Checks halpr_pack_signals() on a 2000 signal setup
+*               and measures one servo period with a cold cache
+*               before and after packing.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "rtapi.h"
+#include "hal_test.h"
+#include "tests/unittest.h"
+
+#define ARENA_SIZE (2 * 1024 * 1024)
+#define COMPS 100
+#define PINS_PER_DIR 20
+#define SIGNALS (COMPS * PINS_PER_DIR)
+#define PERIODS 500
+#define FLUSH_SIZE (32 * 1024 * 1024)
+
+static volatile double sink;
+
+/* what halpr_pack_signals() needs from hal_lib.c */
+hal_list_t *list_next(hal_list_t * entry)
+{
+    return SHMPTR(entry->next);
+}
+
+static void list_append(hal_list_t * root, hal_list_t * entry)
+{
+    hal_list_t *last = SHMPTR(root->prev);
+
+    entry->next = SHMOFF(root);
+    entry->prev = SHMOFF(last);
+    last->next = SHMOFF(entry);
+    root->prev = SHMOFF(entry);
+}
+
+typedef struct {
+    hal_pin_t *pin[2 * PINS_PER_DIR];	/* inputs, then outputs */
+    void **ptrs;			/* the component's pin pointers */
+} comp_t;
+
+static comp_t comps[COMPS];
+static hal_sig_t *sigs[SIGNALS + 1];
+
+static hal_type_t sig_type(int n)
+{
+    return n % 4 == 0 ? HAL_BIT : n % 4 == 1 ? HAL_S32 : HAL_FLOAT;
+}
+
+static void link_pin(hal_pin_t * pin, hal_sig_t * sig)
+{
+    pin->signal = SHMOFF(sig);
+    *((void **) SHMPTR(pin->data_ptr_addr)) = hal_shmem_base + sig->data_ptr;
+}
+
+/* the layout 'net' produces: components loaded first, then signals
+   created in file order, with other allocations in between */
+static void build(void)
+{
+    hal_thread_t *thread;
+    hal_comp_t *comp;
+    hal_funct_t *funct;
+    hal_funct_entry_t *fentry;
+    int order[SIGNALS];
+    unsigned int seed = 1;
+    int c, n, k, tmp, *last_pin;
+
+    hal_test_arena(ARENA_SIZE);
+    thread = hal_test_alloc_dn(sizeof(hal_thread_t));
+    thread->funct_list.next = thread->funct_list.prev =
+	SHMOFF(&(thread->funct_list));
+    hal_data->thread_list_ptr = SHMOFF(thread);
+    last_pin = &(hal_data->pin_list_ptr);
+    for (c = 0; c < COMPS; c++) {
+	comp = hal_test_alloc_dn(sizeof(hal_comp_t));
+	comp->shmem_base = hal_shmem_base;
+	comps[c].ptrs = hal_test_alloc_up(2 * PINS_PER_DIR * sizeof(void *));
+	for (n = 0; n < 2 * PINS_PER_DIR; n++) {
+	    hal_pin_t *pin = hal_test_alloc_dn(sizeof(hal_pin_t));
+
+	    pin->owner_ptr = SHMOFF(comp);
+	    pin->data_ptr_addr = SHMOFF(&(comps[c].ptrs[n]));
+	    pin->dir = n < PINS_PER_DIR ? HAL_IN : HAL_OUT;
+	    comps[c].ptrs[n] = &(pin->dummysig);
+	    comps[c].pin[n] = pin;
+	    *last_pin = SHMOFF(pin);
+	    last_pin = &(pin->next_ptr);
+	}
+	funct = hal_test_alloc_dn(sizeof(hal_funct_t));
+	funct->owner_ptr = SHMOFF(comp);
+	fentry = hal_test_alloc_dn(sizeof(hal_funct_entry_t));
+	fentry->funct_ptr = SHMOFF(funct);
+	list_append(&(thread->funct_list), &(fentry->links));
+    }
+    /* signal 'n' goes from output n of one component to the same input
+       of the next, in a random 'net' order */
+    for (n = 0; n < SIGNALS; n++) {
+	order[n] = n;
+    }
+    for (n = SIGNALS - 1; n > 0; n--) {
+	k = rand_r(&seed) % (n + 1);
+	tmp = order[n];
+	order[n] = order[k];
+	order[k] = tmp;
+    }
+    for (k = 0; k < SIGNALS; k++) {
+	hal_sig_t *sig;
+
+	n = order[k];
+	sig = hal_test_alloc_dn(sizeof(hal_sig_t));
+	sig->type = sig_type(n);
+	sig->data_ptr = SHMOFF(hal_test_alloc_up(8));
+	*((hal_s32_t *) SHMPTR(sig->data_ptr)) = n;
+	if (sig->type == HAL_FLOAT) {
+	    *((hal_float_t *) SHMPTR(sig->data_ptr)) = n;
+	} else if (sig->type == HAL_BIT) {
+	    *((hal_bit_t *) SHMPTR(sig->data_ptr)) = n & 4 ? 1 : 0;
+	}
+	sig->next_ptr = hal_data->sig_list_ptr;
+	hal_data->sig_list_ptr = SHMOFF(sig);
+	sigs[n] = sig;
+	c = n / PINS_PER_DIR;
+	link_pin(comps[c].pin[PINS_PER_DIR + n % PINS_PER_DIR], sig);
+	link_pin(comps[(c + 1) % COMPS].pin[n % PINS_PER_DIR], sig);
+	/* hal_malloc() data of components loaded between the nets */
+	hal_test_alloc_up(16 + rand_r(&seed) % 192);
+    }
+    /* a signal no thread uses */
+    sigs[SIGNALS] = hal_test_alloc_dn(sizeof(hal_sig_t));
+    sigs[SIGNALS]->type = HAL_FLOAT;
+    sigs[SIGNALS]->data_ptr = SHMOFF(hal_test_alloc_up(8));
+    sigs[SIGNALS]->next_ptr = hal_data->sig_list_ptr;
+    hal_data->sig_list_ptr = SHMOFF(sigs[SIGNALS]);
+    hal_data->shmem_avail = hal_data->shmem_top - hal_data->shmem_bot;
+}
+
+/* one servo period: every funct reads its inputs, writes its outputs */
+static double period(void)
+{
+    double sum = 0.0;
+    int c, n, s;
+
+    for (c = 0; c < COMPS; c++) {
+	void **ptrs = comps[c].ptrs;
+
+	for (n = 0; n < PINS_PER_DIR; n++) {
+	    s = ((c + COMPS - 1) % COMPS) * PINS_PER_DIR + n;
+	    switch (sig_type(s)) {
+	    case HAL_BIT:
+		sum += *((hal_bit_t *) ptrs[n]);
+		break;
+	    case HAL_S32:
+		sum += *((hal_s32_t *) ptrs[n]);
+		break;
+	    default:
+		sum += *((hal_float_t *) ptrs[n]);
+		break;
+	    }
+	}
+	for (n = PINS_PER_DIR; n < 2 * PINS_PER_DIR; n++) {
+	    s = c * PINS_PER_DIR + n - PINS_PER_DIR;
+	    if (sig_type(s) == HAL_FLOAT) {
+		*((hal_float_t *) ptrs[n]) = sum;
+	    }
+	}
+    }
+    return sum;
+}
+
+/* cache lines the signal values are spread over */
+static int sig_lines(void)
+{
+    static char seen[ARENA_SIZE / HAL_CACHE_LINE];
+    int n, lines = 0;
+
+    memset(seen, 0, sizeof(seen));
+    for (n = 0; n < SIGNALS; n++) {
+	int line = sigs[n]->data_ptr / HAL_CACHE_LINE;
+
+	lines += !seen[line];
+	seen[line] = 1;
+    }
+    return lines;
+}
+
+static int perf_open(int cache)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* average time and cache misses of a period with a cold cache */
+static void measure(const char *what, char *flush)
+{
+    struct timespec t0, t1;
+    long long l1 = 0, ll = 0, count;
+    double ns = 0.0;
+    int fd_l1, fd_ll, n;
+
+    fd_l1 = perf_open(PERF_COUNT_HW_CACHE_L1D);
+    fd_ll = perf_open(PERF_COUNT_HW_CACHE_LL);
+    for (n = 0; n < PERIODS; n++) {
+	memset(flush, n, FLUSH_SIZE);
+	if (fd_l1 >= 0) {
+	    ioctl(fd_l1, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	if (fd_ll >= 0) {
+	    ioctl(fd_ll, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	sink += period();
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	if (fd_l1 >= 0) {
+	    ioctl(fd_l1, PERF_EVENT_IOC_DISABLE, 0);
+	}
+	if (fd_ll >= 0) {
+	    ioctl(fd_ll, PERF_EVENT_IOC_DISABLE, 0);
+	}
+	ns += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    }
+    printf("%-8s %5d lines, %8.0fns per period", what, sig_lines(),
+	ns / PERIODS);
+    if (fd_l1 >= 0 && read(fd_l1, &count, sizeof(count)) == sizeof(count)) {
+	l1 = count;
+	printf(", L1D misses %lld", l1 / PERIODS);
+    }
+    if (fd_ll >= 0 && read(fd_ll, &count, sizeof(count)) == sizeof(count)) {
+	ll = count;
+	printf(", LL misses %lld", ll / PERIODS);
+    }
+    printf("\n");
+    if (fd_l1 >= 0) {
+	close(fd_l1);
+    }
+    if (fd_ll >= 0) {
+	close(fd_ll);
+    }
+}
+
+/* every linked pin points at its signal, values are unchanged */
+static int check_links(void)
+{
+    int c, n, s, bad = 0;
+
+    for (c = 0; c < COMPS; c++) {
+	for (n = 0; n < 2 * PINS_PER_DIR; n++) {
+	    hal_pin_t *pin = comps[c].pin[n];
+	    hal_sig_t *sig = SHMPTR(pin->signal);
+
+	    bad += comps[c].ptrs[n] != hal_shmem_base + sig->data_ptr;
+	}
+    }
+    for (s = 0; s < SIGNALS; s++) {
+	if (sig_type(s) == HAL_S32) {
+	    bad += *((hal_s32_t *) SHMPTR(sigs[s]->data_ptr)) != s;
+	}
+	if (sig_type(s) == HAL_BIT) {
+	    bad += *((hal_bit_t *) SHMPTR(sigs[s]->data_ptr)) != (s & 4 ? 1 : 0);
+	}
+    }
+    return bad;
+}
+
+int main(void)
+{
+    char *flush;
+    long block, bot, top, last;
+    int n, c, s;
+    unsigned int seq;
+
+    flush = malloc(FLUSH_SIZE);
+    if (hal_test_arena(ARENA_SIZE) != 0 || flush == NULL) {
+	return 1;
+    }
+    build();
+    CHECK(check_links() == 0);
+    measure("scattered", flush);
+
+    /* too little room: nothing moves */
+    top = hal_data->shmem_top;
+    hal_data->shmem_top = hal_data->shmem_bot + 1000;
+    seq = hal_data->pack_seq;
+    CHECK(halpr_pack_signals() == -ENOMEM);
+    CHECK(hal_data->sig_pack_ptr == 0);
+    CHECK(hal_data->pack_seq == seq);
+    hal_data->shmem_top = top;
+
+    build();
+    bot = hal_data->shmem_bot;
+    seq = hal_data->pack_seq;
+    CHECK(halpr_pack_signals() == SIGNALS);
+    CHECK(check_links() == 0);
+    /* anybody holding a data_ptr can tell it moved */
+    CHECK(hal_data->pack_seq == seq + 1);
+    block = hal_data->sig_pack_ptr;
+    CHECK(block % HAL_CACHE_LINE == 0 && block >= bot);
+    CHECK(hal_data->sig_pack_size % HAL_CACHE_LINE == 0);
+    CHECK(hal_data->shmem_bot == block + hal_data->sig_pack_size);
+    CHECK(hal_data->shmem_avail == hal_data->shmem_top - hal_data->shmem_bot);
+    /* in the order the functs first touch them */
+    last = -1;
+    for (c = 0; c < COMPS - 1; c++) {
+	for (n = 0; n < PINS_PER_DIR; n++) {
+	    s = c * PINS_PER_DIR + n;
+	    CHECK(sigs[s]->data_ptr > last);
+	    last = sigs[s]->data_ptr;
+	}
+    }
+    CHECK(last < block + hal_data->sig_pack_size);
+    CHECK(sigs[SIGNALS]->data_ptr < bot);
+    measure("packed", flush);
+
+    /* again: the block is reused */
+    bot = hal_data->shmem_bot;
+    CHECK(halpr_pack_signals() == SIGNALS);
+    CHECK(check_links() == 0);
+    CHECK(hal_data->sig_pack_ptr == block);
+    CHECK(hal_data->shmem_bot == bot);
+
+    printf("pack %d signals, %s\n", SIGNALS, CHECK_RESULT);
+    free(flush);
+    hal_test_arena_free();
+    return CHECK_EXIT;
+}
@@ -0,0 +1,273 @@
+/********************************************************************
+* Description:  test_hal_parallel.c
+*               Checks the funct graph of a thread, the lanes it is
+*               scheduled in, and that parallel periods run every
+*               funct once, after the functs it depends on, also when
+*               a worker never shows up.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "rtapi.h"
+#include "hal_test.h"
+#include "tests/unittest.h"
+
+#define ARENA_SIZE (64 * 1024)
+#define FUNCTS 6
+#define LANES 3
+#define PERIODS 200
+
+/* what hal_parallel.c and hal_graph.c need from the rest of the library */
+long long int rtapi_get_clocks(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int rtapi_snprintf(char *buf, unsigned long int size, const char *fmt, ...)
+{
+    va_list args;
+    int n;
+
+    va_start(args, fmt);
+    n = vsnprintf(buf, size, fmt, args);
+    va_end(args);
+    return n;
+}
+
+hal_list_t *list_next(hal_list_t * entry)
+{
+    return SHMPTR(entry->next);
+}
+
+static void list_append(hal_list_t * entry, hal_list_t * root)
+{
+    hal_list_t *prev = SHMPTR(root->prev);
+
+    entry->prev = root->prev;
+    entry->next = SHMOFF(root);
+    prev->next = SHMOFF(entry);
+    root->prev = SHMOFF(entry);
+}
+
+/* a servo thread: 'pid' reads what 'enc' writes and writes what 'pwm'
+   reads, 'enc' has two functs; 'dio' and 'led' share nothing with
+   anybody, they may run next to the others */
+static const char *names[FUNCTS] = {
+    "enc.capture", "dio.read", "enc.update", "pid", "led", "pwm.write"
+};
+static const int owner[FUNCTS] = { 0, 1, 0, 2, 3, 4 };
+static const int runtime[FUNCTS] = { 10, 30, 10, 20, 30, 10 };
+/* earlier functs each one must find done in the same period */
+static const int needs[FUNCTS][FUNCTS] = {
+    {0}, {0}, {1, 0, 0}, {1, 0, 1}, {0}, {0, 0, 0, 1}
+};
+
+static hal_thread_t *thread;
+static hal_funct_t *funct[FUNCTS];
+static volatile unsigned int ran[FUNCTS];
+static volatile unsigned int period;
+static volatile int done;
+static int early, twice;
+
+static void funct_code(void *arg, long period_nsec)
+{
+    int n = (int) (long) arg;
+    int a;
+
+    for (a = 0; a < n; a++) {
+	if (needs[n][a] && ran[a] != period) {
+	    __sync_fetch_and_add(&early, 1);
+	}
+    }
+    if (ran[n] == period) {
+	__sync_fetch_and_add(&twice, 1);
+    }
+    ran[n] = period;
+    /* give the others a chance to get in the way */
+    sched_yield();
+}
+
+static hal_comp_t *new_comp(void)
+{
+    hal_comp_t *comp = hal_test_alloc_dn(sizeof(hal_comp_t));
+
+    comp->next_ptr = hal_data->comp_list_ptr;
+    hal_data->comp_list_ptr = SHMOFF(comp);
+    return comp;
+}
+
+static void new_pin(hal_comp_t * comp, hal_pin_dir_t dir, hal_sig_t * sig)
+{
+    hal_pin_t *pin = hal_test_alloc_dn(sizeof(hal_pin_t));
+
+    pin->owner_ptr = SHMOFF(comp);
+    pin->dir = dir;
+    pin->signal = SHMOFF(sig);
+    pin->next_ptr = hal_data->pin_list_ptr;
+    hal_data->pin_list_ptr = SHMOFF(pin);
+}
+
+static void setup(void)
+{
+    hal_comp_t *comp[5];
+    hal_sig_t *fb, *cmd;
+    hal_funct_entry_t *entry;
+    int n;
+
+    for (n = 0; n < 5; n++) {
+	comp[n] = new_comp();
+    }
+    fb = hal_test_alloc_dn(sizeof(hal_sig_t));
+    cmd = hal_test_alloc_dn(sizeof(hal_sig_t));
+    new_pin(comp[0], HAL_OUT, fb);
+    new_pin(comp[2], HAL_IN, fb);
+    new_pin(comp[2], HAL_OUT, cmd);
+    new_pin(comp[4], HAL_IN, cmd);
+    thread = hal_test_alloc_dn(sizeof(hal_thread_t));
+    thread->period = 1000000;
+    thread->lanes = 1;
+    thread->funct_list.next = SHMOFF(&(thread->funct_list));
+    thread->funct_list.prev = SHMOFF(&(thread->funct_list));
+    for (n = 0; n < FUNCTS; n++) {
+	funct[n] = hal_test_alloc_dn(sizeof(hal_funct_t));
+	rtapi_snprintf(funct[n]->name, sizeof(funct[n]->name), "%s", names[n]);
+	funct[n]->owner_ptr = SHMOFF(comp[owner[n]]);
+	funct[n]->runtime = runtime[n];
+	entry = hal_test_alloc_dn(sizeof(hal_funct_entry_t));
+	entry->funct_ptr = SHMOFF(funct[n]);
+	entry->funct = funct_code;
+	entry->arg = (void *) (long) n;
+	list_append(&(entry->links), &(thread->funct_list));
+    }
+}
+
+/* worker_task(), minus the realtime wait */
+static void *worker(void *arg)
+{
+    int lane = (int) (long) arg;
+    unsigned int last = thread->run;
+
+    while (!done) {
+	if (thread->run == last) {
+	    sched_yield();
+	    continue;
+	}
+	last = thread->run;
+	halpr_parallel_run(thread, lane, last);
+    }
+    return NULL;
+}
+
+/* thread_task() in parallel mode, with 'workers' of the lanes running */
+static void run_periods(int workers)
+{
+    pthread_t tid[LANES];
+    unsigned int run;
+    int n;
+
+    done = 0;
+    for (n = 1; n <= workers; n++) {
+	pthread_create(&tid[n], NULL, worker, (void *) (long) n);
+    }
+    for (n = 0; n < PERIODS; n++) {
+	run = thread->run + 1;
+	period = run;
+	hal_barrier();
+	thread->run = run;
+	halpr_parallel_run(thread, 0, run);
+	halpr_parallel_finish(thread, run);
+    }
+    done = 1;
+    for (n = 1; n <= workers; n++) {
+	pthread_join(tid[n], NULL);
+    }
+}
+
+int main(void)
+{
+    hal_graph_t graph;
+    int n, a, missed;
+
+    if (hal_test_arena(ARENA_SIZE) != 0) {
+	return 1;
+    }
+    setup();
+
+    /* the data flow */
+    CHECK(halpr_graph_build(thread, &graph) == 0);
+    CHECK(graph.nfuncts == FUNCTS && graph.ncomps == 5);
+    for (n = 0; n < FUNCTS; n++) {
+	for (a = 0; a < n; a++) {
+	    if (halpr_graph_depends(&graph, a, n) != needs[n][a]) {
+		fprintf(stderr, "%s after %s: %d, expected %d\n", names[n],
+		    names[a], halpr_graph_depends(&graph, a, n), needs[n][a]);
+		check_fails++;
+	    }
+	}
+    }
+    CHECK(graph.levels == 4);
+    CHECK(graph.serial == 110.0 && graph.crit == 50.0);
+
+    /* one lane is the serial thread, more lanes take the free ones */
+    halpr_graph_schedule(&graph, 1);
+    CHECK(graph.span == 110.0);
+    halpr_graph_schedule(&graph, LANES);
+    CHECK(graph.span == 50.0);
+    CHECK(graph.lane[0] == 0 && graph.lane[2] == 0 && graph.lane[3] == 0 &&
+	graph.lane[5] == 0);
+    CHECK(graph.lane[1] != 0 && graph.lane[4] != 0 &&
+	graph.lane[1] != graph.lane[4]);
+    halpr_graph_apply(&graph);
+    for (n = 0, a = 0; n < FUNCTS; n++) {
+	a += graph.entry[n]->lane != graph.lane[n];
+    }
+    CHECK(a == 0);
+
+    /* every funct once a period, after what it needs */
+    thread->lanes = LANES;
+    run_periods(LANES - 1);
+    for (n = 0, missed = 0; n < FUNCTS; n++) {
+	missed += ran[n] != thread->run;
+    }
+    CHECK(early == 0 && twice == 0 && missed == 0);
+
+    /* also when the lanes have to wait for each other */
+    graph.lane[2] = 1;
+    graph.lane[3] = 2;
+    halpr_graph_apply(&graph);
+    CHECK(graph.entry[2]->wait_ptr[0] == SHMOFF(graph.entry[0]));
+    CHECK(graph.entry[3]->wait_ptr[1] == SHMOFF(graph.entry[2]));
+    CHECK(graph.entry[5]->wait_ptr[2] == SHMOFF(graph.entry[3]));
+    CHECK(graph.entry[5]->wait_ptr[1] == 0);
+    halpr_graph_free(&graph);
+    run_periods(LANES - 1);
+    for (n = 0, missed = 0; n < FUNCTS; n++) {
+	missed += ran[n] != thread->run;
+    }
+    CHECK(early == 0 && twice == 0 && missed == 0);
+
+    /* a worker that never shows up only costs time */
+    run_periods(LANES - 2);
+    for (n = 0, missed = 0; n < FUNCTS; n++) {
+	missed += ran[n] != thread->run;
+    }
+    CHECK(early == 0 && twice == 0 && missed == 0);
+    CHECK(funct[1]->stats.count == 3 * PERIODS);
+
+    hal_test_arena_free();
+    printf("%d functs in %d lanes, %d periods, %d early, %d twice, %s\n",
+	FUNCTS, LANES, 3 * PERIODS, early, twice, CHECK_RESULT);
+    return CHECK_EXIT;
+}
@@ -0,0 +1,155 @@
+/********************************************************************
+* Description:  test_hal_pool.c
+*               Checks the hal_malloc() size classes and that the
+*               memory of an exited component is reused, cleared,
+*               by the next one instead of growing shared memory.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "rtapi.h"
+#include "hal_test.h"
+#include "tests/unittest.h"
+
+#define ARENA_SIZE (1024 * 1024)
+#define RELOADS 1000
+
+/* request sizes and the block size each is rounded up to */
+static const long sizes[][2] = {
+    {0, 8}, {1, 8}, {8, 8}, {9, 16}, {255, 256}, {256, 256},
+    {257, 320}, {300, 320}, {512, 512}, {513, 640}, {1000, 1024},
+    {1025, 1280}, {40000, 40960}, {65536, 65536}, {65537, 65544},
+    {100000, 100000},
+};
+
+#define NSIZES ((int) (sizeof(sizes) / sizeof(sizes[0])))
+
+static long block_size(void *p)
+{
+    return ((hal_pool_block_t *) p - 1)->size;
+}
+
+/* what a component might hal_malloc() in its rtapi_app_main() */
+static int load(hal_comp_t * comp, void **ptrs)
+{
+    int n;
+
+    for (n = 0; n < NSIZES; n++) {
+	ptrs[n] = halpr_pool_alloc(sizes[n][0], comp, hal_test_alloc_up);
+	if (ptrs[n] == 0) {
+	    return -1;
+	}
+	/* dirty it, the next owner must get it cleared */
+	memset(ptrs[n], 0xa5, sizes[n][0]);
+    }
+    return 0;
+}
+
+static int is_clear(void *p, long size)
+{
+    char *c = p;
+
+    while (size-- > 0) {
+	if (*c++ != 0) {
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+int main(void)
+{
+    hal_comp_t a, b;
+    void *first[NSIZES], *again[NSIZES], *p, *q;
+    long bot, bytes, freed;
+    int n, k, same;
+
+    if (hal_test_arena(ARENA_SIZE) != 0) {
+	printf("no memory for the arena\n");
+	return 1;
+    }
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+
+    /* size classes */
+    CHECK(load(&a, first) == 0);
+    bytes = 0;
+    for (n = 0; n < NSIZES; n++) {
+	if (block_size(first[n]) != sizes[n][1]) {
+	    fprintf(stderr, "size %ld: block of %ld, expected %ld\n",
+		sizes[n][0], block_size(first[n]), sizes[n][1]);
+	    check_fails++;
+	}
+	bytes += sizeof(hal_pool_block_t) + sizes[n][1];
+    }
+    CHECK(a.mem_bytes == bytes);
+    CHECK(hal_data->pool_free == 0);
+
+    /* unload, the next component gets the same blocks, cleared */
+    bot = hal_data->shmem_bot;
+    halpr_pool_release(&a);
+    CHECK(a.mem_ptr == 0 && a.mem_bytes == 0);
+    CHECK(hal_data->pool_free == bytes);
+    CHECK(load(&b, again) == 0);
+    CHECK(hal_data->shmem_bot == bot);
+    CHECK(hal_data->pool_free == 0);
+    CHECK(b.mem_bytes == bytes);
+    for (n = 0, same = 0; n < NSIZES; n++) {
+	for (k = 0; k < NSIZES; k++) {
+	    same += (again[n] == first[k]);
+	}
+    }
+    CHECK(same == NSIZES);
+
+    /* a smaller request of the same class takes the freed block */
+    halpr_pool_release(&b);
+    p = halpr_pool_alloc(250, &a, hal_test_alloc_up);
+    CHECK(block_size(p) == 256 && is_clear(p, 256));
+    CHECK(hal_data->shmem_bot == bot);
+
+    /* big blocks are first fit, a bigger one serves a smaller request */
+    q = halpr_pool_alloc(70000, &a, hal_test_alloc_up);
+    CHECK(block_size(q) == 100000 && is_clear(q, 100000));
+    CHECK(hal_data->shmem_bot == bot);
+
+    /* two blocks of the class were freed, the third one is new */
+    q = halpr_pool_alloc(250, &a, hal_test_alloc_up);
+    CHECK(q != p && block_size(q) == 256);
+    CHECK(hal_data->shmem_bot == bot);
+    q = halpr_pool_alloc(250, &a, hal_test_alloc_up);
+    CHECK(block_size(q) == 256);
+    CHECK(hal_data->shmem_bot > bot);
+
+    /* blocks without owner are not released */
+    p = halpr_pool_alloc(24, 0, hal_test_alloc_up);
+    CHECK(p != 0 && block_size(p) == 24);
+    bytes = a.mem_bytes;
+    freed = hal_data->pool_free;
+    halpr_pool_release(&a);
+    CHECK(hal_data->pool_free - freed == bytes);
+
+    /* repeated load and unload runs in constant memory */
+    CHECK(load(&a, first) == 0);
+    halpr_pool_release(&a);
+    bot = hal_data->shmem_bot;
+    for (n = 0; n < RELOADS; n++) {
+	if (load(n & 1 ? &a : &b, again) != 0) {
+	    CHECK(!"out of memory on reload");
+	    break;
+	}
+	halpr_pool_release(n & 1 ? &a : &b);
+    }
+    CHECK(hal_data->shmem_bot == bot);
+
+    /* the arena runs out, the pool reports it */
+    CHECK(halpr_pool_alloc(2 * ARENA_SIZE, &a, hal_test_alloc_up) == 0);
+
+    hal_test_arena_free();
+    printf("%d size classes, %d reloads in constant memory, %s\n",
+	NSIZES, RELOADS, CHECK_RESULT);
+    return CHECK_EXIT;
+}
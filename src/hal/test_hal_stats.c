@@ -0,0 +1,149 @@
+/********************************************************************
+* Description:  test_hal_stats.c
+*               Checks the funct run time statistics against exact
+*               figures, that the histogram comes and goes with the
+*               pool, and times the per funct bookkeeping that
+*               thread_task() adds.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rtapi.h"
+#include "hal_test.h"
+#include "tests/unittest.h"
+
+#define ARENA_SIZE (64 * 1024)
+#define SAMPLES 1000000
+#define BENCH_RUNS 20000000
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_s32(const void *a, const void *b)
+{
+    return *(const int *) a - *(const int *) b;
+}
+
+/* estimate within 'tol' (relative) of the exact percentile */
+static int near(double estimate, int *sorted, double percent,
+    double tol)
+{
+    double exact = sorted[(int) (SAMPLES * percent / 100.0) - 1];
+
+    return estimate >= exact * (1.0 - tol) && estimate <= exact * (1.0 + tol);
+}
+
+int main(void)
+{
+    static int times[SAMPLES];
+    static unsigned int hist[HAL_STATS_BUCKETS];
+    hal_stats_t stats, copy;
+    double t0, per_update, mean;
+    unsigned int seed = 1;
+    unsigned long long sum = 0;
+    long bot;
+    int n;
+
+    if (hal_test_arena(ARENA_SIZE) != 0) {
+	return 1;
+    }
+    /* what every funct and thread carries */
+    CHECK(sizeof(hal_stats_t) <= 48);
+
+    /* without a histogram: the sums, and no percentiles */
+    memset(&stats, 0, sizeof(stats));
+    halpr_stats_reset(&stats);
+    for (n = 0; n < 1000; n++) {
+	halpr_stats_update(&stats, 1000 + n);
+    }
+    hist[7] = 1;
+    CHECK(halpr_stats_snapshot(&stats, &copy, hist) == 0);
+    CHECK(copy.count == 1000 && copy.min == 1000 && copy.max == 1999);
+    CHECK(copy.hist_ptr == 0 && hist[7] == 0);
+    CHECK(halpr_stats_percentile(&copy, hist, 50.0) == 0.0);
+    stats.sumsq = (1ULL << 62);
+    halpr_stats_update(&stats, 1000);
+    CHECK(stats.count == 501);
+
+    /* turned on, it starts with the next run */
+    CHECK(halpr_stats_histogram(&stats, 1, hal_test_alloc_up) == 0);
+    CHECK(stats.hist_ptr != 0 && stats.reset == 1);
+
+    /* a servo funct: about 2000 clocks, jitter, rare long runs */
+    for (n = 0; n < SAMPLES; n++) {
+	times[n] = 1800 + rand_r(&seed) % 400;
+	if (n % 1000 == 7) {
+	    times[n] = 20000 + rand_r(&seed) % 5000;
+	}
+	halpr_stats_update(&stats, times[n]);
+	sum += times[n];
+    }
+    CHECK(halpr_stats_snapshot(&stats, &copy, hist) == 0);
+    qsort(times, SAMPLES, sizeof(times[0]), cmp_s32);
+    CHECK(copy.count == SAMPLES);
+    CHECK(copy.min == times[0]);
+    CHECK(copy.max == times[SAMPLES - 1]);
+    CHECK(copy.sum == sum);
+    mean = (double) copy.sum / copy.count;
+    CHECK(mean > 1990.0 && mean < 2030.0);
+    /* four buckets per octave: within a bucket width */
+    CHECK(near(halpr_stats_percentile(&copy, hist, 50.0), times, 50.0, 0.25));
+    CHECK(near(halpr_stats_percentile(&copy, hist, 99.0), times, 99.0, 0.25));
+    CHECK(near(halpr_stats_percentile(&copy, hist, 99.95), times, 99.95,
+	    0.25));
+    CHECK(halpr_stats_percentile(&copy, hist, 100.0) == copy.max);
+
+    /* a reader asks, the writer clears on its next run */
+    stats.reset = 1;
+    halpr_stats_update(&stats, 500);
+    CHECK(stats.reset == 0);
+    CHECK(stats.count == 1 && stats.min == 500 && stats.max == 500);
+    CHECK((stats.seq & 1) == 0);
+
+    /* halving keeps the shape of the histogram */
+    halpr_stats_reset(&stats);
+    for (n = 0; n < 1000; n++) {
+	halpr_stats_update(&stats, n < 900 ? 100 : 1000);
+    }
+    stats.sumsq = (1ULL << 62);
+    halpr_stats_update(&stats, 100);
+    CHECK(stats.count == 501);
+    CHECK(halpr_stats_snapshot(&stats, &copy, hist) == 0);
+    CHECK(halpr_stats_percentile(&copy, hist, 50.0) < 128.0);
+    CHECK(halpr_stats_percentile(&copy, hist, 95.0) >= 512.0);
+
+    /* off gives it back to the pool, on again takes the same block */
+    bot = hal_data->shmem_bot;
+    CHECK(halpr_stats_histogram(&stats, 0, 0) == 0);
+    CHECK(stats.hist_ptr == 0);
+    CHECK(hal_data->pool_free ==
+	sizeof(hal_pool_block_t) + HAL_STATS_BUCKETS * sizeof(unsigned int));
+    halpr_stats_update(&stats, 100);
+    CHECK(halpr_stats_histogram(&stats, 1, hal_test_alloc_up) == 0);
+    CHECK(hal_data->shmem_bot == bot && hal_data->pool_free == 0);
+
+    /* what thread_task() pays per funct, with the histogram */
+    halpr_stats_reset(&stats);
+    t0 = now_ns();
+    for (n = 0; n < BENCH_RUNS; n++) {
+	halpr_stats_update(&stats, 1500 + (n & 1023));
+    }
+    per_update = (now_ns() - t0) / BENCH_RUNS;
+    CHECK(stats.count == BENCH_RUNS);
+
+    printf("stats update: %.1fns per funct, %d bytes, %s\n", per_update,
+	(int) sizeof(hal_stats_t), CHECK_RESULT);
+    hal_test_arena_free();
+    return CHECK_EXIT;
+}
@@ -136,13 +136,16 @@ void halcmd_shutdown(void) {
 struct halcmd_command halcmd_commands[] = {
     {"addf",    FUNCT(do_addf_cmd),    A_TWO | A_PLUS },
     {"alias",   FUNCT(do_alias_cmd),   A_THREE },
+    {"batch",   FUNCT(do_batch_cmd),   A_ONE | A_TILDE },
     {"delf",    FUNCT(do_delf_cmd),    A_TWO | A_OPTIONAL },
     {"delsig",  FUNCT(do_delsig_cmd),  A_ONE },
     {"getp",    FUNCT(do_getp_cmd),    A_ONE },
     {"gets",    FUNCT(do_gets_cmd),    A_ONE },
     {"ptype",   FUNCT(do_ptype_cmd),   A_ONE },
+    {"reset",   FUNCT(do_reset_cmd),   A_ONE | A_PLUS },
     {"stype",   FUNCT(do_stype_cmd),   A_ONE },
     {"help",    FUNCT(do_help_cmd),    A_ONE | A_OPTIONAL },
+    {"histogram", FUNCT(do_histogram_cmd), A_ONE | A_PLUS },
     {"linkpp",  FUNCT(do_linkpp_cmd),  A_TWO | A_REMOVE_ARROWS },
     {"linkps",  FUNCT(do_linkps_cmd),  A_TWO | A_REMOVE_ARROWS },
     {"linksp",  FUNCT(do_linksp_cmd),  A_TWO | A_REMOVE_ARROWS },
@@ -150,8 +153,11 @@ struct halcmd_command halcmd_commands[] = {
     {"loadrt",  FUNCT(do_loadrt_cmd),  A_ONE | A_PLUS },
     {"loadusr", FUNCT(do_loadusr_cmd), A_PLUS | A_TILDE },
     {"lock",    FUNCT(do_lock_cmd),    A_ONE | A_OPTIONAL },
+    {"log",     FUNCT(do_log_cmd),     A_ONE | A_OPTIONAL },
     {"net",     FUNCT(do_net_cmd),     A_ONE | A_PLUS | A_REMOVE_ARROWS },
     {"newsig",  FUNCT(do_newsig_cmd),  A_TWO },
+    {"pack",    FUNCT(do_pack_cmd),    A_ZERO },
+    {"parallel", FUNCT(do_parallel_cmd), A_TWO },
     {"save",    FUNCT(do_save_cmd),    A_TWO | A_OPTIONAL | A_TILDE },
     {"setexact_for_test_suite_only", FUNCT(do_setexact_cmd), A_ZERO },
     {"setp",    FUNCT(do_setp_cmd),    A_TWO },
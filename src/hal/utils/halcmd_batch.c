@@ -0,0 +1,997 @@
+/** This file, 'halcmd_batch.c', implements the batch mode of halcmd
+    ('halcmd -b -f file' and the 'batch' command).  The whole file is
+    read and tokenized first.  Each run of consecutive loadrt, net,
+    setp, sets, addf and newsig commands is then done in three steps:
+    the modules are loaded, several at once where their dependencies
+    allow it, every other command of the run is checked against the
+    HAL, and only if all of them pass are they applied, in file order.
+    Checking and applying happen under one hold of the mutex; the
+    check looks up the pins, params, functs and threads, and the apply
+    uses them with the unlocked halpr_ functions instead of going
+    through the commands again.  Any other command ends the run and
+    is executed on its own, as in normal mode.  The time spent in each
+    phase is reported at the end.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+
+    THE AUTHORS OF THIS LIBRARY ACCEPT ABSOLUTELY NO LIABILITY FOR
+    ANY HARM OR LOSS RESULTING FROM ITS USE.  IT IS _EXTREMELY_ UNWISE
+    TO RELY ON SOFTWARE ALONE FOR SAFETY.  Any machinery capable of
+    harming persons must have provisions for completely removing power
+    from all motors, etc, before persons enter any danger area.  All
+    machinery must be designed to comply with local and national safety
+    codes, and the authors of this software can not, and do not, take
+    any responsibility for such compliance.
+
+    This code was written as part of the EMC HAL project.  For more
+    information, go to www.linuxcnc.org.
+*/
+
+#include "config.h"
+#include "rtapi.h"
+#include "hal.h"
+#include "../hal_priv.h"
+#include "halcmd.h"
+#include "halcmd_commands.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <search.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+typedef enum {
+    BATCH_OTHER,		/* runs on its own, in order */
+    BATCH_LOADRT,
+    BATCH_NET,
+    BATCH_SETP,
+    BATCH_SETS,
+    BATCH_ADDF,
+    BATCH_NEWSIG
+} batch_kind_t;
+
+typedef enum {
+    LOAD_PENDING,
+    LOAD_RUNNING,
+    LOAD_DONE,
+    LOAD_FAILED
+} load_state_t;
+
+typedef struct {
+    batch_kind_t kind;
+    int linenumber;
+    char *tokens[MAX_TOK+1];	/* own copies, unused ones are "" */
+    /* loadrt only */
+    load_state_t state;
+    pid_t pid;
+    char *path;			/* module file */
+    char *depends;		/* modules it needs, comma separated */
+    /* looked up by the check phase, for the apply phase */
+    void *obj[MAX_TOK+1];	/* net: pins to link, NULL ended;
+				   setp: value; addf: funct, thread */
+    int type;			/* net: signal type; setp: value type;
+				   addf: position */
+} batch_cmd_t;
+
+/* what the commands checked so far would change, by name */
+typedef struct {
+    const char *name;
+    const char *signal;		/* pin: signal it gets linked to */
+    int type;			/* signal: its type */
+    int writers;		/* signal: its writers and bidirs */
+    int bidirs;
+    int users;			/* funct: threads it gets added to */
+} batch_name_t;
+
+typedef struct {
+    batch_cmd_t *cmds;
+    int count;
+    int size;
+    int keep_going;
+    int errors;
+    int modules;		/* loaded */
+    double t_parse;		/* time spent per phase, in ms */
+    double t_load;
+    double t_check;
+    double t_apply;
+    double t_other;
+    void *sigs;			/* batch_name_t trees for the checks */
+    void *pins;
+    void *functs;
+    void *threads;		/* users: functs added to the thread */
+} batch_t;
+
+static double now_ms(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static batch_kind_t batch_kind(const char *cmd)
+{
+    if (strcmp(cmd, "loadrt") == 0) {
+	return BATCH_LOADRT;
+    } else if (strcmp(cmd, "net") == 0) {
+	return BATCH_NET;
+    } else if (strcmp(cmd, "setp") == 0) {
+	return BATCH_SETP;
+    } else if (strcmp(cmd, "sets") == 0) {
+	return BATCH_SETS;
+    } else if (strcmp(cmd, "addf") == 0) {
+	return BATCH_ADDF;
+    } else if (strcmp(cmd, "newsig") == 0) {
+	return BATCH_NEWSIG;
+    }
+    return BATCH_OTHER;
+}
+
+/***********************************************************************
+*                          PARSE PHASE                                 *
+************************************************************************/
+
+static int batch_add(batch_t *b, char **tokens, int linenumber)
+{
+    batch_cmd_t *cmd;
+    int n;
+
+    if (b->count == b->size) {
+	b->size = b->size ? 2 * b->size : 256;
+	cmd = realloc(b->cmds, b->size * sizeof(batch_cmd_t));
+	if (cmd == NULL) {
+	    halcmd_error("out of memory\n");
+	    return -ENOMEM;
+	}
+	b->cmds = cmd;
+    }
+    cmd = &(b->cmds[b->count++]);
+    memset(cmd, 0, sizeof(batch_cmd_t));
+    cmd->kind = batch_kind(tokens[0]);
+    cmd->linenumber = linenumber;
+    for (n = 0; n <= MAX_TOK; n++) {
+	if (tokens[n] && tokens[n][0] != '\0') {
+	    cmd->tokens[n] = strdup(tokens[n]);
+	} else {
+	    cmd->tokens[n] = "";
+	}
+    }
+    return 0;
+}
+
+static int batch_parse(batch_t *b, FILE *srcfile)
+{
+    char buf[MAX_CMD_LEN+1];
+    char *tokens[MAX_TOK+1];
+    int linenumber = 1;
+
+    while (fgets(buf, MAX_CMD_LEN, srcfile)) {
+	halcmd_set_linenumber(linenumber);
+	if (halcmd_preprocess_line(buf, tokens) != 0) {
+	    b->errors++;
+	} else if ((strcasecmp(tokens[0], "quit") == 0) ||
+		   (strcasecmp(tokens[0], "exit") == 0)) {
+	    break;
+	} else if (tokens[0][0] != '\0') {
+	    if (batch_add(b, tokens, linenumber) != 0) {
+		return -ENOMEM;
+	    }
+	}
+	linenumber++;
+    }
+    return b->errors ? -EINVAL : 0;
+}
+
+/***********************************************************************
+*                           LOAD PHASE                                 *
+************************************************************************/
+
+/* runs one command the normal way */
+static int batch_exec(batch_t *b, batch_cmd_t *cmd)
+{
+    char *tokens[MAX_TOK+1];
+
+    /* parse_cmd() may rewrite the array, keep ours */
+    memcpy(tokens, cmd->tokens, sizeof(tokens));
+    halcmd_set_linenumber(cmd->linenumber);
+    if (halcmd_parse_cmd(tokens) != 0) {
+	b->errors++;
+	return -1;
+    }
+    return 0;
+}
+
+#if defined(RTAPI_SIM)
+/* rtapi_app loads one module at a time anyway */
+static void batch_load(batch_t *b, int first, int last)
+{
+    int n;
+
+    for (n = first; n < last; n++) {
+	if (b->cmds[n].kind != BATCH_LOADRT) {
+	    continue;
+	}
+	if (batch_exec(b, &(b->cmds[n])) == 0) {
+	    b->modules++;
+	} else if (!b->keep_going) {
+	    return;
+	}
+    }
+}
+#else
+/* the "depends=" entry of the module's .modinfo section, NULL if the
+   module needs no other module */
+static char *module_depends(const char *mod_path)
+{
+    FILE *f;
+    char *image, *p, *end, *deps = NULL;
+    long len;
+
+    f = fopen(mod_path, "r");
+    if (f == NULL) {
+	return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    rewind(f);
+    image = malloc(len + 1);
+    if (image == NULL || fread(image, 1, len, f) != len) {
+	free(image);
+	fclose(f);
+	return NULL;
+    }
+    fclose(f);
+    image[len] = '\0';
+    end = image + len;
+    for (p = image; p + 8 < end; p++) {
+	p = memchr(p, 'd', end - p);
+	if (p == NULL || p + 8 >= end) {
+	    break;
+	}
+	if ((p == image || p[-1] == '\0') && strncmp(p, "depends=", 8) == 0) {
+	    if (p[8] != '\0') {
+		deps = strdup(p + 8);
+	    }
+	    break;
+	}
+    }
+    free(image);
+    return deps;
+}
+
+static int depends_on(const char *depends, const char *name)
+{
+    size_t len = strlen(name);
+    const char *p = depends;
+
+    while (p && *p) {
+	if (strncmp(p, name, len) == 0 && (p[len] == ',' || p[len] == '\0')) {
+	    return 1;
+	}
+	p = strchr(p, ',');
+	if (p) {
+	    p++;
+	}
+    }
+    return 0;
+}
+
+/* a module of this run that 'cmd' needs and that is not loaded yet,
+   or -1 if it can be loaded now */
+static int load_blocker(batch_t *b, int first, int last, batch_cmd_t *cmd)
+{
+    batch_cmd_t *other;
+    int n;
+
+    for (n = first; n < last; n++) {
+	other = &(b->cmds[n]);
+	if (other == cmd || other->kind != BATCH_LOADRT ||
+	    other->state == LOAD_DONE) {
+	    continue;
+	}
+	if (depends_on(cmd->depends, other->tokens[1])) {
+	    return n;
+	}
+    }
+    return -1;
+}
+
+static void load_failed(batch_t *b, batch_cmd_t *cmd)
+{
+    cmd->state = LOAD_FAILED;
+    b->errors++;
+}
+
+static int load_start(batch_t *b, batch_cmd_t *cmd)
+{
+    char *argv[MAX_TOK+3];
+    int m, n;
+    pid_t pid;
+
+    argv[0] = EMC2_BIN_DIR "/linuxcnc_module_helper";
+    argv[1] = "insert";
+    argv[2] = cmd->path;
+    m = 3;
+    for (n = 2; n <= MAX_TOK && cmd->tokens[n][0] != '\0'; n++) {
+	argv[m++] = cmd->tokens[n];
+    }
+    argv[m] = NULL;
+    pid = hal_systemv_nowait(argv);
+    if (comp_id < 0) {
+	fprintf(stderr, "halcmd: hal_init() failed after fork: %d\n", comp_id);
+	exit(-1);
+    }
+    hal_ready(comp_id);
+    if (pid < 0) {
+	return -1;
+    }
+    cmd->pid = pid;
+    cmd->state = LOAD_RUNNING;
+    return 0;
+}
+
+static void load_end(batch_t *b, batch_cmd_t *cmd, int status)
+{
+    halcmd_set_linenumber(cmd->linenumber);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+	halcmd_error("insmod failed, returned %d\n"
+	    "See the output of 'dmesg' for more information.\n",
+	    WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+	load_failed(b, cmd);
+    } else if (loadrt_finish(cmd->tokens[1], &(cmd->tokens[2])) != 0) {
+	load_failed(b, cmd);
+    } else {
+	cmd->state = LOAD_DONE;
+	b->modules++;
+    }
+}
+
+static void batch_load(batch_t *b, int first, int last)
+{
+    char mod_path[MAX_CMD_LEN+1];
+    batch_cmd_t *cmd;
+    int n, blocker, running, finished, status;
+    pid_t pid;
+
+    for (n = first; n < last; n++) {
+	cmd = &(b->cmds[n]);
+	if (cmd->kind != BATCH_LOADRT) {
+	    continue;
+	}
+	halcmd_set_linenumber(cmd->linenumber);
+	if (hal_get_lock()&HAL_LOCK_LOAD) {
+	    halcmd_error("HAL is locked, loading of modules is not permitted\n");
+	    load_failed(b, cmd);
+	} else if (loadrt_module_path(mod_path, sizeof(mod_path), cmd->tokens[1]) != 0) {
+	    load_failed(b, cmd);
+	} else {
+	    cmd->state = LOAD_PENDING;
+	    cmd->path = strdup(mod_path);
+	    cmd->depends = module_depends(mod_path);
+	}
+    }
+    if (b->errors && !b->keep_going) {
+	return;
+    }
+    running = 0;
+    while (1) {
+	/* start everything whose dependencies are in */
+	for (n = first; n < last; n++) {
+	    cmd = &(b->cmds[n]);
+	    if (cmd->kind != BATCH_LOADRT || cmd->state != LOAD_PENDING) {
+		continue;
+	    }
+	    blocker = load_blocker(b, first, last, cmd);
+	    if (blocker >= 0 && b->cmds[blocker].state == LOAD_FAILED) {
+		halcmd_set_linenumber(cmd->linenumber);
+		halcmd_error("module '%s' needs '%s', which was not loaded\n",
+		    cmd->tokens[1], b->cmds[blocker].tokens[1]);
+		load_failed(b, cmd);
+	    } else if (blocker < 0) {
+		if (load_start(b, cmd) != 0) {
+		    load_failed(b, cmd);
+		} else {
+		    running++;
+		}
+	    }
+	}
+	if (running == 0) {
+	    break;
+	}
+	/* and wait for any of them to finish; only our own loaders, the
+	   children of earlier 'loadusr -w' and the like are not ours */
+	finished = 0;
+	for (n = first; n < last; n++) {
+	    cmd = &(b->cmds[n]);
+	    if (cmd->kind != BATCH_LOADRT || cmd->state != LOAD_RUNNING) {
+		continue;
+	    }
+	    pid = waitpid(cmd->pid, &status, WNOHANG);
+	    if (pid == 0 || (pid < 0 && errno == EINTR)) {
+		continue;
+	    }
+	    if (pid < 0) {
+		halcmd_set_linenumber(cmd->linenumber);
+		halcmd_error("waitpid() failed: %s\n", strerror(errno));
+		load_failed(b, cmd);
+	    } else {
+		load_end(b, cmd, status);
+	    }
+	    running--;
+	    finished++;
+	}
+	if (finished == 0) {
+	    usleep(1000);
+	}
+    }
+    /* whatever is left waits on a circular dependency */
+    for (n = first; n < last; n++) {
+	cmd = &(b->cmds[n]);
+	if (cmd->kind == BATCH_LOADRT &&
+	    (cmd->state == LOAD_PENDING || cmd->state == LOAD_RUNNING)) {
+	    halcmd_set_linenumber(cmd->linenumber);
+	    halcmd_error("module '%s' was not loaded\n", cmd->tokens[1]);
+	    load_failed(b, cmd);
+	}
+    }
+}
+#endif
+
+/***********************************************************************
+*                           CHECK PHASE                                *
+************************************************************************/
+
+/* These follow the checks of the individual commands, but also see
+   the changes of the commands before them in the run.  They are all
+   called with the HAL mutex held. */
+
+static int compare_name(const void *a, const void *b)
+{
+    return strcmp(((const batch_name_t *) a)->name,
+	((const batch_name_t *) b)->name);
+}
+
+static batch_name_t *batch_name(void **root, const char *name, int create)
+{
+    batch_name_t key, *entry, **found;
+
+    key.name = name;
+    if (!create) {
+	found = tfind(&key, root, compare_name);
+	return found ? *found : NULL;
+    }
+    entry = calloc(1, sizeof(batch_name_t));
+    if (entry == NULL) {
+	return NULL;
+    }
+    entry->name = name;
+    found = tsearch(entry, root, compare_name);
+    if (found == NULL) {
+	free(entry);
+	return NULL;
+    }
+    if (*found != entry) {
+	free(entry);
+    }
+    return *found;
+}
+
+static int signal_type(const char *type)
+{
+    if (strcasecmp(type, "bit") == 0) {
+	return HAL_BIT;
+    } else if (strcasecmp(type, "float") == 0) {
+	return HAL_FLOAT;
+    } else if (strcasecmp(type, "u32") == 0) {
+	return HAL_U32;
+    } else if (strcasecmp(type, "s32") == 0) {
+	return HAL_S32;
+    }
+    return -1;
+}
+
+/* the signal 'pin' is linked to, counting the nets of this run */
+static const char *pin_signal(batch_t *b, hal_pin_t *pin)
+{
+    batch_name_t *entry;
+
+    entry = batch_name(&(b->pins), pin->name, 0);
+    if (entry) {
+	return entry->signal;
+    }
+    if (pin->signal != 0) {
+	return ((hal_sig_t *) SHMPTR(pin->signal))->name;
+    }
+    return NULL;
+}
+
+static int check_net(batch_t *b, batch_cmd_t *cmd, char **args)
+{
+    char *signal = args[0];
+    const char *linked;
+    batch_name_t *entry;
+    hal_sig_t *sig;
+    hal_pin_t *pin;
+    int i, links = 0, type = -1, writers = 0, bidirs = 0;
+
+    if (strlen(signal) > HAL_NAME_LEN) {
+	halcmd_error("signal name '%s' is too long\n", signal);
+	return -EINVAL;
+    }
+    if (halpr_find_pin_by_name(signal)) {
+	halcmd_error("Signal name '%s' must not be the same as a pin.  "
+	    "Did you omit the signal name?\n", signal);
+	return -ENOENT;
+    }
+    entry = batch_name(&(b->sigs), signal, 0);
+    sig = halpr_find_sig_by_name(signal);
+    if (entry) {
+	type = entry->type;
+	writers = entry->writers;
+	bidirs = entry->bidirs;
+    } else if (sig) {
+	type = sig->type;
+	writers = sig->writers;
+	bidirs = sig->bidirs;
+    }
+    if (args[1] == NULL || args[1][0] == '\0') {
+	halcmd_error("'net' requires at least one pin, none given\n");
+	return -EINVAL;
+    }
+    for (i = 1; args[i] && args[i][0] != '\0'; i++) {
+	pin = halpr_find_pin_by_name(args[i]);
+	if (pin == 0) {
+	    halcmd_error("Pin '%s' does not exist\n", args[i]);
+	    return -ENOENT;
+	}
+	linked = pin_signal(b, pin);
+	if (linked && strcmp(linked, signal) == 0) {
+	    /* already on this signal */
+	    continue;
+	} else if (linked) {
+	    halcmd_error("Pin '%s' was already linked to signal '%s'\n",
+		pin->name, linked);
+	    return -EINVAL;
+	}
+	if (type == -1) {
+	    type = pin->type;
+	}
+	if (type != pin->type) {
+	    halcmd_error("Signal '%s' cannot add pin '%s' of another type\n",
+		signal, pin->name);
+	    return -EINVAL;
+	}
+	if ((pin->dir == HAL_OUT && (writers || bidirs)) ||
+	    (pin->dir == HAL_IO && writers)) {
+	    halcmd_error("Signal '%s' can not add pin '%s', "
+		"it already has a writer\n", signal, pin->name);
+	    return -EINVAL;
+	}
+	if (pin->dir == HAL_OUT) {
+	    writers++;
+	} else if (pin->dir == HAL_IO) {
+	    bidirs++;
+	}
+	entry = batch_name(&(b->pins), pin->name, 1);
+	if (entry == NULL) {
+	    return -ENOMEM;
+	}
+	entry->signal = signal;
+	cmd->obj[links++] = pin;
+    }
+    cmd->obj[links] = NULL;
+    cmd->type = type;
+    entry = batch_name(&(b->sigs), signal, 1);
+    if (entry == NULL) {
+	return -ENOMEM;
+    }
+    entry->type = type;
+    entry->writers = writers;
+    entry->bidirs = bidirs;
+    return 0;
+}
+
+static int check_setp(batch_t *b, batch_cmd_t *cmd, char *name,
+    char *value)
+{
+    hal_param_t *param;
+    hal_pin_t *pin;
+
+    param = halpr_find_param_by_name(name);
+    if (param) {
+	if (param->dir == HAL_RO) {
+	    halcmd_error("param '%s' is not writable\n", name);
+	    return -EINVAL;
+	}
+	cmd->obj[0] = SHMPTR(param->data_ptr);
+	cmd->type = param->type;
+	return halcmd_check_value(param->type, value);
+    }
+    pin = halpr_find_pin_by_name(name);
+    if (pin == 0) {
+	halcmd_error("parameter or pin '%s' not found\n", name);
+	return -EINVAL;
+    }
+    if (pin->dir == HAL_OUT) {
+	halcmd_error("pin '%s' is not writable\n", name);
+	return -EINVAL;
+    }
+    if (pin_signal(b, pin)) {
+	halcmd_error("pin '%s' is connected to a signal\n", name);
+	return -EINVAL;
+    }
+    cmd->obj[0] = &(pin->dummysig);
+    cmd->type = pin->type;
+    return halcmd_check_value(pin->type, value);
+}
+
+static int check_sets(batch_t *b, char *name, char *value)
+{
+    batch_name_t *entry;
+    hal_sig_t *sig;
+
+    entry = batch_name(&(b->sigs), name, 0);
+    sig = halpr_find_sig_by_name(name);
+    if (entry == NULL && sig == 0) {
+	halcmd_error("signal '%s' not found\n", name);
+	return -EINVAL;
+    }
+    if (entry ? entry->writers > 0 : sig->writers > 0) {
+	halcmd_error("signal '%s' already has writer(s)\n", name);
+	return -EINVAL;
+    }
+    return halcmd_check_value(entry ? entry->type : sig->type, value);
+}
+
+/* the functs 'thread' has now, plus those this run adds */
+static int thread_functs(hal_thread_t *thread, batch_name_t *entry)
+{
+    hal_list_t *list_root, *list_entry;
+    int n = entry->users;
+
+    list_root = &(thread->funct_list);
+    for (list_entry = SHMPTR(list_root->next); list_entry != list_root;
+	list_entry = SHMPTR(list_entry->next)) {
+	n++;
+    }
+    return n;
+}
+
+static int check_addf(batch_t *b, batch_cmd_t *cmd, char *name,
+    char *thread_name, char *position_str)
+{
+    batch_name_t *entry, *thread_entry;
+    hal_funct_t *funct;
+    hal_thread_t *thread;
+    int position, functs;
+
+    funct = halpr_find_funct_by_name(name);
+    if (funct == 0) {
+	halcmd_error("function '%s' not found\n", name);
+	return -EINVAL;
+    }
+    thread = halpr_find_thread_by_name(thread_name);
+    if (thread == 0) {
+	halcmd_error("thread '%s' not found\n", thread_name);
+	return -EINVAL;
+    }
+    if (funct->uses_fp && !thread->uses_fp) {
+	halcmd_error("function '%s' needs FP\n", name);
+	return -EINVAL;
+    }
+    entry = batch_name(&(b->functs), funct->name, 1);
+    thread_entry = batch_name(&(b->threads), thread->name, 1);
+    if (entry == NULL || thread_entry == NULL) {
+	return -ENOMEM;
+    }
+    if (!funct->reentrant && funct->users + entry->users > 0) {
+	halcmd_error("function '%s' may only be added to one thread\n", name);
+	return -EINVAL;
+    }
+    position = position_str[0] != '\0' ? atoi(position_str) : -1;
+    functs = thread_functs(thread, thread_entry);
+    if (position == 0 || position > functs + 1 || position < -functs - 1) {
+	halcmd_error("bad position %d for thread '%s'\n", position,
+	    thread_name);
+	return -EINVAL;
+    }
+    entry->users++;
+    thread_entry->users++;
+    cmd->obj[0] = funct;
+    cmd->obj[1] = thread;
+    cmd->type = position;
+    return 0;
+}
+
+static int check_newsig(batch_t *b, char *name, char *type)
+{
+    batch_name_t *entry;
+
+    if (signal_type(type) < 0) {
+	halcmd_error("Unknown signal type '%s'\n", type);
+	return -EINVAL;
+    }
+    if (strlen(name) > HAL_NAME_LEN) {
+	halcmd_error("signal name '%s' is too long\n", name);
+	return -EINVAL;
+    }
+    if (batch_name(&(b->sigs), name, 0) || halpr_find_sig_by_name(name)) {
+	halcmd_error("signal '%s' already exists\n", name);
+	return -EINVAL;
+    }
+    entry = batch_name(&(b->sigs), name, 1);
+    if (entry == NULL) {
+	return -ENOMEM;
+    }
+    entry->type = signal_type(type);
+    return 0;
+}
+
+static int check_cmd(batch_t *b, batch_cmd_t *cmd)
+{
+    char *args[MAX_TOK+1];
+    int n, m;
+
+    halcmd_set_linenumber(cmd->linenumber);
+    if ((cmd->kind == BATCH_NET || cmd->kind == BATCH_ADDF ||
+	    cmd->kind == BATCH_NEWSIG) && (hal_data->lock & HAL_LOCK_CONFIG)) {
+	halcmd_error("HAL is locked, '%s' is not permitted\n", cmd->tokens[0]);
+	return -EPERM;
+    }
+    switch (cmd->kind) {
+    case BATCH_NET:
+	/* drop the arrows, like parse_cmd() does */
+	for (n = 1, m = 0; n <= MAX_TOK && cmd->tokens[n][0] != '\0'; n++) {
+	    if (cmd->tokens[n][0] != '<' && cmd->tokens[n][0] != '=') {
+		args[m++] = cmd->tokens[n];
+	    }
+	}
+	args[m] = NULL;
+	if (m == 0) {
+	    halcmd_error("net requires at least 1 arguments, 0 given\n");
+	    return -EINVAL;
+	}
+	return check_net(b, cmd, args);
+    case BATCH_SETP:
+	return check_setp(b, cmd, cmd->tokens[1], cmd->tokens[2]);
+    case BATCH_SETS:
+	return check_sets(b, cmd->tokens[1], cmd->tokens[2]);
+    case BATCH_ADDF:
+	return check_addf(b, cmd, cmd->tokens[1], cmd->tokens[2],
+	    cmd->tokens[3]);
+    case BATCH_NEWSIG:
+	return check_newsig(b, cmd->tokens[1], cmd->tokens[2]);
+    default:
+	return 0;
+    }
+}
+
+/***********************************************************************
+*                           APPLY PHASE                                *
+************************************************************************/
+
+/* These do what the checks found, still under the same hold of the
+   mutex, so nothing could have changed in between. */
+
+static int apply_net(batch_cmd_t *cmd)
+{
+    hal_sig_t *sig;
+    int n, retval;
+
+    sig = halpr_find_sig_by_name(cmd->tokens[1]);
+    if (sig == 0) {
+	/* with the type of its first pin */
+	retval = halpr_signal_new(cmd->tokens[1], cmd->type);
+	if (retval != 0) {
+	    return retval;
+	}
+	sig = halpr_find_sig_by_name(cmd->tokens[1]);
+    }
+    for (n = 0; cmd->obj[n] != NULL; n++) {
+	retval = halpr_link(cmd->obj[n], sig);
+	if (retval != 0) {
+	    return retval;
+	}
+    }
+    return 0;
+}
+
+static int apply_sets(batch_cmd_t *cmd)
+{
+    hal_sig_t *sig;
+
+    /* it may be new in this run */
+    sig = halpr_find_sig_by_name(cmd->tokens[1]);
+    if (sig == 0) {
+	return -EINVAL;
+    }
+    return halcmd_set_value(sig->type, SHMPTR(sig->data_ptr),
+	cmd->tokens[2]);
+}
+
+static int apply_cmd(batch_cmd_t *cmd)
+{
+    switch (cmd->kind) {
+    case BATCH_NET:
+	return apply_net(cmd);
+    case BATCH_SETP:
+	return halcmd_set_value(cmd->type, cmd->obj[0], cmd->tokens[2]);
+    case BATCH_SETS:
+	return apply_sets(cmd);
+    case BATCH_ADDF:
+	return halpr_add_funct_to_thread(cmd->obj[0], cmd->obj[1], cmd->type);
+    case BATCH_NEWSIG:
+	return halpr_signal_new(cmd->tokens[1], signal_type(cmd->tokens[2]));
+    default:
+	return 0;
+    }
+}
+
+/***********************************************************************
+*                              RUN                                     *
+************************************************************************/
+
+/* one run of batchable commands, cmds[first] up to cmds[last-1] */
+static void batch_run(batch_t *b, int first, int last)
+{
+    batch_cmd_t *cmd;
+    double t;
+    int n, errors, linked;
+
+    t = now_ms();
+    batch_load(b, first, last);
+    b->t_load += now_ms() - t;
+    if (b->errors && !b->keep_going) {
+	return;
+    }
+    /* check everything before changing anything */
+    t = now_ms();
+    errors = 0;
+    rtapi_mutex_get(&(hal_data->mutex));
+    for (n = first; n < last; n++) {
+	if (b->cmds[n].kind == BATCH_LOADRT) {
+	    continue;
+	}
+	if (check_cmd(b, &(b->cmds[n])) != 0) {
+	    errors++;
+	}
+    }
+    tdestroy(b->sigs, free);
+    tdestroy(b->pins, free);
+    tdestroy(b->functs, free);
+    tdestroy(b->threads, free);
+    b->sigs = b->pins = b->functs = b->threads = NULL;
+    b->t_check += now_ms() - t;
+    if (errors) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	halcmd_error("%d error(s), lines %d to %d not applied\n", errors,
+	    b->cmds[first].linenumber, b->cmds[last-1].linenumber);
+	b->errors += errors;
+	return;
+    }
+    t = now_ms();
+    linked = 0;
+    for (n = first; n < last; n++) {
+	cmd = &(b->cmds[n]);
+	if (cmd->kind == BATCH_LOADRT) {
+	    continue;
+	}
+	if (apply_cmd(cmd) != 0) {
+	    halcmd_set_linenumber(cmd->linenumber);
+	    halcmd_error("%s failed\n", cmd->tokens[0]);
+	    b->errors++;
+	    if (!b->keep_going) {
+		break;
+	    }
+	}
+	linked |= (cmd->kind == BATCH_NET);
+    }
+    if (linked) {
+	/* components may depend on others now, once for all the nets */
+	halpr_threads_replan();
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    b->t_apply += now_ms() - t;
+}
+
+static void batch_free(batch_t *b)
+{
+    int n, i;
+
+    for (n = 0; n < b->count; n++) {
+	for (i = 0; i <= MAX_TOK; i++) {
+	    if (b->cmds[n].tokens[i][0] != '\0') {
+		free(b->cmds[n].tokens[i]);
+	    }
+	}
+	free(b->cmds[n].path);
+	free(b->cmds[n].depends);
+    }
+    free(b->cmds);
+}
+
+int halcmd_batch(FILE *srcfile, int keep_going)
+{
+    batch_t b;
+    double t, start;
+    int first, last;
+
+    memset(&b, 0, sizeof(b));
+    b.keep_going = keep_going;
+    start = now_ms();
+    if (batch_parse(&b, srcfile) == -ENOMEM) {
+	b.keep_going = 0;
+    }
+    b.t_parse = now_ms() - start;
+    first = 0;
+    while (first < b.count && (b.errors == 0 || b.keep_going)) {
+	if (halcmd_done) {
+	    b.errors++;
+	    break;
+	}
+	if (b.cmds[first].kind == BATCH_OTHER) {
+	    t = now_ms();
+	    batch_exec(&b, &(b.cmds[first]));
+	    b.t_other += now_ms() - t;
+	    first++;
+	    continue;
+	}
+	for (last = first; last < b.count; last++) {
+	    if (b.cmds[last].kind == BATCH_OTHER) {
+		break;
+	    }
+	}
+	batch_run(&b, first, last);
+	first = last;
+    }
+    if (rtapi_get_msg_level() >= RTAPI_MSG_ERR) {
+	fprintf(stderr, "%s: %d commands, %d modules loaded in %.1f ms: "
+	    "parse %.1f, load %.1f, check %.1f, apply %.1f, other %.1f ms\n",
+	    halcmd_get_filename(), b.count, b.modules, now_ms() - start,
+	    b.t_parse, b.t_load, b.t_check, b.t_apply, b.t_other);
+    }
+    batch_free(&b);
+    return b.errors;
+}
+
+int do_batch_cmd(char *hal_filename)
+{
+    FILE *f = fopen(hal_filename, "r");
+    int fd, errors;
+    int lineno_save = halcmd_get_linenumber();
+    char *filename_save = strdup(halcmd_get_filename());
+
+    if (!f) {
+	fprintf(stderr, "Could not open hal file '%s': %s\n",
+		hal_filename, strerror(errno));
+	free(filename_save);
+	return -EINVAL;
+    }
+    fd = fileno(f);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    halcmd_set_filename(hal_filename);
+    errors = halcmd_batch(f, 0);
+
+    halcmd_set_linenumber(lineno_save);
+    halcmd_set_filename(filename_save);
+    free(filename_save);
+    fclose(f);
+    return errors ? -EINVAL : 0;
+}
@@ -54,7 +54,9 @@
 #include <signal.h>
 #include <errno.h>
 #include <time.h>
+#include <syslog.h>
 #include <fnmatch.h>
+#include <math.h>
 
 
 static int unloadrt_comp(char *mod_name);
@@ -67,6 +69,8 @@ static void print_script_sig_info(int type, char **patterns);
 static void print_param_info(int type, char **patterns);
 static void print_funct_info(char **patterns);
 static void print_thread_info(char **patterns);
+static void print_funct_stats(char **patterns);
+static void print_thread_graph(char **patterns);
 static void print_comp_names(char **patterns);
 static void print_pin_names(char **patterns);
 static void print_sig_names(char **patterns);
@@ -290,6 +294,93 @@ int do_start_cmd(void) {
     return retval;
 }
 
+int do_pack_cmd(void) {
+    int retval = hal_pack_signals();
+    if (retval >= 0) {
+        /* print success message */
+        halcmd_info("%d signal values packed\n", retval);
+        retval = 0;
+    }
+    return retval;
+}
+
+int do_parallel_cmd(char *thread, char *onoff) {
+    int retval, on;
+
+    if (strcmp(onoff, "on") == 0) {
+        on = 1;
+    } else if (strcmp(onoff, "off") == 0) {
+        on = 0;
+    } else {
+        halcmd_error("parallel: expected 'on' or 'off', got '%s'\n", onoff);
+        return -EINVAL;
+    }
+    retval = hal_thread_parallel(thread, on);
+    if (retval == 0) {
+        halcmd_info("Thread '%s' runs %s\n", thread,
+                    on ? "in parallel" : "serial");
+    } else {
+        halcmd_error("parallel failed\n");
+    }
+    return retval;
+}
+
+int do_histogram_cmd(char *onoff, char **patterns) {
+    int next, n, count, on, retval;
+    hal_funct_t *fptr;
+    hal_thread_t *tptr;
+    char (*names)[HAL_NAME_LEN + 1];
+
+    if (strcmp(onoff, "on") == 0) {
+        on = 1;
+    } else if (strcmp(onoff, "off") == 0) {
+        on = 0;
+    } else {
+        halcmd_error("histogram: expected 'on' or 'off', got '%s'\n", onoff);
+        return -EINVAL;
+    }
+    /* collect the names first, hal_stats_histogram() takes the mutex */
+    rtapi_mutex_get(&(hal_data->mutex));
+    count = 0;
+    for (next = hal_data->thread_list_ptr; next != 0; next = tptr->next_ptr) {
+        tptr = SHMPTR(next);
+        count++;
+    }
+    for (next = hal_data->funct_list_ptr; next != 0; next = fptr->next_ptr) {
+        fptr = SHMPTR(next);
+        count++;
+    }
+    names = malloc((count + 1) * sizeof(*names));
+    if (names == NULL) {
+        rtapi_mutex_give(&(hal_data->mutex));
+        halcmd_error("out of memory\n");
+        return -ENOMEM;
+    }
+    n = 0;
+    for (next = hal_data->thread_list_ptr; next != 0; next = tptr->next_ptr) {
+        tptr = SHMPTR(next);
+        if (match(patterns, tptr->name)) {
+            strcpy(names[n++], tptr->name);
+        }
+    }
+    for (next = hal_data->funct_list_ptr; next != 0; next = fptr->next_ptr) {
+        fptr = SHMPTR(next);
+        if (match(patterns, fptr->name)) {
+            strcpy(names[n++], fptr->name);
+        }
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    retval = 0;
+    for (count = 0; count < n && retval == 0; count++) {
+        retval = hal_stats_histogram(names[count], on);
+    }
+    free(names);
+    if (retval != 0) {
+        halcmd_error("histogram failed\n");
+    }
+    return retval;
+}
+
 int do_stop_cmd(void) {
     int retval = hal_stop_threads();
     if (retval == 0) {
@@ -624,6 +715,7 @@ int do_newsig_cmd(char *name, char *type)
 
 static int set_common(hal_type_t type, void *d_ptr, char *value) {
     // This function assumes that the mutex is held
+    // A NULL d_ptr only checks that 'value' is valid for 'type'
     int retval = 0;
     double fval;
     long lval;
@@ -633,10 +725,10 @@ static int set_common(hal_type_t type, void *d_ptr, char *value) {
     switch (type) {
     case HAL_BIT:
 	if ((strcmp("1", value) == 0) || (strcasecmp("TRUE", value) == 0)) {
-	    *(hal_bit_t *) (d_ptr) = 1;
+	    if (d_ptr) *(hal_bit_t *) (d_ptr) = 1;
 	} else if ((strcmp("0", value) == 0)
 	    || (strcasecmp("FALSE", value)) == 0) {
-	    *(hal_bit_t *) (d_ptr) = 0;
+	    if (d_ptr) *(hal_bit_t *) (d_ptr) = 0;
 	} else {
 	    halcmd_error("value '%s' invalid for bit\n", value);
 	    retval = -EINVAL;
@@ -649,7 +741,7 @@ static int set_common(hal_type_t type, void *d_ptr, char *value) {
 	    halcmd_error("value '%s' invalid for float\n", value);
 	    retval = -EINVAL;
 	} else {
-	    *((hal_float_t *) (d_ptr)) = fval;
+	    if (d_ptr) *((hal_float_t *) (d_ptr)) = fval;
 	}
 	break;
     case HAL_S32:
@@ -659,7 +751,7 @@ static int set_common(hal_type_t type, void *d_ptr, char *value) {
 	    halcmd_error("value '%s' invalid for S32\n", value);
 	    retval = -EINVAL;
 	} else {
-	    *((hal_s32_t *) (d_ptr)) = lval;
+	    if (d_ptr) *((hal_s32_t *) (d_ptr)) = lval;
 	}
 	break;
     case HAL_U32:
@@ -669,7 +761,7 @@ static int set_common(hal_type_t type, void *d_ptr, char *value) {
 	    halcmd_error("value '%s' invalid for U32\n", value);
 	    retval = -EINVAL;
 	} else {
-	    *((hal_u32_t *) (d_ptr)) = ulval;
+	    if (d_ptr) *((hal_u32_t *) (d_ptr)) = ulval;
 	}
 	break;
     default:
@@ -680,6 +772,16 @@ static int set_common(hal_type_t type, void *d_ptr, char *value) {
     return retval;
 }
 
+int halcmd_check_value(hal_type_t type, char *value)
+{
+    return set_common(type, NULL, value);
+}
+
+int halcmd_set_value(hal_type_t type, void *d_ptr, char *value)
+{
+    return set_common(type, d_ptr, value);
+}
+
 int do_setp_cmd(char *name, char *value)
 {
     int retval;
@@ -982,6 +1084,12 @@ int do_show_cmd(char *type, char **patterns)
     } else if (strcmp(type, "alias") == 0) {
 	print_pin_aliases(patterns);
 	print_param_aliases(patterns);
+    } else if (strcmp(type, "mem") == 0) {
+	print_mem_status();
+    } else if (strcmp(type, "funct-stats") == 0) {
+	print_funct_stats(patterns);
+    } else if (strcmp(type, "graph") == 0) {
+	print_thread_graph(patterns);
     } else {
 	halcmd_error("Unknown 'show' type '%s'\n", type);
 	return -1;
@@ -1047,51 +1155,27 @@ int do_status_cmd(char *type)
     return 0;
 }
 
-int do_loadrt_cmd(char *mod_name, char *args[])
+#if !defined(RTAPI_SIM)
+int loadrt_module_path(char *mod_path, size_t size, char *mod_name)
 {
-    char arg_string[MAX_CMD_LEN+1];
-    int m=0, n=0, retval;
-    hal_comp_t *comp;
-    char *argv[MAX_TOK+3];
-    char *cp1;
-#if defined(RTAPI_SIM)
-    argv[m++] = "-Wn";
-    argv[m++] = mod_name;
-    argv[m++] = EMC2_BIN_DIR "/rtapi_app";
-    argv[m++] = "load";
-    argv[m++] = mod_name;
-    /* loop thru remaining arguments */
-    while ( args[n] && args[n][0] != '\0' ) {
-        argv[m++] = args[n++];
-    }
-    argv[m++] = NULL;
-    retval = do_loadusr_cmd(argv);
-#else
     static char *rtmod_dir = EMC2_RTLIB_DIR;
     struct stat stat_buf;
-    char mod_path[MAX_CMD_LEN+1];
+    int r;
 
-    if (hal_get_lock()&HAL_LOCK_LOAD) {
-	halcmd_error("HAL is locked, loading of modules is not permitted\n");
-	return -EPERM;
-    }
     if ( (strlen(rtmod_dir)+strlen(mod_name)+5) > MAX_CMD_LEN ) {
 	halcmd_error("Module path too long\n");
 	return -1;
     }
 
     /* make full module name '<path>/<name>.o' */
-    {
-        int r;
-        r = snprintf(mod_path, sizeof(mod_path), "%s/%s%s", rtmod_dir, mod_name, MODULE_EXT);
-        if (r < 0) {
-            halcmd_error("error making module path for %s/%s%s\n", rtmod_dir, mod_name, MODULE_EXT);
-            return -1;
-        } else if (r >= sizeof(mod_path)) {
-            // truncation!
-            halcmd_error("module path too long (max %lu) for %s/%s%s\n", (unsigned long)sizeof(mod_path)-1, rtmod_dir, mod_name, MODULE_EXT);
-            return -1;
-        }
+    r = snprintf(mod_path, size, "%s/%s%s", rtmod_dir, mod_name, MODULE_EXT);
+    if (r < 0) {
+        halcmd_error("error making module path for %s/%s%s\n", rtmod_dir, mod_name, MODULE_EXT);
+        return -1;
+    } else if (r >= size) {
+        // truncation!
+        halcmd_error("module path too long (max %lu) for %s/%s%s\n", (unsigned long)size-1, rtmod_dir, mod_name, MODULE_EXT);
+        return -1;
     }
 
     /* is there a file with that name? */
@@ -1100,30 +1184,17 @@ int do_loadrt_cmd(char *mod_name, char *args[])
         halcmd_error("Can't find module '%s' in %s\n", mod_name, rtmod_dir);
         return -1;
     }
-    
-    argv[0] = EMC2_BIN_DIR "/linuxcnc_module_helper";
-    argv[1] = "insert";
-    argv[2] = mod_path;
-    /* loop thru remaining arguments */
-    n = 0;
-    m = 3;
-    while ( args[n] && args[n][0] != '\0' ) {
-        argv[m++] = args[n++];
-    }
-    /* add a NULL to terminate the argv array */
-    argv[m] = NULL;
-
-    retval = hal_systemv(argv);
+    return 0;
+}
 #endif
 
-    if ( retval != 0 ) {
-	halcmd_error("insmod failed, returned %d\n"
-#if !defined(RTAPI_SIM)
-            "See the output of 'dmesg' for more information.\n"
-#endif
-        , retval );
-	return -1;
-    }
+int loadrt_finish(char *mod_name, char *args[])
+{
+    char arg_string[MAX_CMD_LEN+1];
+    int n;
+    hal_comp_t *comp;
+    char *cp1;
+
     /* make the args that were passed to the module into a single string */
     n = 0;
     arg_string[0] = '\0';
@@ -1150,12 +1221,67 @@ int do_loadrt_cmd(char *mod_name, char *args[])
     }
     /* link args to comp struct */
     comp->insmod_args = SHMOFF(cp1);
+    /* functs it added to threads in parallel mode left them serial */
+    halpr_threads_replan();
     rtapi_mutex_give(&(hal_data->mutex));
     /* print success message */
     halcmd_info("Realtime module '%s' loaded\n", mod_name);
     return 0;
 }
 
+int do_loadrt_cmd(char *mod_name, char *args[])
+{
+    int m=0, n=0, retval;
+    char *argv[MAX_TOK+3];
+#if defined(RTAPI_SIM)
+    argv[m++] = "-Wn";
+    argv[m++] = mod_name;
+    argv[m++] = EMC2_BIN_DIR "/rtapi_app";
+    argv[m++] = "load";
+    argv[m++] = mod_name;
+    /* loop thru remaining arguments */
+    while ( args[n] && args[n][0] != '\0' ) {
+        argv[m++] = args[n++];
+    }
+    argv[m++] = NULL;
+    retval = do_loadusr_cmd(argv);
+#else
+    char mod_path[MAX_CMD_LEN+1];
+
+    if (hal_get_lock()&HAL_LOCK_LOAD) {
+	halcmd_error("HAL is locked, loading of modules is not permitted\n");
+	return -EPERM;
+    }
+    if (loadrt_module_path(mod_path, sizeof(mod_path), mod_name) != 0) {
+	return -1;
+    }
+    
+    argv[0] = EMC2_BIN_DIR "/linuxcnc_module_helper";
+    argv[1] = "insert";
+    argv[2] = mod_path;
+    /* loop thru remaining arguments */
+    n = 0;
+    m = 3;
+    while ( args[n] && args[n][0] != '\0' ) {
+        argv[m++] = args[n++];
+    }
+    /* add a NULL to terminate the argv array */
+    argv[m] = NULL;
+
+    retval = hal_systemv(argv);
+#endif
+
+    if ( retval != 0 ) {
+	halcmd_error("insmod failed, returned %d\n"
+#if !defined(RTAPI_SIM)
+            "See the output of 'dmesg' for more information.\n"
+#endif
+        , retval );
+	return -1;
+    }
+    return loadrt_finish(mod_name, args);
+}
+
 int do_delsig_cmd(char *mod_name)
 {
     int next, retval, retval1, n;
@@ -1330,6 +1456,11 @@ static int unloadrt_comp(char *mod_name)
 	halcmd_error("rmmod failed, returned %d\n", retval);
 	return -1;
     }
+    /* its functs left threads in parallel mode serial, hal_lib can't
+       plan them from realtime */
+    rtapi_mutex_get(&(hal_data->mutex));
+    halpr_threads_replan();
+    rtapi_mutex_give(&(hal_data->mutex));
     /* print success message */
     halcmd_info("Realtime module '%s' unloaded\n",
 	mod_name);
@@ -1556,6 +1687,73 @@ int do_waitusr_cmd(char *comp_name)
 }
 
 
+int do_log_cmd(char *mode)
+{
+    static const char *level_names[] = {
+	"", "ERR", "WARN", "INFO", "DBG", "ALL"
+    };
+    static const int priorities[] = {
+	LOG_ERR, LOG_ERR, LOG_WARNING, LOG_INFO, LOG_DEBUG, LOG_DEBUG
+    };
+    char buf[1024];
+    int follow, drain, level, len;
+    long long time;
+    struct timespec ts = {0, 100 * 1000 * 1000};
+
+    follow = (strcmp(mode, "follow") == 0);
+    drain = (strcmp(mode, "syslog") == 0);
+    if (*mode != '\0' && !follow && !drain) {
+	halcmd_error("unknown log mode '%s'\n", mode);
+	return -EINVAL;
+    }
+    if (drain) {
+	/* forwards for as long as it runs, like follow */
+	follow = 1;
+	openlog("rtapi", 0, LOG_USER);
+    }
+    while (!halcmd_done) {
+	if (drain) {
+	    len = rtapi_log_drain(buf, sizeof(buf), &level, &time);
+	} else {
+	    len = rtapi_log_read(buf, sizeof(buf), &level, &time);
+	}
+	if (len == -EBUSY && drain) {
+	    /* 'halcmd log' is reading, try again later */
+	    len = 0;
+	} else if (len == -EBUSY) {
+	    halcmd_error("another process is reading the message ring\n");
+	    return len;
+	} else if (len < 0) {
+	    halcmd_error("no message ring\n");
+	    return len;
+	}
+	if (len == 0) {
+	    if (!follow) {
+		break;
+	    }
+	    /* sleep for 100mS */
+	    nanosleep(&ts, NULL);
+	    continue;
+	}
+	if (level < RTAPI_MSG_NONE || level > RTAPI_MSG_ALL) {
+	    level = RTAPI_MSG_ALL;
+	}
+	if (drain) {
+	    syslog(priorities[level], "%s", buf);
+	} else if (scriptmode) {
+	    halcmd_output("%s", buf);
+	} else {
+	    halcmd_output("%6lld.%06lld %-4s %s", time / 1000000000,
+		(time % 1000000000) / 1000, level_names[level], buf);
+	}
+    }
+    if (drain) {
+	closelog();
+    }
+    return 0;
+}
+
+
 static void print_comp_info(char **patterns)
 {
     int next;
@@ -1849,6 +2047,225 @@ static void print_funct_info(char **patterns)
     halcmd_output("\n");
 }
 
+/* one line of 'show funct-stats' */
+static void print_stats_line(const char *kind, const char *name,
+    hal_stats_t * stats)
+{
+    hal_stats_t copy;
+    unsigned int hist[HAL_STATS_BUCKETS];
+    double mean, var;
+
+    if (halpr_stats_snapshot(stats, &copy, hist) != 0) {
+	halcmd_output("%-6s %-31s  (busy, try again)\n", kind, name);
+	return;
+    }
+    if (copy.count == 0) {
+	halcmd_output("%-6s %-31s  %10d\n", kind, name, 0);
+	return;
+    }
+    mean = (double) copy.sum / copy.count;
+    var = (double) copy.sumsq / copy.count - mean * mean;
+    if (var < 0.0) {
+	var = 0.0;
+    }
+    if (copy.hist_ptr == 0) {
+	/* percentiles only with 'histogram on' */
+	halcmd_output("%-6s %-31s  %10u %8ld %8.0f %8.0f %8s %8s %8s %8s %8ld\n",
+	    kind, name, copy.count, (long)copy.min, mean, sqrt(var),
+	    "-", "-", "-", "-", (long)copy.max);
+	return;
+    }
+    halcmd_output("%-6s %-31s  %10u %8ld %8.0f %8.0f %8.0f %8.0f %8.0f %8.0f %8ld\n",
+	kind, name, copy.count, (long)copy.min, mean, sqrt(var),
+	halpr_stats_percentile(&copy, hist, 50.0),
+	halpr_stats_percentile(&copy, hist, 90.0),
+	halpr_stats_percentile(&copy, hist, 99.0),
+	halpr_stats_percentile(&copy, hist, 99.9), (long)copy.max);
+}
+
+static void print_funct_stats(char **patterns)
+{
+    int next;
+    hal_funct_t *fptr;
+    hal_thread_t *tptr;
+
+    if (scriptmode == 0) {
+	halcmd_output("Function Run Time Statistics (same units as .time):\n");
+	halcmd_output("Type   Name                                  Count      Min     Mean   StdDev"
+	    "      P50      P90      P99    P99.9      Max\n");
+    }
+    rtapi_mutex_get(&(hal_data->mutex));
+    next = hal_data->thread_list_ptr;
+    while (next != 0) {
+	tptr = SHMPTR(next);
+	if (match(patterns, tptr->name)) {
+	    print_stats_line("thread", tptr->name, &(tptr->stats));
+	}
+	next = tptr->next_ptr;
+    }
+    next = hal_data->funct_list_ptr;
+    while (next != 0) {
+	fptr = SHMPTR(next);
+	if (match(patterns, fptr->name)) {
+	    print_stats_line("funct", fptr->name, &(fptr->stats));
+	}
+	next = fptr->next_ptr;
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    halcmd_output("\n");
+}
+
+static void print_one_graph(hal_thread_t * tptr)
+{
+    hal_graph_t graph;
+    char *reach, *on_path;
+    int n, a, b, c, len, parallel;
+    char after[80];
+
+    if (halpr_graph_build(tptr, &graph) != 0) {
+	halcmd_error("out of memory\n");
+	return;
+    }
+    n = graph.nfuncts;
+    if (n == 0) {
+	halcmd_output("Thread %s has no functions\n\n", tptr->name);
+	halpr_graph_free(&graph);
+	return;
+    }
+    reach = calloc(n * n, 1);
+    on_path = calloc(n, 1);
+    if (!reach || !on_path) {
+	halcmd_error("out of memory\n");
+	goto out;
+    }
+    for (a = graph.last; graph.crit > 0.0 && a >= 0; a = graph.crit_prev[a]) {
+	on_path[a] = 1;
+    }
+    /* 'reach[a][b]': b can only start after a is done */
+    for (b = 0; b < n; b++) {
+	for (a = b - 1; a >= 0; a--) {
+	    if (halpr_graph_depends(&graph, a, b)) {
+		reach[a * n + b] = 1;
+	    }
+	    if (reach[a * n + b]) {
+		for (c = 0; c < a; c++) {
+		    if (reach[c * n + a]) {
+			reach[c * n + b] = 1;
+		    }
+		}
+	    }
+	}
+    }
+    /* in parallel mode, the lanes the thread runs them in, and the
+       period a plan from the current means would give */
+    parallel = tptr->lanes > 1;
+    if (parallel) {
+	halpr_graph_schedule(&graph, tptr->lanes);
+    }
+    if (scriptmode == 0) {
+	halcmd_output("Thread %s, %d functions in %d levels:\n", tptr->name,
+	    n, graph.levels);
+	halcmd_output("Order Level     Mean   Finish Crit %sName                            After\n",
+	    parallel ? "Lane " : "");
+    }
+    for (b = 0; b < n; b++) {
+	/* only the direct dependencies, not those implied by others */
+	after[0] = '\0';
+	len = 0;
+	for (a = 0; a < b && len < (int) sizeof(after); a++) {
+	    if (!halpr_graph_depends(&graph, a, b)) {
+		continue;
+	    }
+	    for (c = a + 1; c < b; c++) {
+		if (reach[a * n + c] && reach[c * n + b]) {
+		    break;
+		}
+	    }
+	    if (c == b) {
+		len += snprintf(after + len, sizeof(after) - len, "%s%d",
+		    len ? "," : "", a + 1);
+	    }
+	}
+	halcmd_output("%5d %5d %8.0f %8.0f  %s   ", b + 1, graph.level[b],
+	    graph.mean[b], graph.finish[b], on_path[b] ? "*" : " ");
+	if (parallel) {
+	    halcmd_output("%4d ", graph.entry[b]->lane);
+	}
+	if (after[0] != '\0') {
+	    halcmd_output("%-31s %s\n", graph.funct[b]->name, after);
+	} else {
+	    halcmd_output("%s\n", graph.funct[b]->name);
+	}
+    }
+    if (scriptmode == 0) {
+	halcmd_output("Serial %.0f, critical path %.0f", graph.serial,
+	    graph.crit);
+	if (graph.crit > 0.0) {
+	    halcmd_output(", at most %.2fx faster in parallel",
+		graph.serial / graph.crit);
+	}
+	halcmd_output("\n");
+	if (parallel) {
+	    halcmd_output("Parallel in %d lanes, about %.0f if planned now\n",
+		tptr->lanes, graph.span);
+	}
+    }
+    halcmd_output("\n");
+  out:
+    free(reach);
+    free(on_path);
+    halpr_graph_free(&graph);
+}
+
+static void print_thread_graph(char **patterns)
+{
+    int next;
+    hal_thread_t *tptr;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    next = hal_data->thread_list_ptr;
+    while (next != 0) {
+	tptr = SHMPTR(next);
+	if (match(patterns, tptr->name)) {
+	    print_one_graph(tptr);
+	}
+	next = tptr->next_ptr;
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+}
+
+int do_reset_cmd(char *type, char **patterns)
+{
+    int next;
+    hal_funct_t *fptr;
+    hal_thread_t *tptr;
+
+    if (strcmp(type, "funct-stats") != 0) {
+	halcmd_error("Unknown 'reset' type '%s'\n", type);
+	return -1;
+    }
+    /* the threads clear the stats on their next run */
+    rtapi_mutex_get(&(hal_data->mutex));
+    next = hal_data->thread_list_ptr;
+    while (next != 0) {
+	tptr = SHMPTR(next);
+	if (match(patterns, tptr->name)) {
+	    tptr->stats.reset = 1;
+	}
+	next = tptr->next_ptr;
+    }
+    next = hal_data->funct_list_ptr;
+    while (next != 0) {
+	fptr = SHMPTR(next);
+	if (match(patterns, fptr->name)) {
+	    fptr->stats.reset = 1;
+	}
+	next = fptr->next_ptr;
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    return 0;
+}
+
 static void print_thread_info(char **patterns)
 {
     int next_thread, n;
@@ -2041,6 +2458,47 @@ static int count_list(int list_root)
     return n;
 }
 
+/* shmem used by each component: its hal_malloc() blocks plus the
+   structs of the pins, params and functs it owns */
+static void print_comp_mem(void)
+{
+    int next, pins, params, functs;
+    long structs;
+    hal_comp_t *comp;
+    hal_pin_t *pin;
+    hal_param_t *param;
+    hal_funct_t *funct;
+
+    halcmd_output("\nShared memory by component:\n");
+    halcmd_output("  %-*s  %8s  %5s  %6s  %6s  %8s\n", HAL_NAME_LEN,
+	"Component", "Malloc", "Pins", "Params", "Functs", "Total");
+    rtapi_mutex_get(&(hal_data->mutex));
+    next = hal_data->comp_list_ptr;
+    while (next != 0) {
+	comp = SHMPTR(next);
+	next = comp->next_ptr;
+	pins = params = functs = 0;
+	for (pin = halpr_find_pin_by_owner(comp, 0); pin != 0;
+	    pin = halpr_find_pin_by_owner(comp, pin)) {
+	    pins++;
+	}
+	for (param = halpr_find_param_by_owner(comp, 0); param != 0;
+	    param = halpr_find_param_by_owner(comp, param)) {
+	    params++;
+	}
+	for (funct = halpr_find_funct_by_owner(comp, 0); funct != 0;
+	    funct = halpr_find_funct_by_owner(comp, funct)) {
+	    functs++;
+	}
+	structs = sizeof(hal_comp_t) + pins * sizeof(hal_pin_t) +
+	    params * sizeof(hal_param_t) + functs * sizeof(hal_funct_t);
+	halcmd_output("  %-*s  %8ld  %5d  %6d  %6d  %8ld\n", HAL_NAME_LEN,
+	    comp->name, (long)comp->mem_bytes, pins, params, functs,
+	    (long)comp->mem_bytes + structs);
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+}
+
 static void print_mem_status()
 {
     int active, recycled, next;
@@ -2048,7 +2506,8 @@ static void print_mem_status()
     hal_param_t *param;
 
     halcmd_output("HAL memory status\n");
-    halcmd_output("  used/total shared memory:   %ld/%d\n", (long)(HAL_SIZE - hal_data->shmem_avail), HAL_SIZE);
+    halcmd_output("  used/total shared memory:   %ld/%d\n", (long)(hal_data->shmem_size - hal_data->shmem_avail), hal_data->shmem_size);
+    halcmd_output("  free pooled hal_malloc:     %ld\n", (long)hal_data->pool_free);
     // count components
     active = count_list(hal_data->comp_list_ptr);
     recycled = count_list(hal_data->comp_free_ptr);
@@ -2091,6 +2550,7 @@ static void print_mem_status()
     active = count_list(hal_data->thread_list_ptr);
     recycled = count_list(hal_data->thread_free_ptr);
     halcmd_output("  active/recycled threads:    %d/%d\n", active, recycled);
+    print_comp_mem();
 }
 
 /* Switch function for pin/sig/param type for the print_*_list functions */
@@ -2595,6 +3055,9 @@ static void save_threads(FILE *dst)
 	    fprintf(dst, "addf %s %s\n", funct->name, tptr->name);
 	    list_entry = list_next(list_entry);
 	}
+	if (tptr->parallel) {
+	    fprintf(dst, "parallel %s on\n", tptr->name);
+	}
 	next_thread = tptr->next_ptr;
     }
     rtapi_mutex_give(&(hal_data->mutex));
@@ -2642,6 +3105,14 @@ int do_help_cmd(char *command)
     } else if (strcmp(command, "waitusr") == 0) {
 	printf("waitusr compname\n");
 	printf("  Waits for user space HAL module 'compname' to exit.\n");
+    } else if (strcmp(command, "log") == 0) {
+	printf("log [follow|syslog]\n");
+	printf("  Prints the messages that realtime code has put in the\n");
+	printf("  RTAPI message ring with rtapi_log(), oldest first, and\n");
+	printf("  takes them out of the ring.  With 'follow', keeps waiting\n");
+	printf("  for new messages until interrupted.  With 'syslog', passes\n");
+	printf("  them on to syslog until interrupted, except while another\n");
+	printf("  'halcmd log' reads them.\n");
     } else if (strcmp(command, "unloadusr") == 0) {
 	printf("unloadusr compname\n");
 	printf("  Unloads user space HAL module 'compname'.  If 'compname'\n");
@@ -2747,6 +3218,17 @@ int do_help_cmd(char *command)
 	printf("  'all' with no pattern.  If 'pattern' is specified\n");
 	printf("  it prints only those items whose names match the\n");
 	printf("  pattern, which may be a 'shell glob'.\n");
+	printf("  'show mem' prints shared memory use by component.\n");
+	printf("  'show funct-stats' prints run time statistics of\n");
+	printf("  functions and threads: count, min, mean, standard\n");
+	printf("  deviation, percentiles (see 'histogram') and max.\n");
+	printf("  'show graph [thread]' prints the data flow between the\n");
+	printf("  functions of a thread: which ones could run at the same\n");
+	printf("  time, and the critical path using the mean run times.\n");
+    } else if (strcmp(command, "reset") == 0) {
+	printf("reset funct-stats [pattern]\n");
+	printf("  Clears the run time statistics of the functions and\n");
+	printf("  threads that match 'pattern', or of all of them.\n");
     } else if (strcmp(command, "list") == 0) {
 	printf("list type [pattern]\n");
 	printf("  Prints the names of HAL items of the specified type.\n");
@@ -2774,12 +3256,40 @@ int do_help_cmd(char *command)
 	printf("  or 'thread'.  ('linka' and 'neta' show arrows for pin\n");
 	printf("  direction.)  If 'type' is omitted or 'all', does the\n");
 	printf("  equivalent of 'comp', 'netl', 'param', and 'thread'.\n");
+    } else if (strcmp(command, "batch") == 0) {
+	printf("batch filename\n");
+	printf("  Executes the commands in 'filename' in batch mode, like\n");
+	printf("  \"halcmd -b -f filename\".  The file is read first, the\n");
+	printf("  modules of each block of loadrt, net, setp, sets, addf\n");
+	printf("  and newsig commands are loaded in parallel, and the rest\n");
+	printf("  of the block is applied only if all of it checks out.\n");
+	printf("  Prints the time spent in each phase.\n");
     } else if (strcmp(command, "start") == 0) {
 	printf("start\n");
 	printf("  Starts all realtime threads.\n");
     } else if (strcmp(command, "stop") == 0) {
 	printf("stop\n");
 	printf("  Stops all realtime threads.\n");
+    } else if (strcmp(command, "pack") == 0) {
+	printf("pack\n");
+	printf("  Moves the values of the signals used by realtime threads\n");
+	printf("  into one block, in the order the functions run, so each\n");
+	printf("  period touches fewer cache lines.  Use it after the last\n");
+	printf("  'net' and 'addf', while the threads are stopped.\n");
+    } else if (strcmp(command, "parallel") == 0) {
+	printf("parallel threadname on|off\n");
+	printf("  Runs the functions of 'threadname' that share no written\n");
+	printf("  signal at the same time, on the thread's task and its\n");
+	printf("  workers on other CPUs, or back one after the other.  The\n");
+	printf("  workers are made with the thread, one on each CPU in the\n");
+	printf("  worker_cpus parameter of hal_lib ([HAL]WORKER_CPUS).\n");
+	printf("  See 'show graph' for the lanes the functions run in.\n");
+    } else if (strcmp(command, "histogram") == 0) {
+	printf("histogram on|off [pattern]\n");
+	printf("  Keeps a histogram of the run times of the functions and\n");
+	printf("  threads that match 'pattern', or of all of them, for the\n");
+	printf("  percentiles of 'show funct-stats'.  Each takes about half\n");
+	printf("  a kilobyte of HAL memory, 'off' gives it back.\n");
     } else if (strcmp(command, "quit") == 0) {
 	printf("quit\n");
 	printf("  Stop processing input and terminate halcmd (when\n");
@@ -2815,6 +3325,7 @@ static void print_help_commands(void)
     printf("  loadrt              Load realtime module(s)\n");
     printf("  loadusr             Start user space program\n");
     printf("  waitusr             Waits for userspace component to exit\n");
+    printf("  log                 Print messages from realtime code\n");
     printf("  unload              Unload realtime module or terminate userspace component\n");
     printf("  lock, unlock        Lock/unlock HAL behaviour\n");
     printf("  linkps              Link pin to signal\n");
@@ -2828,10 +3339,14 @@ static void print_help_commands(void)
     printf("  addf, delf          Add/remove function to/from a thread\n");
     printf("  show                Display info about HAL objects\n");
     printf("  list                Display names of HAL objects\n");
+    printf("  reset               Clear function run time statistics\n");
     printf("  source              Execute commands from another .hal file\n");
+    printf("  batch               Execute a .hal file in batch mode\n");
     printf("  status              Display status information\n");
     printf("  save                Print config as commands\n");
     printf("  start, stop         Start/stop realtime threads\n");
+    printf("  pack                Pack signal values used by threads\n");
+    printf("  parallel            Run a thread's functions in parallel\n");
     printf("  alias, unalias      Add or remove pin or parameter name aliases\n");
     printf("  quit, exit          Exit from halcmd\n");
 }
@@ -50,6 +50,9 @@ extern int do_linkps_cmd(char *pin, char *signal);
 extern int do_linksp_cmd(char *signal, char *pin);
 extern int do_start_cmd();
 extern int do_stop_cmd();
+extern int do_pack_cmd();
+extern int do_parallel_cmd(char *thread, char *onoff);
+extern int do_histogram_cmd(char *onoff, char **patterns);
 extern int do_help_cmd(char *command);
 extern int do_lock_cmd(char *command);
 extern int do_unlock_cmd(char *command);
@@ -67,7 +70,9 @@ extern int do_ptype_cmd(char *name);
 extern int do_stype_cmd(char *name);
 extern int do_show_cmd(char *type, char **patterns);
 extern int do_list_cmd(char *type, char **patterns);
+extern int do_reset_cmd(char *type, char **patterns);
 extern int do_source_cmd(char *type);
+extern int do_batch_cmd(char *filename);
 extern int do_status_cmd(char *type);
 extern int do_delsig_cmd(char *mod_name);
 extern int do_loadrt_cmd(char *mod_name, char *args[]);
@@ -77,11 +82,19 @@ extern int do_unloadrt_cmd(char *mod_name);
 extern int do_unloadusr_cmd(char *mod_name);
 extern int do_loadusr_cmd(char *args[]);
 extern int do_waitusr_cmd(char *comp_name);
+extern int do_log_cmd(char *mode);
 extern int do_save_cmd(char *type, char *filename);
 extern int do_setexact_cmd(void);
 
 pid_t hal_systemv_nowait(char *const argv[]);
 int hal_systemv(char *const argv[]);
 
+/* pieces of 'loadrt' that batch mode runs for several modules at once */
+int loadrt_module_path(char *mod_path, size_t size, char *mod_name);
+int loadrt_finish(char *mod_name, char *args[]);
+int halcmd_check_value(hal_type_t type, char *value);
+int halcmd_set_value(hal_type_t type, void *d_ptr, char *value);
+int halcmd_batch(FILE *srcfile, int keep_going);
+
 extern int scriptmode, comp_id;
 #endif
@@ -49,9 +49,9 @@ static const char *command_table[] = {
     "loadrt", "loadusr", "unload", "lock", "unlock",
     "linkps", "linksp", "linkpp", "unlinkp",
     "net", "newsig", "delsig", "getp", "gets", "setp", "sets", "ptype", "stype",
-    "addf", "delf", "show", "list", "status", "save", "source",
-    "start", "stop", "quit", "exit", "help", "alias", "unalias", 
-    NULL,
+    "addf", "delf", "show", "list", "status", "save", "source", "batch", "reset",
+    "start", "stop", "pack", "quit", "exit", "help", "alias", "unalias", 
+    "log", "parallel", "histogram", NULL,
 };
 
 static const char *nonRT_command_table[] = {
@@ -65,7 +65,13 @@ static const char *alias_table[] = {
 };
 
 static const char *show_table[] = {
-    "all", "alias", "comp", "pin", "sig", "param", "funct", "thread",
+    "all", "alias", "comp", "pin", "sig", "param", "funct", "thread", "mem",
+    "funct-stats", "graph",
+    NULL,
+};
+
+static const char *reset_table[] = {
+    "funct-stats",
     NULL,
 };
 
@@ -91,6 +97,9 @@ static const char *pintype_table[] = {
 
 static const char *lock_table[] = { "none", "tune", "all", NULL };
 static const char *unlock_table[] = { "tune", "all", NULL };
+static const char *log_table[] = { "follow", "syslog", NULL };
+static const char *parallel_table[] = { "on", "off", NULL };
+static const char *histogram_table[] = { "on", "off", NULL };
 
 static const char **string_table = NULL;
 
@@ -687,6 +696,8 @@ char **halcmd_completer(const char *text, int start, int end, hal_completer_func
                 result = func(text, thread_generator);
             }
         }
+    } else if(startswith(buffer, "reset ") && argno == 1) {
+        result = completion_matches_table(text, reset_table, func);
     } else if(startswith(buffer, "save ") && argno == 1) {
         result = completion_matches_table(text, save_table, func);
     } else if(startswith(buffer, "status ") && argno == 1) {
@@ -705,17 +716,26 @@ char **halcmd_completer(const char *text, int start, int end, hal_completer_func
         result = func(text, attached_funct_generator);
     } else if(startswith(buffer, "delf ") && argno == 2) {
         result = func(text, thread_generator);
+    } else if(startswith(buffer, "parallel ") && argno == 1) {
+        result = func(text, thread_generator);
+    } else if(startswith(buffer, "parallel ") && argno == 2) {
+        result = completion_matches_table(text, parallel_table, func);
+    } else if(startswith(buffer, "histogram ") && argno == 1) {
+        result = completion_matches_table(text, histogram_table, func);
     } else if(startswith(buffer, "help ") && argno == 1) {
         result = completion_matches_table(text, command_table, func);
     } else if(startswith(buffer, "unloadusr ") && argno == 1) {
         result = func(text, usrcomp_generator);
+    } else if(startswith(buffer, "log ") && argno == 1) {
+        result = completion_matches_table(text, log_table, func);
     } else if(startswith(buffer, "waitusr ") && argno == 1) {
         result = func(text, usrcomp_generator);
     } else if(startswith(buffer, "unloadrt ") && argno == 1) {
         result = func(text, rtcomp_generator);
     } else if(startswith(buffer, "unload ") && argno == 1) {
         result = func(text, comp_generator);
-    } else if(startswith(buffer, "source ") && argno == 1) {
+    } else if((startswith(buffer, "source ") || startswith(buffer, "batch "))
+              && argno == 1) {
         rtapi_mutex_give(&(hal_data->mutex));
         // leaves rl_attempted_completion_over = 0 to complete from filesystem
         return 0;
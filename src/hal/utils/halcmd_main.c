@@ -74,6 +74,7 @@ int main(int argc, char **argv)
     int c, fd;
     int keep_going, retval, errorcount;
     int filemode = 0;
+    int batchmode = 0;
     char *filename = NULL;
     FILE *srcfile = NULL;
     char raw_buf[MAX_CMD_LEN+1];
@@ -91,7 +92,7 @@ int main(int argc, char **argv)
     keep_going = 0;
     /* start parsing the command line, options first */
     while(1) {
-        c = getopt(argc, argv, "+RCfi:kqQsvVh");
+        c = getopt(argc, argv, "+RCbfi:kqQsvVh");
         if(c == -1) break;
         switch(c) {
             case 'R':
@@ -138,6 +139,10 @@ int main(int argc, char **argv)
 	    case 'f':
                 filemode = 1;
 		break;
+	    case 'b':
+		/* -b = batch mode, for -f */
+		batchmode = 1;
+		break;
 	    case 'C':
                 cl = getenv("COMP_LINE");
                 cw = getenv("COMP_POINT");
@@ -228,6 +233,10 @@ int main(int argc, char **argv)
             errorcount++;
         }
 #endif
+        if(batchmode) {
+            fprintf(stderr, "-b may only be used together with -f\n");
+            errorcount++;
+        }
         if(errorcount == 0 && argc > optind) {
             halcmd_set_filename("<commandline>");
             halcmd_set_linenumber(0);
@@ -236,6 +245,9 @@ int main(int argc, char **argv)
                 errorcount++;
             }
         }
+    } else if (batchmode) {
+	/* read the whole file, then run it */
+	errorcount = halcmd_batch(srcfile, keep_going);
     } else {
 	/* read command line(s) from 'srcfile' */
 	while (get_input(srcfile, raw_buf, MAX_CMD_LEN)) {
@@ -294,7 +306,7 @@ static int release_HAL_mutex(void)
         return -EINVAL;
     }
     /* get HAL shared memory block from RTAPI */
-    mem_id = rtapi_shmem_new(HAL_KEY, comp_id, HAL_SIZE);
+    mem_id = rtapi_shmem_new(HAL_KEY, comp_id, sizeof(hal_data_t));
     if (mem_id < 0) {
         rtapi_print_msg(RTAPI_MSG_ERR,
             "ERROR: could not open shared memory\n");
@@ -349,6 +361,9 @@ static void print_help_general(int showR)
     printf("options:\n\n");
     printf("  -f [filename]  Read commands from 'filename', not command\n");
     printf("                 line.  If no filename, read from stdin.\n");
+    printf("  -b             Batch mode for -f: read the whole file, load\n");
+    printf("                 modules in parallel, check each block of net,\n");
+    printf("                 setp and addf commands before applying it.\n");
 #ifndef NO_INI
     printf("  -i filename    Open .ini file 'filename', allow commands\n");
     printf("                 to get their values from ini file.\n");
@@ -367,7 +382,8 @@ static void print_help_general(int showR)
     printf("commands:\n\n");
     printf("  loadrt, loadusr, waitusr, unload, lock, unlock, net, linkps, linksp,\n");
     printf("  unlinkp, newsig, delsig, setp, getp, ptype, sets, gets, stype,\n");
-    printf("  addf, delf, show, list, save, status, start, stop, source, quit, exit\n");
+    printf("  addf, delf, show, list, save, status, start, stop, source, batch,\n");
+    printf("  quit, exit\n");
     printf("  help           Lists all commands with short descriptions\n");
     printf("  help command   Prints detailed help for 'command'\n\n");
 }
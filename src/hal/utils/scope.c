@@ -88,6 +88,7 @@ static void main_window_closed(GtkWidget * widget, gpointer * gdata);
 static void set_focus(GtkWindow * window, GtkWidget *widget, gpointer * gdata);
 static void quit(int sig);
 static int heartbeat(gpointer data);
+static void find_channel_data(void);
 static void rm_normal_button_clicked(GtkWidget * widget, gpointer * gdata);
 static void rm_single_button_clicked(GtkWidget * widget, gpointer * gdata);
 static void rm_roll_button_clicked(GtkWidget * widget, gpointer * gdata);
@@ -232,6 +233,10 @@ static int heartbeat(gpointer data)
     } else {
 	handle_watchdog_timeout();
     }
+    /* signals were packed while sampling, follow them */
+    if (ctrl_shm->state != IDLE && ctrl_shm->pack_seq != hal_data->pack_seq) {
+	find_channel_data();
+    }
     if (ctrl_usr->pending_restart && ctrl_shm->state == IDLE) {
         ctrl_usr->pending_restart = 0;
         ctrl_usr->run_mode = ctrl_usr->old_run_mode;
@@ -254,18 +259,21 @@ static int heartbeat(gpointer data)
     return 1;
 }
 
-void start_capture(void)
+/* points the realtime part at the data of the channels, stamped with
+   the hal_pack_signals() generation it is good for; during a capture
+   only the places change */
+static void find_channel_data(void)
 {
     int n;
+    unsigned int seq;
     scope_chan_t *chan;
     hal_pin_t *pin;
     hal_sig_t *sig;
     hal_param_t *param;
 
-    if (ctrl_shm->state != IDLE) {
-	/* already running! */
-	return;
-    }
+    /* if signals move while this runs, the next heartbeat sees it */
+    seq = hal_data->pack_seq;
+    hal_barrier();
     for (n = 0; n < 16; n++) {
 	/* point to user space channel data */
 	chan = &(ctrl_usr->chan[n]);
@@ -315,6 +323,10 @@ void start_capture(void)
 	    /* channel source is invalid */
 	    chan->data_len = 0;
 	}
+	if (ctrl_shm->state != IDLE) {
+	    /* a capture under way keeps its channels */
+	    continue;
+	}
 	/* set data type */
 	ctrl_shm->data_type[n] = chan->data_type;
 	/* set data length - zero means don't sample */
@@ -324,7 +336,21 @@ void start_capture(void)
 	    ctrl_shm->data_len[n] = 0;
 	}
     }
+    /* the offsets are out before realtime takes them */
+    hal_barrier();
+    ctrl_shm->pack_seq = seq;
+}
+
+void start_capture(void)
+{
+    if (ctrl_shm->state != IDLE) {
+	/* already running! */
+	return;
+    }
+    find_channel_data();
     ctrl_shm->pre_trig = (ctrl_shm->rec_len-2) * ctrl_usr->trig.position;
+    prepare_trigger_quals();
+    ctrl_shm->stream = 0;
     ctrl_shm->state = INIT;
 }
 
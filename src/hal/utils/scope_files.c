@@ -78,6 +78,8 @@
    TPOS <float>		0.0-1.0, trigger position setting
    TPOLAR <enum>	triger polarity, RISE or FALL
    TMODE <int>		0 = normal trigger, 1 = auto trigger
+   TQUAL <string>	trigger qualifier, <chan>'>'<level> or <chan>'<'<level>,
+			or 'off' to clear them all
    RMODE <int>		0 = stop, 1 = norm, 2 = single, 3 = roll
   
 */
@@ -136,6 +138,7 @@ static char *tlevel_cmd(void * arg);
 static char *tpos_cmd(void * arg);
 static char *tpolar_cmd(void * arg);
 static char *tmode_cmd(void * arg);
+static char *tqual_cmd(void * arg);
 static char *rmode_cmd(void * arg);
 
 /***********************************************************************
@@ -163,6 +166,7 @@ static const cmd_lut_entry_t cmd_lut[25] =
   { "tpos",	FLOAT,	tpos_cmd },
   { "tpolar",	INT,	tpolar_cmd },
   { "tmode",	INT,	tmode_cmd },
+  { "tqual",	STRING,	tqual_cmd },
   { "rmode",	INT,	rmode_cmd },
   { "", 0, dummy_cmd }
 };
@@ -673,6 +677,17 @@ static char *tmode_cmd(void * arg)
     return NULL;
 }    
 
+static char *tqual_cmd(void * arg)
+{
+    int rv;
+
+    rv = set_trigger_qual((char *)(arg));
+    if ( rv < 0 ) {
+	return "could not set trigger qualifier";
+    }
+    return NULL;
+}
+
 static char *rmode_cmd(void * arg)
 {
     int *argp;
@@ -47,6 +47,9 @@ MODULE_LICENSE("GPL");
 long num_samples = 16000;
 long shm_size;
 RTAPI_MP_LONG(num_samples, "Number of samples in the shared memory block")
+long stream_samples = 0;
+long stream_shm_size;
+RTAPI_MP_LONG(stream_samples, "Number of samples in the stream ring, 0 for none")
 
 /***********************************************************************
 *                         GLOBAL VARIABLES                             *
@@ -61,6 +64,7 @@ scope_shm_control_t *ctrl_shm;	/* ptr to shared mem control struct */
 
 static int comp_id;		/* component ID */
 static int shm_id;		/* shared memory ID */
+static int stream_shm_id = -1;	/* stream ring shared memory ID */
 static scope_rt_control_t ctrl_struct;	/* realtime control structure */
 
 /***********************************************************************
@@ -69,9 +73,16 @@ static scope_rt_control_t ctrl_struct;	/* realtime control structure */
 
 static void init_rt_control_struct(void *shmem);
 static void init_shm_control_struct(void);
+static void init_stream_struct(void *shmem);
 
 static void sample(void *arg, long period);
+static void read_sample(scope_data_t * dest);
 static void capture_sample(void);
+static int start_stream(void);
+static void stream_sample(void);
+static int compare_values(hal_type_t type, scope_data_t * a,
+    scope_data_t * b);
+static int trig_quals_set(void);
 static int check_trigger(void);
 
 /***********************************************************************
@@ -112,6 +123,31 @@ int rtapi_app_main(void)
     ctrl_rt = &ctrl_struct;
     init_rt_control_struct(shm_base);
 
+    /* the stream ring is optional, and can be much larger */
+    if (stream_samples > 0) {
+	skip = (sizeof(scope_stream_t) + 7) & ~7;
+	stream_shm_size = skip + stream_samples * sizeof(scope_data_t);
+	stream_shm_id = rtapi_shmem_new(SCOPE_STREAM_SHM_KEY, comp_id,
+	    stream_shm_size);
+	if (stream_shm_id < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SCOPE: ERROR: failed to get stream shared memory\n");
+	    rtapi_shmem_delete(shm_id, comp_id);
+	    hal_exit(comp_id);
+	    return -1;
+	}
+	retval = rtapi_shmem_getptr(stream_shm_id, &shm_base);
+	if (retval < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SCOPE: ERROR: failed to map stream shared memory\n");
+	    rtapi_shmem_delete(stream_shm_id, comp_id);
+	    rtapi_shmem_delete(shm_id, comp_id);
+	    hal_exit(comp_id);
+	    return -1;
+	}
+	init_stream_struct(shm_base);
+    }
+
     /* export scope data sampling function */
     retval = hal_export_funct("scope.sample", sample, NULL, 0, 0, comp_id);
     if (retval != 0) {
@@ -132,6 +168,9 @@ void rtapi_app_exit(void)
 	/* need to unlink it before we release the scope shared memory */
 	hal_del_funct_from_thread("scope.sample", ctrl_shm->thread_name);
     }
+    if (stream_shm_id >= 0) {
+	rtapi_shmem_delete(stream_shm_id, comp_id);
+    }
     rtapi_shmem_delete(shm_id, comp_id);
     hal_exit(comp_id);
 }
@@ -161,6 +200,17 @@ static void sample(void *arg, long period)
     }
     /* reset counter */
     ctrl_rt->mult_cntr = 0;
+    /* hal_pack_signals() moved the signal values: sample nothing until
+       the user side has found them again, then use the new places */
+    if (ctrl_shm->pack_seq != hal_data->pack_seq) {
+	return;
+    }
+    if (ctrl_rt->pack_seq != ctrl_shm->pack_seq) {
+	for (n = 0; n < 16; n++) {
+	    ctrl_rt->data_addr[n] = SHMPTR(ctrl_shm->data_offset[n]);
+	}
+	ctrl_rt->pack_seq = ctrl_shm->pack_seq;
+    }
     /* run the sampling state machine */
     switch (ctrl_shm->state) {
     case IDLE:
@@ -179,6 +229,23 @@ static void sample(void *arg, long period)
 	    ctrl_rt->data_type[n] = ctrl_shm->data_type[n];
 	    ctrl_rt->data_len[n] = ctrl_shm->data_len[n];
 	}
+	ctrl_rt->pack_seq = ctrl_shm->pack_seq;
+	if (ctrl_shm->stream) {
+	    if (start_stream() != 0) {
+		/* no stream ring, or nothing to stream */
+		ctrl_shm->state = IDLE;
+		break;
+	    }
+	    /* wait for a trigger only if one is set up */
+	    if (ctrl_shm->trig_chan != 0 || trig_quals_set()) {
+		ctrl_shm->state = STREAM_TRIG;
+		/* dummy call to preset 'prev_cond' */
+		check_trigger();
+	    } else {
+		ctrl_shm->state = STREAM;
+	    }
+	    break;
+	}
 	/* set next state */
 	ctrl_shm->state = PRE_TRIG;
 	break;
@@ -229,6 +296,17 @@ static void sample(void *arg, long period)
     case DONE:
 	/* do nothing while GUI displays waveform */
 	break;
+    case STREAM_TRIG:
+	/* stream from the trigger on, no pre-trigger data */
+	if (check_trigger()) {
+	    ctrl_shm->state = STREAM;
+	    stream_sample();
+	}
+	break;
+    case STREAM:
+	/* runs until the user resets it */
+	stream_sample();
+	break;
     default:
 	/* shouldn't get here - if we do, set a legal state */
 	ctrl_shm->state = IDLE;
@@ -237,12 +315,10 @@ static void sample(void *arg, long period)
     /* done */
 }
 
-static void capture_sample(void)
+static void read_sample(scope_data_t * dest)
 {
-    scope_data_t *dest;
     int n;
 
-    dest = &(ctrl_rt->buffer[ctrl_shm->curr]);
     /* loop through all channels to acquire data */
     for (n = 0; n < 16; n++) {
 	/* capture 1, 2, or 4 bytes, based on data size */
@@ -270,6 +346,11 @@ static void capture_sample(void)
 	    break;
 	}
     }
+}
+
+static void capture_sample(void)
+{
+    read_sample(&(ctrl_rt->buffer[ctrl_shm->curr]));
     /* increment sample pointer */
     ctrl_shm->curr += ctrl_shm->sample_len;
     /* is there room in the buffer for another sample? */
@@ -279,13 +360,138 @@ static void capture_sample(void)
     }
 }
 
-// TODO: type-independent way to get high bit
-// #define SIGN_BIT (~(((ireal_t)~(ireal_t)0)>>1))
+static int start_stream(void)
+{
+    scope_stream_t *stream;
+    int n, chans;
+
+    stream = ctrl_rt->stream;
+    if (stream == 0) {
+	return -1;
+    }
+    /* records hold the acquired channels only, in channel order */
+    chans = 0;
+    for (n = 0; n < 16; n++) {
+	if (ctrl_rt->data_len[n] != 0) {
+	    stream->type[chans++] = ctrl_rt->data_type[n];
+	}
+    }
+    if (chans == 0) {
+	return -1;
+    }
+    stream->chans = chans;
+    stream->decim = ctrl_shm->decim > 1 ? ctrl_shm->decim : 1;
+    stream->rec_len = stream->decim > 1 ? 2 * chans : chans;
+    stream->ring_len = (stream->buf_len / stream->rec_len) * stream->rec_len;
+    /* one record always stays empty, so full != empty */
+    if (stream->ring_len < 2 * stream->rec_len) {
+	return -1;
+    }
+    stream->in = 0;
+    stream->out = 0;
+    stream->records = 0;
+    stream->lost = 0;
+    ctrl_rt->decim_cntr = 0;
+    return 0;
+}
+
+static void stream_sample(void)
+{
+    scope_stream_t *stream;
+    scope_data_t value[16], *dest;
+    int n, next;
+
+    stream = ctrl_rt->stream;
+    read_sample(value);
+    /* track the envelope of the samples in this record */
+    for (n = 0; n < stream->chans; n++) {
+	if (ctrl_rt->decim_cntr == 0 ||
+	    compare_values(stream->type[n], &value[n],
+		&(ctrl_rt->env_min[n])) < 0) {
+	    ctrl_rt->env_min[n].d_ireal = value[n].d_ireal;
+	}
+	if (ctrl_rt->decim_cntr == 0 ||
+	    compare_values(stream->type[n], &value[n],
+		&(ctrl_rt->env_max[n])) > 0) {
+	    ctrl_rt->env_max[n].d_ireal = value[n].d_ireal;
+	}
+    }
+    if (++ctrl_rt->decim_cntr < stream->decim) {
+	return;
+    }
+    ctrl_rt->decim_cntr = 0;
+    /* room for the record? never wait for the reader */
+    next = stream->in + stream->rec_len;
+    if (next >= stream->ring_len) {
+	next = 0;
+    }
+    if (next == stream->out) {
+	stream->lost++;
+	return;
+    }
+    dest = &(ctrl_rt->stream_buf[stream->in]);
+    for (n = 0; n < stream->chans; n++) {
+	dest[n].d_ireal = ctrl_rt->env_min[n].d_ireal;
+	if (stream->decim > 1) {
+	    dest[stream->chans + n].d_ireal = ctrl_rt->env_max[n].d_ireal;
+	}
+    }
+    /* the record must be complete before the reader can see it */
+    hal_barrier();
+    stream->in = next;
+    stream->records++;
+}
+
+/* Returns >0, 0 or <0 as 'a' is above, equal to or below 'b'.
+   Floats are compared without the FPU, using a hack - see
+   http://en.wikipedia.org/wiki/IEEE_754 - the bits of a double,
+   with the sign bit flipped for positive numbers and all bits
+   flipped for negative ones, sort like the numbers do as unsigned
+   ints.  This _only_ works with IEEE-754 floating point numbers,
+   and NANs will not compare sensibly. */
+static int compare_values(hal_type_t type, scope_data_t * a,
+    scope_data_t * b)
+{
+    ireal_t tmp1, tmp2;
+
+    switch (type) {
+    case HAL_BIT:
+	return (a->d_u8 != 0) - (b->d_u8 != 0);
+    case HAL_FLOAT:
+	tmp1 = a->d_ireal;
+	tmp2 = b->d_ireal;
+	tmp1 = (tmp1 & 0x8000000000000000ull) ? ~tmp1 :
+	    tmp1 | 0x8000000000000000ull;
+	tmp2 = (tmp2 & 0x8000000000000000ull) ? ~tmp2 :
+	    tmp2 | 0x8000000000000000ull;
+	return (tmp1 > tmp2) - (tmp1 < tmp2);
+    case HAL_S32:
+	return (a->d_s32 > b->d_s32) - (a->d_s32 < b->d_s32);
+    case HAL_U32:
+	return (a->d_u32 > b->d_u32) - (a->d_u32 < b->d_u32);
+    default:
+	return 0;
+    }
+}
+
+static int trig_quals_set(void)
+{
+    int n;
+
+    for (n = 0; n < SCOPE_TRIG_QUALS; n++) {
+	if (ctrl_shm->trig_qual[n].chan != 0) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
 static int check_trigger(void)
 {
-    static int compare_result = 0;
-    int prev_compare_result;
-    scope_data_t *value, *level;
+    static int prev_cond = 0;
+    int cond, fire, n, cmp;
+    scope_trig_qual_t *qual;
+    scope_data_t *value;
 
     /* has user forced trigger? */
     if (ctrl_shm->force_trig != 0) {
@@ -301,80 +507,41 @@ static int check_trigger(void)
 	/* no auto, reset delay timer */
 	ctrl_rt->auto_timer = 0;
     }
-    /* if no trigger channel is selected we're done */
-    if (ctrl_shm->trig_chan == 0) {
+    /* if no trigger channel or qualifier is selected we're done */
+    if (ctrl_shm->trig_chan == 0 && !trig_quals_set()) {
 	return 0;
     }
-    /* point a scope_data_t union at the signal value */
-    value = ctrl_rt->data_addr[ctrl_shm->trig_chan - 1];
-    /* and at the trigger level */
-    level = &(ctrl_shm->trig_level);
-    /* save previous compare result */
-    prev_compare_result = compare_result;
-    /* compare actual value to trigger level */
-    switch (ctrl_rt->data_type[ctrl_shm->trig_chan - 1]) {
-    case HAL_BIT:
-	/* for bits, we don't even look at the trigger level */
-	compare_result = value->d_u8;
-	break;
-    case HAL_FLOAT:
-	{
-	ireal_t tmp1, tmp2;
-	/* don't want to use the FPU in this function, so we use */
-	/* a hack - see http://en.wikipedia.org/wiki/IEEE_754 */
-	/* this _only_ works with IEEE-754 floating point numbers */
-	/* and will probably fail for infinities, NANs, etc. */
-	/* OK, here we go! */
-	/* get the value as an integer */
-	tmp1 = value->d_ireal;
-	/* get the trigger as an integer */
-	tmp2 = level->d_ireal;
-	/* is the value negative? (highest bit) */
-	if (tmp1 & 0x8000000000000000ull) {
-	    /* yes, is the trigger level negative? */
-	    if (tmp2 & 0x8000000000000000ull) {
-		/* yes, make both positive */
-		tmp1 ^= 0x8000000000000000ull;
-		tmp2 ^= 0x8000000000000000ull;
-		/* and compare them as unsigned ints */
-		/* because of negation, we reverse the compare */
-		compare_result = (tmp1 < tmp2);
-	    } else {
-		/* trigger level positive, value negative */
-		compare_result = 0;
-	    }
+    /* the trigger fires when the condition goes from false to true */
+    cond = 1;
+    if (ctrl_shm->trig_chan != 0) {
+	n = ctrl_shm->trig_chan - 1;
+	/* point a scope_data_t union at the signal value */
+	value = ctrl_rt->data_addr[n];
+	if (ctrl_rt->data_type[n] == HAL_BIT) {
+	    /* for bits, we don't even look at the trigger level */
+	    cond = (value->d_u8 != 0);
 	} else {
-	    /* value is positive, is trigger level negative? */
-	    if (tmp2 & 0x8000000000000000ull) {
-		/* trigger level negative, value positive */
-		compare_result = 1;
-	    } else {
-		/* both are positive */
-		/* compare them as unsigned ints */
-		compare_result = (tmp1 > tmp2);
-	    }
+	    cond = compare_values(ctrl_rt->data_type[n], value,
+		&(ctrl_shm->trig_level)) > 0;
 	}
+	/* for a falling edge the condition is being below the level */
+	if (!ctrl_shm->trig_edge) {
+	    cond = !cond;
 	}
-	break;
-    case HAL_S32:
-	compare_result = (value->d_s32 > level->d_s32);
-	break;
-    case HAL_U32:
-	compare_result = (value->d_u32 > level->d_u32);
-	break;
-    default:
-	compare_result = 0;
-	break;
-    }
-    /* test for rising edge */
-    if (ctrl_shm->trig_edge && compare_result && !prev_compare_result) {
-	return 1;
     }
-    /* test for falling edge */
-    if (!ctrl_shm->trig_edge && !compare_result && prev_compare_result) {
-	return 1;
+    /* and every qualifier must hold at the same time */
+    for (n = 0; cond && n < SCOPE_TRIG_QUALS; n++) {
+	qual = &(ctrl_shm->trig_qual[n]);
+	if (qual->chan < 1 || qual->chan > 16) {
+	    continue;
+	}
+	cmp = compare_values(ctrl_rt->data_type[qual->chan - 1],
+	    ctrl_rt->data_addr[qual->chan - 1], &(qual->level));
+	cond = qual->above ? (cmp > 0) : (cmp < 0);
     }
-    return 0;
+    fire = cond && !prev_cond;
+    prev_cond = cond;
+    return fire;
 }
 
 /***********************************************************************
@@ -422,3 +589,21 @@ static void init_shm_control_struct(void)
     ctrl_shm->mult = 1;
     ctrl_shm->state = IDLE;
 }
+
+static void init_stream_struct(void *shmem)
+{
+    char *cp;
+    int skip, n;
+
+    /* first clear the header to all zeros */
+    cp = (char *) shmem;
+    for (n = 0; n < sizeof(scope_stream_t); n++) {
+	cp[n] = 0;
+    }
+    ctrl_rt->stream = shmem;
+    ctrl_rt->stream->shm_size = stream_shm_size;
+    /* the ring follows the header, aligned for the 8 byte values */
+    skip = (sizeof(scope_stream_t) + 7) & ~7;
+    ctrl_rt->stream_buf = (scope_data_t *) (((char *) (shmem)) + skip);
+    ctrl_rt->stream->buf_len = (stream_shm_size - skip) / sizeof(scope_data_t);
+}
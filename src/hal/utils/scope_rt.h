@@ -52,6 +52,12 @@ typedef struct {
     char data_len[16];		/* data size for each channel */
     void *data_addr[16];	/* pointers to data for each channel */
     hal_type_t data_type[16];	/* data type for each channel */
+    unsigned int pack_seq;	/* ctrl_shm->pack_seq of data_addr */
+    scope_stream_t *stream;	/* stream ring header, NULL if none */
+    scope_data_t *stream_buf;	/* ptr to stream ring (kernel mapping) */
+    int decim_cntr;		/* samples in the current stream record */
+    scope_data_t env_min[16];	/* minimum of each channel in the record */
+    scope_data_t env_max[16];	/* maximum of each channel in the record */
 } scope_rt_control_t;
 
 /***********************************************************************
@@ -42,7 +42,9 @@
 ************************************************************************/
 
 #define SCOPE_SHM_KEY  0x130CF406
+#define SCOPE_STREAM_SHM_KEY  0x130CF407
 #define SCOPE_NUM_SAMPLES_DEFAULT 16000
+#define SCOPE_TRIG_QUALS 4
 
 typedef enum {
     IDLE = 0,			/* waiting for run command */
@@ -51,7 +53,9 @@ typedef enum {
     TRIG_WAIT,			/* waiting for trigger */
     POST_TRIG,			/* acquiring post-trigger data */
     DONE,			/* data acquisition complete */
-    RESET			/* data acquisition interrupted */
+    RESET,			/* data acquisition interrupted */
+    STREAM_TRIG,		/* streaming, waiting for trigger */
+    STREAM			/* streaming to the stream ring */
 } scope_state_t;
 
 /* this struct holds a single value - one sample of one channel */
@@ -64,6 +68,15 @@ typedef union {
     ireal_t d_ireal;		/* intlike variable for float */
 } scope_data_t;
 
+/* a trigger qualifier: while any qualifier is set, the trigger only
+   fires when the edge condition and every qualifier are true together */
+
+typedef struct {
+    int chan;			/* U channel number, 0 if not used */
+    int above;			/* U 1 = value above level, 0 = below */
+    scope_data_t level;		/* U level to compare with */
+} scope_trig_qual_t;
+
 /** This struct holds control data needed by both realtime and GUI code.
     It lives in shared memory.  The codes for each field identify which
     module(s) set the field.  "I" set at init only, "R" set by realtime
@@ -89,8 +102,35 @@ typedef struct {
     int samples;		/* R number of valid samples */
     scope_state_t state;	/* RU current state */
     int data_offset[16];	/* U data addr in shmem for each channel */
+    unsigned int pack_seq;	/* U hal_data->pack_seq of data_offset */
     hal_type_t data_type[16];	/* U data type for each channel */
     char data_len[16];		/* U data size, 0 if not to be acquired */
+    scope_trig_qual_t trig_qual[SCOPE_TRIG_QUALS];	/* U trigger qualifiers */
+    int stream;			/* U non-zero to stream instead of record */
+    int decim;			/* U samples per stream record */
 } scope_shm_control_t;
 
+/** In streaming mode the samples go to a ring in a second shared
+    memory block, created only if scope_rt is loaded with
+    stream_samples set.  Each record holds one value per acquired
+    channel, or if 'decim' is more than one the minimum of each
+    channel over 'decim' samples followed by the maximum of each.
+    RT writes whole records at 'in' and drops them, counting 'lost',
+    if the reader has not freed the space yet.
+*/
+
+typedef struct {
+    unsigned long shm_size;	/* I actual size of SHM area */
+    int buf_len;		/* I length of buffer */
+    int rec_len;		/* R values in each record */
+    int ring_len;		/* R used part of buffer, whole records */
+    int decim;			/* R samples per record */
+    int chans;			/* R acquired channels */
+    hal_type_t type[16];	/* R type of each acquired channel */
+    volatile int in;		/* R where the next record goes */
+    volatile int out;		/* U next record to be read */
+    volatile unsigned long records;	/* R records written */
+    volatile unsigned long lost;	/* R records dropped, ring full */
+} scope_stream_t;
+
 #endif /* HALSC_SHM_H */
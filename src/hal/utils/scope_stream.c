@@ -0,0 +1,487 @@
+/** This file, 'scope_stream.c', is a command line reader for the
+    streaming mode of the HAL oscilloscope.  It sets up 'scope_rt' to
+    stream the named pins, signals or parameters into its stream ring,
+    and writes the records to stdout as text, one line per record,
+    until it is killed or has written the requested number of records.
+
+    Invoking:
+
+    halscope_stream [-t thread] [-m mult] [-d decim] [-n records]
+		    [-T trigger] [-q qualifier]... [-f file] name...
+
+    'thread' is the thread to sample in, needed if halscope has not
+    already picked one.  'mult' samples every N runs of the thread.
+    'decim' folds N samples into each record, which then holds the
+    minimum of each channel followed by the maximum of each.
+
+    A trigger or qualifier is <chan>'>'<level> or <chan>'<'<level>,
+    channels numbered from 1 in the order the names are given.  The
+    trigger waits for the first channel to cross the level upwards
+    ('>') or downwards ('<') while all the qualifiers hold, and the
+    stream starts there.  Without either, streaming starts at once.
+
+    'scope_rt' must be loaded with 'stream_samples' set, and halscope
+    must not be running a capture at the same time.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+
+    THE AUTHORS OF THIS LIBRARY ACCEPT ABSOLUTELY NO LIABILITY FOR
+    ANY HARM OR LOSS RESULTING FROM ITS USE.  IT IS _EXTREMELY_ UNWISE
+    TO RELY ON SOFTWARE ALONE FOR SAFETY.  Any machinery capable of
+    harming persons must have provisions for completely removing power
+    from all motors, etc, before persons enter any danger area.  All
+    machinery must be designed to comply with local and national safety
+    codes, and the authors of this software can not, and do not, take
+    any responsibility for such compliance.
+
+    This code was written as part of the EMC HAL project.  For more
+    information, go to www.linuxcnc.org.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "../hal_priv.h"	/* private HAL decls */
+#include "scope_shm.h"		/* scope shared declarations */
+
+/***********************************************************************
+*                         GLOBAL VARIABLES                             *
+************************************************************************/
+
+static int comp_id = -1;	/* -1 means hal_init() not called yet */
+static int shm_id = -1;
+static int stream_shm_id = -1;
+static scope_shm_control_t *ctrl_shm;
+static scope_stream_t *stream;
+static volatile int done;
+
+/***********************************************************************
+*                         LOCAL FUNCTIONS                              *
+************************************************************************/
+
+static void quit(int sig)
+{
+    done = 1;
+}
+
+static void sleep_ms(int ms)
+{
+    struct timespec delay;
+
+    delay.tv_sec = 0;
+    delay.tv_nsec = ms * 1000000;
+    nanosleep(&delay, NULL);
+}
+
+/* finds a pin, signal or parameter, sets up channel 'n' to sample it */
+static int set_channel(int n, const char *name)
+{
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    hal_param_t *param;
+    hal_type_t type;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    if ((pin = halpr_find_pin_by_name(name)) != 0) {
+	type = pin->type;
+	if (pin->signal == 0) {
+	    /* pin is unlinked, get data from dummysig */
+	    ctrl_shm->data_offset[n] = SHMOFF(&(pin->dummysig));
+	} else {
+	    sig = SHMPTR(pin->signal);
+	    ctrl_shm->data_offset[n] = sig->data_ptr;
+	}
+    } else if ((sig = halpr_find_sig_by_name(name)) != 0) {
+	type = sig->type;
+	ctrl_shm->data_offset[n] = sig->data_ptr;
+    } else if ((param = halpr_find_param_by_name(name)) != 0) {
+	type = param->type;
+	ctrl_shm->data_offset[n] = param->data_ptr;
+    } else {
+	rtapi_mutex_give(&(hal_data->mutex));
+	fprintf(stderr, "ERROR: no pin, signal or parameter '%s'\n", name);
+	return -1;
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    ctrl_shm->data_type[n] = type;
+    switch (type) {
+    case HAL_BIT:
+	ctrl_shm->data_len[n] = sizeof(hal_bit_t);
+	break;
+    case HAL_FLOAT:
+	ctrl_shm->data_len[n] = sizeof(hal_float_t);
+	break;
+    case HAL_S32:
+	ctrl_shm->data_len[n] = sizeof(hal_s32_t);
+	break;
+    case HAL_U32:
+	ctrl_shm->data_len[n] = sizeof(hal_u32_t);
+	break;
+    default:
+	fprintf(stderr, "ERROR: '%s' has an unknown type\n", name);
+	return -1;
+    }
+    return 0;
+}
+
+/* sets up the first 'chans' channels, stamped with the generation of
+   hal_pack_signals() their places are good for */
+static int find_channels(int chans, char **names)
+{
+    unsigned int seq;
+    int n;
+
+    /* if signals move while this runs, the next call sees it */
+    seq = hal_data->pack_seq;
+    hal_barrier();
+    for (n = 0; n < chans; n++) {
+	if (set_channel(n, names[n]) < 0) {
+	    return -1;
+	}
+    }
+    /* the offsets are out before realtime takes them */
+    hal_barrier();
+    ctrl_shm->pack_seq = seq;
+    return 0;
+}
+
+/* parses <chan>'>'<level> or <chan>'<'<level> */
+static int parse_cond(const char *spec, int chans, int *chan, int *above,
+    scope_data_t * level)
+{
+    char *cp, *cp2;
+    double value;
+
+    *chan = strtol(spec, &cp, 10);
+    if ((cp == spec) || (*chan < 1) || (*chan > chans)) {
+	return -1;
+    }
+    if (*cp == '>') {
+	*above = 1;
+    } else if (*cp == '<') {
+	*above = 0;
+    } else {
+	return -1;
+    }
+    cp++;
+    value = strtod(cp, &cp2);
+    if ((cp2 == cp) || (*cp2 != '\0')) {
+	return -1;
+    }
+    switch (ctrl_shm->data_type[*chan - 1]) {
+    case HAL_BIT:
+	level->d_u8 = (value > 0.0);
+	break;
+    case HAL_FLOAT:
+	level->d_real = value;
+	break;
+    case HAL_S32:
+	level->d_s32 = value;
+	break;
+    case HAL_U32:
+	level->d_u32 = value;
+	break;
+    default:
+	return -1;
+    }
+    return 0;
+}
+
+static void print_value(hal_type_t type, scope_data_t * value)
+{
+    switch (type) {
+    case HAL_BIT:
+	printf(value->d_u8 ? "1 " : "0 ");
+	break;
+    case HAL_FLOAT:
+	printf("%.9g ", value->d_real);
+	break;
+    case HAL_S32:
+	printf("%ld ", (long) value->d_s32);
+	break;
+    case HAL_U32:
+	printf("%lu ", (unsigned long) value->d_u32);
+	break;
+    default:
+	printf("? ");
+	break;
+    }
+}
+
+static void *map_shmem(int key, int *id, unsigned long size)
+{
+    void *ptr;
+
+    *id = rtapi_shmem_new(key, comp_id, size);
+    if (*id < 0) {
+	return NULL;
+    }
+    if (rtapi_shmem_getptr(*id, &ptr) < 0) {
+	return NULL;
+    }
+    return ptr;
+}
+
+/***********************************************************************
+*                            MAIN PROGRAM                              *
+************************************************************************/
+
+int main(int argc, char **argv)
+{
+    scope_shm_control_t saved;
+    scope_data_t *data, *rec;
+    char *thread, *trigger, *quals[SCOPE_TRIG_QUALS];
+    int c, n, chans, nquals, mult, decim, attached, detached, exitval;
+    long records;
+    unsigned long lost;
+
+    thread = NULL;
+    trigger = NULL;
+    nquals = 0;
+    mult = 1;
+    decim = 1;
+    records = -1;		/* -1 means run forever */
+    while ((c = getopt(argc, argv, "t:m:d:n:T:q:f:")) != -1) {
+	switch (c) {
+	case 't':
+	    thread = optarg;
+	    break;
+	case 'm':
+	    mult = atoi(optarg);
+	    break;
+	case 'd':
+	    decim = atoi(optarg);
+	    break;
+	case 'n':
+	    records = atol(optarg);
+	    break;
+	case 'T':
+	    trigger = optarg;
+	    break;
+	case 'q':
+	    if (nquals >= SCOPE_TRIG_QUALS) {
+		fprintf(stderr, "ERROR: at most %d qualifiers\n",
+		    SCOPE_TRIG_QUALS);
+		exit(1);
+	    }
+	    quals[nquals++] = optarg;
+	    break;
+	case 'f':
+	    /* make stdout be the named file */
+	    if (freopen(optarg, "w", stdout) == NULL) {
+		fprintf(stderr, "ERROR: can't create '%s'\n", optarg);
+		exit(1);
+	    }
+	    break;
+	default:
+	    fprintf(stderr, "Usage: halscope_stream [-t thread] [-m mult] "
+		"[-d decim] [-n records] [-T trigger] [-q qualifier]... "
+		"[-f file] name...\n");
+	    exit(1);
+	}
+    }
+    chans = argc - optind;
+    if ((chans < 1) || (chans > 16) || (mult < 1) || (decim < 1)) {
+	fprintf(stderr, "ERROR: need 1 to 16 names, mult and decim >= 1\n");
+	exit(1);
+    }
+    exitval = 1;
+    attached = 0;
+    detached = 0;
+    comp_id = hal_init("halscope_stream");
+    if (comp_id < 0) {
+	fprintf(stderr, "ERROR: hal_init() failed: %d\n", comp_id);
+	exit(1);
+    }
+    hal_ready(comp_id);
+    if (!halpr_find_funct_by_name("scope.sample")) {
+	fprintf(stderr, "ERROR: scope_rt is not loaded\n");
+	goto out;
+    }
+    ctrl_shm = map_shmem(SCOPE_SHM_KEY, &shm_id, sizeof(scope_shm_control_t));
+    /* size is unknown until mapped, the header has it */
+    stream = map_shmem(SCOPE_STREAM_SHM_KEY, &stream_shm_id,
+	sizeof(scope_stream_t));
+    if ((ctrl_shm == NULL) || (stream == NULL)) {
+	fprintf(stderr, "ERROR: couldn't map scope shared memory\n");
+	goto out;
+    }
+    if (stream->shm_size == 0) {
+	fprintf(stderr, "ERROR: scope_rt was loaded without stream_samples\n");
+	goto out;
+    }
+    n = stream->shm_size;
+    rtapi_shmem_delete(stream_shm_id, comp_id);
+    stream = map_shmem(SCOPE_STREAM_SHM_KEY, &stream_shm_id, n);
+    if (stream == NULL) {
+	fprintf(stderr, "ERROR: couldn't re-map stream shared memory\n");
+	goto out;
+    }
+    data = (scope_data_t *) (((char *) stream) +
+	((sizeof(scope_stream_t) + 7) & ~7));
+    if (ctrl_shm->state != IDLE) {
+	fprintf(stderr, "ERROR: the scope is busy, stop halscope first\n");
+	goto out;
+    }
+    /* halscope's settings are put back at exit */
+    saved = *ctrl_shm;
+    if (thread != NULL && strcmp(thread, ctrl_shm->thread_name) != 0) {
+	if (ctrl_shm->thread_name[0] != '\0') {
+	    hal_del_funct_from_thread("scope.sample", ctrl_shm->thread_name);
+	    ctrl_shm->thread_name[0] = '\0';
+	    detached = 1;
+	}
+	if (hal_add_funct_to_thread("scope.sample", thread, -1) < 0) {
+	    fprintf(stderr, "ERROR: couldn't sample in thread '%s'\n", thread);
+	    goto restore;
+	}
+	snprintf(ctrl_shm->thread_name, sizeof(ctrl_shm->thread_name),
+	    "%s", thread);
+	attached = 1;
+    }
+    if (ctrl_shm->thread_name[0] == '\0') {
+	fprintf(stderr, "ERROR: no sample thread, use -t\n");
+	goto restore;
+    }
+    for (n = 0; n < 16; n++) {
+	ctrl_shm->data_len[n] = 0;
+    }
+    if (find_channels(chans, argv + optind) < 0) {
+	goto restore;
+    }
+    ctrl_shm->trig_chan = 0;
+    ctrl_shm->auto_trig = 0;
+    if (trigger != NULL) {
+	if (parse_cond(trigger, chans, &(ctrl_shm->trig_chan),
+		&(ctrl_shm->trig_edge), &(ctrl_shm->trig_level)) < 0) {
+	    fprintf(stderr, "ERROR: bad trigger '%s'\n", trigger);
+	    goto restore;
+	}
+    }
+    for (n = 0; n < SCOPE_TRIG_QUALS; n++) {
+	ctrl_shm->trig_qual[n].chan = 0;
+	if (n < nquals && parse_cond(quals[n], chans,
+		&(ctrl_shm->trig_qual[n].chan), &(ctrl_shm->trig_qual[n].above),
+		&(ctrl_shm->trig_qual[n].level)) < 0) {
+	    fprintf(stderr, "ERROR: bad qualifier '%s'\n", quals[n]);
+	    goto restore;
+	}
+    }
+    ctrl_shm->mult = mult;
+    ctrl_shm->decim = decim;
+    ctrl_shm->stream = 1;
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+    signal(SIGPIPE, quit);
+    ctrl_shm->state = INIT;
+    /* wait for the realtime part to set up the ring */
+    for (n = 0; n < 100 && ctrl_shm->state == INIT; n++) {
+	sleep_ms(10);
+    }
+    if ((ctrl_shm->state != STREAM_TRIG) && (ctrl_shm->state != STREAM)) {
+	fprintf(stderr, "ERROR: streaming did not start, is the thread "
+	    "running and the ring big enough?\n");
+	goto stop;
+    }
+    lost = 0;
+    while (!done && records != 0) {
+	if (ctrl_shm->pack_seq != hal_data->pack_seq) {
+	    /* signals were packed, follow them */
+	    if (find_channels(chans, argv + optind) < 0) {
+		break;
+	    }
+	}
+	if (stream->out == stream->in) {
+	    /* ring empty, sleep for 10mS */
+	    fflush(stdout);
+	    sleep_ms(10);
+	    continue;
+	}
+	/* don't read the record before seeing 'in' pass it */
+	hal_barrier();
+	rec = &data[stream->out];
+	for (n = 0; n < stream->rec_len; n++) {
+	    print_value(stream->type[n % stream->chans], &rec[n]);
+	}
+	printf("\n");
+	hal_barrier();
+	n = stream->out + stream->rec_len;
+	if (n >= stream->ring_len) {
+	    n = 0;
+	}
+	stream->out = n;
+	if (stream->lost != lost) {
+	    fprintf(stderr, "overrun, %lu records lost\n", stream->lost - lost);
+	    lost = stream->lost;
+	}
+	if (records > 0) {
+	    records--;
+	}
+    }
+    fflush(stdout);
+    exitval = 0;
+
+stop:
+    ctrl_shm->state = RESET;
+    for (n = 0; n < 100 && ctrl_shm->state != IDLE; n++) {
+	sleep_ms(10);
+    }
+    /* if the thread isn't running nobody else will do it */
+    ctrl_shm->state = IDLE;
+restore:
+    if (attached) {
+	hal_del_funct_from_thread("scope.sample", ctrl_shm->thread_name);
+	ctrl_shm->thread_name[0] = '\0';
+    }
+    if (detached) {
+	/* back in halscope's thread, at the end as halscope puts it */
+	if (hal_add_funct_to_thread("scope.sample", saved.thread_name,
+		-1) < 0) {
+	    fprintf(stderr, "ERROR: couldn't sample in thread '%s' again\n",
+		saved.thread_name);
+	} else {
+	    memcpy(ctrl_shm->thread_name, saved.thread_name,
+		sizeof(saved.thread_name));
+	}
+    }
+    ctrl_shm->stream = 0;
+    /* halscope's channels, as they were when it looked them up */
+    memcpy(ctrl_shm->data_offset, saved.data_offset,
+	sizeof(saved.data_offset));
+    memcpy(ctrl_shm->data_type, saved.data_type, sizeof(saved.data_type));
+    memcpy(ctrl_shm->data_len, saved.data_len, sizeof(saved.data_len));
+    ctrl_shm->pack_seq = saved.pack_seq;
+    ctrl_shm->decim = saved.decim;
+    ctrl_shm->mult = saved.mult;
+    ctrl_shm->trig_chan = saved.trig_chan;
+    ctrl_shm->trig_level = saved.trig_level;
+    ctrl_shm->trig_edge = saved.trig_edge;
+    ctrl_shm->auto_trig = saved.auto_trig;
+    memcpy(ctrl_shm->trig_qual, saved.trig_qual, sizeof(saved.trig_qual));
+out:
+    if (stream_shm_id >= 0) {
+	rtapi_shmem_delete(stream_shm_id, comp_id);
+    }
+    if (shm_id >= 0) {
+	rtapi_shmem_delete(shm_id, comp_id);
+    }
+    hal_exit(comp_id);
+    return exitval;
+}
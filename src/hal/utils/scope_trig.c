@@ -70,6 +70,8 @@ static void init_trigger_info_window(void);
 static void trigger_selection_made(GtkWidget * clist, gint row, gint column,
     GdkEventButton * event, dialog_generic_t * dptr);
 static void dialog_select_trigger_source(void);
+static double set_level_value(scope_data_t * dest, hal_type_t type,
+    double level);
 
 /* callback functions */
 static void auto_button_clicked(GtkWidget * widget, gpointer * gdata);
@@ -103,8 +105,15 @@ void refresh_trigger(void)
     scope_chan_t *chan;
     gchar buf[BUFLEN + 1];
     double fp_level;
+    int n, quals;
 
     trig = &(ctrl_usr->trig);
+    quals = 0;
+    for (n = 0; n < SCOPE_TRIG_QUALS; n++) {
+	if (trig->qual_chan[n] != 0) {
+	    quals++;
+	}
+    }
     /* display edge */
     if (ctrl_shm->trig_edge == 0) {
 	snprintf(buf, BUFLEN, _("Falling"));
@@ -116,12 +125,20 @@ void refresh_trigger(void)
     if ((ctrl_shm->trig_chan < 1) || (ctrl_shm->trig_chan > 16)) {
 	/* no source */
 	ctrl_shm->trig_chan = 0;
-	gtk_label_set_text_if(trig->source_label, _("Source\nNone"));
+	if (quals > 0) {
+	    gtk_label_set_text_if(trig->source_label, _("Source\nQualifiers"));
+	} else {
+	    gtk_label_set_text_if(trig->source_label, _("Source\nNone"));
+	}
 	gtk_label_set_text_if(trig->level_label, "  ----  ");
 	/* nothing left to do */
 	return;
     }
-    snprintf(buf, BUFLEN, _("Source\nChan %2d"), ctrl_shm->trig_chan);
+    if (quals > 0) {
+	snprintf(buf, BUFLEN, _("Source\nChan %2d +Q"), ctrl_shm->trig_chan);
+    } else {
+	snprintf(buf, BUFLEN, _("Source\nChan %2d"), ctrl_shm->trig_chan);
+    }
     gtk_label_set_text_if(trig->source_label, buf);
     /* point to source channel data */
     chan = &(ctrl_usr->chan[ctrl_shm->trig_chan - 1]);
@@ -130,31 +147,8 @@ void refresh_trigger(void)
 	chan->scale * ((chan->position - trig->level) * 10) +
 	chan->vert_offset;
     /* apply type specific tweaks to trigger level */
-    switch (chan->data_type) {
-    case HAL_FLOAT:
-	ctrl_shm->trig_level.d_real = fp_level;
-	break;
-    case HAL_S32:
-	if (fp_level > 2147483647.0) {
-	    fp_level = 2147483647.0;
-	}
-	if (fp_level < -2147483648.0) {
-	    fp_level = -2147483648.0;
-	}
-	ctrl_shm->trig_level.d_s32 = fp_level;
-	break;
-    case HAL_U32:
-	if (fp_level > 4294967295.0) {
-	    fp_level = 4294967295.0;
-	}
-	if (fp_level < 0.0) {
-	    fp_level = 0.0;
-	}
-	ctrl_shm->trig_level.d_u32 = fp_level;
-	break;
-    default:
-	break;
-    }
+    fp_level = set_level_value(&(ctrl_shm->trig_level), chan->data_type,
+	fp_level);
     if (chan->data_type == HAL_BIT) {
 	snprintf(buf, BUFLEN, "  ----  ");
         gtk_widget_set_sensitive(GTK_WIDGET(trig->level_slider), 0);
@@ -169,6 +163,7 @@ void refresh_trigger(void)
 void write_trig_config(FILE *fp)
 {
     scope_trig_t *trig;
+    int n;
     
     trig = &(ctrl_usr->trig);
     if (ctrl_shm->trig_chan > 0) {
@@ -178,12 +173,135 @@ void write_trig_config(FILE *fp)
 	fprintf(fp, "TPOLAR %d\n", ctrl_shm->trig_edge);
     }
     fprintf(fp, "TMODE %d\n", ctrl_shm->auto_trig);
+    for (n = 0; n < SCOPE_TRIG_QUALS; n++) {
+	if (trig->qual_chan[n] != 0) {
+	    fprintf(fp, "TQUAL %d%c%.9g\n", trig->qual_chan[n],
+		trig->qual_above[n] ? '>' : '<', trig->qual_level[n]);
+	}
+    }
+}
+
+/* 'spec' is <chan>'>'<level> or <chan>'<'<level>, which replaces any
+   qualifier already on that channel, or 'off' to clear them all */
+int set_trigger_qual(char *spec)
+{
+    scope_trig_t *trig;
+    char *cp, *cp2;
+    int n, chan, above, slot;
+    double level;
+
+    trig = &(ctrl_usr->trig);
+    if (strcmp(spec, "off") == 0) {
+	for (n = 0; n < SCOPE_TRIG_QUALS; n++) {
+	    trig->qual_chan[n] = 0;
+	}
+	refresh_trigger();
+	return 0;
+    }
+    chan = strtol(spec, &cp, 10);
+    if ((cp == spec) || (chan < 1) || (chan > 16)) {
+	return -1;
+    }
+    if (*cp == '>') {
+	above = 1;
+    } else if (*cp == '<') {
+	above = 0;
+    } else {
+	return -1;
+    }
+    cp++;
+    level = strtod(cp, &cp2);
+    if ((cp2 == cp) || (*cp2 != '\0')) {
+	return -1;
+    }
+    slot = -1;
+    for (n = 0; n < SCOPE_TRIG_QUALS; n++) {
+	if (trig->qual_chan[n] == chan) {
+	    slot = n;
+	    break;
+	}
+	if ((trig->qual_chan[n] == 0) && (slot < 0)) {
+	    slot = n;
+	}
+    }
+    if (slot < 0) {
+	/* all in use */
+	return -1;
+    }
+    trig->qual_chan[slot] = chan;
+    trig->qual_above[slot] = above;
+    trig->qual_level[slot] = level;
+    refresh_trigger();
+    return 0;
+}
+
+/* copies the qualifiers to shared memory, in the types of their
+   channels, before a capture starts */
+void prepare_trigger_quals(void)
+{
+    scope_trig_t *trig;
+    scope_trig_qual_t *qual;
+    scope_chan_t *chan;
+    int n;
+
+    trig = &(ctrl_usr->trig);
+    for (n = 0; n < SCOPE_TRIG_QUALS; n++) {
+	qual = &(ctrl_shm->trig_qual[n]);
+	qual->chan = 0;
+	if (trig->qual_chan[n] == 0) {
+	    continue;
+	}
+	chan = &(ctrl_usr->chan[trig->qual_chan[n] - 1]);
+	if (chan->name == NULL) {
+	    /* channel has no source */
+	    continue;
+	}
+	qual->above = trig->qual_above[n];
+	set_level_value(&(qual->level), chan->data_type, trig->qual_level[n]);
+	qual->chan = trig->qual_chan[n];
+    }
 }
 
 /***********************************************************************
 *                       LOCAL FUNCTIONS                                *
 ************************************************************************/
 
+/* stores 'level' in 'dest' as a value of 'type', returns it clamped
+   to the range of the type */
+static double set_level_value(scope_data_t * dest, hal_type_t type,
+    double level)
+{
+    switch (type) {
+    case HAL_FLOAT:
+	dest->d_real = level;
+	break;
+    case HAL_S32:
+	if (level > 2147483647.0) {
+	    level = 2147483647.0;
+	}
+	if (level < -2147483648.0) {
+	    level = -2147483648.0;
+	}
+	dest->d_s32 = level;
+	break;
+    case HAL_U32:
+	if (level > 4294967295.0) {
+	    level = 4294967295.0;
+	}
+	if (level < 0.0) {
+	    level = 0.0;
+	}
+	dest->d_u32 = level;
+	break;
+    case HAL_BIT:
+	dest->d_u8 = (level > 0.0);
+	break;
+    default:
+	break;
+    }
+    return level;
+}
+
 static void init_trigger_mode_window(void)
 {
     scope_trig_t *trig;
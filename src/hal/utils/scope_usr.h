@@ -134,6 +134,9 @@ typedef struct {
     /* general data */
     double position;		/* horiz position of trigger (0.0-1.0) */
     double level;		/* setting of level slider (0.0-1.0) */
+    int qual_chan[SCOPE_TRIG_QUALS];	/* qualifier channels, 0 = unused */
+    int qual_above[SCOPE_TRIG_QUALS];	/* 1 = above level, 0 = below */
+    double qual_level[SCOPE_TRIG_QUALS];	/* qualifier levels */
     /* widgets for trigger mode window */
     GtkWidget *normal_button;
     GtkWidget *auto_button;
@@ -293,6 +296,8 @@ int set_trigger_level(double setting);
 int set_trigger_pos(double setting);
 int set_trigger_polarity(int setting);
 int set_trigger_mode(int mode);
+int set_trigger_qual(char *spec);
+void prepare_trigger_quals(void);
 int set_run_mode(int mode);
 void prepare_scope_restart(void);
 void log_popup(int);
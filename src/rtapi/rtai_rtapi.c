@@ -480,6 +480,23 @@ void rtapi_print_msg(int level, const char *fmt, ...)
     ///}
 }
 
+void rtapi_log_msg(rtapi_log_site_t *site, ...)
+{
+    va_list args;
+
+    /* filtered here, like the simulator does, the reader can't */
+    if ((site->level > msg_level) || (msg_level == RTAPI_MSG_NONE)) {
+	return;
+    }
+    va_start(args, site);
+    if (log_site_ready(&(rtapi_data->log_ring), site) == 0) {
+	log_put(&(rtapi_data->log_ring), site, rtapi_get_time(), args);
+    } else {
+	rtapi_msg_handler(site->level, site->fmt, args);
+    }
+    va_end(args);
+}
+
 int rtapi_set_msg_level(int level)
 {
     if ((level < RTAPI_MSG_NONE) || (level > RTAPI_MSG_ALL)) {
@@ -671,6 +688,14 @@ static int rtapi_trap_handler(int vec, int signo, struct pt_regs *regs,
 
 int rtapi_task_new(void (*taskcode) (void *), void *arg,
     int prio, int owner, unsigned long int stacksize, int uses_fp)
+{
+    return rtapi_task_new_cpu(taskcode, arg, prio, owner, stacksize,
+	uses_fp, -1);
+}
+
+int rtapi_task_new_cpu(void (*taskcode) (void *), void *arg,
+    int prio, int owner, unsigned long int stacksize, int uses_fp,
+    int cpu_id)
 {
     int n;
     long task_id;
@@ -706,6 +731,13 @@ int rtapi_task_new(void (*taskcode) (void *), void *arg,
 	rtapi_mutex_give(&(rtapi_data->mutex));
 	return -EINVAL;
     }
+    /* check requested CPU, default is the one reserved for RT */
+    if (cpu_id < 0) {
+	cpu_id = rtapi_data->rt_cpu;
+    } else if (cpu_id >= NR_CPUS || !cpu_online(cpu_id)) {
+	rtapi_mutex_give(&(rtapi_data->mutex));
+	return -EINVAL;
+    }
     /* get space for the OS's task data - this is around 900 bytes, */
     /* so we don't want to statically allocate it for unused tasks. */
     ostask_array[task_id] = kmalloc(sizeof(RT_TASK), GFP_USER);
@@ -715,9 +747,9 @@ int rtapi_task_new(void (*taskcode) (void *), void *arg,
     }
     task->taskcode = taskcode;
     task->arg = arg;
-    /* call OS to initialize the task - use predetermined CPU */
+    /* call OS to initialize the task on the chosen CPU */
     retval = rt_task_init_cpuid(ostask_array[task_id], wrapper, task_id,
-	 stacksize, prio, uses_fp, 0 /* signal */, rtapi_data->rt_cpu );
+	 stacksize, prio, uses_fp, 0 /* signal */, cpu_id );
     if (retval != 0) {
 	/* couldn't create task, free task data memory */
 	kfree(ostask_array[task_id]);
@@ -1730,6 +1762,7 @@ EXPORT_SYMBOL(rtapi_snprintf);
 EXPORT_SYMBOL(rtapi_vsnprintf);
 EXPORT_SYMBOL(rtapi_print);
 EXPORT_SYMBOL(rtapi_print_msg);
+EXPORT_SYMBOL(rtapi_log_msg);
 EXPORT_SYMBOL(rtapi_set_msg_level);
 EXPORT_SYMBOL(rtapi_get_msg_level);
 EXPORT_SYMBOL(rtapi_set_msg_handler);
@@ -1744,6 +1777,7 @@ EXPORT_SYMBOL(rtapi_prio_lowest);
 EXPORT_SYMBOL(rtapi_prio_next_higher);
 EXPORT_SYMBOL(rtapi_prio_next_lower);
 EXPORT_SYMBOL(rtapi_task_new);
+EXPORT_SYMBOL(rtapi_task_new_cpu);
 EXPORT_SYMBOL(rtapi_task_delete);
 EXPORT_SYMBOL(rtapi_task_start);
 EXPORT_SYMBOL(rtapi_wait);
@@ -203,6 +203,57 @@ RTAPI_BEGIN_DECLS
     extern rtapi_msg_handler_t rtapi_get_msg_handler(void);
 #endif
 
+/** 'rtapi_log()' is rtapi_print_msg() for realtime functions.  The
+    first message from a call site copies its format string into the
+    RTAPI message ring; after that a message costs a slot claim and a
+    copy of its arguments, and never blocks.  The text is formatted
+    later, in user space, by 'halcmd log', or else by 'halcmd log
+    syslog', which linuxcnc and halrun start to pass the messages on
+    to syslog.  Messages above the RTAPI message level are dropped
+    right away, as by rtapi_print_msg().  Each call site passes at
+    most 10 messages per second, the ones dropped are counted in the
+    next message that passes.  Formats with more than 6 conversions,
+    '*' widths or long doubles, and messages from user space, are
+    printed by rtapi_print_msg() instead.  %s arguments are copied,
+    at most 63 characters per message in all.  May be called from
+    user, init/cleanup, and realtime code.
+*/
+    typedef struct {
+	const char *fmt;	/* format string */
+	int level;		/* message level */
+	int id;			/* slot in the site table, -1 until used */
+	long long window;	/* start of the rate limit window */
+	int count;		/* messages in this window */
+	unsigned int suppressed;	/* dropped by the rate limit */
+    } rtapi_log_site_t;
+
+    extern void rtapi_log_msg(rtapi_log_site_t *site, ...);
+
+#define rtapi_log(level, fmt, args...) do { \
+	static rtapi_log_site_t rtapi_log_site = { fmt, level, -1, 0, 0, 0 }; \
+	rtapi_log_msg(&rtapi_log_site, ## args); \
+    } while (0)
+
+#ifdef ULAPI
+/** 'rtapi_log_read()' takes the oldest message out of the RTAPI
+    message ring and formats it into 'buf', as one line.  Its level
+    and rtapi_get_time() are stored in 'level' and 'time'.  Returns
+    the length of the line, 0 if the ring is empty, -EBUSY if another
+    process is reading the ring, or -EINVAL if there is no ring.
+    Call only from user processes.
+*/
+    extern int rtapi_log_read(char *buf, unsigned long size, int *level,
+	long long *time);
+
+/** 'rtapi_log_drain()' is rtapi_log_read() for a reader that runs
+    all the time, like 'halcmd log syslog'.  It also returns 0 while
+    another process read the ring within the last second, so that
+    'halcmd log' shows every message while somebody watches.
+*/
+    extern int rtapi_log_drain(char *buf, unsigned long size, int *level,
+	long long *time);
+#endif
+
 /***********************************************************************
 *                  LIGHTWEIGHT MUTEX FUNCTIONS                         *
 ************************************************************************/
@@ -426,6 +477,17 @@ RTAPI_BEGIN_DECLS
     extern int rtapi_task_new(void (*taskcode) (void *), void *arg,
 	int prio, int owner, unsigned long int stacksize, int uses_fp);
 
+/** 'rtapi_task_new_cpu()' is rtapi_task_new() for a task that must run
+    on CPU 'cpu_id' instead of the one RTAPI reserves for realtime
+    tasks.  A 'cpu_id' of -1 is that CPU.  Returns -EINVAL if the CPU
+    is not online, and -ENOSYS if tasks can't be placed at all (the
+    simulator runs all tasks in one process).  Call only from within
+    init/cleanup code, not from realtime tasks.
+*/
+    extern int rtapi_task_new_cpu(void (*taskcode) (void *), void *arg,
+	int prio, int owner, unsigned long int stacksize, int uses_fp,
+	int cpu_id);
+
 /** 'rtapi_task_delete()' deletes a task.  'task_id' is a task ID
     from a previous call to rtapi_task_new().  It frees memory
     associated with 'task', and does any other cleanup needed.  If
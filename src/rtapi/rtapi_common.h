@@ -72,6 +72,7 @@
 #endif
 
 #include "rtapi_bitops.h"
+#include "rtapi_log.h"
 
 /* maximum number of various resources */
 #define RTAPI_MAX_MODULES 64
@@ -89,7 +90,7 @@
    against the code in the shared memory area.  If they don't match,
    the rtapi_init() call will faill.
 */
-static unsigned int rev_code = 1;  // increment this whenever you change the data structures
+static unsigned int rev_code = 3;  // increment this whenever you change the data structures
 
 /* These structs hold data associated with objects like tasks, etc. */
 
@@ -186,6 +187,7 @@ typedef struct {
     sem_data sem_array[RTAPI_MAX_SEMS + 1];	/* data for semaphores */
     fifo_data fifo_array[RTAPI_MAX_FIFOS + 1];	/* data for fifos */
     irq_data irq_array[RTAPI_MAX_IRQS + 1];	/* data for hooked irqs */
+    log_data log_ring;		/* rtapi_log() messages */
 } rtapi_data_t;
 
 #define RTAPI_KEY   0x90280A48	/* key used to open RTAPI shared memory */
@@ -275,6 +277,9 @@ static void init_rtapi_data(rtapi_data_t * data)
 	data->irq_array[n].owner = 0;
 	data->irq_array[n].handler = NULL;
     }
+    data->log_ring.magic = 0;
+    data->log_ring.mutex = 0;
+    init_log_data(&(data->log_ring));
     /* done, release the mutex */
     rtapi_mutex_give(&(data->mutex));
     return;
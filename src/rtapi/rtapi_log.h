@@ -0,0 +1,470 @@
+#ifndef RTAPI_LOG_H
+#define RTAPI_LOG_H
+
+/********************************************************************
+* Description:  rtapi_log.h
+*               The RTAPI message ring.  rtapi_log() call sites
+*               store their format string in a shared table once,
+*               after that a message is a slot claim and a copy of
+*               its arguments.  The text is formatted later, by a
+*               user space reader: 'halcmd log' when somebody
+*               watches, else 'halcmd log syslog', which the start
+*               scripts run to forward the messages to syslog.
+*
+*               Like rtapi_common.h this is INTERNAL to the RTAPI
+*               implementation and contains code as well as data,
+*               so it must be included by only one file per module.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+#define RTAPI_LOG_RECORDS 256	/* ring size, must be a power of two */
+#define RTAPI_LOG_SITES 128	/* distinct call sites */
+#define RTAPI_LOG_FMTLEN 256	/* longest format string, with the NUL */
+#define RTAPI_LOG_ARGS 6	/* most conversions per format */
+#define RTAPI_LOG_STRLEN 64	/* room for %s arguments, per message */
+#define RTAPI_LOG_TRIES 8	/* lost slot races before a message is dropped */
+#define RTAPI_LOG_BURST 10	/* messages per call site per window */
+#define RTAPI_LOG_WINDOW 1000000000LL	/* rate limit window, in nS */
+#define RTAPI_LOG_WATCHED 1000000000LL	/* drain stays away this long after
+					   a read by 'halcmd log', in nS */
+#define RTAPI_LOG_MAGIC 0x4c4f4752
+
+/* argument classes, from the conversions in the format string */
+typedef enum {
+    LOG_ARG_INT = 1,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STR,
+    LOG_ARG_PTR
+} log_arg_type;
+
+typedef struct {
+    volatile int ready;		/* set once the slot is filled in */
+    int nargs;			/* number of conversions */
+    unsigned char type[RTAPI_LOG_ARGS];	/* their classes */
+    char fmt[RTAPI_LOG_FMTLEN];	/* copy of the format string */
+} log_site_data;
+
+typedef struct {
+    volatile unsigned long seq;	/* slot state, see log_put() */
+    int site;			/* index into the site table */
+    int level;			/* message level */
+    unsigned int suppressed;	/* dropped by the rate limit before this */
+    long long time;		/* rtapi_get_time() when logged */
+    unsigned long long arg[RTAPI_LOG_ARGS];	/* the arguments, or offsets
+						   into str for %s */
+    char str[RTAPI_LOG_STRLEN];	/* copies of the %s arguments */
+} log_record_data;
+
+typedef struct {
+    int magic;			/* set once the ring is initialized */
+    unsigned long mutex;	/* init, and one reader at a time */
+    volatile unsigned long head;	/* next slot to claim */
+    unsigned long tail;		/* next slot to read */
+    volatile unsigned long lost;	/* messages dropped, ring full */
+    unsigned long lost_seen;	/* lost count already reported */
+    volatile long long watched;	/* reader clock of the last read that
+				   wasn't a drain */
+    volatile int site_count;	/* site slots claimed */
+    log_site_data site_array[RTAPI_LOG_SITES];
+    log_record_data rec_array[RTAPI_LOG_RECORDS];
+} log_data;
+
+#define log_barrier() __sync_synchronize()
+
+static void init_log_data(log_data * log)
+{
+    int n;
+
+    if (log->magic == RTAPI_LOG_MAGIC) {
+	return;
+    }
+    rtapi_mutex_get(&(log->mutex));
+    if (log->magic != RTAPI_LOG_MAGIC) {
+	log->head = 0;
+	log->tail = 0;
+	log->lost = 0;
+	log->lost_seen = 0;
+	log->watched = 0;
+	log->site_count = 0;
+	for (n = 0; n < RTAPI_LOG_SITES; n++) {
+	    log->site_array[n].ready = 0;
+	}
+	/* a slot is free for the writer at position 'pos' when its seq
+	   equals pos, and holds a message for the reader when it equals
+	   pos + 1 */
+	for (n = 0; n < RTAPI_LOG_RECORDS; n++) {
+	    log->rec_array[n].seq = n;
+	}
+	log_barrier();
+	log->magic = RTAPI_LOG_MAGIC;
+    }
+    rtapi_mutex_give(&(log->mutex));
+}
+
+/* the writer side is inline, user processes print directly and don't
+   need it */
+
+/* classifies the conversions in 'fmt', returns how many there are, or
+   -1 if the format can't be logged ('*', 'L', too many, too long) */
+static __inline__ int log_parse_format(const char *fmt, unsigned char *type)
+{
+    const char *p;
+    int n, longs;
+
+    n = 0;
+    for (p = fmt; *p != '\0'; p++) {
+	if (p - fmt >= RTAPI_LOG_FMTLEN - 1) {
+	    return -1;
+	}
+	if (*p != '%') {
+	    continue;
+	}
+	p++;
+	if (*p == '%') {
+	    continue;
+	}
+	while ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' ||
+	    *p == ' ' || *p == '#' || *p == '.') {
+	    p++;
+	}
+	longs = 0;
+	while (*p == 'l') {
+	    longs++;
+	    p++;
+	}
+	while (*p == 'h') {
+	    p++;
+	}
+	if (n == RTAPI_LOG_ARGS) {
+	    return -1;
+	}
+	switch (*p) {
+	case 'd':
+	case 'i':
+	case 'u':
+	case 'x':
+	case 'X':
+	case 'o':
+	case 'c':
+	    type[n++] = longs == 0 ? LOG_ARG_INT :
+		longs == 1 ? LOG_ARG_LONG : LOG_ARG_LLONG;
+	    break;
+	case 'f':
+	case 'e':
+	case 'E':
+	case 'g':
+	case 'G':
+	    type[n++] = LOG_ARG_DOUBLE;
+	    break;
+	case 's':
+	    type[n++] = LOG_ARG_STR;
+	    break;
+	case 'p':
+	    type[n++] = LOG_ARG_PTR;
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    return n;
+}
+
+/* finds or adds the site table slot for a call site.  Returns 0 if
+   messages from the site can go in the ring, -1 if they must be
+   printed directly.  The answer is cached in the call site. */
+static __inline__ int log_site_ready(log_data * log, rtapi_log_site_t * site)
+{
+    unsigned char type[RTAPI_LOG_ARGS];
+    log_site_data *sd;
+    int n, nargs, count;
+    const char *s, *t;
+
+    if (site->id >= 0) {
+	return 0;
+    }
+    if (site->id == -2 || log == NULL || log->magic != RTAPI_LOG_MAGIC) {
+	return -1;
+    }
+    nargs = log_parse_format(site->fmt, type);
+    if (nargs < 0) {
+	site->id = -2;
+	return -1;
+    }
+    /* the same format from another module, or a reloaded one */
+    count = log->site_count;
+    if (count > RTAPI_LOG_SITES) {
+	count = RTAPI_LOG_SITES;
+    }
+    for (n = 0; n < count; n++) {
+	sd = &(log->site_array[n]);
+	if (!sd->ready) {
+	    continue;
+	}
+	for (s = sd->fmt, t = site->fmt; *s == *t && *s != '\0'; s++, t++) {
+	}
+	if (*s == *t) {
+	    site->id = n;
+	    return 0;
+	}
+    }
+    n = __sync_fetch_and_add(&(log->site_count), 1);
+    if (n >= RTAPI_LOG_SITES) {
+	site->id = -2;
+	return -1;
+    }
+    sd = &(log->site_array[n]);
+    for (count = 0; site->fmt[count] != '\0'; count++) {
+	sd->fmt[count] = site->fmt[count];
+    }
+    sd->fmt[count] = '\0';
+    for (count = 0; count < nargs; count++) {
+	sd->type[count] = type[count];
+    }
+    sd->nargs = nargs;
+    log_barrier();
+    sd->ready = 1;
+    site->id = n;
+    return 0;
+}
+
+/* puts one message from a ready call site in the ring.  Several
+   writers may race for the head, none of them ever waits: a writer
+   that loses the race RTAPI_LOG_TRIES times, or finds the ring full,
+   drops the message and counts it as lost. */
+static __inline__ void log_put(log_data * log, rtapi_log_site_t * site,
+    long long now, va_list ap)
+{
+    log_site_data *sd;
+    log_record_data *rec;
+    unsigned long pos;
+    long dif;
+    int n, tries, len;
+    const char *str;
+    union {
+	double d;
+	unsigned long long u;
+    } f;
+
+    /* rate limit; the counts live in the caller's memory, if two
+       threads share a call site a race here only miscounts */
+    if (now - site->window >= RTAPI_LOG_WINDOW) {
+	site->window = now;
+	site->count = 0;
+    }
+    if (site->count >= RTAPI_LOG_BURST) {
+	site->suppressed++;
+	return;
+    }
+    site->count++;
+    tries = 0;
+    while (1) {
+	pos = log->head;
+	rec = &(log->rec_array[pos & (RTAPI_LOG_RECORDS - 1)]);
+	dif = (long) (rec->seq - pos);
+	if (dif == 0) {
+	    if (__sync_bool_compare_and_swap(&(log->head), pos, pos + 1)) {
+		break;
+	    }
+	} else if (dif < 0) {
+	    /* the reader hasn't freed this slot yet */
+	    __sync_fetch_and_add(&(log->lost), 1);
+	    return;
+	}
+	if (++tries == RTAPI_LOG_TRIES) {
+	    __sync_fetch_and_add(&(log->lost), 1);
+	    return;
+	}
+    }
+    sd = &(log->site_array[site->id]);
+    rec->site = site->id;
+    rec->level = site->level;
+    rec->suppressed = site->suppressed;
+    site->suppressed = 0;
+    rec->time = now;
+    rec->str[RTAPI_LOG_STRLEN - 1] = '\0';
+    len = 0;
+    for (n = 0; n < sd->nargs; n++) {
+	switch (sd->type[n]) {
+	case LOG_ARG_INT:
+	    rec->arg[n] = va_arg(ap, int);
+	    break;
+	case LOG_ARG_LONG:
+	    rec->arg[n] = va_arg(ap, long);
+	    break;
+	case LOG_ARG_LLONG:
+	    rec->arg[n] = va_arg(ap, long long);
+	    break;
+	case LOG_ARG_DOUBLE:
+	    f.d = va_arg(ap, double);
+	    rec->arg[n] = f.u;
+	    break;
+	case LOG_ARG_PTR:
+	    rec->arg[n] = (unsigned long) va_arg(ap, void *);
+	    break;
+	default:
+	    /* truncated to what is left of str, the last byte stays NUL */
+	    str = va_arg(ap, const char *);
+	    rec->arg[n] = len;
+	    while (str != NULL && *str != '\0' && len < RTAPI_LOG_STRLEN - 1) {
+		rec->str[len++] = *str++;
+	    }
+	    if (len < RTAPI_LOG_STRLEN - 1) {
+		rec->str[len++] = '\0';
+	    }
+	    break;
+	}
+    }
+    log_barrier();
+    rec->seq = pos + 1;
+}
+
+#ifdef ULAPI
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* readers compare their own stamps only, any steady clock will do */
+static long long log_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* formats one record, as one line */
+static int log_format(log_data * log, log_record_data * rec, char *buf,
+    unsigned long size)
+{
+    log_site_data *sd;
+    char spec[32];
+    const char *p, *start;
+    unsigned long len;
+    int n;
+    union {
+	double d;
+	unsigned long long u;
+    } f;
+
+    sd = &(log->site_array[rec->site]);
+    len = 0;
+    n = 0;
+    for (p = sd->fmt; *p != '\0' && len < size - 1; p++) {
+	if (*p != '%') {
+	    buf[len++] = *p;
+	    continue;
+	}
+	if (p[1] == '%') {
+	    buf[len++] = '%';
+	    p++;
+	    continue;
+	}
+	start = p;
+	do {
+	    p++;
+	} while (*p != '\0' && strchr("diuxXocfeEgGsp", *p) == NULL);
+	if (*p == '\0' || n == sd->nargs ||
+	    (unsigned long) (p - start) >= sizeof(spec) - 1) {
+	    break;
+	}
+	memcpy(spec, start, p - start + 1);
+	spec[p - start + 1] = '\0';
+	switch (sd->type[n]) {
+	case LOG_ARG_INT:
+	    snprintf(buf + len, size - len, spec, (int) rec->arg[n]);
+	    break;
+	case LOG_ARG_LONG:
+	    snprintf(buf + len, size - len, spec, (long) rec->arg[n]);
+	    break;
+	case LOG_ARG_LLONG:
+	    snprintf(buf + len, size - len, spec, (long long) rec->arg[n]);
+	    break;
+	case LOG_ARG_DOUBLE:
+	    f.u = rec->arg[n];
+	    snprintf(buf + len, size - len, spec, f.d);
+	    break;
+	case LOG_ARG_PTR:
+	    snprintf(buf + len, size - len, spec,
+		(void *) (unsigned long) rec->arg[n]);
+	    break;
+	default:
+	    snprintf(buf + len, size - len, spec,
+		rec->str + (rec->arg[n] % RTAPI_LOG_STRLEN));
+	    break;
+	}
+	n++;
+	len += strlen(buf + len);
+    }
+    buf[len] = '\0';
+    while (len > 0 && buf[len - 1] == '\n') {
+	buf[--len] = '\0';
+    }
+    if (rec->suppressed != 0) {
+	snprintf(buf + len, size - len, " (%u suppressed)",
+	    rec->suppressed);
+	len += strlen(buf + len);
+    }
+    snprintf(buf + len, size - len, "\n");
+    return len + strlen(buf + len);
+}
+
+/* takes the oldest message out of the ring and formats it.  Returns
+   its length, 0 if the ring is empty, -EBUSY if another reader has
+   the ring.  A 'drain' read also returns 0 while somebody else read
+   the ring within RTAPI_LOG_WATCHED, so that the one watching gets
+   every message. */
+static int log_get(log_data * log, char *buf, unsigned long size,
+    int *level, long long *time, int drain)
+{
+    log_record_data *rec;
+    unsigned long pos, lost;
+    long long now;
+    int len;
+
+    if (size < 2) {
+	return -EINVAL;
+    }
+    now = log_clock();
+    if (!drain) {
+	log->watched = now;
+    } else if (log->watched != 0 && now - log->watched < RTAPI_LOG_WATCHED) {
+	return 0;
+    }
+    if (rtapi_mutex_try(&(log->mutex)) != 0) {
+	return -EBUSY;
+    }
+    lost = log->lost;
+    if (lost != log->lost_seen) {
+	len = snprintf(buf, size, "RTAPI: %lu messages lost, ring full\n",
+	    lost - log->lost_seen);
+	log->lost_seen = lost;
+	*level = RTAPI_MSG_WARN;
+	*time = 0;
+	rtapi_mutex_give(&(log->mutex));
+	return len < (int) size ? len : (int) size - 1;
+    }
+    pos = log->tail;
+    rec = &(log->rec_array[pos & (RTAPI_LOG_RECORDS - 1)]);
+    if (rec->seq != pos + 1) {
+	rtapi_mutex_give(&(log->mutex));
+	return 0;
+    }
+    log_barrier();
+    len = log_format(log, rec, buf, size);
+    *level = rec->level;
+    *time = rec->time;
+    log_barrier();
+    rec->seq = pos + RTAPI_LOG_RECORDS;
+    log->tail = pos + 1;
+    rtapi_mutex_give(&(log->mutex));
+    return len;
+}
+
+#endif /* ULAPI */
+
+#endif /* RTAPI_LOG_H */
@@ -528,6 +528,25 @@ void rtapi_print_msg(int level, const char *fmt, ...)
     //}
 }
 
+void rtapi_log_msg(rtapi_log_site_t *site, ...)
+{
+    char buffer[BUFFERLEN];
+    va_list args;
+
+    /* filtered here, like the simulator does, the reader can't */
+    if ((site->level > msg_level) || (msg_level == RTAPI_MSG_NONE)) {
+	return;
+    }
+    va_start(args, site);
+    if (log_site_ready(&(rtapi_data->log_ring), site) == 0) {
+	log_put(&(rtapi_data->log_ring), site, rtapi_get_time(), args);
+    } else {
+	vsn_printf(buffer, BUFFERLEN, site->fmt, args);
+	rtapi_msg_handler(site->level, buffer);
+    }
+    va_end(args);
+}
+
 int rtapi_set_msg_level(int level)
 {
     if ((level < RTAPI_MSG_NONE) || (level > RTAPI_MSG_ALL)) {
@@ -688,6 +707,14 @@ static void *wrapper(void *wrapper_arg)
 
 int rtapi_task_new(void (*taskcode) (void *), void *arg,
     int prio, int owner, unsigned long int stacksize, int uses_fp)
+{
+    return rtapi_task_new_cpu(taskcode, arg, prio, owner, stacksize,
+	uses_fp, -1);
+}
+
+int rtapi_task_new_cpu(void (*taskcode) (void *), void *arg,
+    int prio, int owner, unsigned long int stacksize, int uses_fp,
+    int cpu_id)
 {
     int n;
     int task_id;
@@ -725,6 +752,13 @@ int rtapi_task_new(void (*taskcode) (void *), void *arg,
 	rtapi_mutex_give(&(rtapi_data->mutex));
 	return -EINVAL;
     }
+    /* check requested CPU, default is the one reserved for RT */
+    if (cpu_id < 0) {
+	cpu_id = rtapi_data->rt_cpu;
+    } else if (cpu_id >= NR_CPUS) {
+	rtapi_mutex_give(&(rtapi_data->mutex));
+	return -EINVAL;
+    }
     /* set up task attributes */
     retval = pthread_attr_init(&attr);
     if (retval != 0) {
@@ -736,8 +770,8 @@ int rtapi_task_new(void (*taskcode) (void *), void *arg,
     if (retval != 0) {
 	return -EINVAL;
     }
-    /* use pre-determined CPU for RT tasks */
-    pthread_attr_setcpu_np(&attr, rtapi_data->rt_cpu);
+    /* run on the chosen CPU */
+    pthread_attr_setcpu_np(&attr, cpu_id);
     pthread_attr_setfp_np(&attr, uses_fp);
     task->taskcode = taskcode;
     task->arg = arg;
@@ -1736,6 +1770,7 @@ unsigned char rtapi_inb(unsigned int port)
 EXPORT_SYMBOL(rtapi_init);
 EXPORT_SYMBOL(rtapi_exit);
 EXPORT_SYMBOL(rtapi_task_new);
+EXPORT_SYMBOL(rtapi_task_new_cpu);
 EXPORT_SYMBOL(rtapi_prio_next_lower);
 EXPORT_SYMBOL(rtapi_prio_highest);
 EXPORT_SYMBOL(rtapi_vsnprintf);
@@ -1743,6 +1778,7 @@ EXPORT_SYMBOL(rtapi_wait);
 EXPORT_SYMBOL(rtapi_task_pause);
 EXPORT_SYMBOL(rtapi_clock_set_period);
 EXPORT_SYMBOL(rtapi_print_msg);
+EXPORT_SYMBOL(rtapi_log_msg);
 EXPORT_SYMBOL(rtapi_shmem_getptr);
 EXPORT_SYMBOL(rtapi_get_clocks);
 EXPORT_SYMBOL(rtapi_shmem_delete);
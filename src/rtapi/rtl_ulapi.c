@@ -265,6 +265,38 @@ void rtapi_print_msg(int level, const char *fmt, ...)
     }
 }
 
+/* user processes aren't realtime, they print directly */
+void rtapi_log_msg(rtapi_log_site_t *site, ...)
+{
+    char buffer[BUFFERLEN + 1];
+    va_list args;
+
+    if ((site->level <= msg_level) && (msg_level != RTAPI_MSG_NONE)) {
+	va_start(args, site);
+	vsnprintf(buffer, BUFFERLEN, site->fmt, args);
+	fputs(buffer, PRINT_DEST);
+	va_end(args);
+    }
+}
+
+int rtapi_log_read(char *buf, unsigned long size, int *level,
+    long long *time)
+{
+    if (rtapi_data == NULL) {
+	return -EINVAL;
+    }
+    return log_get(&(rtapi_data->log_ring), buf, size, level, time, 0);
+}
+
+int rtapi_log_drain(char *buf, unsigned long size, int *level,
+    long long *time)
+{
+    if (rtapi_data == NULL) {
+	return -EINVAL;
+    }
+    return log_get(&(rtapi_data->log_ring), buf, size, level, time, 1);
+}
+
 int rtapi_set_msg_level(int level)
 {
     if ((level < RTAPI_MSG_NONE) || (level > RTAPI_MSG_ALL)) {
@@ -19,6 +19,9 @@
 
 static int msg_level = RTAPI_MSG_ERR;	/* message printing level */
 
+#include "rtapi_log.h"
+static log_data *log_ring = 0;	/* rtapi_log() messages */
+
 #include <sys/ipc.h>		/* IPC_* */
 #include <sys/shm.h>		/* shmget() */
 /* These structs hold data associated with objects like tasks, etc. */
@@ -180,6 +183,46 @@ void rtapi_print_msg(int level, const char *fmt, ...)
     }
 }
 
+void rtapi_log_msg(rtapi_log_site_t *site, ...)
+{
+    va_list args;
+
+    if ((site->level > msg_level) || (msg_level == RTAPI_MSG_NONE)) {
+	return;
+    }
+    va_start(args, site);
+#ifdef RTAPI
+    if (log_site_ready(log_ring, site) == 0) {
+	log_put(log_ring, site, rtapi_get_time(), args);
+	va_end(args);
+	return;
+    }
+#endif
+    /* user processes aren't realtime, they print directly */
+    rtapi_msg_handler(site->level, site->fmt, args);
+    va_end(args);
+}
+
+#ifdef ULAPI
+int rtapi_log_read(char *buf, unsigned long size, int *level,
+    long long *time)
+{
+    if (log_ring == 0) {
+	return -EINVAL;
+    }
+    return log_get(log_ring, buf, size, level, time, 0);
+}
+
+int rtapi_log_drain(char *buf, unsigned long size, int *level,
+    long long *time)
+{
+    if (log_ring == 0) {
+	return -EINVAL;
+    }
+    return log_get(log_ring, buf, size, level, time, 1);
+}
+#endif
+
 int rtapi_snprintf(char *buffer, unsigned long int size, const char *msg, ...) {
     va_list args;
     int result;
@@ -235,6 +278,7 @@ typedef struct {
 } uuid_data_t;
 
 #define UUID_KEY  0x48484c34 /* key for UUID for simulator */
+#define RTAPI_LOG_KEY 0x48484c35 /* key for the message ring */
 
 int rtapi_init(const char *modname)
 {
@@ -269,6 +313,18 @@ int rtapi_init(const char *modname)
         id = uuid_data->uuid;
     rtapi_mutex_give(&uuid_data->mutex);
 
+    if (log_ring == 0) {
+        /* without it rtapi_log() prints directly, like rtapi_print_msg() */
+        retval = rtapi_shmem_new(RTAPI_LOG_KEY, uuid_id, sizeof(log_data));
+        if (retval >= 0 && rtapi_shmem_getptr(retval, &uuid_mem) >= 0) {
+            log_ring = (log_data *) uuid_mem;
+            init_log_data(log_ring);
+        } else {
+            rtapi_print_msg(RTAPI_MSG_WARN,
+            "rtapi_init: no shared memory for the message ring\n");
+        }
+    }
+
     return id;
 }
 
@@ -146,6 +146,15 @@ int rtapi_task_new(void (*taskcode) (void*), void *arg,
   return n;
 }
 
+int rtapi_task_new_cpu(void (*taskcode) (void*), void *arg,
+    int prio, int owner, unsigned long int stacksize, int uses_fp,
+    int cpu_id) {
+  /* all tasks share the one process, they can't be placed */
+  if (cpu_id >= 0)
+    return -ENOSYS;
+  return rtapi_task_new(taskcode, arg, prio, owner, stacksize, uses_fp);
+}
+
 
 int rtapi_task_delete(int id) {
   struct rtapi_task *task;
@@ -258,6 +267,34 @@ int rtapi_task_resume(int task_id)
 }
 
 
+/* all tasks take turns in one process, there is nobody to block on
+   a semaphore for */
+int rtapi_sem_new(int key, int module_id)
+{
+  return -ENOSYS;
+}
+
+int rtapi_sem_delete(int sem_id, int module_id)
+{
+  return -EINVAL;
+}
+
+int rtapi_sem_give(int sem_id)
+{
+  return -EINVAL;
+}
+
+int rtapi_sem_take(int sem_id)
+{
+  return -EINVAL;
+}
+
+int rtapi_sem_try(int sem_id)
+{
+  return -EINVAL;
+}
+
+
 int rtapi_task_set_period(int task_id,
 			  unsigned long int period_nsec)
 {
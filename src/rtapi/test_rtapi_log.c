@@ -0,0 +1,179 @@
+/********************************************************************
+* Description:  test_rtapi_log.c
+*               Checks the RTAPI message ring: formatting in the
+*               reader, the per call site rate limit, and that
+*               racing writers neither tear nor lose messages
+*               without counting them.
+*
+* License: LGPL Version 2
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "rtapi.h"
+#include "rtapi_log.h"
+#include "tests/unittest.h"
+
+#define WRITERS 4
+#define MESSAGES 20000
+
+static log_data *ring;
+static volatile int finished;
+
+/* what the RTAPI implementations do, with the time passed in */
+static int log_msg(rtapi_log_site_t * site, long long now, ...)
+{
+    va_list args;
+
+    if (log_site_ready(ring, site) != 0) {
+	return -1;
+    }
+    va_start(args, now);
+    log_put(ring, site, now, args);
+    va_end(args);
+    return 0;
+}
+
+static int read_one(char *buf, int *level)
+{
+    long long time;
+
+    return log_get(ring, buf, 256, level, &time, 0);
+}
+
+static void *writer(void *arg)
+{
+    rtapi_log_site_t site = { "writer %d message %d check %d\n",
+	RTAPI_MSG_ERR, -1, 0, 0, 0 };
+    volatile int spin;
+    int id, n;
+
+    id = (long) arg;
+    for (n = 0; n < MESSAGES; n++) {
+	/* a new rate limit window for every message */
+	log_msg(&site, n * RTAPI_LOG_WINDOW, id, n, id * MESSAGES + n);
+	/* the rest of the realtime function */
+	for (spin = 0; spin < 20000; spin++) {
+	}
+    }
+    __sync_fetch_and_add(&finished, 1);
+    return NULL;
+}
+
+int main(void)
+{
+    rtapi_log_site_t types = { "%d %lx %lld %.3f|%5s|%c 100%%\n",
+	RTAPI_MSG_WARN, -1, 0, 0, 0 };
+    rtapi_log_site_t same = { "%d %lx %lld %.3f|%5s|%c 100%%\n",
+	RTAPI_MSG_WARN, -1, 0, 0, 0 };
+    rtapi_log_site_t strs = { "%s|%s|%u %p\n", RTAPI_MSG_ERR, -1, 0, 0, 0 };
+    rtapi_log_site_t burst = { "burst %d", RTAPI_MSG_INFO, -1, 0, 0, 0 };
+    rtapi_log_site_t star = { "%*d\n", RTAPI_MSG_ERR, -1, 0, 0, 0 };
+    rtapi_log_site_t many = { "%d %d %d %d %d %d %d\n", RTAPI_MSG_ERR,
+	-1, 0, 0, 0 };
+    char buf[256], longstr[100];
+    long long time;
+    int n, level, id, msg, check, got[WRITERS], read, torn;
+    pthread_t tid[WRITERS];
+
+    ring = calloc(1, sizeof(log_data));
+    if (ring == NULL) {
+	return 1;
+    }
+    init_log_data(ring);
+    CHECK(read_one(buf, &level) == 0);
+
+    /* each conversion is formatted from its own copy of the argument */
+    CHECK(log_msg(&types, 0, -5, 0xbeefL, 1LL << 40, 2.5, "cd", 'x') == 0);
+    CHECK(read_one(buf, &level) > 0);
+    CHECK(level == RTAPI_MSG_WARN);
+    CHECK(strcmp(buf, "-5 beef 1099511627776 2.500|   cd|x 100%\n") == 0);
+    /* the same format elsewhere shares the site slot */
+    CHECK(log_msg(&same, 0, 1, 2L, 3LL, 4.0, "e", 'f') == 0);
+    CHECK(same.id == types.id);
+    CHECK(read_one(buf, &level) > 0);
+    CHECK(strcmp(buf, "1 2 3 4.000|    e|f 100%\n") == 0);
+    /* %s arguments are cut to what fits in the record */
+    memset(longstr, 'z', sizeof(longstr) - 1);
+    longstr[sizeof(longstr) - 1] = '\0';
+    CHECK(log_msg(&strs, 0, longstr, "lost", 7u, (void *) 0) == 0);
+    CHECK(read_one(buf, &level) > 0);
+    CHECK(strlen(buf) == RTAPI_LOG_STRLEN - 1 + strlen("||7 (nil)\n"));
+    CHECK(strstr(buf, "zzz||7 (nil)\n") != NULL);
+    /* formats the ring can't hold are left to the caller */
+    CHECK(log_msg(&star, 0, 3, 1) == -1);
+    CHECK(log_msg(&many, 0, 1, 2, 3, 4, 5, 6, 7) == -1);
+    CHECK(star.id == -2 && many.id == -2);
+
+    /* rate limit: a burst, then the rest of the window is counted */
+    for (n = 0; n < 25; n++) {
+	log_msg(&burst, 1000 + n, n);
+    }
+    log_msg(&burst, 1000 + RTAPI_LOG_WINDOW, 25);
+    for (n = 0; read_one(buf, &level) > 0; n++) {
+	if (n < RTAPI_LOG_BURST) {
+	    CHECK(strchr(buf, '(') == NULL);
+	}
+    }
+    CHECK(n == RTAPI_LOG_BURST + 1);
+    CHECK(strcmp(buf, "burst 25 (15 suppressed)\n") == 0);
+
+    /* the drain leaves messages to whoever read the ring lately */
+    CHECK(log_msg(&burst, 5 * RTAPI_LOG_WINDOW, 26) == 0);
+    CHECK(log_get(ring, buf, sizeof(buf), &level, &time, 1) == 0);
+    time = log_clock() - RTAPI_LOG_WATCHED;
+    ring->watched = time;
+    CHECK(log_get(ring, buf, sizeof(buf), &level, &time, 1) > 0);
+    CHECK(strcmp(buf, "burst 26\n") == 0);
+    /* and doesn't count as watching itself */
+    CHECK(ring->watched < log_clock() - RTAPI_LOG_WATCHED + 1000000000LL / 2);
+
+    /* racing writers: every message is read whole, or counted lost */
+    for (n = 0; n < WRITERS; n++) {
+	got[n] = -1;
+	pthread_create(&tid[n], NULL, writer, (void *) (long) n);
+    }
+    read = 0;
+    torn = 0;
+    while (1) {
+	/* check before reading, a message may land in between */
+	n = finished;
+	if (read_one(buf, &level) == 0) {
+	    if (n == WRITERS) {
+		break;
+	    }
+	    continue;
+	}
+	if (strncmp(buf, "RTAPI: ", 7) == 0) {
+	    continue;
+	}
+	if (sscanf(buf, "writer %d message %d check %d", &id, &msg, &check)
+	    != 3 || id < 0 || id >= WRITERS || check != id * MESSAGES + msg ||
+	    msg <= got[id]) {
+	    torn++;
+	    continue;
+	}
+	got[id] = msg;
+	read++;
+    }
+    for (n = 0; n < WRITERS; n++) {
+	pthread_join(tid[n], NULL);
+    }
+    /* the last lost count comes out as a line of its own */
+    while (read_one(buf, &level) > 0) {
+    }
+    CHECK(torn == 0);
+    CHECK(read + ring->lost == WRITERS * MESSAGES);
+    CHECK(ring->lost_seen == ring->lost);
+
+    printf("%d writers, %d messages: %d read, %lu lost, %d torn, %s\n",
+	WRITERS, WRITERS * MESSAGES, read, ring->lost, torn,
+	CHECK_RESULT);
+    free(ring);
+    return CHECK_EXIT;
+}
@@ -0,0 +1,33 @@
+/********************************************************************
+* Description:  unittest.h
+*               What the standalone unit test programs share: CHECK(),
+*               which reports and counts failed conditions, and the
+*               word that ends their summary line, which is what
+*               tests/unit/shared-checkresult looks for.
+*
+*               Each program is a single source file plus the code
+*               under test, so the counter is defined here.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+
+#ifndef UNITTEST_H
+#define UNITTEST_H
+
+#include <stdio.h>
+
+static int check_fails;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+	fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+	check_fails++; \
+    } \
+} while (0)
+
+/* last word of the summary line, and the exit status of main() */
+#define CHECK_RESULT (check_fails ? "FAILED" : "ok")
+#define CHECK_EXIT (check_fails ? 1 : 0)
+
+#endif /* UNITTEST_H */
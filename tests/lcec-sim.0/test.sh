@@ -0,0 +1,27 @@
+#!/bin/sh
+realtime start
+halcmd loadusr -W lcec_conf ethercat-conf.xml
+halcmd loadrt lcec sim_wc_errors=50
+halcmd loadrt threads name1=servo period1=1000000
+halcmd addf lcec.read-all servo
+halcmd addf lcec.write-all servo
+
+# read back the startup sdo through the runtime channel
+halcmd setp lcec.0.enc.sdo-0-index 0x8000
+halcmd setp lcec.0.enc.sdo-0-subindex 1
+halcmd setp lcec.0.enc.sdo-0-size 2
+halcmd start
+sleep 1
+halcmd setp lcec.0.enc.sdo-0-trigger 1
+sleep 1
+halcmd stop
+
+for pin in lcec.slaves-responding lcec.state-op lcec.0.din.slave-oper \
+    lcec.0.enc.slave-oper lcec.0.domain-wc-expected lcec.0.enc.sdo-0-value \
+    lcec.0.enc.sdo-0-error; do
+    echo "$pin $(halcmd getp $pin)"
+done
+echo "wc-errors $(halcmd getp lcec.0.domain-wc-errors)"
+
+halcmd unload all
+realtime stop
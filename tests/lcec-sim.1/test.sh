@@ -0,0 +1,41 @@
+#!/bin/bash
+TYPES=(EL1002 EL2002 EL3102 EL4102)
+SAMPLES=20
+
+write_conf() {
+    echo '<masters>'
+    echo '  <master idx="0" appTimePeriod="1000000" refClockSyncCycles="1000">'
+    for ((i = 0; i < $1; i++)); do
+        echo "    <slave idx=\"$i\" type=\"${TYPES[$((i % ${#TYPES[@]}))]}\"/>"
+    done
+    echo '  </master>'
+    echo '</masters>'
+}
+
+# average of the funct runtime over some samples, plus its maximum
+measure() {
+    for ((i = 0; i < $SAMPLES; i++)); do
+        halcmd getp $1.time
+        sleep 0.05
+    done | awk -v max=$(halcmd getp $1.tmax) -v n=$2 \
+        '{ sum += $1 } END { avg = sum / NR; printf "%d clk (%d clk/slave, max %d)", avg, avg / n, max }'
+}
+
+realtime start
+for slaves in 10 100 500; do
+    write_conf $slaves > bench-conf.xml
+    if halcmd loadusr -W lcec_conf bench-conf.xml && halcmd loadrt lcec; then
+        halcmd loadrt threads name1=servo period1=1000000
+        halcmd addf lcec.read-all servo
+        halcmd addf lcec.write-all servo
+        halcmd start
+        sleep 1
+        echo "slaves $slaves: read-all $(measure lcec.read-all $slaves), write-all $(measure lcec.write-all $slaves)"
+        halcmd stop
+    else
+        echo "slaves $slaves: load failed"
+    fi
+    halcmd unload all
+done
+realtime stop
+rm -f bench-conf.xml
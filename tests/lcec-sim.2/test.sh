@@ -0,0 +1,20 @@
+#!/bin/sh
+realtime start
+halcmd loadusr -W lcec_conf ethercat-conf.xml
+halcmd loadrt lcec
+halcmd loadrt threads name1=servo period1=1000000
+halcmd addf lcec.read-all servo
+halcmd addf lcec.write-all servo
+halcmd setp lcec.0.drv.srv-pos-scale 1000
+halcmd start
+sleep 1
+halcmd stop
+
+for pin in lcec.0.drv.slave-oper lcec.0.domain-wc-expected \
+    lcec.0.drv.srv-controlword lcec.0.drv.srv-mode-fb \
+    lcec.0.drv.srv-enabled lcec.0.drv.srv-pos-fb; do
+    echo "$pin $(halcmd getp $pin)"
+done
+
+halcmd unload all
+realtime stop
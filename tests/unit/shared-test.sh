@@ -0,0 +1,3 @@
+#!/bin/sh
+# each directory here is named after the unit test program it runs
+exec ${PWD##*/}
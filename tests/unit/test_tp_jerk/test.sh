@@ -0,0 +1 @@
+../shared-test.sh
\ No newline at end of file